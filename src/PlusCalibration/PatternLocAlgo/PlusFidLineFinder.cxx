@@ -8,8 +8,10 @@ See License.txt for details.
 #include "PlusFidLineFinder.h"
 #include "igsioMath.h"
 #include "PlusFidSegmentation.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkMath.h"
 #include <algorithm>
+#include <unordered_set>
 
 #include "vnl/vnl_vector.h"
 #include "vnl/vnl_matrix.h"
@@ -17,6 +19,23 @@ See License.txt for details.
 #include "vnl/algo/vnl_qr.h"
 #include "vnl/algo/vnl_svd.h"
 
+namespace
+{
+  /*! Hash of the sorted dot indices of a line, for detecting lines that are already found */
+  struct LinePointIndicesHash
+  {
+    size_t operator()(const std::vector<int>& pointIndices) const
+    {
+      size_t hash = pointIndices.size();
+      for (std::vector<int>::const_iterator pointIt = pointIndices.begin(); pointIt != pointIndices.end(); ++pointIt)
+      {
+        hash ^= std::hash<int>()(*pointIt) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      }
+      return hash;
+    }
+  };
+}
+
 //-----------------------------------------------------------------------------
 
 PlusFidLineFinder::PlusFidLineFinder()
@@ -42,6 +61,14 @@ PlusFidLineFinder::PlusFidLineFinder()
 
   m_MinThetaRad = -1.0;
   m_MaxThetaRad = -1.0;
+
+  m_DotGridOrigin[0] = 0;
+  m_DotGridOrigin[1] = 0;
+  m_DotGridCellSizePx = 1.0;
+  m_DotGridSize[0] = 0;
+  m_DotGridSize[1] = 0;
+
+  m_LastFindLinesTimeSec = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -440,6 +467,8 @@ void PlusFidLineFinder::FindLines2Points()
   }
 
   std::vector<PlusFidLine> twoPointsLinesVector;
+  // Lines that are already in twoPointsLinesVector, the key is made of the two (sorted) dot indices
+  std::unordered_set<unsigned long long> twoPointsLineKeys;
 
   for (unsigned int i = 0 ; i < m_Patterns.size() ; i++)
   {
@@ -450,6 +479,13 @@ void PlusFidLineFinder::FindLines2Points()
     {
       for (unsigned int dot2Index = dot1Index + 1; dot2Index < m_DotsVector.size(); dot2Index++)
       {
+        unsigned long long lineKey = (static_cast<unsigned long long>(dot1Index) << 32) | dot2Index;
+        if (twoPointsLineKeys.find(lineKey) != twoPointsLineKeys.end())
+        {
+          // already found for a previous pattern
+          continue;
+        }
+
         double length = SegmentLength(m_DotsVector[dot1Index], m_DotsVector[dot2Index]);
         bool acceptLength = fabs(length - lineLenPx) < floor(m_Patterns[i]->GetDistanceToOriginToleranceMm()[m_Patterns[i]->GetWires().size() - 1] / m_ApproximateSpacingMmPerPixel + 0.5);
 
@@ -463,22 +499,19 @@ void PlusFidLineFinder::FindLines2Points()
             PlusFidLine twoPointsLine;
             twoPointsLine.AddPoint(dot1Index);
             twoPointsLine.AddPoint(dot2Index);
+            twoPointsLine.SetStartPointIndex(dot1Index);
+            ComputeLine(twoPointsLine);
 
-            bool duplicate = std::binary_search(twoPointsLinesVector.begin(), twoPointsLinesVector.end(), twoPointsLine, PlusFidLine::compareLines);
-
-            if (!duplicate)
-            {
-              twoPointsLine.SetStartPointIndex(dot1Index);
-              ComputeLine(twoPointsLine);
-
-              twoPointsLinesVector.push_back(twoPointsLine);
-              std::sort(twoPointsLinesVector.begin(), twoPointsLinesVector.end(), PlusFidLine::compareLines);   //the lines need to be sorted that way each time for the binary search to be performed
-            }
+            twoPointsLineKeys.insert(lineKey);
+            twoPointsLinesVector.push_back(twoPointsLine);
           }
         }
       }
     }
   }
+  // Lines of different patterns are found out of order. Order them by dot indices, as the intensity sort is not stable
+  // and the order of lines with equal intensity depends on the input order.
+  std::sort(twoPointsLinesVector.begin(), twoPointsLinesVector.end(), PlusFidLine::compareLines);
   std::sort(twoPointsLinesVector.begin(), twoPointsLinesVector.end(), PlusFidLine::lessThan);   //sort the lines by intensity finally
 
   m_LinesVector.push_back(twoPointsLinesVector);
@@ -506,6 +539,12 @@ void PlusFidLineFinder::FindLinesNPoints()
     }
   }
 
+  // Lines that are already found, for each number of points. The key is the sorted list of dot indices of the line.
+  std::vector< std::unordered_set<std::vector<int>, LinePointIndicesHash> > nPointsLineKeys(maxNumberOfPointsPerLine + 1);
+
+  BuildDotGrid(dist);
+  std::vector<int> nearDotIndices;
+
   for (unsigned int i = 0 ; i < m_Patterns.size() ; i++)
   {
     for (unsigned int linesVectorIndex = 3 ; linesVectorIndex <= maxNumberOfPointsPerLine ; linesVectorIndex++)
@@ -515,13 +554,22 @@ void PlusFidLineFinder::FindLinesNPoints()
         continue;
       }
 
+      int lineLenPx = floor(m_Patterns[i]->GetDistanceToOriginMm()[linesVectorIndex - 2] / m_ApproximateSpacingMmPerPixel + 0.5);
+      int lineLenTolerancePx = floor(m_Patterns[i]->GetDistanceToOriginToleranceMm()[linesVectorIndex - 2] / m_ApproximateSpacingMmPerPixel + 0.5);
+      bool linesAdded = false;
+
       for (unsigned int l = 0; l < m_LinesVector[linesVectorIndex - 1].size(); l++)
       {
         PlusFidLine currentShorterPointsLine;
         currentShorterPointsLine = m_LinesVector[linesVectorIndex - 1][l]; //the current max point line we want to expand
 
-        for (unsigned int b3 = 0; b3 < m_DotsVector.size(); b3++)
+        // Only the dots close to the line can be added to the line
+        GetDotsNearLine(m_DotsVector[currentShorterPointsLine.GetStartPointIndex()], m_DotsVector[currentShorterPointsLine.GetEndPointIndex()],
+                        lineLenPx + lineLenTolerancePx, dist, nearDotIndices);
+
+        for (std::vector<int>::iterator nearDotIt = nearDotIndices.begin(); nearDotIt != nearDotIndices.end(); ++nearDotIt)
         {
+          int b3 = *nearDotIt;
           std::vector<int> candidatesIndex;
           bool checkDuplicateFlag = false;//assume there is no duplicate
 
@@ -558,8 +606,7 @@ void PlusFidLineFinder::FindLinesNPoints()
 
             double length = SegmentLength(m_DotsVector[currentShorterPointsLine.GetStartPointIndex()], m_DotsVector[b3]);   //distance between the origin and the point we try to add
 
-            int lineLenPx = floor(m_Patterns[i]->GetDistanceToOriginMm()[linesVectorIndex - 2] / m_ApproximateSpacingMmPerPixel + 0.5);
-            bool acceptLength = fabs(length - lineLenPx) < floor(m_Patterns[i]->GetDistanceToOriginToleranceMm()[linesVectorIndex - 2] / m_ApproximateSpacingMmPerPixel + 0.5);
+            bool acceptLength = fabs(length - lineLenPx) < lineLenTolerancePx;
 
             if (!acceptLength)
             {
@@ -585,25 +632,31 @@ void PlusFidLineFinder::FindLinesNPoints()
               continue;
             }
 
-            if (m_LinesVector.size() <= linesVectorIndex)  //in case the maxpoint lines has not found any yet (the binary search works on empty vector, not on NULL one obviously)
+            if (m_LinesVector.size() <= linesVectorIndex)  //in case the maxpoint lines has not found any yet
             {
               std::vector<PlusFidLine> emptyLine;
               m_LinesVector.push_back(emptyLine);
             }
 
-            if (!std::binary_search(m_LinesVector[linesVectorIndex].begin(), m_LinesVector[linesVectorIndex].end(), line, PlusFidLine::compareLines))
+            if (nPointsLineKeys[linesVectorIndex].find(candidatesIndex) == nPointsLineKeys[linesVectorIndex].end())
             {
               ComputeLine(line);
               if (AcceptLine(line))
               {
+                nPointsLineKeys[linesVectorIndex].insert(candidatesIndex);
                 m_LinesVector[linesVectorIndex].push_back(line);
-                // sort the lines so that lines that are already in the list can be quickly found by a binary search
-                std::sort(m_LinesVector[linesVectorIndex].begin(), m_LinesVector[linesVectorIndex].end(), PlusFidLine::compareLines);
+                linesAdded = true;
               }
             }
           }
         }
       }
+
+      if (linesAdded)
+      {
+        // sort the lines by dot indices, the longer lines are searched in this order
+        std::sort(m_LinesVector[linesVectorIndex].begin(), m_LinesVector[linesVectorIndex].end(), PlusFidLine::compareLines);
+      }
     }
   }
   if (m_LinesVector[m_LinesVector.size() - 1].empty())
@@ -614,6 +667,118 @@ void PlusFidLineFinder::FindLinesNPoints()
 
 //-----------------------------------------------------------------------------
 
+void PlusFidLineFinder::BuildDotGrid(double minimumCellSizePx)
+{
+  for (std::vector< std::vector<int> >::iterator cellIt = m_DotGridCells.begin(); cellIt != m_DotGridCells.end(); ++cellIt)
+  {
+    cellIt->clear();
+  }
+  if (m_DotsVector.empty())
+  {
+    m_DotGridSize[0] = 0;
+    m_DotGridSize[1] = 0;
+    return;
+  }
+
+  double bounds[4] = { m_DotsVector[0].GetX(), m_DotsVector[0].GetX(), m_DotsVector[0].GetY(), m_DotsVector[0].GetY() };
+  for (std::vector<PlusFidDot>::iterator dotIt = m_DotsVector.begin(); dotIt != m_DotsVector.end(); ++dotIt)
+  {
+    bounds[0] = std::min(bounds[0], dotIt->GetX());
+    bounds[1] = std::max(bounds[1], dotIt->GetX());
+    bounds[2] = std::min(bounds[2], dotIt->GetY());
+    bounds[3] = std::max(bounds[3], dotIt->GetY());
+  }
+
+  // Cells are chosen to contain about one dot on average, but they are not made smaller than the collinearity tolerance
+  double area = std::max(1.0, (bounds[1] - bounds[0]) * (bounds[3] - bounds[2]));
+  m_DotGridCellSizePx = std::max(std::max(minimumCellSizePx, 1.0), sqrt(area / m_DotsVector.size()));
+  m_DotGridOrigin[0] = bounds[0];
+  m_DotGridOrigin[1] = bounds[2];
+  m_DotGridSize[0] = static_cast<int>(floor((bounds[1] - bounds[0]) / m_DotGridCellSizePx)) + 1;
+  m_DotGridSize[1] = static_cast<int>(floor((bounds[3] - bounds[2]) / m_DotGridCellSizePx)) + 1;
+  if (m_DotGridCells.size() < static_cast<size_t>(m_DotGridSize[0]) * m_DotGridSize[1])
+  {
+    m_DotGridCells.resize(static_cast<size_t>(m_DotGridSize[0]) * m_DotGridSize[1]);
+  }
+
+  for (unsigned int dotIndex = 0; dotIndex < m_DotsVector.size(); dotIndex++)
+  {
+    int cellX = std::min(m_DotGridSize[0] - 1, static_cast<int>(floor((m_DotsVector[dotIndex].GetX() - m_DotGridOrigin[0]) / m_DotGridCellSizePx)));
+    int cellY = std::min(m_DotGridSize[1] - 1, static_cast<int>(floor((m_DotsVector[dotIndex].GetY() - m_DotGridOrigin[1]) / m_DotGridCellSizePx)));
+    m_DotGridCells[cellY * m_DotGridSize[0] + cellX].push_back(dotIndex);
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+void PlusFidLineFinder::GetDotsNearLine(const PlusFidDot& startDot, const PlusFidDot& endDot, double maxDistanceFromStart, double maxDistanceFromLine, std::vector<int>& dotIndices)
+{
+  dotIndices.clear();
+
+  double direction[2] = { endDot.GetX() - startDot.GetX(), endDot.GetY() - startDot.GetY() };
+  double directionLength = sqrt(direction[0] * direction[0] + direction[1] * direction[1]);
+  if (directionLength <= 0)
+  {
+    // the line direction is undefined, all the dots are returned
+    for (unsigned int dotIndex = 0; dotIndex < m_DotsVector.size(); dotIndex++)
+    {
+      dotIndices.push_back(dotIndex);
+    }
+    return;
+  }
+  direction[0] /= directionLength;
+  direction[1] /= directionLength;
+
+  // The searched region is a rectangle along the line. The cells are tested with a margin: the dots can be anywhere in the cell
+  // and the distances are computed by the caller at a different (float) precision.
+  const double marginPx = 1.0;
+  const double cellHalfDiagonal = m_DotGridCellSizePx * sqrt(2.0) / 2.0;
+  double maxCellDistanceFromLine = maxDistanceFromLine + cellHalfDiagonal + marginPx;
+  double minCellPositionAlongLine = -cellHalfDiagonal - marginPx;
+  double maxCellPositionAlongLine = maxDistanceFromStart + cellHalfDiagonal + marginPx;
+
+  double endPoint[2] = { startDot.GetX() + direction[0] * maxDistanceFromStart, startDot.GetY() + direction[1] * maxDistanceFromStart };
+  double extent = maxDistanceFromLine + marginPx;
+  int cellRange[4] =
+  {
+    static_cast<int>(floor((std::min(startDot.GetX(), endPoint[0]) - extent - m_DotGridOrigin[0]) / m_DotGridCellSizePx)),
+    static_cast<int>(floor((std::max(startDot.GetX(), endPoint[0]) + extent - m_DotGridOrigin[0]) / m_DotGridCellSizePx)),
+    static_cast<int>(floor((std::min(startDot.GetY(), endPoint[1]) - extent - m_DotGridOrigin[1]) / m_DotGridCellSizePx)),
+    static_cast<int>(floor((std::max(startDot.GetY(), endPoint[1]) + extent - m_DotGridOrigin[1]) / m_DotGridCellSizePx))
+  };
+  cellRange[0] = std::max(cellRange[0], 0);
+  cellRange[1] = std::min(cellRange[1], m_DotGridSize[0] - 1);
+  cellRange[2] = std::max(cellRange[2], 0);
+  cellRange[3] = std::min(cellRange[3], m_DotGridSize[1] - 1);
+
+  for (int cellY = cellRange[2]; cellY <= cellRange[3]; cellY++)
+  {
+    for (int cellX = cellRange[0]; cellX <= cellRange[1]; cellX++)
+    {
+      const std::vector<int>& cell = m_DotGridCells[cellY * m_DotGridSize[0] + cellX];
+      if (cell.empty())
+      {
+        continue;
+      }
+      double startToCellCenter[2] = { m_DotGridOrigin[0] + (cellX + 0.5) * m_DotGridCellSizePx - startDot.GetX(),
+                                      m_DotGridOrigin[1] + (cellY + 0.5) * m_DotGridCellSizePx - startDot.GetY()
+                                    };
+      double positionAlongLine = startToCellCenter[0] * direction[0] + startToCellCenter[1] * direction[1];
+      double distanceFromLine = fabs(startToCellCenter[0] * direction[1] - startToCellCenter[1] * direction[0]);
+      if (distanceFromLine > maxCellDistanceFromLine || positionAlongLine < minCellPositionAlongLine || positionAlongLine > maxCellPositionAlongLine)
+      {
+        continue;
+      }
+      dotIndices.insert(dotIndices.end(), cell.begin(), cell.end());
+    }
+  }
+
+  // return the dots in the same order as they are in the dots vector
+  std::sort(dotIndices.begin(), dotIndices.end());
+}
+
+//-----------------------------------------------------------------------------
+
 void PlusFidLineFinder::Clear()
 {
   //LOG_TRACE("FidLineFinder::Clear");
@@ -676,6 +841,8 @@ void PlusFidLineFinder::FindLines()
 {
   LOG_TRACE("FidLineFinder::FindLines");
 
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+
   // Make pairs of dots into 2-point lines.
   FindLines2Points();
 
@@ -684,6 +851,8 @@ void PlusFidLineFinder::FindLines()
 
   // Sort by intensity.
   std::sort(m_LinesVector[m_LinesVector.size() - 1].begin(), m_LinesVector[m_LinesVector.size() - 1].end(), PlusFidLine::lessThan);
+
+  m_LastFindLinesTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
 }
 
 //----------------------------------------------------------------------------
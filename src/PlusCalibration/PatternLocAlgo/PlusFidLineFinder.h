@@ -56,6 +56,9 @@ public:
   /*! Find lines, runs the FindLines2Points and FindLinesNPoints and then sort the lines by intensity */
   void FindLines();
 
+  /*! Get the computation time of the last FindLines call, in seconds */
+  double GetLastFindLinesTimeSec() const { return m_LastFindLinesTimeSec; };
+
   /*! Get the vector of lines, this vector contains all lines of different number of points that match the criteria */
   std::vector<std::vector<PlusFidLine>>& GetLinesVector();
 
@@ -106,6 +109,14 @@ protected:
   /*! Return true if an angle is in the allowed angle range, false otherwise */
   bool AcceptAngleRad(double angleRad);
 
+  /*! Sort the dots into the cells of a uniform grid, which allows quick search for dots around a line */
+  void BuildDotGrid(double minimumCellSizePx);
+
+  /*! Get the indices of the dots that may be closer than maxDistanceFromLine to the line that starts at startDot and points
+  towards endDot, and closer than maxDistanceFromStart to startDot. The result may contain farther dots, too,
+  but it contains all the dots that are within both distances. The indices are returned in ascending order. */
+  void GetDotsNearLine(const PlusFidDot& startDot, const PlusFidDot& endDot, double maxDistanceFromStart, double maxDistanceFromLine, std::vector<int>& dotIndices);
+
   //Accessors and mutators
 
   /*! Get the maximum rotation vector, this maximum rotation represents the physical limitation of the probe,
@@ -134,6 +145,14 @@ protected:
   std::vector< std::vector<PlusFidLine> > m_LinesVector;
 
   std::vector<PlusFidPattern*> m_Patterns;
+
+  /*! Uniform grid of the dots, each cell contains the indices of the dots in ascending order. Set up by BuildDotGrid. */
+  std::vector< std::vector<int> > m_DotGridCells;
+  double m_DotGridOrigin[2];
+  double m_DotGridCellSizePx;
+  int m_DotGridSize[2];
+
+  double m_LastFindLinesTimeSec;
 };
 
 #endif // _FIDUCIAL_LINE_FINDER_H
@@ -12,6 +12,7 @@ See License.txt for details.
 
 #include "vtkIGSIOTrackedFrameList.h"
 #include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
 
 static const double DOT_STEPS  = 4.0;
 static const double DOT_RADIUS = 6.0;
@@ -19,6 +20,8 @@ static const double DOT_RADIUS = 6.0;
 //-----------------------------------------------------------------------------
 
 PlusFidPatternRecognition::PlusFidPatternRecognition()
+  : m_LastSegmentationTimeSec(0)
+  , m_LastLabelingTimeSec(0)
 {
 
 }
@@ -84,6 +87,8 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
   m_FidSegmentation.Clear();
   m_FidLineFinder.Clear();
   m_FidLabeling.Clear();
+  m_LastSegmentationTimeSec = 0;
+  m_LastLabelingTimeSec = 0;
 
   m_FidSegmentation.SetFrameSize(trackedFrame->GetFrameSize());
   m_FidLineFinder.SetFrameSize(trackedFrame->GetFrameSize());
@@ -103,6 +108,7 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
   memcpy(m_FidSegmentation.GetUnalteredImage(), image, bytes);
 
   //Start of the segmentation
+  double segmentationStartTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
   m_FidSegmentation.MorphologicalOperations();
   m_FidSegmentation.Suppress(m_FidSegmentation.GetWorking(), m_FidSegmentation.GetThresholdImagePercent() / 100.00);
   bool tooManyCandidates = false;
@@ -119,6 +125,7 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
   //End of the segmentation
 
   m_FidSegmentation.SetCandidateFidValues(m_FidSegmentation.GetDotsVector());
+  m_LastSegmentationTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - segmentationStartTimeSec;
 
   m_FidLineFinder.SetCandidateFidValues(m_FidSegmentation.GetCandidateFidValues());
   m_FidLineFinder.SetDotsVector(m_FidSegmentation.GetDotsVector());
@@ -128,8 +135,10 @@ PlusStatus PlusFidPatternRecognition::RecognizePattern(igsioTrackedFrame* tracke
 
   if (m_FidLineFinder.GetLinesVector().size() > 3)
   {
+    double labelingStartTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
     m_FidLabeling.SetLinesVector(m_FidLineFinder.GetLinesVector());
     m_FidLabeling.FindPattern();
+    m_LastLabelingTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - labelingStartTimeSec;
   }
 
   if (m_FidSegmentation.GetDebugOutput())
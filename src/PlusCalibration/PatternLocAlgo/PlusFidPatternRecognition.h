@@ -83,6 +83,15 @@ public:
   /*! Get the FidLabeling element, his element finds the pattern from the detected n-points lines */
   PlusFidLabeling* GetFidLabeling() { return & m_FidLabeling; };
 
+  /*! Get the computation time of the segmentation in the last RecognizePattern call, in seconds */
+  double GetLastSegmentationTimeSec() const { return m_LastSegmentationTimeSec; };
+
+  /*! Get the computation time of the line finding in the last RecognizePattern call, in seconds */
+  double GetLastLineFindingTimeSec() const { return m_FidLineFinder.GetLastFindLinesTimeSec(); };
+
+  /*! Get the computation time of the labeling in the last RecognizePattern call, in seconds (0 if labeling was skipped) */
+  double GetLastLabelingTimeSec() const { return m_LastLabelingTimeSec; };
+
   /*! Get the pattern structure vector, this defines the patterns that the algorithm finds */
   std::vector<PlusFidPattern*>& GetPatterns() { return m_Patterns; };
 
@@ -103,6 +112,9 @@ protected:
   std::vector<PlusFidPattern*>  m_Patterns;
 
   double                        m_MaxLineLengthToleranceMm;
+
+  double                        m_LastSegmentationTimeSec;
+  double                        m_LastLabelingTimeSec;
 };
 
 //-----------------------------------------------------------------------------
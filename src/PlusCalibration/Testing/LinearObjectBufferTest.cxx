@@ -0,0 +1,249 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file LinearObjectBufferTest.cxx
+\brief This test checks the search structures of the linear object registration. LinearObjectBuffer::GetMatches
+(k-d tree over the candidate signatures) is compared to a search through all candidates on random signatures,
+signatures with many ties, and signatures with mismatched sizes. The sliding window eigenvalues of
+PointObservationBuffer (computed from running sums) are compared to the eigenvalues computed from the covariance
+matrix of each window.
+*/
+
+#include "PlusConfigure.h"
+#include "LinearObjectBuffer.h"
+#include "Point.h"
+#include "PointObservation.h"
+#include "PointObservationBuffer.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+  const double MAX_EIGENVALUE_DIFFERENCE = 1e-8; // mm^2
+
+  //----------------------------------------------------------------------------
+  // The closest candidate as found by the original search: lowest index among the candidates at the smallest distance
+  LinearObject* FindClosestCandidate( const std::vector<double>& signature, LinearObjectBuffer* candidates, double& closestDistance )
+  {
+    LinearObject* closestObject = candidates->GetLinearObject( 0 );
+    closestDistance = LinearObject::Norm( LinearObject::Subtract( signature, closestObject->Signature ) );
+    for ( int j = 0; j < candidates->Size(); j++ )
+    {
+      double distance = LinearObject::Norm( LinearObject::Subtract( signature, candidates->GetLinearObject( j )->Signature ) );
+      if ( distance < closestDistance )
+      {
+        closestObject = candidates->GetLinearObject( j );
+        closestDistance = distance;
+      }
+    }
+    return closestObject;
+  }
+
+  //----------------------------------------------------------------------------
+  // Create a point with a random signature. If numberOfValues is positive then the signature elements are
+  // integers in [0, numberOfValues) to have many objects at the same distance.
+  LinearObject* CreateObject( std::mt19937& generator, unsigned int signatureSize, int numberOfValues )
+  {
+    LinearObject* object = new Point( std::vector<double>( LinearObject::DIMENSION, 0.0 ) );
+    std::uniform_real_distribution<double> continuousDistribution( 0.0, 100.0 );
+    std::uniform_int_distribution<int> discreteDistribution( 0, std::max( numberOfValues - 1, 0 ) );
+    for ( unsigned int i = 0; i < signatureSize; i++ )
+    {
+      object->Signature.push_back( numberOfValues > 0 ? discreteDistribution( generator ) : continuousDistribution( generator ) );
+    }
+    return object;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestGetMatches( const std::string& testName, std::mt19937& generator, int numberOfCandidates, int numberOfObjects,
+                      unsigned int signatureSize, int numberOfValues, double matchingThreshold,
+                      unsigned int mismatchedCandidateStep, unsigned int mismatchedObjectStep )
+  {
+    LinearObjectBuffer candidates;
+    for ( int j = 0; j < numberOfCandidates; j++ )
+    {
+      bool mismatched = ( mismatchedCandidateStep > 0 && j % mismatchedCandidateStep == mismatchedCandidateStep - 1 );
+      candidates.AddLinearObject( CreateObject( generator, mismatched ? signatureSize - 1 : signatureSize, numberOfValues ) );
+    }
+
+    LinearObjectBuffer objects;
+    std::vector<LinearObject*> allObjects;
+    std::vector<LinearObject*> expectedMatches;
+    std::vector<LinearObject*> expectedMatchedObjects;
+    for ( int i = 0; i < numberOfObjects; i++ )
+    {
+      bool mismatched = ( mismatchedObjectStep > 0 && i % mismatchedObjectStep == mismatchedObjectStep - 1 );
+      LinearObject* object = CreateObject( generator, mismatched ? signatureSize + 1 : signatureSize, numberOfValues );
+      objects.AddLinearObject( object );
+      allObjects.push_back( object );
+      double closestDistance = 0;
+      LinearObject* closestCandidate = FindClosestCandidate( object->Signature, &candidates, closestDistance );
+      if ( closestDistance < matchingThreshold )
+      {
+        expectedMatchedObjects.push_back( object );
+        expectedMatches.push_back( closestCandidate );
+      }
+    }
+
+    // The returned buffer contains objects of the candidate buffer, so it must not delete them
+    LinearObjectBuffer* matches = objects.GetMatches( &candidates, matchingThreshold );
+
+    int numberOfFailures = 0;
+    if ( matches->Size() != static_cast<int>( expectedMatches.size() ) || objects.Size() != static_cast<int>( expectedMatchedObjects.size() ) )
+    {
+      LOG_ERROR( testName << ": number of matches mismatch: current=" << matches->Size() << " (" << objects.Size() << " objects kept), expected=" << expectedMatches.size() );
+      numberOfFailures++;
+    }
+    else
+    {
+      for ( int i = 0; i < matches->Size(); i++ )
+      {
+        if ( objects.GetLinearObject( i ) != expectedMatchedObjects[i] || matches->GetLinearObject( i ) != expectedMatches[i] )
+        {
+          LOG_ERROR( testName << ": match #" << i << " differs from the result of the search through all candidates" );
+          numberOfFailures++;
+        }
+      }
+    }
+    LOG_INFO( testName << ": " << matches->Size() << " matches of " << numberOfObjects << " objects checked" );
+
+    // GetMatches removes the unmatched objects from the buffer without deleting them
+    for ( unsigned int i = 0; i < allObjects.size(); i++ )
+    {
+      if ( std::find( expectedMatchedObjects.begin(), expectedMatchedObjects.end(), allObjects[i] ) == expectedMatchedObjects.end() )
+      {
+        delete allObjects[i];
+      }
+    }
+    return numberOfFailures;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWindowEigenvalues( std::mt19937& generator, int numberOfObservations, unsigned int windowSize )
+  {
+    // Random walk far from the origin, with straight line and stationary sections to have small eigenvalues as well
+    PointObservationBuffer observations;
+    std::normal_distribution<double> stepDistribution( 0.0, 1.0 );
+    std::vector<double> position( PointObservation::SIZE, 0.0 );
+    position[0] = 200.0;
+    position[1] = -300.0;
+    position[2] = 150.0;
+    std::vector<double> direction( PointObservation::SIZE, 0.0 );
+    for ( int i = 0; i < numberOfObservations; i++ )
+    {
+      int section = ( i / 60 ) % 3;
+      if ( i % 60 == 0 )
+      {
+        for ( int d = 0; d < PointObservation::SIZE; d++ )
+        {
+          direction[d] = stepDistribution( generator );
+        }
+      }
+      for ( int d = 0; d < PointObservation::SIZE; d++ )
+      {
+        if ( section == 0 )
+        {
+          position[d] += stepDistribution( generator );
+        }
+        else if ( section == 1 )
+        {
+          position[d] += direction[d] + 1e-3 * stepDistribution( generator );
+        }
+        else
+        {
+          position[d] += 1e-4 * stepDistribution( generator );
+        }
+      }
+      observations.AddObservation( new PointObservation( position ) );
+    }
+
+    std::vector< std::vector<double> > windowEigenvalues = observations.CalculateWindowEigenvalues( windowSize );
+    if ( windowEigenvalues.size() != observations.Size() - windowSize )
+    {
+      LOG_ERROR( "Number of windows mismatch: current=" << windowEigenvalues.size() << ", expected=" << observations.Size() - windowSize );
+      return 1;
+    }
+
+    int numberOfFailures = 0;
+    double maxDifference = 0;
+    for ( unsigned int i = 0; i < windowEigenvalues.size(); i++ )
+    {
+      PointObservationBuffer window;
+      for ( unsigned int j = i; j < i + windowSize; j++ )
+      {
+        window.AddObservation( new PointObservation( observations.GetObservation( j )->Observation ) );
+      }
+      std::vector<double> eigenvalues = window.CalculateEigenvalues();
+      for ( int d = 0; d < PointObservation::SIZE; d++ )
+      {
+        double difference = fabs( windowEigenvalues[i][d] - eigenvalues[d] );
+        maxDifference = std::max( maxDifference, difference );
+        if ( difference > MAX_EIGENVALUE_DIFFERENCE )
+        {
+          LOG_ERROR( "Eigenvalue #" << d << " mismatch in window #" << i << ": running sums=" << windowEigenvalues[i][d] << ", covariance matrix=" << eigenvalues[d] );
+          numberOfFailures++;
+        }
+      }
+    }
+    LOG_INFO( "Window eigenvalues: " << windowEigenvalues.size() << " windows checked, maximum difference: " << maxDifference << " mm^2" );
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+  bool printHelp = false;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize( argc, argv );
+
+  args.AddArgument( "--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help." );
+  args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
+
+  if ( !args.Parse() )
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit( EXIT_FAILURE );
+  }
+
+  if ( printHelp )
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit( EXIT_SUCCESS );
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel( verboseLevel );
+
+  std::mt19937 generator( 1 );
+  int numberOfFailures = 0;
+
+  // Signatures are distances from 4 references
+  numberOfFailures += TestGetMatches( "Random signatures", generator, 500, 200, 4, 0, 1e10, 0, 0 );
+  numberOfFailures += TestGetMatches( "Random signatures with threshold", generator, 500, 200, 4, 0, 10.0, 0, 0 );
+  numberOfFailures += TestGetMatches( "Ties", generator, 300, 200, 4, 3, 1e10, 0, 0 );
+  numberOfFailures += TestGetMatches( "Ties with threshold", generator, 300, 200, 2, 4, 1.0, 0, 0 );
+  numberOfFailures += TestGetMatches( "Mismatched candidate signature sizes", generator, 300, 100, 4, 3, 1e10, 7, 0 );
+  numberOfFailures += TestGetMatches( "Mismatched object signature sizes", generator, 300, 100, 4, 0, 1e10, 0, 5 );
+  numberOfFailures += TestGetMatches( "Single candidate", generator, 1, 20, 4, 0, 1e10, 0, 0 );
+
+  // Same window size as in ExtractLinearObjects
+  numberOfFailures += TestWindowEigenvalues( generator, 1000, 21 );
+
+  if ( numberOfFailures > 0 )
+  {
+    LOG_ERROR( "Number of failures: " << numberOfFailures << ". Test failed!" );
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO( "Test completed successfully" );
+  return EXIT_SUCCESS;
+}
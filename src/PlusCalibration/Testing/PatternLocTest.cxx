@@ -9,12 +9,14 @@ See License.txt for details.
 #include "PlusFidPatternRecognition.h"
 #include "PlusPatternLocResultFile.h"
 #include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkXMLDataElement.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -36,6 +38,13 @@ void SegmentImageSequence(vtkIGSIOTrackedFrameList* trackedFrameList, std::ofstr
   double sumFiducialNum = 0;// divide by framenum
   double sumFiducialCandidate = 0;// divide by framenum
 
+  // Computation time statistics
+  double sumPatternRecognitionTimeSec = 0;
+  double maxPatternRecognitionTimeSec = 0;
+  double sumLineFindingTimeSec = 0;
+  double maxLineFindingTimeSec = 0;
+  int numberOfTimedFrames = 0;
+
   bool writeFidPositionsToFile = (fidPositionOutputFilename != NULL);
   std::ofstream outFileFidPositions;
   if (writeFidPositionsToFile)
@@ -63,7 +72,15 @@ void SegmentImageSequence(vtkIGSIOTrackedFrameList* trackedFrameList, std::ofstr
       LOG_ERROR("UsFidSegTest only supports 8-bit images");
       continue;
     }
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
     patternRecognition.RecognizePattern(trackedFrameList->GetTrackedFrame(currentFrameIndex), segResults, error, currentFrameIndex);
+    double patternRecognitionTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+    double lineFindingTimeSec = patternRecognition.GetFidLineFinder()->GetLastFindLinesTimeSec();
+    sumPatternRecognitionTimeSec += patternRecognitionTimeSec;
+    maxPatternRecognitionTimeSec = std::max(maxPatternRecognitionTimeSec, patternRecognitionTimeSec);
+    sumLineFindingTimeSec += lineFindingTimeSec;
+    maxLineFindingTimeSec = std::max(maxLineFindingTimeSec, lineFindingTimeSec);
+    numberOfTimedFrames++;
 
     sumFiducialCandidate += segResults.GetNumDots();
     int numFid = 0;
@@ -105,6 +122,14 @@ void SegmentImageSequence(vtkIGSIOTrackedFrameList* trackedFrameList, std::ofstr
   double meanFidCandidate = sumFiducialCandidate / trackedFrameList->GetNumberOfTrackedFrames();
   PlusUsFidSegResultFile::WriteSegmentationResultsStats(outFile,  meanFid, meanFidCandidate);
 
+  if (numberOfTimedFrames > 0)
+  {
+    LOG_INFO("Pattern recognition time of " << numberOfTimedFrames << " frames: mean = " << sumPatternRecognitionTimeSec / numberOfTimedFrames * 1000.0
+             << " ms, max = " << maxPatternRecognitionTimeSec * 1000.0 << " ms");
+    LOG_INFO("Line finding time of " << numberOfTimedFrames << " frames: mean = " << sumLineFindingTimeSec / numberOfTimedFrames * 1000.0
+             << " ms, max = " << maxLineFindingTimeSec * 1000.0 << " ms");
+  }
+
   if (writeFidPositionsToFile)
   {
     outFileFidPositions.close();
@@ -0,0 +1,281 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PatternRecognitionBenchmarkTest.cxx
+  This program runs PlusFidPatternRecognition on all frames of an image sequence and reports the computation time
+  per frame (median and 95th percentile) and the mean number of candidates of each stage of the algorithm
+  (segmentation, line finding, labeling). The results can be written to an XML file. If a baseline file (written
+  by a previous run of this program) is specified then the test fails if the median time of any stage exceeds the
+  baseline by more than the allowed percentage.
+
+  Timing depends on the machine, so the registered tests do not specify a baseline. To check a change for slowdowns:
+  run the test on the unchanged code with --output-xml-file, then run it on the changed code on the same machine with
+  --baseline set to that file. The median times are compared, so use a --max-slowdown-percent that is larger than the
+  run-to-run variation of the machine (run the unchanged code twice against its own baseline to measure it).
+*/
+
+#include "PlusConfigure.h"
+#include "PlusFidPatternRecognition.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  // Stages with shorter baseline median time are not compared, as their timing is dominated by measurement noise
+  const double MIN_COMPARED_BASELINE_TIME_MS = 0.05;
+
+  //----------------------------------------------------------------------------
+  struct StageStatistics
+  {
+    std::string Name;
+    std::vector<double> TimesMs;
+    std::vector<double> CandidateCounts;
+  };
+
+  //----------------------------------------------------------------------------
+  // Nearest-rank percentile of the values, percentile is in the range of 0..100
+  double GetPercentile(std::vector<double> values, double percentile)
+  {
+    if (values.empty())
+    {
+      return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    int rank = static_cast<int>(std::ceil(percentile / 100.0 * values.size())) - 1;
+    rank = std::max(0, std::min(rank, static_cast<int>(values.size()) - 1));
+    return values[rank];
+  }
+
+  //----------------------------------------------------------------------------
+  double GetMean(const std::vector<double>& values)
+  {
+    if (values.empty())
+    {
+      return 0.0;
+    }
+    double sum = 0.0;
+    for (std::vector<double>::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+      sum += *it;
+    }
+    return sum / values.size();
+  }
+
+  //----------------------------------------------------------------------------
+  // Returns the number of stages that are slower than the baseline by more than maxSlowdownPercent
+  int CompareToBaseline(vtkXMLDataElement* resultsElement, const std::string& baselineFileName, double maxSlowdownPercent)
+  {
+    vtkSmartPointer<vtkXMLDataElement> baselineElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(baselineFileName.c_str()));
+    if (baselineElement == NULL)
+    {
+      LOG_ERROR("Unable to read baseline file: " << baselineFileName);
+      return 1;
+    }
+
+    int numberOfFailures = 0;
+    int numberOfBaselineStages = 0;
+    for (int stageIndex = 0; stageIndex < baselineElement->GetNumberOfNestedElements(); ++stageIndex)
+    {
+      vtkXMLDataElement* baselineStageElement = baselineElement->GetNestedElement(stageIndex);
+      if (baselineStageElement->GetName() == NULL || STRCASECMP(baselineStageElement->GetName(), "Stage") != 0 || baselineStageElement->GetAttribute("Name") == NULL)
+      {
+        continue;
+      }
+      ++numberOfBaselineStages;
+      std::string stageName = baselineStageElement->GetAttribute("Name");
+      vtkXMLDataElement* stageElement = resultsElement->FindNestedElementWithNameAndAttribute("Stage", "Name", stageName.c_str());
+      double baselineMedianTimeMs = 0.0;
+      double medianTimeMs = 0.0;
+      if (stageElement == NULL || !baselineStageElement->GetScalarAttribute("MedianTimeMs", baselineMedianTimeMs) || !stageElement->GetScalarAttribute("MedianTimeMs", medianTimeMs))
+      {
+        LOG_ERROR("Median time of stage " << stageName << " is missing from the baseline or the results");
+        ++numberOfFailures;
+        continue;
+      }
+      if (baselineMedianTimeMs < MIN_COMPARED_BASELINE_TIME_MS)
+      {
+        LOG_INFO("Stage " << stageName << ": baseline median time " << baselineMedianTimeMs << " ms is too short to compare");
+        continue;
+      }
+      double slowdownPercent = (medianTimeMs - baselineMedianTimeMs) / baselineMedianTimeMs * 100.0;
+      LOG_INFO("Stage " << stageName << ": median time " << medianTimeMs << " ms, baseline " << baselineMedianTimeMs << " ms (" << slowdownPercent << "% change)");
+      if (slowdownPercent > maxSlowdownPercent)
+      {
+        LOG_ERROR("Stage " << stageName << " is slower than the baseline by " << slowdownPercent << "% (allowed: " << maxSlowdownPercent << "%)");
+        ++numberOfFailures;
+      }
+    }
+    if (numberOfBaselineStages == 0)
+    {
+      LOG_ERROR("Baseline file " << baselineFileName << " does not contain any stage statistics");
+      ++numberOfFailures;
+    }
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  std::string inputTestDataDir;
+  std::string inputImageSequenceFileName;
+  std::string inputConfigFileName;
+  std::string inputBaselineFileName;
+  std::string outputResultsFileName;
+  int numberOfRepetitions(1);
+  double maxSlowdownPercent(50.0);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--test-data-dir", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputTestDataDir, "Test data directory");
+  args.AddArgument("--img-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImageSequenceFileName, "Filename of the input image sequence. Pattern recognition will be performed for all frames of the sequence.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Calibration configuration file name");
+  args.AddArgument("--repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of times all frames of the sequence are processed (Default: 1).");
+  args.AddArgument("--output-xml-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputResultsFileName, "Name of the file that the timing and candidate count statistics of each stage are written to. Can be used as baseline in later runs.");
+  args.AddArgument("--baseline", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of the file storing the baseline statistics (written by --output-xml-file). If not specified then no comparison is performed.");
+  args.AddArgument("--max-slowdown-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxSlowdownPercent, "The test fails if the median time of a stage is larger than the baseline by more than this percentage (Default: 50).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputImageSequenceFileName.empty() || inputConfigFileName.empty())
+  {
+    LOG_ERROR("At least one of the following parameters is missing: --img-seq-file, --config-file");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+
+  PlusFidPatternRecognition patternRecognition;
+  if (patternRecognition.ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read pattern recognition configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+
+  std::string inputImageSequencePath = inputTestDataDir.empty() ? inputImageSequenceFileName : inputTestDataDir + "/" + inputImageSequenceFileName;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputImageSequencePath, trackedFrameList) != PLUS_SUCCESS || trackedFrameList->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("Failed to read sequence metafile: " << inputImageSequencePath);
+    return EXIT_FAILURE;
+  }
+
+  // Candidates: dots found by the segmentation, lines with the maximum number of points found by the line finder,
+  // fiducials labeled by the labeling
+  StageStatistics segmentation = { "Segmentation" };
+  StageStatistics lineFinding = { "LineFinding" };
+  StageStatistics labeling = { "Labeling" };
+  StageStatistics total = { "Total" };
+
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(frameIndex);
+      if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+      {
+        LOG_ERROR("Frame " << frameIndex << ": only 8-bit images are supported");
+        return EXIT_FAILURE;
+      }
+
+      PlusPatternRecognitionResult result;
+      PlusFidPatternRecognition::PatternRecognitionError error;
+      double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+      patternRecognition.RecognizePattern(trackedFrame, result, error, frameIndex);
+      double totalTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+
+      segmentation.TimesMs.push_back(patternRecognition.GetLastSegmentationTimeSec() * 1000.0);
+      segmentation.CandidateCounts.push_back(result.GetCandidateFidValues().size());
+      lineFinding.TimesMs.push_back(patternRecognition.GetLastLineFindingTimeSec() * 1000.0);
+      lineFinding.CandidateCounts.push_back(patternRecognition.GetFidLineFinder()->GetLinesVector().back().size());
+      labeling.TimesMs.push_back(patternRecognition.GetLastLabelingTimeSec() * 1000.0);
+      labeling.CandidateCounts.push_back(result.GetFoundDotsCoordinateValue().size());
+      total.TimesMs.push_back(totalTimeSec * 1000.0);
+      total.CandidateCounts.push_back(result.GetFoundDotsCoordinateValue().size());
+    }
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> resultsElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  resultsElement->SetName("PatternRecognitionBenchmark");
+  resultsElement->SetAttribute("ImageSequence", inputImageSequenceFileName.c_str());
+  resultsElement->SetIntAttribute("NumberOfFrames", static_cast<int>(total.TimesMs.size()));
+
+  StageStatistics* stages[] = { &segmentation, &lineFinding, &labeling, &total };
+  for (unsigned int stageIndex = 0; stageIndex < sizeof(stages) / sizeof(stages[0]); ++stageIndex)
+  {
+    const StageStatistics& stage = *stages[stageIndex];
+    double medianTimeMs = GetPercentile(stage.TimesMs, 50);
+    double percentile95TimeMs = GetPercentile(stage.TimesMs, 95);
+    double meanCandidateCount = GetMean(stage.CandidateCounts);
+    LOG_INFO(stage.Name << " time per frame: median = " << medianTimeMs << " ms, 95th percentile = " << percentile95TimeMs
+             << " ms, mean candidate count = " << meanCandidateCount);
+
+    vtkSmartPointer<vtkXMLDataElement> stageElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    stageElement->SetName("Stage");
+    stageElement->SetAttribute("Name", stage.Name.c_str());
+    stageElement->SetDoubleAttribute("MedianTimeMs", medianTimeMs);
+    stageElement->SetDoubleAttribute("Percentile95TimeMs", percentile95TimeMs);
+    stageElement->SetDoubleAttribute("MeanCandidateCount", meanCandidateCount);
+    resultsElement->AddNestedElement(stageElement);
+  }
+
+  if (!outputResultsFileName.empty())
+  {
+    if (igsioCommon::XML::PrintXML(outputResultsFileName, resultsElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to write results to file: " << outputResultsFileName);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!inputBaselineFileName.empty())
+  {
+    if (CompareToBaseline(resultsElement, inputBaselineFileName, maxSlowdownPercent) > 0)
+    {
+      LOG_ERROR("Pattern recognition is slower than the baseline");
+      return EXIT_FAILURE;
+    }
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
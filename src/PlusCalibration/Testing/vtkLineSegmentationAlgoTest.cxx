@@ -204,6 +204,73 @@ int CompareLineSegmentationResults( const std::vector<vtkPlusLineSegmentationAlg
   return numberOfFailures;
 }
 
+//----------------------------------------------------------------------------
+// Segment the frames with the requested number of threads and compare the result to the single-threaded one.
+// Results must match exactly, as the frames are processed independently and RANSAC is seeded per frame.
+int CompareSingleAndMultiThreadedResults( vtkIGSIOTrackedFrameList* trackedFrameList, const std::vector<int>& clipRectOrigin, const std::vector<int>& clipRectSize,
+    vtkPlusLineSegmentationAlgo* singleThreadedLineSegmenter, int numberOfThreads )
+{
+  vtkSmartPointer<vtkPlusLineSegmentationAlgo> multiThreadedLineSegmenter = vtkSmartPointer<vtkPlusLineSegmentationAlgo>::New();
+  if ( clipRectOrigin.size() == 2 && clipRectSize.size() == 2 )
+  {
+    int origin[2] = {clipRectOrigin[0], clipRectOrigin[1]};
+    int size[2] = {clipRectSize[0], clipRectSize[1]};
+    multiThreadedLineSegmenter->SetClipRectangle( origin, size );
+  }
+  multiThreadedLineSegmenter->SetNumberOfThreads( numberOfThreads );
+  multiThreadedLineSegmenter->SetTrackedFrameList( *trackedFrameList );
+  if ( multiThreadedLineSegmenter->Update() != PLUS_SUCCESS )
+  {
+    LOG_ERROR( "Failed to get line positions from video frames using " << numberOfThreads << " threads" );
+    return 1;
+  }
+
+  unsigned int numberOfFailures = 0;
+
+  std::vector<double> singleThreadedTimestamps;
+  std::vector<double> multiThreadedTimestamps;
+  singleThreadedLineSegmenter->GetDetectedTimestamps( singleThreadedTimestamps );
+  multiThreadedLineSegmenter->GetDetectedTimestamps( multiThreadedTimestamps );
+  std::vector<double> singleThreadedPositions;
+  std::vector<double> multiThreadedPositions;
+  singleThreadedLineSegmenter->GetDetectedPositions( singleThreadedPositions );
+  multiThreadedLineSegmenter->GetDetectedPositions( multiThreadedPositions );
+  if ( singleThreadedTimestamps != multiThreadedTimestamps || singleThreadedPositions != multiThreadedPositions )
+  {
+    LOG_ERROR( "Detected position signal mismatch between 1 and " << numberOfThreads << " threads: "
+               << singleThreadedPositions.size() << " and " << multiThreadedPositions.size() << " samples" );
+    numberOfFailures++;
+  }
+
+  std::vector<vtkPlusLineSegmentationAlgo::LineParameters> singleThreadedLineParameters;
+  std::vector<vtkPlusLineSegmentationAlgo::LineParameters> multiThreadedLineParameters;
+  singleThreadedLineSegmenter->GetDetectedLineParameters( singleThreadedLineParameters );
+  multiThreadedLineSegmenter->GetDetectedLineParameters( multiThreadedLineParameters );
+  if ( singleThreadedLineParameters.size() != multiThreadedLineParameters.size() )
+  {
+    LOG_ERROR( "Number of line parameters mismatch between 1 and " << numberOfThreads << " threads: "
+               << singleThreadedLineParameters.size() << " and " << multiThreadedLineParameters.size() );
+    return numberOfFailures + 1;
+  }
+  for ( unsigned int frameIndex = 0; frameIndex < singleThreadedLineParameters.size(); ++frameIndex )
+  {
+    const vtkPlusLineSegmentationAlgo::LineParameters& singleParam = singleThreadedLineParameters[frameIndex];
+    const vtkPlusLineSegmentationAlgo::LineParameters& multiParam = multiThreadedLineParameters[frameIndex];
+    if ( singleParam.lineDetected != multiParam.lineDetected
+         || ( singleParam.lineDetected
+              && ( singleParam.lineOriginPoint_Image[0] != multiParam.lineOriginPoint_Image[0]
+                   || singleParam.lineOriginPoint_Image[1] != multiParam.lineOriginPoint_Image[1]
+                   || singleParam.lineDirectionVector_Image[0] != multiParam.lineDirectionVector_Image[0]
+                   || singleParam.lineDirectionVector_Image[1] != multiParam.lineDirectionVector_Image[1] ) ) )
+    {
+      LOG_ERROR( "Line parameters mismatch in Frame #" << frameIndex << " between 1 and " << numberOfThreads << " threads" );
+      numberOfFailures++;
+    }
+  }
+
+  return numberOfFailures;
+}
+
 //----------------------------------------------------------------------------
 int main( int argc, char** argv )
 {
@@ -217,6 +284,7 @@ int main( int argc, char** argv )
   std::vector<int> clipRectSize;
   std::string inputBaselineFileName;
   bool saveImages = false;
+  int compareNumberOfThreads = 0;
 
   args.AddArgument( "--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help." );
   args.AddArgument( "--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)" );
@@ -225,6 +293,7 @@ int main( int argc, char** argv )
   args.AddArgument( "--clip-rect-size", vtksys::CommandLineArguments::MULTI_ARGUMENT, &clipRectSize, "Size of the clipping rectangle" );
   args.AddArgument( "--save-images", vtksys::CommandLineArguments::NO_ARGUMENT, &saveImages, "Save images with detected lines overlaid" );
   args.AddArgument( "--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Input xml baseline file name with path" );
+  args.AddArgument( "--compare-number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &compareNumberOfThreads, "If positive, segment the frames with this many threads as well and require exactly the same result as with a single thread" );
 
   if ( !args.Parse() )
   {
@@ -271,6 +340,7 @@ int main( int argc, char** argv )
     lineSegmenter->SetClipRectangle( origin, size );
   }
 
+  lineSegmenter->SetNumberOfThreads( 1 );
   lineSegmenter->SetTrackedFrameList( *trackedFrameList );
   lineSegmenter->SetSaveIntermediateImages( saveImages );
   lineSegmenter->SetIntermediateFilesOutputDirectory( vtkPlusConfig::GetInstance()->GetOutputDirectory() );
@@ -307,6 +377,18 @@ int main( int argc, char** argv )
     }
   }
 
+  // Compare result to the multi-threaded result
+  if ( compareNumberOfThreads > 0 )
+  {
+    LOG_INFO( "Comparing result with " << compareNumberOfThreads << " threads..." );
+    int numberOfFailures = CompareSingleAndMultiThreadedResults( trackedFrameList, clipRectOrigin, clipRectSize, lineSegmenter, compareNumberOfThreads );
+    if ( numberOfFailures > 0 )
+    {
+      LOG_ERROR( "Number of differences compared to the single-threaded result: " << numberOfFailures << ". Test failed!" );
+      exit( EXIT_FAILURE );
+    }
+  }
+
   LOG_INFO( "Test finished successfully!" );
   return EXIT_SUCCESS;
 }
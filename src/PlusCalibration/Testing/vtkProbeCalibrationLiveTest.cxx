@@ -0,0 +1,290 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkProbeCalibrationLiveTest.cxx
+\brief This test adds the frames of a recorded calibration data set one by one to a live probe calibration
+and checks that the finalized live calibration result is the same as the result of the linear least squares calibration
+computed from the whole data set at once, and that it matches the baseline linear least squares calibration result.
+The live 3D reprojection error, which is computed from the normal equations, is checked after each frame against the error
+computed point by point.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusFidPatternRecognition.h"
+#include "igsioMath.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkIGSIOTransformRepository.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusProbeCalibrationAlgo.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+// Probe calibration that can compute the live calibration error point by point, for checking the error computed from the normal equations
+class vtkProbeCalibrationLiveTestAlgo : public vtkPlusProbeCalibrationAlgo
+{
+public:
+  static vtkProbeCalibrationLiveTestAlgo* New();
+  vtkTypeMacro(vtkProbeCalibrationLiveTestAlgo, vtkPlusProbeCalibrationAlgo);
+
+  double ComputeLiveReprojectionError3DRmsPointByPoint(const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix)
+  {
+    std::vector<double> reprojectionErrors;
+    ComputeError3d(reprojectionErrors, CALIBRATION_ALL, imageToProbeTransformMatrix);
+    double reprojectionError3DRms = 0;
+    igsioMath::ComputeRms(reprojectionErrors, reprojectionError3DRms);
+    return reprojectionError3DRms;
+  }
+
+protected:
+  vtkProbeCalibrationLiveTestAlgo() {}
+};
+
+vtkStandardNewMacro(vtkProbeCalibrationLiveTestAlgo);
+
+//----------------------------------------------------------------------------
+// Compare the ImageToProbe matrix to the calibration result stored in a baseline file, return the number of differences
+int CompareCalibrationResultWithBaseline(const std::string& baselineFileName, const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double translationErrorThreshold, double rotationErrorThreshold)
+{
+  vtkSmartPointer<vtkXMLDataElement> baselineRootElem = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(baselineFileName.c_str()));
+  if (baselineRootElem == NULL)
+  {
+    LOG_ERROR("Reading baseline data file failed: " << baselineFileName);
+    return 1;
+  }
+  vtkXMLDataElement* calibrationResultsBaseline = baselineRootElem->FindNestedElementWithName("CalibrationResults");
+  vtkXMLDataElement* transformBaseline = (calibrationResultsBaseline != NULL ? calibrationResultsBaseline->FindNestedElementWithName("Transform") : NULL);
+  double blTransformImageToProbe[16];
+  if (transformBaseline == NULL || !transformBaseline->GetVectorAttribute("Matrix", 16, blTransformImageToProbe))
+  {
+    LOG_ERROR("Reading baseline CalibrationResults/Transform Matrix failed: " << baselineFileName);
+    return 1;
+  }
+
+  vtkSmartPointer<vtkMatrix4x4> baseTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> currentTransMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int i = 0; i < 4; i++)
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      baseTransMatrix->SetElement(i, j, blTransformImageToProbe[4 * i + j]);
+      currentTransMatrix->SetElement(i, j, imageToProbeTransformMatrix(i, j));
+    }
+  }
+
+  int numberOfFailures = 0;
+  double translationError = igsioMath::GetPositionDifference(baseTransMatrix, currentTransMatrix);
+  if (translationError > translationErrorThreshold)
+  {
+    LOG_ERROR("Live calibration ImageToProbe translation difference (compared to baseline) is higher than expected: " << translationError << " mm (threshold: " << translationErrorThreshold << " mm)");
+    numberOfFailures++;
+  }
+  double rotationError = igsioMath::GetOrientationDifference(baseTransMatrix, currentTransMatrix);
+  if (rotationError > rotationErrorThreshold)
+  {
+    LOG_ERROR("Live calibration ImageToProbe rotation difference (compared to baseline) is higher than expected: " << rotationError << " degree (threshold: " << rotationErrorThreshold << " degree)");
+    numberOfFailures++;
+  }
+  return numberOfFailures;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool printHelp(false);
+  std::string inputCalibrationSeqMetafile;
+  std::string inputConfigFileName;
+  std::string inputBaselineFileName;
+  double maxMatrixElementDifference = 1e-6;
+  double maxRmsErrorDifference = 1e-6;
+  double translationErrorThreshold = 0.1;
+  double rotationErrorThreshold = 0.1;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--calibration-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputCalibrationSeqMetafile, "Sequence metafile name of input calibration dataset.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Configuration file name.");
+  args.AddArgument("--baseline-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBaselineFileName, "Name of file storing the baseline linear least squares calibration result of the calibration dataset. Optional.");
+  args.AddArgument("--translation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &translationErrorThreshold, "Translation error threshold in mm. Used for baseline comparison (default: 0.1).");
+  args.AddArgument("--rotation-error-threshold", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &rotationErrorThreshold, "Rotation error threshold in degrees. Used for baseline comparison (default: 0.1).");
+  args.AddArgument("--max-matrix-element-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxMatrixElementDifference, "Maximum allowed difference between the elements of the live and the batch calibration matrix (default: 1e-6).");
+  args.AddArgument("--max-rms-error-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxRmsErrorDifference, "Maximum allowed difference between the live RMS error and the RMS error computed point by point, in mm (default: 1e-6).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputCalibrationSeqMetafile.empty())
+  {
+    LOG_ERROR("The arguments --config-file and --calibration-seq-file are required");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  if (transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read CoordinateDefinitions!");
+    return EXIT_FAILURE;
+  }
+
+  // Load and segment the calibration images
+  PlusFidPatternRecognition patternRecognition;
+  PlusFidPatternRecognition::PatternRecognitionError error;
+  patternRecognition.ReadConfiguration(configRootElement);
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> calibrationTrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputCalibrationSeqMetafile, calibrationTrackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading calibration images from '" << inputCalibrationSeqMetafile << "' failed!");
+    return EXIT_FAILURE;
+  }
+  if (patternRecognition.RecognizePattern(calibrationTrackedFrameList, error) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error occured during segmentation of calibration images!");
+    return EXIT_FAILURE;
+  }
+  const std::vector<PlusNWire>& nWires = patternRecognition.GetFidLineFinder()->GetNWires();
+
+  // Live calibration, frame by frame
+  vtkSmartPointer<vtkProbeCalibrationLiveTestAlgo> liveCalibration = vtkSmartPointer<vtkProbeCalibrationLiveTestAlgo>::New();
+  if (liveCalibration->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read probe calibration configuration!");
+    return EXIT_FAILURE;
+  }
+  if (liveCalibration->StartLiveCalibration(nWires) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start live calibration!");
+    return EXIT_FAILURE;
+  }
+  vnl_matrix_fixed<double, 4, 4> liveImageToProbeTransformMatrix;
+  double liveReprojectionError3DRms = 0;
+  double reprojectionError3DMean = 0;
+  double reprojectionError3DStdDev = 0;
+  double maxFrameAddTimeSec = 0;
+  double totalFrameAddTimeSec = 0;
+  for (unsigned int frameIndex = 0; frameIndex < calibrationTrackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (liveCalibration->AddLiveCalibrationFrame(calibrationTrackedFrameList->GetTrackedFrame(frameIndex), transformRepository) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add frame " << frameIndex << " to the live calibration!");
+      return EXIT_FAILURE;
+    }
+    double frameAddTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+    totalFrameAddTimeSec += frameAddTimeSec;
+    maxFrameAddTimeSec = std::max(maxFrameAddTimeSec, frameAddTimeSec);
+
+    bool resultAvailable = (liveCalibration->GetLiveCalibrationResult(liveImageToProbeTransformMatrix, liveReprojectionError3DRms) == PLUS_SUCCESS);
+    if (resultAvailable != (liveCalibration->GetNumberOfLiveCalibrationFrames() >= 10))
+    {
+      LOG_ERROR("Live calibration result is " << (resultAvailable ? "" : "not ") << "available after " << liveCalibration->GetNumberOfLiveCalibrationFrames() << " frames");
+      return EXIT_FAILURE;
+    }
+    if (!resultAvailable)
+    {
+      continue;
+    }
+    double expectedReprojectionError3DRms = liveCalibration->ComputeLiveReprojectionError3DRmsPointByPoint(liveImageToProbeTransformMatrix);
+    if (fabs(liveReprojectionError3DRms - expectedReprojectionError3DRms) > maxRmsErrorDifference)
+    {
+      LOG_ERROR("Live calibration 3D reprojection error RMS after " << liveCalibration->GetNumberOfLiveCalibrationFrames() << " frames = " << liveReprojectionError3DRms
+                << "mm differs from the RMS computed point by point = " << expectedReprojectionError3DRms << "mm");
+      return EXIT_FAILURE;
+    }
+  }
+  if (liveCalibration->GetLiveCalibrationResult(liveImageToProbeTransformMatrix, liveReprojectionError3DRms) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Live calibration result is not available");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Live calibration result before finalization: 3D reprojection error RMS = " << liveReprojectionError3DRms << "mm");
+
+  // Outliers are rejected and the error is computed once, when all the frames are added
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (liveCalibration->FinalizeLiveCalibration(liveImageToProbeTransformMatrix, reprojectionError3DMean, reprojectionError3DStdDev) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to finalize the live calibration!");
+    return EXIT_FAILURE;
+  }
+  double finalizeTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+  LOG_INFO("Live calibration: " << liveCalibration->GetNumberOfLiveCalibrationFrames() << " frames, 3D reprojection error mean = " << reprojectionError3DMean << "mm, stdev = " << reprojectionError3DStdDev << "mm");
+  LOG_INFO("Frame add time: mean = " << totalFrameAddTimeSec / calibrationTrackedFrameList->GetNumberOfTrackedFrames() * 1000.0 << "ms, max = " << maxFrameAddTimeSec * 1000.0 << "ms, finalize time = " << finalizeTimeSec * 1000.0 << "ms");
+
+  // Calibration from all the frames at once, without optimization
+  vtkSmartPointer<vtkPlusProbeCalibrationAlgo> batchCalibration = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New();
+  if (batchCalibration->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read probe calibration configuration!");
+    return EXIT_FAILURE;
+  }
+  batchCalibration->GetOptimizer()->SetOptimizationMethod(vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_NONE);
+  if (batchCalibration->Calibrate(calibrationTrackedFrameList, calibrationTrackedFrameList, transformRepository, nWires) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Calibration failed!");
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkMatrix4x4> batchImageToProbeTransformMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  batchCalibration->GetImageToProbeTransformMatrix(batchImageToProbeTransformMatrix);
+
+  int numberOfFailures = 0;
+  for (int row = 0; row < 4; ++row)
+  {
+    for (int column = 0; column < 4; ++column)
+    {
+      if (fabs(liveImageToProbeTransformMatrix(row, column) - batchImageToProbeTransformMatrix->GetElement(row, column)) > maxMatrixElementDifference)
+      {
+        LOG_ERROR("Live calibration matrix element (" << row << ", " << column << ") = " << liveImageToProbeTransformMatrix(row, column)
+                  << " differs from the batch calibration result " << batchImageToProbeTransformMatrix->GetElement(row, column));
+        numberOfFailures++;
+      }
+    }
+  }
+
+  // Baseline result of the linear least squares calibration
+  if (!inputBaselineFileName.empty())
+  {
+    numberOfFailures += CompareCalibrationResultWithBaseline(inputBaselineFileName, liveImageToProbeTransformMatrix, translationErrorThreshold, rotationErrorThreshold);
+  }
+
+  if (numberOfFailures > 0)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Test completed successfully" << std::endl;
+  return EXIT_SUCCESS;
+}
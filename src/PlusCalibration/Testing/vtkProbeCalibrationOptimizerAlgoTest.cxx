@@ -0,0 +1,184 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkProbeCalibrationOptimizerAlgoTest.cxx
+\brief This test runs a freehand calibration on a recorded data set with the Powell and the Levenberg-Marquardt
+optimization algorithm and checks that the Levenberg-Marquardt optimization result is at least as good as the Powell
+optimization result. The optimization method (2D or 3D cost function) is defined in the configuration file.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusFidPatternRecognition.h"
+#include "PlusMath.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkIGSIOTransformRepository.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusProbeCalibrationAlgo.h"
+#include "vtkPlusProbeCalibrationOptimizerAlgo.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  PlusStatus RunCalibration(vtkXMLDataElement* configRootElement, vtkPlusProbeCalibrationOptimizerAlgo::OptimizationAlgorithmType optimizationAlgorithm,
+    vtkIGSIOTrackedFrameList* validationTrackedFrameList, vtkIGSIOTrackedFrameList* calibrationTrackedFrameList, const std::vector<PlusNWire>& nWires,
+    vtkPlusProbeCalibrationAlgo* freehandCalibration, vnl_matrix_fixed<double,4,4>& imageToProbeTransformMatrix, double& calibrationTimeSec)
+  {
+    vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+    if (transformRepository->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read CoordinateDefinitions!");
+      return PLUS_FAIL;
+    }
+    if (freehandCalibration->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read probe calibration configuration!");
+      return PLUS_FAIL;
+    }
+    if (!freehandCalibration->GetOptimizer()->Enabled())
+    {
+      LOG_ERROR("Calibration optimization is not enabled in the configuration file");
+      return PLUS_FAIL;
+    }
+    freehandCalibration->GetOptimizer()->SetOptimizationAlgorithm(optimizationAlgorithm);
+    freehandCalibration->GetOptimizer()->SetRobustLoss(vtkPlusProbeCalibrationOptimizerAlgo::ROBUST_LOSS_NONE);
+
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (freehandCalibration->Calibrate(validationTrackedFrameList, calibrationTrackedFrameList, transformRepository, nWires) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Calibration failed!");
+      return PLUS_FAIL;
+    }
+    calibrationTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+    imageToProbeTransformMatrix = freehandCalibration->GetOptimizer()->GetOptimizedImageToProbeTransformMatrix();
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool printHelp(false);
+  std::string inputCalibrationSeqMetafile;
+  std::string inputValidationSeqMetafile;
+  std::string inputConfigFileName;
+  double relativeErrorTolerance = 0.01;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--calibration-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputCalibrationSeqMetafile, "Sequence metafile name of input calibration dataset.");
+  args.AddArgument("--validation-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputValidationSeqMetafile, "Sequence metafile name of input validation dataset.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Configuration file name, defining the optimization method.");
+  args.AddArgument("--relative-error-tolerance", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &relativeErrorTolerance, "Maximum allowed relative increase of the optimized cost function value compared to the Powell optimization result (default: 0.01).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputCalibrationSeqMetafile.empty() || inputValidationSeqMetafile.empty())
+  {
+    LOG_ERROR("The arguments --config-file, --calibration-seq-file and --validation-seq-file are required");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  // Load and segment the calibration and validation images
+  PlusFidPatternRecognition patternRecognition;
+  PlusFidPatternRecognition::PatternRecognitionError error;
+  patternRecognition.ReadConfiguration(configRootElement);
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> calibrationTrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputCalibrationSeqMetafile, calibrationTrackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading calibration images from '" << inputCalibrationSeqMetafile << "' failed!");
+    return EXIT_FAILURE;
+  }
+  if (patternRecognition.RecognizePattern(calibrationTrackedFrameList, error) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error occured during segmentation of calibration images!");
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> validationTrackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputValidationSeqMetafile, validationTrackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading validation images from '" << inputValidationSeqMetafile << "' failed!");
+    return EXIT_FAILURE;
+  }
+  if (patternRecognition.RecognizePattern(validationTrackedFrameList, error) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Error occured during segmentation of validation images!");
+    return EXIT_FAILURE;
+  }
+  const std::vector<PlusNWire>& nWires = patternRecognition.GetFidLineFinder()->GetNWires();
+
+  // Calibrate with both optimization algorithms
+  vtkSmartPointer<vtkPlusProbeCalibrationAlgo> powellCalibration = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New();
+  vnl_matrix_fixed<double,4,4> powellImageToProbeTransformMatrix;
+  double powellCalibrationTimeSec = 0;
+  if (RunCalibration(configRootElement, vtkPlusProbeCalibrationOptimizerAlgo::POWELL, validationTrackedFrameList, calibrationTrackedFrameList, nWires,
+    powellCalibration, powellImageToProbeTransformMatrix, powellCalibrationTimeSec) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Calibration with Powell optimization failed");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPlusProbeCalibrationAlgo> lmCalibration = vtkSmartPointer<vtkPlusProbeCalibrationAlgo>::New();
+  vnl_matrix_fixed<double,4,4> lmImageToProbeTransformMatrix;
+  double lmCalibrationTimeSec = 0;
+  if (RunCalibration(configRootElement, vtkPlusProbeCalibrationOptimizerAlgo::LEVENBERG_MARQUARDT, validationTrackedFrameList, calibrationTrackedFrameList, nWires,
+    lmCalibration, lmImageToProbeTransformMatrix, lmCalibrationTimeSec) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Calibration with Levenberg-Marquardt optimization failed");
+    return EXIT_FAILURE;
+  }
+
+  // Evaluate both results on the same (non-outlier) calibration data
+  double errorMean = 0;
+  double errorStDev = 0;
+  double powellErrorRms = 0;
+  double lmErrorRms = 0;
+  powellCalibration->GetOptimizer()->ComputeError(powellImageToProbeTransformMatrix, errorMean, errorStDev, powellErrorRms);
+  powellCalibration->GetOptimizer()->ComputeError(lmImageToProbeTransformMatrix, errorMean, errorStDev, lmErrorRms);
+
+  LOG_INFO("Powell optimization: RMS error = " << powellErrorRms << ", calibration time = " << powellCalibrationTimeSec << " sec");
+  LOG_INFO("Levenberg-Marquardt optimization: RMS error = " << lmErrorRms << ", calibration time = " << lmCalibrationTimeSec << " sec");
+
+  if (lmErrorRms > powellErrorRms * (1.0 + relativeErrorTolerance))
+  {
+    LOG_ERROR("Levenberg-Marquardt optimization result (RMS error = " << lmErrorRms << ") is worse than the Powell optimization result (RMS error = " << powellErrorRms << ")");
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Test completed successfully" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -20,6 +20,7 @@ See License.txt for details.
 // Local includes
 #include "PlusConfigure.h"
 #include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkPlusTemporalCalibrationAlgo.h"
 #include "vtkIGSIOTrackedFrameList.h"
@@ -41,6 +42,10 @@ See License.txt for details.
 #include <vtkXMLUtilities.h>
 #include <vtksys/CommandLineArguments.hxx>
 
+// STL includes
+#include <iomanip>
+#include <limits>
+
 // define tolerance used for comparing double numbers
 namespace
 {
@@ -110,6 +115,8 @@ void WriteCalibrationResultToFile(const std::string& outputFileName, const Tempo
 {
   std::ofstream myfile;
   myfile.open(outputFileName.c_str());
+  // Full precision, so that the results files of two runs can be compared for identical results
+  myfile << std::setprecision(std::numeric_limits<double>::max_digits10);
   myfile << "<TemporalCalibrationResults TrackerLagSec=\"" << calibResult.trackerLagSec
          << "\" CalibrationError=\"" << calibResult.calibrationError
          << "\" MaxCalibrationError=\"" << calibResult.maxCalibrationError << "\" />";
@@ -328,11 +335,13 @@ int main(int argc, char** argv)
   vtkPlusTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR error(vtkPlusTemporalCalibrationAlgo::TEMPORAL_CALIBRATION_ERROR_NONE);
 
   //  Calculate the time-offset
+  const double computationStartTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
   if (testTemporalCalibrationObject->Update(error) != PLUS_SUCCESS)
   {
     LOG_ERROR("Cannot determine tracker lag, temporal calibration failed");
     exit(EXIT_FAILURE);
   }
+  LOG_INFO("Temporal calibration computation time: " << vtkIGSIOAccurateTimer::GetSystemTime() - computationStartTimeSec << " sec");
 
   // Display results
   TemporalCalibrationResult calibResult;
@@ -7,6 +7,8 @@ See License.txt for details.
 #ifndef LINEAROBJECT_H
 #define LINEAROBJECT_H
 
+#include "vtkPlusCalibrationExport.h"
+
 #include "vtkXMLDataElement.h"
 #include <cmath>
 #include <sstream>
@@ -14,7 +16,7 @@ See License.txt for details.
 #include <vector>
 
 // This class stores a vector of values and a string label
-class LinearObject
+class vtkPlusCalibrationExport LinearObject
 {
 public:
   std::string Name;
@@ -9,6 +9,123 @@ See License.txt for details.
 #include "LinearObjectBuffer.h"
 #include "igsioCommon.h"
 
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  //-----------------------------------------------------------------------------
+  // Same as LinearObject::Norm( LinearObject::Subtract( v1, v2 ) ), without the temporary vectors
+  double SignatureDistance( const std::vector<double>& v1, const std::vector<double>& v2 )
+  {
+    if ( v1.size() != v2.size() )
+    {
+      return 0.0;
+    }
+    double distance = 0.0;
+    for ( unsigned int i = 0; i < v1.size(); i++ )
+    {
+      double diff = v1[i] - v2[i];
+      distance += diff * diff;
+    }
+    return sqrt( distance );
+  }
+
+  //-----------------------------------------------------------------------------
+  // k-d tree over the signatures of linear objects for finding the object with the closest signature.
+  // If multiple objects are at the same distance then the one with the lowest index is found (as in a linear search).
+  class SignatureKdTree
+  {
+  public:
+    SignatureKdTree( LinearObjectBuffer* objects )
+      : Objects( objects )
+    {
+      std::vector<int> indices( objects->Size() );
+      for ( int i = 0; i < objects->Size(); i++ )
+      {
+        indices[i] = i;
+      }
+      this->Nodes.reserve( indices.size() );
+      this->Root = this->Build( indices, 0, indices.size(), 0 );
+    }
+
+    void FindClosest( const std::vector<double>& signature, LinearObject*& closestObject, double& closestDistance ) const
+    {
+      int closestIndex = -1;
+      closestDistance = std::numeric_limits<double>::infinity();
+      this->Search( this->Root, signature, closestIndex, closestDistance );
+      closestObject = this->Objects->GetLinearObject( closestIndex );
+    }
+
+  private:
+    struct Node
+    {
+      int Index;
+      unsigned int SplitDimension;
+      int Left;
+      int Right;
+    };
+
+    const std::vector<double>& GetSignature( int index ) const
+    {
+      return this->Objects->GetLinearObject( index )->Signature;
+    }
+
+    int Build( std::vector<int>& indices, int begin, int end, unsigned int depth )
+    {
+      if ( begin >= end )
+      {
+        return -1;
+      }
+      unsigned int splitDimension = depth % this->GetSignature( indices[begin] ).size();
+      int middle = begin + ( end - begin ) / 2;
+      std::nth_element( indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+        [this, splitDimension]( int a, int b ) { return this->GetSignature( a )[splitDimension] < this->GetSignature( b )[splitDimension]; } );
+
+      int nodeIndex = this->Nodes.size();
+      Node node = { indices[middle], splitDimension, -1, -1 };
+      this->Nodes.push_back( node );
+      int left = this->Build( indices, begin, middle, depth + 1 );
+      int right = this->Build( indices, middle + 1, end, depth + 1 );
+      this->Nodes[nodeIndex].Left = left;
+      this->Nodes[nodeIndex].Right = right;
+      return nodeIndex;
+    }
+
+    void Search( int nodeIndex, const std::vector<double>& signature, int& closestIndex, double& closestDistance ) const
+    {
+      if ( nodeIndex < 0 )
+      {
+        return;
+      }
+      const Node& node = this->Nodes[nodeIndex];
+      const std::vector<double>& nodeSignature = this->GetSignature( node.Index );
+
+      double distance = SignatureDistance( signature, nodeSignature );
+      if ( distance < closestDistance || ( distance == closestDistance && node.Index < closestIndex ) )
+      {
+        closestIndex = node.Index;
+        closestDistance = distance;
+      }
+
+      double diff = signature[node.SplitDimension] - nodeSignature[node.SplitDimension];
+      int nearChild = ( diff < 0 ) ? node.Left : node.Right;
+      int farChild = ( diff < 0 ) ? node.Right : node.Left;
+      this->Search( nearChild, signature, closestIndex, closestDistance );
+      // Objects on the other side of the splitting plane are at least |diff| away.
+      // Objects at exactly the closest distance are still visited, as they may have a lower index.
+      if ( sqrt( diff * diff ) <= closestDistance )
+      {
+        this->Search( farChild, signature, closestIndex, closestDistance );
+      }
+    }
+
+    LinearObjectBuffer* Objects;
+    std::vector<Node> Nodes;
+    int Root;
+  };
+}
+
 //-----------------------------------------------------------------------------
 
 LinearObjectBuffer::LinearObjectBuffer()
@@ -112,18 +229,36 @@ LinearObjectBuffer* LinearObjectBuffer::GetMatches( LinearObjectBuffer* candidat
     return matchedCandidates;
   }
 
+  // The k-d tree requires all candidate signatures to have the same, non-zero dimension (this is the case if they are
+  // computed by CalculateSignature with the same references), otherwise all candidates are checked
+  bool useKdTree = !candidates->GetLinearObject(0)->Signature.empty();
+  for ( int j = 1; j < candidates->Size() && useKdTree; j++ )
+  {
+    useKdTree = ( candidates->GetLinearObject(j)->Signature.size() == candidates->GetLinearObject(0)->Signature.size() );
+  }
+  SignatureKdTree* candidateTree = useKdTree ? new SignatureKdTree( candidates ) : NULL;
+
   for ( int i = 0; i < this->Size(); i++ )
   {
+    const std::vector<double>& signature = this->GetLinearObject(i)->Signature;
 
     LinearObject* closestObject = candidates->GetLinearObject(0);
-    double closestDistance = LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, closestObject->Signature ) );
+    double closestDistance = SignatureDistance( signature, closestObject->Signature );
 
-    for ( int j = 0; j < candidates->Size(); j++ )
+    if ( candidateTree != NULL && signature.size() == closestObject->Signature.size() )
     {
-      if ( LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, candidates->GetLinearObject(j)->Signature ) ) < closestDistance )
+      candidateTree->FindClosest( signature, closestObject, closestDistance );
+    }
+    else
+    {
+      for ( int j = 0; j < candidates->Size(); j++ )
       {
-        closestObject = candidates->GetLinearObject(j);
-        closestDistance = LinearObject::Norm( LinearObject::Subtract( this->GetLinearObject(i)->Signature, candidates->GetLinearObject(j)->Signature ) );
+        double distance = SignatureDistance( signature, candidates->GetLinearObject(j)->Signature );
+        if ( distance < closestDistance )
+        {
+          closestObject = candidates->GetLinearObject(j);
+          closestDistance = distance;
+        }
       }
     }
 
@@ -136,6 +271,8 @@ LinearObjectBuffer* LinearObjectBuffer::GetMatches( LinearObjectBuffer* candidat
 
   }
 
+  delete candidateTree;
+
   this->objects = matchedObjects;
 
   return matchedCandidates;
@@ -22,7 +22,7 @@ See License.txt for details.
 #include "vnl/algo/vnl_matrix_inverse.h"
 
 // This class stores a vector of values and a string label
-class LinearObjectBuffer
+class vtkPlusCalibrationExport LinearObjectBuffer
 {
 private:
   std::vector<LinearObject*> objects;
@@ -15,7 +15,7 @@ See License.txt for details.
 #include <cmath>
 
 // This class stores a vector of values and a string label
-class Point : public LinearObject
+class vtkPlusCalibrationExport Point : public LinearObject
 {
 public:
   Point();
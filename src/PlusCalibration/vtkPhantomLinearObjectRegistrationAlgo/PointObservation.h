@@ -15,7 +15,7 @@
 
 
 // This class stores a vector of values only - we do not care about time
-class PointObservation
+class vtkPlusCalibrationExport PointObservation
 {
 public:
   std::vector<double> Observation;
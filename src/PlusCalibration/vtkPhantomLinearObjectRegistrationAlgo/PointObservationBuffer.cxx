@@ -310,46 +310,27 @@ std::vector<double> PointObservationBuffer::CalculateCentroid()
 std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<int>* dof )
 {
   // First, let us identify the segmentation points and the associated DOFs, then we can divide up the points
-  int TEST_INTERVAL = 21;
+  const unsigned int TEST_INTERVAL = 21;
 
-  PointObservationBuffer* eigenBuffer = new PointObservationBuffer(); // Note: 1 < 2 < 3
+  std::vector<PointObservationBuffer*> linearObjects;
+  if ( this->Size() <= TEST_INTERVAL )
+  {
+    return linearObjects;
+  }
+
+  std::vector< std::vector<double> > windowEigenvalues = this->CalculateWindowEigenvalues( TEST_INTERVAL ); // Note: 1 < 2 < 3
   int currStartIndex, currEndIndex;
   bool collecting = false;
 
-  std::vector<PointObservationBuffer*> linearObjects;
-
   // Note: i is the start of the interval over which we will exam for linearity
   for ( unsigned int i = 0; i < this->Size() - TEST_INTERVAL; i++ )
   {
-    // Create a smaller point observation buffer to work with at each iteration with the points of interest
-    PointObservationBuffer* tempBuffer = new PointObservationBuffer();
-    for ( unsigned int j = i; j < i + TEST_INTERVAL; j++ )
-    {
-      tempBuffer->AddObservation( this->GetObservation( j ) );
-    }
-
-    // Find the eigenvalues of covariance matrix
-    std::vector<double> centroid = tempBuffer->CalculateCentroid();
-    vnl_matrix<double>* cov = tempBuffer->CovarianceMatrix( centroid );
-
-    //Calculate the eigenvectors of the covariance matrix
-    vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
-    vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
-    vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
-    // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
-
-    std::vector<double> eigen( 3, 0.0 );
-    eigen.at( 0 ) = eigenvalues.get( 0 );
-    eigen.at( 1 ) = eigenvalues.get( 1 );
-    eigen.at( 2 ) = eigenvalues.get( 2 );
-    eigenBuffer->AddObservation( new PointObservation( eigen ) );
-
     if ( !collecting )
     {
       currStartIndex = i;
     }
 
-    if ( eigenvalues.get( 0 ) < extractionThreshold )
+    if ( windowEigenvalues.at( i ).at( 0 ) < extractionThreshold )
     {
       collecting = true;
       continue;
@@ -373,7 +354,7 @@ std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObject
       dofInterval.push_back( currStartIndex );
       for ( int j = currStartIndex; j < currEndIndex; j++ )
       {
-        if ( eigenBuffer->GetObservation( j )->Observation.at( e ) > extractionThreshold )
+        if ( windowEigenvalues.at( j ).at( e ) > extractionThreshold )
         {
           dofInterval.push_back( j );
         }
@@ -413,3 +394,111 @@ std::vector<PointObservationBuffer*> PointObservationBuffer::ExtractLinearObject
 
   return linearObjects;
 }
+
+//-----------------------------------------------------------------------------
+
+std::vector<double> PointObservationBuffer::CalculateEigenvalues()
+{
+  std::vector<double> centroid = this->CalculateCentroid();
+  vnl_matrix<double>* cov = this->CovarianceMatrix( centroid );
+
+  vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
+  vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
+  vnl_symmetric_eigensystem_compute( *cov, eigenvectors, eigenvalues );
+  delete cov;
+
+  std::vector<double> eigen( PointObservation::SIZE, 0.0 );
+  for ( int d = 0; d < PointObservation::SIZE; d++ )
+  {
+    eigen.at( d ) = eigenvalues.get( d );
+  }
+  return eigen;
+}
+
+//-----------------------------------------------------------------------------
+
+std::vector< std::vector<double> > PointObservationBuffer::CalculateWindowEigenvalues( unsigned int windowSize )
+{
+  std::vector< std::vector<double> > windowEigenvalues;
+  if ( windowSize == 0 || this->Size() <= windowSize )
+  {
+    return windowEigenvalues;
+  }
+  windowEigenvalues.reserve( this->Size() - windowSize );
+
+  // The sliding window is moved by one point in each iteration, so instead of computing the centroid and covariance
+  // of all points in the window again, sums of the coordinates and of their products are updated (add the point that
+  // enters the window, remove the point that leaves it). Coordinates are taken relative to the first observation to
+  // keep the sums small and the sums are recomputed from scratch after each full window shift to avoid drift.
+  std::vector<double> origin = this->GetObservation( 0 )->Observation;
+  double sum[ PointObservation::SIZE ];
+  double sumOfProducts[ PointObservation::SIZE ][ PointObservation::SIZE ];
+
+  vnl_matrix<double> cov( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
+  vnl_matrix<double> eigenvectors( PointObservation::SIZE, PointObservation::SIZE, 0.0 );
+  vnl_vector<double> eigenvalues( PointObservation::SIZE, 0.0 );
+
+  for ( unsigned int i = 0; i < this->Size() - windowSize; i++ )
+  {
+    if ( i % windowSize == 0 )
+    {
+      for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+      {
+        sum[ d1 ] = 0.0;
+        for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
+        {
+          sumOfProducts[ d1 ][ d2 ] = 0.0;
+        }
+      }
+      for ( unsigned int j = i; j < i + windowSize; j++ )
+      {
+        this->AddToWindowSums( this->GetObservation( j ), origin, 1.0, sum, sumOfProducts );
+      }
+    }
+    else
+    {
+      this->AddToWindowSums( this->GetObservation( i - 1 ), origin, -1.0, sum, sumOfProducts );
+      this->AddToWindowSums( this->GetObservation( i + windowSize - 1 ), origin, 1.0, sum, sumOfProducts );
+    }
+
+    // Find the eigenvalues of covariance matrix
+    for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+    {
+      for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
+      {
+        cov.put( d1, d2, sumOfProducts[ d1 ][ d2 ] / windowSize - ( sum[ d1 ] / windowSize ) * ( sum[ d2 ] / windowSize ) );
+      }
+    }
+
+    //Calculate the eigenvectors of the covariance matrix
+    vnl_symmetric_eigensystem_compute( cov, eigenvectors, eigenvalues );
+    // Note: eigenvectors are ordered in increasing eigenvalue ( 0 = smallest, end = biggest )
+
+    std::vector<double> eigen( 3, 0.0 );
+    eigen.at( 0 ) = eigenvalues.get( 0 );
+    eigen.at( 1 ) = eigenvalues.get( 1 );
+    eigen.at( 2 ) = eigenvalues.get( 2 );
+    windowEigenvalues.push_back( eigen );
+  }
+
+  return windowEigenvalues;
+}
+
+//-----------------------------------------------------------------------------
+
+void PointObservationBuffer::AddToWindowSums( PointObservation* observation, const std::vector<double>& origin, double weight, double sum[ PointObservation::SIZE ], double sumOfProducts[ PointObservation::SIZE ][ PointObservation::SIZE ] )
+{
+  double relative[ PointObservation::SIZE ];
+  for ( int d = 0; d < PointObservation::SIZE; d++ )
+  {
+    relative[ d ] = observation->Observation.at( d ) - origin.at( d );
+    sum[ d ] += weight * relative[ d ];
+  }
+  for ( int d1 = 0; d1 < PointObservation::SIZE; d1++ )
+  {
+    for ( int d2 = 0; d2 < PointObservation::SIZE; d2++ )
+    {
+      sumOfProducts[ d1 ][ d2 ] += weight * relative[ d1 ] * relative[ d2 ];
+    }
+  }
+}
@@ -24,7 +24,7 @@ See License.txt for details.
 #include "vnl/algo/vnl_svd.h"
 
 
-class PointObservationBuffer
+class vtkPlusCalibrationExport PointObservationBuffer
 {
 private:
   typedef std::vector<PointObservation*> PointObservationVector;
@@ -51,6 +51,12 @@ public:
 
   std::vector<PointObservationBuffer*> ExtractLinearObjects( int collectionFrames, double extractionThreshold, std::vector<int>* dof );
 
+  // Eigenvalues of the covariance matrix of all observations, in increasing order
+  std::vector<double> CalculateEigenvalues();
+  // Eigenvalues of the covariance matrix of each window of windowSize consecutive observations (one element per window start
+  // position, except the last one), computed from sliding window sums
+  std::vector< std::vector<double> > CalculateWindowEigenvalues( unsigned int windowSize );
+
   std::string ToXMLString() const;
   void FromXMLElement( vtkXMLDataElement* element );
 
@@ -58,6 +64,9 @@ private:
   std::vector<double> CalculateCentroid();
   vnl_matrix<double>* CovarianceMatrix( std::vector<double> centroid );
 
+  // Add (weight = 1) or remove (weight = -1) an observation to the sliding window sums used by ExtractLinearObjects
+  static void AddToWindowSums( PointObservation* observation, const std::vector<double>& origin, double weight, double sum[ PointObservation::SIZE ], double sumOfProducts[ PointObservation::SIZE ][ PointObservation::SIZE ] );
+
 };
 
 #endif
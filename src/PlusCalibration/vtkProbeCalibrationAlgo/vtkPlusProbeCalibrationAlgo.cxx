@@ -9,6 +9,7 @@ See License.txt for details.
 
 #include "float.h"
 #include <vnl/vnl_inverse.h>
+#include <vnl/algo/vnl_svd.h>
 
 #include "vtkIGSIOTrackedFrameList.h"
 #include "igsioTrackedFrame.h"
@@ -27,10 +28,13 @@ See License.txt for details.
 #include "vtkMath.h"
 #include "vtksys/SystemTools.hxx"
 #include "vtkPoints.h"
-#include "vtkLine.h"
 #include "vtkPlane.h"
 
+#include <algorithm>
+
 static const int MIN_NUMBER_OF_VALID_CALIBRATION_FRAMES = 10; // minimum number of successfully calibrated frames required for calibration
+static const unsigned int MIN_NUMBER_OF_CALIBRATION_EQUATIONS = 8; // minimum number of non-outlier points required for computing a row of the calibration matrix
+static const double OUTLIER_THRESHOLD_STDEV_MULTIPLIER = 3.0; // points are outliers if their fitting error differs from the mean error by more than this many times the standard deviation
 static const double DEFAULT_ERROR_CONFIDENCE_INTERVAL = 0.95; // this fraction of the data is taken into account when computing mean and standard deviation in the final calibration error report
 
 vtkStandardNewMacro(vtkPlusProbeCalibrationAlgo);
@@ -48,8 +52,12 @@ vtkPlusProbeCalibrationAlgo::vtkPlusProbeCalibrationAlgo()
   , ProbeCoordinateFrame(NULL)
   , PhantomCoordinateFrame(NULL)
   , ReferenceCoordinateFrame(NULL)
+  , NumberOfNormalEquationPoints(0)
+  , LiveCalibrationResultAvailable(false)
+  , LiveReprojectionError3DRms(0)
   , ErrorConfidenceLevel(DEFAULT_ERROR_CONFIDENCE_INTERVAL)
 {
+  ClearNormalEquations();
   this->Optimizer = vtkPlusProbeCalibrationOptimizerAlgo::New();
   this->Optimizer->SetProbeCalibrationAlgo(this);
 }
@@ -99,79 +107,99 @@ PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformByLinearLeas
   // Do calibration for all dimensions and assemble output matrix
   const int n = 4; // number of point dimensions + 1 (homogeneous coordinate system representation: x, y, z, 1)
   const unsigned int numberOfNWiresOnEachFrame = this->NWires.size();
-  const unsigned int numberOfFrames = PreProcessedWirePositions[CALIBRATION_ALL].FramePositions.size();
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions;
+  const unsigned int numberOfFrames = framePositions.size();
   const unsigned int m = numberOfFrames * numberOfNWiresOnEachFrame; // number of all middle line intersection points on all frames
 
-  // If we attempt to run least square with not enough points then vnl_lsqr crashes. Return with an error if there are very few frames to avoid crashing.
+  // Return with an error if there are very few frames, as the result would be unreliable
   if (numberOfFrames < MIN_NUMBER_OF_VALID_CALIBRATION_FRAMES)
   {
     LOG_ERROR("Unable to perform calibration - there are " << numberOfFrames << " frames with segmented points and minimum " << MIN_NUMBER_OF_VALID_CALIBRATION_FRAMES << " frames are needed");
     return PLUS_FAIL;
   }
 
-  vnl_sparse_matrix<double> middleWireIntersectionPointsPos_Image(m, n);
+  imageToProbeTransformMatrix.fill(0);
+
+  // The last row is always (0,0,0,1), so only the first 3 rows are computed
+  for (int row = 0; row < n - 1; ++row)
   {
-    int outputColumnIndex = 0;
-    for (unsigned int frameIndex = 0; frameIndex < this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions.size(); ++frameIndex)
+    // Start from the normal equations of all the points, outliers are removed by subtracting their contribution
+    vnl_matrix<double> normalMatrix(this->NormalMatrix.data_block(), n, n);
+    vnl_vector<double> normalVector(n);
+    for (int i = 0; i < n; ++i)
     {
-      for (unsigned int nWireIndex = 0; nWireIndex < numberOfNWiresOnEachFrame; ++nWireIndex)
-      {
-        const vnl_vector_fixed<double, 4> middleWireIntersectionPointPos_Image = PreProcessedWirePositions[CALIBRATION_ALL].FramePositions[frameIndex].AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
-        middleWireIntersectionPointsPos_Image(outputColumnIndex, 0) = middleWireIntersectionPointPos_Image[0];
-        middleWireIntersectionPointsPos_Image(outputColumnIndex, 1) = middleWireIntersectionPointPos_Image[1];
-        middleWireIntersectionPointsPos_Image(outputColumnIndex, 2) = middleWireIntersectionPointPos_Image[2];
-        middleWireIntersectionPointsPos_Image(outputColumnIndex, 3) = middleWireIntersectionPointPos_Image[3];
-        outputColumnIndex++;
-      }
+      normalVector[i] = this->NormalVectors(i, row);
     }
-  }
-
-  imageToProbeTransformMatrix.fill(0);
+    std::vector<bool> isOutlier(m, false);
+    unsigned int numberOfNonOutliers = m;
+    vnl_vector<double> resultVector(n, 0);
+    std::vector<double> differences(m, 0);
 
-  for (int row = 0; row < n; ++row)
-  {
-    vnl_vector<double> probePositionRowVector(m, 0);
+    bool outlierFound = true;
+    while (outlierFound && numberOfNonOutliers > MIN_NUMBER_OF_CALIBRATION_EQUATIONS)
     {
-      int posIndex = 0;
-      for (unsigned int frameIndex = 0; frameIndex < this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions.size(); ++frameIndex)
+      if (SolveNormalEquations(normalMatrix, normalVector, resultVector) != PLUS_SUCCESS)
       {
-        for (unsigned int nWireIndex = 0; nWireIndex < numberOfNWiresOnEachFrame; ++nWireIndex)
+        return PLUS_FAIL;
+      }
+
+      // Compute the fitting error (Ax - b) of all the non-outlier points
+      double differenceSum = 0;
+      double differenceSquareSum = 0;
+      for (unsigned int frameIndex = 0, pointIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+      {
+        for (unsigned int nWireIndex = 0; nWireIndex < numberOfNWiresOnEachFrame; ++nWireIndex, ++pointIndex)
         {
-          probePositionRowVector[posIndex] = this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions[frameIndex].MiddleWireIntersectionPointsPos_Probe[nWireIndex][row];
-          posIndex++;
+          if (isOutlier[pointIndex])
+          {
+            continue;
+          }
+          const vnl_vector_fixed<double, 4>& middleWireIntersectionPointPos_Image = framePositions[frameIndex].AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
+          double difference = -framePositions[frameIndex].MiddleWireIntersectionPointsPos_Probe[nWireIndex][row];
+          for (int i = 0; i < n; ++i)
+          {
+            difference += middleWireIntersectionPointPos_Image[i] * resultVector[i];
+          }
+          differences[pointIndex] = difference;
+          differenceSum += difference;
+          differenceSquareSum += difference * difference;
         }
       }
-    }
-
-    // Fill the nonOutliers vector with the indices of all the points  (0, 1, 2, 3, ... m)
-    vnl_vector<unsigned int> nonOutliers(m);
-    for (unsigned int i = 0; i < m; ++i)
-    {
-      nonOutliers.put(i, i);
-    }
+      const double meanDifference = differenceSum / numberOfNonOutliers;
+      const double stdevDifference = sqrt(std::max(0.0, differenceSquareSum / numberOfNonOutliers - meanDifference * meanDifference));
+      LOG_DEBUG("Mean = " << std::fixed << meanDifference << "   Stdev = " << stdevDifference);
 
-    vnl_vector<double> resultVector(n, 0);
-    if (PlusMath::LSQRMinimize(middleWireIntersectionPointsPos_Image, probePositionRowVector, resultVector, NULL, NULL, &nonOutliers) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Failed to run LSQRMinimize!");
-      return PLUS_FAIL;
-    }
-
-    // Update outlier list
-    for (unsigned int pointIndex = 0; pointIndex < m; pointIndex++)
-    {
-      bool validPoint = false; // not an outlier
-      for (unsigned int validPointListIndex = 0; validPointListIndex < nonOutliers.size(); validPointListIndex++)
+      // If the difference from mean larger than OUTLIER_THRESHOLD_STDEV_MULTIPLIER * stdev, remove it from equation
+      outlierFound = false;
+      for (unsigned int frameIndex = 0, pointIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
       {
-        if (nonOutliers.get(validPointListIndex) == pointIndex)
+        for (unsigned int nWireIndex = 0; nWireIndex < numberOfNWiresOnEachFrame; ++nWireIndex, ++pointIndex)
         {
-          validPoint = true;
-          break;
+          if (isOutlier[pointIndex] || fabs(differences[pointIndex] - meanDifference) <= OUTLIER_THRESHOLD_STDEV_MULTIPLIER * stdevDifference)
+          {
+            continue;
+          }
+          const vnl_vector_fixed<double, 4>& middleWireIntersectionPointPos_Image = framePositions[frameIndex].AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
+          const double middleWireIntersectionPointPos_Probe = framePositions[frameIndex].MiddleWireIntersectionPointsPos_Probe[nWireIndex][row];
+          for (int i = 0; i < n; ++i)
+          {
+            for (int j = 0; j < n; ++j)
+            {
+              normalMatrix(i, j) -= middleWireIntersectionPointPos_Image[i] * middleWireIntersectionPointPos_Image[j];
+            }
+            normalVector[i] -= middleWireIntersectionPointPos_Image[i] * middleWireIntersectionPointPos_Probe;
+          }
+          isOutlier[pointIndex] = true;
+          numberOfNonOutliers--;
+          outlierFound = true;
+          outliers.insert(pointIndex);
         }
       }
-      if (!validPoint)
+
+      if (numberOfNonOutliers <= MIN_NUMBER_OF_CALIBRATION_EQUATIONS)
       {
-        outliers.insert(pointIndex);
+        LOG_ERROR("It was not possible calibrate! Not enough equations!");
+        return PLUS_FAIL;
       }
     }
 
@@ -179,7 +207,63 @@ PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformByLinearLeas
     imageToProbeTransformMatrix.set_row(row, resultVector);
   }
 
-  // Force the last row to be exactly (0,0,0,1) - sometimes it contains numbers of 1e-18 magnitude
+  CompleteImageToProbeTransformMatrix(imageToProbeTransformMatrix);
+
+  LOG_DEBUG(outliers.size() << " outliers points were found");
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformFromNormalEquations(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DRms)
+{
+  const int n = 4;
+  imageToProbeTransformMatrix.fill(0);
+  vnl_matrix<double> normalMatrix(this->NormalMatrix.data_block(), n, n);
+  vnl_vector<double> normalVector(n);
+  vnl_vector<double> resultVector(n, 0);
+  double squaredResidualSum = 0;
+  // The last row is always (0,0,0,1), so only the first 3 rows are computed. The residual of the last row is 0.
+  for (int row = 0; row < n - 1; ++row)
+  {
+    for (int i = 0; i < n; ++i)
+    {
+      normalVector[i] = this->NormalVectors(i, row);
+    }
+    if (SolveNormalEquations(normalMatrix, normalVector, resultVector) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    imageToProbeTransformMatrix.set_row(row, resultVector);
+
+    // sum((p_Image^T * x - p_Probe(row))^2) = c - 2 * x^T * b + x^T * A * x
+    squaredResidualSum += this->NormalTargetSquareSums[row] - 2.0 * dot_product(resultVector, normalVector) + dot_product(resultVector, normalMatrix * resultVector);
+  }
+  CompleteImageToProbeTransformMatrix(imageToProbeTransformMatrix);
+
+  // The sum may become slightly negative due to cancellation if the fit is nearly perfect
+  reprojectionError3DRms = (this->NumberOfNormalEquationPoints > 0 ? sqrt(std::max(0.0, squaredResidualSum) / this->NumberOfNormalEquationPoints) : 0.0);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::SolveNormalEquations(const vnl_matrix<double>& normalMatrix, const vnl_vector<double>& normalVector, vnl_vector<double>& resultVector)
+{
+  vnl_svd<double> normalMatrixSvd(normalMatrix);
+  normalMatrixSvd.zero_out_relative(1e-12);
+  if (normalMatrixSvd.rank() < normalMatrix.rows() - 1)
+  {
+    LOG_ERROR("Unable to perform calibration - the linear least squares problem is ill-conditioned");
+    return PLUS_FAIL;
+  }
+  resultVector = normalMatrixSvd.solve(normalVector);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::CompleteImageToProbeTransformMatrix(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix)
+{
+  // Set the last row to (0,0,0,1)
   imageToProbeTransformMatrix(3, 0) = 0;
   imageToProbeTransformMatrix(3, 1) = 0;
   imageToProbeTransformMatrix(3, 2) = 0;
@@ -198,10 +282,6 @@ PlusStatus vtkPlusProbeCalibrationAlgo::ComputeImageToProbeTransformByLinearLeas
   imageToProbeTransformMatrix(0, 2) = zVector[0];
   imageToProbeTransformMatrix(1, 2) = zVector[1];
   imageToProbeTransformMatrix(2, 2) = zVector[2];
-
-  LOG_DEBUG(outliers.size() << " outliers points were found");
-
-  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -244,9 +324,10 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
     calibrationEndFrame = numberOfCalibrationFrames;
   }
 
-  this->NWires = nWires;
+  SetNWires(nWires);
 
   this->PreProcessedWirePositions[CALIBRATION_ALL].Clear();
+  ClearNormalEquations();
   this->PreProcessedWirePositions[VALIDATION_ALL].Clear();
   this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].Clear();
 
@@ -297,8 +378,16 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
   {
     LOG_INFO("Additional calibration optimization is requested");
     UpdateNonOutlierData(outliers);
-    this->Optimizer->SetImageToProbeSeedTransform(imageToProbeTransformMatrix);
-    this->Optimizer->Update();
+    if (SetOptimizerInputData(imageToProbeTransformMatrix) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set calibration optimization input data");
+      return PLUS_FAIL;
+    }
+    if (this->Optimizer->Update() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Calibration optimization failed");
+      return PLUS_FAIL;
+    }
     imageToProbeTransformMatrix = this->Optimizer->GetOptimizedImageToProbeTransformMatrix();
     SetAndValidateImageToProbeTransform(imageToProbeTransformMatrix, transformRepository);
   }
@@ -365,6 +454,51 @@ PlusStatus vtkPlusProbeCalibrationAlgo::Calibrate(vtkIGSIOTrackedFrameList* vali
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::SetNWires(const std::vector<PlusNWire>& nWires)
+{
+  this->NWires = nWires;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->WireEndPointsFront_Phantom[i].clear();
+    this->WireEndPointsBack_Phantom[i].clear();
+  }
+  for (std::vector<PlusNWire>::const_iterator nWireIt = this->NWires.begin(); nWireIt != this->NWires.end(); ++nWireIt)
+  {
+    for (int wireIndex = 0; wireIndex < 3; ++wireIndex)
+    {
+      const PlusFidWire& wire = nWireIt->GetWires()[wireIndex];
+      for (int i = 0; i < 3; ++i)
+      {
+        this->WireEndPointsFront_Phantom[i].push_back(wire.EndPointFront[i]);
+        this->WireEndPointsBack_Phantom[i].push_back(wire.EndPointBack[i]);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::AddFramePosition(PreProcessedWirePositionIdType datasetType, const NWirePositionType& framePosition)
+{
+  this->PreProcessedWirePositions[datasetType].FramePositions.push_back(framePosition);
+
+  WirePositionArraysType& wirePositions = this->PreProcessedWirePositions[datasetType].WirePositionArrays;
+  for (std::vector< vnl_vector_fixed<double, 4> >::const_iterator pointIt = framePosition.AllWiresIntersectionPointsPos_Image.begin(); pointIt != framePosition.AllWiresIntersectionPointsPos_Image.end(); ++pointIt)
+  {
+    wirePositions.AllWiresX_Image.push_back((*pointIt)[0]);
+    wirePositions.AllWiresY_Image.push_back((*pointIt)[1]);
+  }
+  for (unsigned int nWireIndex = 0; nWireIndex < framePosition.MiddleWireIntersectionPointsPos_Probe.size(); ++nWireIndex)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      wirePositions.MiddleWires_Image[i].push_back(framePosition.AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1][i]);
+      wirePositions.MiddleWires_Probe[i].push_back(framePosition.MiddleWireIntersectionPointsPos_Probe[nWireIndex][i]);
+    }
+  }
+  wirePositions.PhantomToProbeTransforms.push_back(vnl_inverse(framePosition.ProbeToPhantomTransform));
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusProbeCalibrationAlgo::AddPositionsPerImage(igsioTrackedFrame* trackedFrame, vtkIGSIOTransformRepository* transformRepository, PreProcessedWirePositionIdType datasetType)
 {
@@ -509,11 +643,142 @@ PlusStatus vtkPlusProbeCalibrationAlgo::AddPositionsPerImage(igsioTrackedFrame*
     }
   }
 
-  this->PreProcessedWirePositions[datasetType].FramePositions.push_back(framePosition);
+  AddFramePosition(datasetType, framePosition);
+  if (datasetType == CALIBRATION_ALL)
+  {
+    AddFramePositionToNormalEquations(framePosition);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::ClearNormalEquations()
+{
+  this->NormalMatrix.fill(0);
+  this->NormalVectors.fill(0);
+  this->NormalTargetSquareSums.fill(0);
+  this->NumberOfNormalEquationPoints = 0;
+}
 
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::AddFramePositionToNormalEquations(const NWirePositionType& framePosition)
+{
+  for (unsigned int nWireIndex = 0; nWireIndex < framePosition.MiddleWireIntersectionPointsPos_Probe.size(); ++nWireIndex)
+  {
+    const vnl_vector_fixed<double, 4>& middleWireIntersectionPointPos_Image = framePosition.AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
+    const vnl_vector_fixed<double, 4>& middleWireIntersectionPointPos_Probe = framePosition.MiddleWireIntersectionPointsPos_Probe[nWireIndex];
+    for (int i = 0; i < 4; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        this->NormalMatrix(i, j) += middleWireIntersectionPointPos_Image[i] * middleWireIntersectionPointPos_Image[j];
+        this->NormalVectors(i, j) += middleWireIntersectionPointPos_Image[i] * middleWireIntersectionPointPos_Probe[j];
+      }
+      this->NormalTargetSquareSums[i] += middleWireIntersectionPointPos_Probe[i] * middleWireIntersectionPointPos_Probe[i];
+    }
+    this->NumberOfNormalEquationPoints++;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::StartLiveCalibration(const std::vector<PlusNWire>& nWires)
+{
+  LOG_TRACE("vtkPlusProbeCalibrationAlgo::StartLiveCalibration");
+  if (nWires.empty())
+  {
+    LOG_ERROR("Unable to start live calibration - no NWires are defined");
+    return PLUS_FAIL;
+  }
+  SetNWires(nWires);
+  this->PreProcessedWirePositions[CALIBRATION_ALL].Clear();
+  this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].Clear();
+  ClearNormalEquations();
+  this->LiveCalibrationResultAvailable = false;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::AddLiveCalibrationFrame(igsioTrackedFrame* trackedFrame, vtkIGSIOTransformRepository* transformRepository)
+{
+  LOG_TRACE("vtkPlusProbeCalibrationAlgo::AddLiveCalibrationFrame");
+  if (this->NWires.empty())
+  {
+    LOG_ERROR("Unable to add live calibration frame - live calibration is not started");
+    return PLUS_FAIL;
+  }
+
+  const int numberOfFramesBefore = GetNumberOfLiveCalibrationFrames();
+  if (AddPositionsPerImage(trackedFrame, transformRepository, CALIBRATION_ALL) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Add live calibration position failed");
+    return PLUS_FAIL;
+  }
+  if (GetNumberOfLiveCalibrationFrames() == numberOfFramesBefore || GetNumberOfLiveCalibrationFrames() < MIN_NUMBER_OF_VALID_CALIBRATION_FRAMES)
+  {
+    // segmentation failed on the frame or not enough frames are collected yet, the result is not changed
+    return PLUS_SUCCESS;
+  }
+
+  // Outliers are only rejected in FinalizeLiveCalibration, as it requires iterating through all the collected points
+  if (ComputeImageToProbeTransformFromNormalEquations(this->LiveImageToProbeTransformMatrix, this->LiveReprojectionError3DRms) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Live calibration with linear least squares method failed");
+    this->LiveCalibrationResultAvailable = false;
+    return PLUS_FAIL;
+  }
+  this->LiveCalibrationResultAvailable = true;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::GetLiveCalibrationResult(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix)
+{
+  if (!this->LiveCalibrationResultAvailable)
+  {
+    LOG_DEBUG("Live calibration result is not available: " << GetNumberOfLiveCalibrationFrames() << " frames are collected, minimum " << MIN_NUMBER_OF_VALID_CALIBRATION_FRAMES << " frames are needed");
+    return PLUS_FAIL;
+  }
+  imageToProbeTransformMatrix = this->LiveImageToProbeTransformMatrix;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::GetLiveCalibrationResult(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DRms)
+{
+  if (GetLiveCalibrationResult(imageToProbeTransformMatrix) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  reprojectionError3DRms = this->LiveReprojectionError3DRms;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::FinalizeLiveCalibration(vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DMean, double& reprojectionError3DStdDev)
+{
+  LOG_TRACE("vtkPlusProbeCalibrationAlgo::FinalizeLiveCalibration");
+  std::set<int> outliers;
+  if (ComputeImageToProbeTransformByLinearLeastSquaresMethod(imageToProbeTransformMatrix, outliers) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Live calibration with linear least squares method failed");
+    return PLUS_FAIL;
+  }
+  std::vector<double> reprojectionErrors;
+  ComputeError3d(reprojectionErrors, CALIBRATION_ALL, imageToProbeTransformMatrix);
+  igsioMath::ComputeMeanAndStdev(reprojectionErrors, reprojectionError3DMean, reprojectionError3DStdDev);
+
+  LOG_DEBUG("Live calibration 3D reprojection error (" << GetNumberOfLiveCalibrationFrames() << " frames, " << outliers.size() << " outliers): mean = "
+            << reprojectionError3DMean << "mm, stdev = " << reprojectionError3DStdDev << "mm");
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+int vtkPlusProbeCalibrationAlgo::GetNumberOfLiveCalibrationFrames()
+{
+  return this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions.size();
+}
+
 //-----------------------------------------------------------------------------
 void vtkPlusProbeCalibrationAlgo::SetAndValidateImageToProbeTransform(const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, vtkIGSIOTransformRepository* transformRepository)
 {
@@ -1009,19 +1274,49 @@ void vtkPlusProbeCalibrationAlgo::UpdateNonOutlierData(const std::set<int>& outl
       continue;
     }
     // not outlier frame, copy to the non-outlier list
-    this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions.push_back(this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions[frameIndex]);
+    AddFramePosition(CALIBRATION_NOT_OUTLIER, this->PreProcessedWirePositions[CALIBRATION_ALL].FramePositions[frameIndex]);
   }
 }
 
-//-----------------------------------------------------------------------------
-double vtkPlusProbeCalibrationAlgo::PointToWireDistance(const vnl_double_3& aPoint, const vnl_double_3& aLineEndPoint1, const vnl_double_3& aLineEndPoint2)
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationAlgo::SetOptimizerInputData(const vnl_matrix_fixed<double, 4, 4>& imageToProbeSeedTransformMatrix)
 {
-  // Convert point from vnl to vtk format
-  double wireP0[3] = {aLineEndPoint1[0], aLineEndPoint1[1], aLineEndPoint1[2]};
-  double wireP1[3] = {aLineEndPoint2[0], aLineEndPoint2[1], aLineEndPoint2[2]};
-  double segmentedPoint[3] = {aPoint(0), aPoint(1), aPoint(2)};
-  double distanceToWire = sqrt(vtkLine::DistanceToLine(segmentedPoint, wireP0, wireP1));
-  return distanceToWire;
+  vnl_matrix_fixed<double, 4, 4> imageToProbeSeedTransform = imageToProbeSeedTransformMatrix;
+  const std::vector<NWirePositionType>& framePositions = this->PreProcessedWirePositions[CALIBRATION_NOT_OUTLIER].FramePositions;
+  switch (this->Optimizer->GetOptimizationMethod())
+  {
+  case vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D:
+  {
+    std::vector< vnl_vector<double> > middleWirePositions_Image;
+    std::vector< vnl_vector<double> > middleWirePositions_Probe;
+    for (std::vector<NWirePositionType>::const_iterator frameIt = framePositions.begin(); frameIt != framePositions.end(); ++frameIt)
+    {
+      for (unsigned int nWireIndex = 0; nWireIndex < this->NWires.size(); ++nWireIndex)
+      {
+        middleWirePositions_Image.push_back(vnl_vector<double>(frameIt->AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1].data_block(), 4));
+        middleWirePositions_Probe.push_back(vnl_vector<double>(frameIt->MiddleWireIntersectionPointsPos_Probe[nWireIndex].data_block(), 4));
+      }
+    }
+    return this->Optimizer->SetInputDataForMiddlePointMethod(&middleWirePositions_Image, &middleWirePositions_Probe, &imageToProbeSeedTransform, NULL);
+  }
+  case vtkPlusProbeCalibrationOptimizerAlgo::MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D:
+  {
+    std::vector< vnl_vector<double> > allWiresPositions_Image;
+    std::vector< vnl_matrix_fixed<double, 4, 4> > probeToPhantomTransforms;
+    for (std::vector<NWirePositionType>::const_iterator frameIt = framePositions.begin(); frameIt != framePositions.end(); ++frameIt)
+    {
+      for (unsigned int pointIndex = 0; pointIndex < this->NWires.size() * 3; ++pointIndex)
+      {
+        allWiresPositions_Image.push_back(vnl_vector<double>(frameIt->AllWiresIntersectionPointsPos_Image[pointIndex].data_block(), 4));
+      }
+      probeToPhantomTransforms.push_back(frameIt->ProbeToPhantomTransform);
+    }
+    return this->Optimizer->SetOptimizerDataUsingNWires(&allWiresPositions_Image, &this->NWires, &probeToPhantomTransforms, &imageToProbeSeedTransform, NULL);
+  }
+  default:
+    LOG_ERROR("Invalid calibration optimization method");
+    return PLUS_FAIL;
+  }
 }
 
 //--------------------------------------------------------------------------------
@@ -1035,80 +1330,52 @@ void vtkPlusProbeCalibrationAlgo::ComputeError2d(PreProcessedWirePositionIdType
     double& errorMean, double& errorStDev, double& errorRms,
     std::vector< std::vector< vnl_vector_fixed<double, 2> > >* reprojectionError2Ds /*=NULL*/)
 {
-  std::vector<double> reprojectionErrors;
-
-  int nWires = this->NWires.size(); // number of N-wires in the calibration pattern
-
-  vnl_vector_fixed<double, 4> segmentedInPhantomFrame_vnl;
-  segmentedInPhantomFrame_vnl(3) = 1;
-  vnl_vector_fixed<double, 4> wireFrontPoint_Phantom;
-  vnl_vector_fixed<double, 4> wireBackPoint_Phantom;
-  wireFrontPoint_Phantom(3) = 1;
-  wireBackPoint_Phantom(3) = 1;
-  vnl_vector_fixed<double, 4> wireFrontPoint_Image;
-  vnl_vector_fixed<double, 4> wireBackPoint_Image;
-  wireFrontPoint_Image(3) = 1;
-  wireBackPoint_Image(3) = 1;
-
-  int numberOfFrames = this->PreProcessedWirePositions[datasetType].FramePositions.size();
+  const WirePositionArraysType& wirePositions = this->PreProcessedWirePositions[datasetType].WirePositionArrays;
+  const unsigned int numberOfWires = this->NWires.size() * 3;
+  const unsigned int numberOfFrames = wirePositions.PhantomToProbeTransforms.size();
   if (reprojectionError2Ds != NULL)
   {
     reprojectionError2Ds->clear();
-    reprojectionError2Ds->resize(this->NWires.size() * 3);
+    reprojectionError2Ds->resize(numberOfWires);
   }
 
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)  // for each frame
+  std::vector<double> reprojectionErrors;
+  reprojectionErrors.reserve(numberOfFrames * numberOfWires);
+  std::vector<double> errorsX_Image(numberOfWires);
+  std::vector<double> errorsY_Image(numberOfWires);
+  std::vector<unsigned char> intersectionValid(numberOfWires);
+  const double* const wireEndPointsFront_Phantom[3] = { this->WireEndPointsFront_Phantom[0].data(), this->WireEndPointsFront_Phantom[1].data(), this->WireEndPointsFront_Phantom[2].data() };
+  const double* const wireEndPointsBack_Phantom[3] = { this->WireEndPointsBack_Phantom[0].data(), this->WireEndPointsBack_Phantom[1].data(), this->WireEndPointsBack_Phantom[2].data() };
+
+  vnl_matrix_fixed<double, 4, 4> probeToImageTransform_vnl = vnl_inverse(imageToProbeMatrix);
+  for (unsigned int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)  // for each frame
   {
-    vnl_matrix_fixed<double, 4, 4> probeToPhantomTransform_vnl = this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].ProbeToPhantomTransform;
-    vnl_matrix_fixed<double, 4, 4> phantomToImageTransform_vnl = vnl_inverse(imageToProbeMatrix) * vnl_inverse(probeToPhantomTransform_vnl);
-    vtkSmartPointer<vtkMatrix4x4> phantomToImageTransform = vtkSmartPointer<vtkMatrix4x4>::New();
-    PlusMath::ConvertVnlMatrixToVtkMatrix(phantomToImageTransform_vnl, phantomToImageTransform);
+    vnl_matrix_fixed<double, 4, 4> phantomToImageTransform_vnl = probeToImageTransform_vnl * wirePositions.PhantomToProbeTransforms[frameIndex];
 
-    double normalVector[3] = { 0.0, 0.0, 1.0 };
-    double origin[3] = { 0.0, 0.0, 0.0 };
+    // Compute the intersection of all wires with the image plane
+    ComputeWireIntersectionErrors2D(phantomToImageTransform_vnl, numberOfWires, wireEndPointsFront_Phantom, wireEndPointsBack_Phantom,
+                                    wirePositions.AllWiresX_Image.data() + frameIndex * numberOfWires, wirePositions.AllWiresY_Image.data() + frameIndex * numberOfWires,
+                                    errorsX_Image.data(), errorsY_Image.data(), intersectionValid.data());
 
-    for (int nWireIndex = 0; nWireIndex < nWires; nWireIndex++)   // for each segmented N-wire
+    for (unsigned int wireIndex = 0; wireIndex < numberOfWires; wireIndex++)   // for each segmented point
     {
-      for (int wireIndex = 0; wireIndex < 3; wireIndex++)   // for each segmented point
+      if (!intersectionValid[wireIndex])
       {
-        // Compute the wire intersection point position in the image
-        PlusFidWire wire = this->NWires[nWireIndex].GetWires()[wireIndex];
-        double wireEndPointFrontInPhantomFrame[4] = { wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0 };
-        double wireEndPointBackInPhantomFrame[4] = { wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0 };
-        double wireEndPointFrontInImageFrame[4] = {0};
-        double wireEndPointBackInImageFrame[4] = {0};
-        phantomToImageTransform->MultiplyPoint(wireEndPointFrontInPhantomFrame, wireEndPointFrontInImageFrame);
-        phantomToImageTransform->MultiplyPoint(wireEndPointBackInPhantomFrame, wireEndPointBackInImageFrame);
-
-        double computedPositionInImagePlane[3];
-        double t = 0; // Parametric coordinate along the line
-
-        // Compute intersection of wire and image plane
-        if ((! vtkPlane::IntersectWithLine(wireEndPointFrontInImageFrame, wireEndPointBackInImageFrame, normalVector, origin, t, computedPositionInImagePlane))
-            && (wireEndPointFrontInImageFrame[3] * wireEndPointBackInImageFrame[3] < 0))    // This condition to ensure that warning is thrown only if the zero value is returned because both points are on the same side of the image plane (in that case the intersection is still valid although the return value is zero)
-        {
-          LOG_WARNING("Image plane and wire are parallel!");
-          if (reprojectionError2Ds != NULL)
-          {
-            vnl_vector_fixed<double, 2> reprojectionError2D(2, DBL_MAX);
-            (*reprojectionError2Ds)[nWireIndex * 3 + wireIndex].push_back(reprojectionError2D);
-          }
-          continue;
-        }
-
-        // Get the segmented intersection position in the image
-        vnl_vector_fixed<double, 4> segmentedPoint_Image = this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].AllWiresIntersectionPointsPos_Image[3 * nWireIndex + wireIndex];
-
-        vnl_vector_fixed<double, 2> reprojectionError2D;
-        reprojectionError2D[0] = segmentedPoint_Image[0] - computedPositionInImagePlane[0];
-        reprojectionError2D[1] = segmentedPoint_Image[1] - computedPositionInImagePlane[1];
-
+        LOG_WARNING("Image plane and wire are parallel!");
         if (reprojectionError2Ds != NULL)
         {
-          (*reprojectionError2Ds)[nWireIndex * 3 + wireIndex].push_back(reprojectionError2D);
+          vnl_vector_fixed<double, 2> reprojectionError2D(2, DBL_MAX);
+          (*reprojectionError2Ds)[wireIndex].push_back(reprojectionError2D);
         }
-        reprojectionErrors.push_back(reprojectionError2D.magnitude());
+        continue;
       }
+
+      vnl_vector_fixed<double, 2> reprojectionError2D(errorsX_Image[wireIndex], errorsY_Image[wireIndex]);
+      if (reprojectionError2Ds != NULL)
+      {
+        (*reprojectionError2Ds)[wireIndex].push_back(reprojectionError2D);
+      }
+      reprojectionErrors.push_back(reprojectionError2D.magnitude());
     }
   }
 
@@ -1119,20 +1386,71 @@ void vtkPlusProbeCalibrationAlgo::ComputeError2d(PreProcessedWirePositionIdType
 //--------------------------------------------------------------------------------
 void vtkPlusProbeCalibrationAlgo::ComputeError3d(std::vector<double>& reprojectionErrors, PreProcessedWirePositionIdType datasetType, const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix)
 {
-  reprojectionErrors.clear();
-  int numberOfFrames = this->PreProcessedWirePositions[datasetType].FramePositions.size();
-  vnl_vector_fixed<double, 4> segmentedInProbeFrame_vnl;
-  vnl_vector_fixed<double, 4> pointErrorVector;
-  for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
+  const WirePositionArraysType& wirePositions = this->PreProcessedWirePositions[datasetType].WirePositionArrays;
+  const double* const points_Image[4] = { wirePositions.MiddleWires_Image[0].data(), wirePositions.MiddleWires_Image[1].data(), wirePositions.MiddleWires_Image[2].data(), wirePositions.MiddleWires_Image[3].data() };
+  const double* const points_Probe[4] = { wirePositions.MiddleWires_Probe[0].data(), wirePositions.MiddleWires_Probe[1].data(), wirePositions.MiddleWires_Probe[2].data(), wirePositions.MiddleWires_Probe[3].data() };
+  reprojectionErrors.resize(wirePositions.MiddleWires_Image[0].size());
+  ComputeMiddleWireErrors3D(imageToProbeMatrix, reprojectionErrors.size(), points_Image, points_Probe, reprojectionErrors.data());
+}
+
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::ComputeWireIntersectionErrors2D(const vnl_matrix_fixed<double, 4, 4>& phantomToImageTransform, unsigned int numberOfWires,
+    const double* const wireEndPointsFront_Phantom[3], const double* const wireEndPointsBack_Phantom[3],
+    const double* segmentedX_Image, const double* segmentedY_Image, double* errorsX_Image, double* errorsY_Image, unsigned char* intersectionValid)
+{
+  // Same tolerance as in vtkPlane::IntersectWithLine: the wire is parallel to the plane if the denominator is negligible compared to the numerator
+  const double parallelTolerance = 1.0e-06;
+
+  const double m00 = phantomToImageTransform(0, 0), m01 = phantomToImageTransform(0, 1), m02 = phantomToImageTransform(0, 2), m03 = phantomToImageTransform(0, 3);
+  const double m10 = phantomToImageTransform(1, 0), m11 = phantomToImageTransform(1, 1), m12 = phantomToImageTransform(1, 2), m13 = phantomToImageTransform(1, 3);
+  const double m20 = phantomToImageTransform(2, 0), m21 = phantomToImageTransform(2, 1), m22 = phantomToImageTransform(2, 2), m23 = phantomToImageTransform(2, 3);
+  const double* frontX = wireEndPointsFront_Phantom[0];
+  const double* frontY = wireEndPointsFront_Phantom[1];
+  const double* frontZ = wireEndPointsFront_Phantom[2];
+  const double* backX = wireEndPointsBack_Phantom[0];
+  const double* backY = wireEndPointsBack_Phantom[1];
+  const double* backZ = wireEndPointsBack_Phantom[2];
+
+  for (unsigned int wireIndex = 0; wireIndex < numberOfWires; ++wireIndex)
   {
-    for (unsigned int nWireIndex = 0; nWireIndex < this->NWires.size(); nWireIndex++)
-    {
-      // Find the projection in the probe frame
-      segmentedInProbeFrame_vnl = imageToProbeMatrix * this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].AllWiresIntersectionPointsPos_Image[nWireIndex * 3 + 1];
+    // Wire end points in the image frame
+    const double frontX_Image = m00 * frontX[wireIndex] + m01 * frontY[wireIndex] + m02 * frontZ[wireIndex] + m03;
+    const double frontY_Image = m10 * frontX[wireIndex] + m11 * frontY[wireIndex] + m12 * frontZ[wireIndex] + m13;
+    const double frontZ_Image = m20 * frontX[wireIndex] + m21 * frontY[wireIndex] + m22 * frontZ[wireIndex] + m23;
+    const double backX_Image = m00 * backX[wireIndex] + m01 * backY[wireIndex] + m02 * backZ[wireIndex] + m03;
+    const double backY_Image = m10 * backX[wireIndex] + m11 * backY[wireIndex] + m12 * backZ[wireIndex] + m13;
+    const double backZ_Image = m20 * backX[wireIndex] + m21 * backY[wireIndex] + m22 * backZ[wireIndex] + m23;
+
+    // Intersection with the image plane (z = 0): front + t * (back - front)
+    const double numerator = -frontZ_Image;
+    const double denominator = backZ_Image - frontZ_Image;
+    intersectionValid[wireIndex] = (fabs(denominator) > fabs(numerator) * parallelTolerance);
+    const double t = numerator / denominator;
+    errorsX_Image[wireIndex] = segmentedX_Image[wireIndex] - (frontX_Image + t * (backX_Image - frontX_Image));
+    errorsY_Image[wireIndex] = segmentedY_Image[wireIndex] - (frontY_Image + t * (backY_Image - frontY_Image));
+  }
+}
 
-      pointErrorVector = segmentedInProbeFrame_vnl - this->PreProcessedWirePositions[datasetType].FramePositions[frameIndex].MiddleWireIntersectionPointsPos_Probe[nWireIndex];
-      reprojectionErrors.push_back(pointErrorVector.magnitude());
-    }
+//--------------------------------------------------------------------------------
+void vtkPlusProbeCalibrationAlgo::ComputeMiddleWireErrors3D(const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransform, unsigned int numberOfPoints,
+    const double* const points_Image[4], const double* const points_Probe[4], double* errors)
+{
+  const double m00 = imageToProbeTransform(0, 0), m01 = imageToProbeTransform(0, 1), m02 = imageToProbeTransform(0, 2), m03 = imageToProbeTransform(0, 3);
+  const double m10 = imageToProbeTransform(1, 0), m11 = imageToProbeTransform(1, 1), m12 = imageToProbeTransform(1, 2), m13 = imageToProbeTransform(1, 3);
+  const double m20 = imageToProbeTransform(2, 0), m21 = imageToProbeTransform(2, 1), m22 = imageToProbeTransform(2, 2), m23 = imageToProbeTransform(2, 3);
+  const double m30 = imageToProbeTransform(3, 0), m31 = imageToProbeTransform(3, 1), m32 = imageToProbeTransform(3, 2), m33 = imageToProbeTransform(3, 3);
+  const double* x = points_Image[0];
+  const double* y = points_Image[1];
+  const double* z = points_Image[2];
+  const double* w = points_Image[3];
+
+  for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    const double dx = m00 * x[pointIndex] + m01 * y[pointIndex] + m02 * z[pointIndex] + m03 * w[pointIndex] - points_Probe[0][pointIndex];
+    const double dy = m10 * x[pointIndex] + m11 * y[pointIndex] + m12 * z[pointIndex] + m13 * w[pointIndex] - points_Probe[1][pointIndex];
+    const double dz = m20 * x[pointIndex] + m21 * y[pointIndex] + m22 * z[pointIndex] + m23 * w[pointIndex] - points_Probe[2][pointIndex];
+    const double dw = m30 * x[pointIndex] + m31 * y[pointIndex] + m32 * z[pointIndex] + m33 * w[pointIndex] - points_Probe[3][pointIndex];
+    errors[pointIndex] = sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
   }
 }
 
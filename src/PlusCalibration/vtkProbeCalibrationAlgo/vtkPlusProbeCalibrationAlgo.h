@@ -77,6 +77,51 @@ public:
   /*! Get the calibration result transformation matrix */
   void GetImageToProbeTransformMatrix( vtkMatrix4x4* imageToProbeMatrix );
 
+  /*!
+    Start live calibration: clear the calibration data. Segmented frames can then be added one by one by AddLiveCalibrationFrame
+    and the linear least squares calibration result is updated after each added frame. When all frames are added,
+    FinalizeLiveCalibration computes the final result.
+    \param nWires NWire structure that contains the computed imaginary intersections. It used to determine the computed position
+  */
+  PlusStatus StartLiveCalibration( const std::vector<PlusNWire>& nWires );
+
+  /*!
+    Add a segmented frame to the live calibration and update the calibration result if there are enough frames.
+    Frames are accumulated in the normal equations of the linear least squares problem and the result is solved from the
+    accumulated normal equations, therefore the cost of the update does not depend on the number of collected frames.
+    Outliers are not rejected and the error is not computed until FinalizeLiveCalibration is called.
+    \param trackedFrame The actual tracked frame (already segmented) to add for calibration
+    \param transformRepository Transform repository object to be able to get the default transform
+  */
+  PlusStatus AddLiveCalibrationFrame( igsioTrackedFrame* trackedFrame, vtkIGSIOTransformRepository* transformRepository );
+
+  /*!
+    Get the current live calibration result (without outlier rejection). Returns with failure if not enough frames have been added since StartLiveCalibration.
+    \param imageToProbeTransformMatrix Calibration result computed by the linear least squares method from all the added frames
+  */
+  PlusStatus GetLiveCalibrationResult( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix );
+
+  /*!
+    Get the current live calibration result (without outlier rejection) and its error. Returns with failure if not enough frames have been added since StartLiveCalibration.
+    \param imageToProbeTransformMatrix Calibration result computed by the linear least squares method from all the added frames
+    \param reprojectionError3DRms RMS of the 3D reprojection errors (OPE) of all the added middle wire points with this result. It is computed
+      from the accumulated normal equations, so it is available in constant time after each added frame.
+  */
+  PlusStatus GetLiveCalibrationResult( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DRms );
+
+  /*!
+    Compute the final live calibration result: reject the outliers, compute the linear least squares calibration from the remaining
+    points and compute the 3D reprojection error of all the calibration frames. The result is the same as the result of the linear
+    least squares method in Calibrate. Frames can still be added after finalization.
+    \param imageToProbeTransformMatrix Calibration result computed by the linear least squares method with outlier rejection
+    \param reprojectionError3DMean Mean of the 3D reprojection errors (OPE) of all the calibration frames
+    \param reprojectionError3DStdDev Standard deviation of the 3D reprojection errors (OPE) of all the calibration frames
+  */
+  PlusStatus FinalizeLiveCalibration( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DMean, double& reprojectionError3DStdDev );
+
+  /*! Get the number of frames (with successfully segmented fiducials) that are used in the live calibration */
+  int GetNumberOfLiveCalibrationFrames();
+
   /*! Set the calibration date and time in string format */
   vtkSetStringMacro( CalibrationDate );
   /*! Get the calibration date and time in string format */
@@ -122,6 +167,24 @@ public:
   void ComputeError2d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
   void ComputeError3d( const vnl_matrix_fixed<double, 4, 4>& imageToProbeMatrix, double& errorMean, double& errorStDev, double& errorRms );
 
+  /*!
+    Compute the 2D reprojection errors of the wires in a frame: difference between the segmented positions and the intersections of the wires with the image plane.
+    All arrays contain one element per wire. There is no dependency between the wires, so the loop can be vectorized by the compiler.
+    The wire end points may be given in any frame (e.g., in the probe frame by the optimizer), phantomToImageTransform shall transform them to the image frame.
+    \param phantomToImageTransform Transform from the phantom frame to the image frame
+    \param numberOfWires Number of wires (number of elements in each array)
+    \param wireEndPointsFront_Phantom X, Y and Z coordinate arrays of the front end points of the wires in the phantom frame
+    \param wireEndPointsBack_Phantom X, Y and Z coordinate arrays of the back end points of the wires in the phantom frame
+    \param segmentedX_Image X coordinates of the segmented points in the image frame
+    \param segmentedY_Image Y coordinates of the segmented points in the image frame
+    \param errorsX_Image Output X coordinates of the errors (segmented - computed position)
+    \param errorsY_Image Output Y coordinates of the errors (segmented - computed position)
+    \param intersectionValid Output flags, 0 if the wire is parallel to the image plane (the error is undefined in this case)
+  */
+  static void ComputeWireIntersectionErrors2D( const vnl_matrix_fixed<double, 4, 4>& phantomToImageTransform, unsigned int numberOfWires,
+      const double* const wireEndPointsFront_Phantom[3], const double* const wireEndPointsBack_Phantom[3],
+      const double* segmentedX_Image, const double* segmentedY_Image, double* errorsX_Image, double* errorsY_Image, unsigned char* intersectionValid );
+
 protected:
 
   enum PreProcessedWirePositionIdType
@@ -183,11 +246,40 @@ protected:
   */
   PlusStatus ComputeImageToProbeTransformByLinearLeastSquaresMethod( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, std::set<int>& outliers );
 
+  /*!
+    Compute the ImageToProbe matrix from the accumulated normal equations of all the calibration points, without outlier rejection
+    \param reprojectionError3DRms RMS of the 3D reprojection errors of the calibration points, computed from the normal equations
+  */
+  PlusStatus ComputeImageToProbeTransformFromNormalEquations( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix, double& reprojectionError3DRms );
+
+  /*!
+    Solve the normal equations of one row of the ImageToProbe matrix. The z coordinate of the segmented points is always 0,
+    therefore the normal matrix is singular and the minimum norm solution is computed.
+  */
+  static PlusStatus SolveNormalEquations( const vnl_matrix<double>& normalMatrix, const vnl_vector<double>& normalVector, vnl_vector<double>& resultVector );
+
+  /*! Set the last row to (0,0,0,1) and the z axis to the cross product of the x and y axes, so that the projection matrix becomes a 3D-3D transform */
+  static void CompleteImageToProbeTransformMatrix( vnl_matrix_fixed<double, 4, 4>& imageToProbeTransformMatrix );
+
   /*! Remove outliers from calibration data
   */
   void UpdateNonOutlierData( const std::set<int>& outliers );
 
-  static double PointToWireDistance( const vnl_double_3& aPoint, const vnl_double_3& aLineEndPoint1, const vnl_double_3& aLineEndPoint2 );
+  /*! Pass the non-outlier calibration data to the optimizer, as required by its optimization method
+  */
+  PlusStatus SetOptimizerInputData( const vnl_matrix_fixed<double, 4, 4>& imageToProbeSeedTransformMatrix );
+
+  /*!
+    Compute the 3D reprojection errors of the middle wire points: distances between the segmented positions transformed to the probe frame
+    and the positions computed from the phantom geometry. All arrays contain one element per point.
+    \param imageToProbeTransform Transform from the image frame to the probe frame
+    \param numberOfPoints Number of points (number of elements in each array)
+    \param points_Image X, Y, Z and W coordinate arrays of the segmented points in the image frame
+    \param points_Probe X, Y, Z and W coordinate arrays of the computed points in the probe frame
+    \param errors Output distances
+  */
+  static void ComputeMiddleWireErrors3D( const vnl_matrix_fixed<double, 4, 4>& imageToProbeTransform, unsigned int numberOfPoints,
+                                         const double* const points_Image[4], const double* const points_Probe[4], double* errors );
 
 protected:
   /*! Set the image coordinate frame name */
@@ -225,6 +317,16 @@ protected:
   /*! List of NWires used for calibration and error computation */
   std::vector<PlusNWire> NWires;
 
+  /*!
+    Front and back end points of all the wires in the phantom frame, in the same order as the segmented points (nwire x 3 values per coordinate)
+    indices: [x/y/z][wire]
+  */
+  std::vector<double> WireEndPointsFront_Phantom[3];
+  std::vector<double> WireEndPointsBack_Phantom[3];
+
+  /*! Set the NWires used for calibration and update the wire end point arrays */
+  void SetNWires( const std::vector<PlusNWire>& nWires );
+
   /*! Stores wire intersection positions for each frame. */
   struct NWirePositionType
   {
@@ -245,6 +347,45 @@ protected:
     vnl_matrix_fixed<double, 4, 4> ProbeToPhantomTransform;
   };
 
+  /*!
+    Wire intersection positions of all frames of a dataset in structure-of-arrays layout (one contiguous array per coordinate),
+    used for computing the errors of all points in tight loops. Contains the same data as the list of NWirePositionType.
+  */
+  struct WirePositionArraysType
+  {
+    /*!
+      Segmented point positions of all the wires in the image frame
+      indices: [frame * nwire * 3 + wire]
+    */
+    std::vector<double> AllWiresX_Image;
+    std::vector<double> AllWiresY_Image;
+
+    /*!
+      Segmented middle wire positions in the image frame and computed middle wire positions in the probe frame (homogeneous coordinates)
+      indices: [x/y/z/w][frame * nwire + nWire]
+    */
+    std::vector<double> MiddleWires_Image[4];
+    std::vector<double> MiddleWires_Probe[4];
+
+    /*!
+      Inverse of the probe to phantom transform of each frame
+      indices: [frame]
+    */
+    std::vector< vnl_matrix_fixed<double, 4, 4> > PhantomToProbeTransforms;
+
+    void Clear()
+    {
+      AllWiresX_Image.clear();
+      AllWiresY_Image.clear();
+      for ( int i = 0; i < 4; ++i )
+      {
+        MiddleWires_Image[i].clear();
+        MiddleWires_Probe[i].clear();
+      }
+      PhantomToProbeTransforms.clear();
+    }
+  };
+
   struct NWireErrorType
   {
     /*!
@@ -293,11 +434,13 @@ protected:
   struct PreProcessedWirePositionsType
   {
     std::vector<NWirePositionType> FramePositions;
+    WirePositionArraysType WirePositionArrays;
     NWireErrorType NWireErrors;
 
     void Clear()
     {
       FramePositions.clear();
+      WirePositionArrays.Clear();
 
       NWireErrors.ReprojectionError3Ds.clear();
       NWireErrors.ReprojectionError2Ds.clear();
@@ -308,6 +451,33 @@ protected:
 
   PreProcessedWirePositionsType PreProcessedWirePositions[LAST_PREPROCESSED_WIRE_POS_ID];
 
+  /*! Add the wire positions of a frame to a dataset (both to the frame list and to the wire position arrays) */
+  void AddFramePosition( PreProcessedWirePositionIdType datasetType, const NWirePositionType& framePosition );
+
+  /*! Clear the normal equations of the linear least squares problem */
+  void ClearNormalEquations();
+
+  /*! Add the middle wire positions of a calibration frame to the normal equations of the linear least squares problem */
+  void AddFramePositionToNormalEquations( const NWirePositionType& framePosition );
+
+  /*!
+    Normal equations of the linear least squares problem of the ImageToProbe matrix, accumulated from the middle wire positions
+    of all the calibration frames (CALIBRATION_ALL). The matrix row i is the solution of NormalMatrix * x = NormalVectors.get_column(i).
+    NormalMatrix = sum(p_Image * p_Image^T), NormalVectors = sum(p_Image * p_Probe^T)
+    NormalTargetSquareSums(i) = sum(p_Probe(i)^2), so that the sum of squared residuals of row i with the solution x is
+    NormalTargetSquareSums(i) - 2 * x^T * NormalVectors.get_column(i) + x^T * NormalMatrix * x
+  */
+  vnl_matrix_fixed<double, 4, 4> NormalMatrix;
+  vnl_matrix_fixed<double, 4, 4> NormalVectors;
+  vnl_vector_fixed<double, 4> NormalTargetSquareSums;
+  /*! Number of points accumulated in the normal equations */
+  int NumberOfNormalEquationPoints;
+
+  /*! Live calibration result without outlier rejection, valid if LiveCalibrationResultAvailable is true */
+  bool LiveCalibrationResultAvailable;
+  vnl_matrix_fixed<double, 4, 4> LiveImageToProbeTransformMatrix;
+  double LiveReprojectionError3DRms;
+
   /*!
     Confidence level (trusted zone) as a percentage of the independent validation data used to produce the final error computation results.  It serves as an effective way to get rid of corrupted data
     (or outliers) in the validation dataset. Default value: 0.95 (or 95%), meaning the top ranked 95% of the ascendingly-ordered PRE values from the validation data would be accepted as the valid PRE values.
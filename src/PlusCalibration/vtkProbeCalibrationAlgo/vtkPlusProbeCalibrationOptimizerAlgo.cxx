@@ -13,6 +13,7 @@ See License.txt for details.
 #include "vtkPlusProbeCalibrationOptimizerAlgo.h"
 #include "vtkPlusProbeCalibrationAlgo.h"
 #include "vtkTransform.h"
+#include "vtkIGSIOAccurateTimer.h"
 #include "vtkIGSIOTransformRepository.h"
 #include "vtkXMLUtilities.h"
 
@@ -22,8 +23,20 @@ See License.txt for details.
 #include "itkScaleVersor3DTransform.h"
 #include "itkSimilarity3DTransform.h"
 
+#include "vnl/vnl_inverse.h"
+#include "vnl/algo/vnl_svd.h"
+
+#include <algorithm>
+
 typedef  itk::PowellOptimizer  OptimizerType;
 
+// Levenberg-Marquardt optimizer parameters
+static const int LM_MAX_ITERATIONS = 100;
+static const double LM_MIN_LAMBDA = 1e-10;
+static const double LM_MAX_LAMBDA = 1e12;
+static const double LM_COST_TOLERANCE = 1e-10;
+static const double LM_STEP_TOLERANCE = 1e-10;
+
 //-----------------------------------------------------------------------------
 class DistanceToWiresCostFunction : public itk::SingleValuedCostFunction
 {
@@ -166,6 +179,9 @@ vtkStandardNewMacro(vtkPlusProbeCalibrationOptimizerAlgo);
 vtkPlusProbeCalibrationOptimizerAlgo::vtkPlusProbeCalibrationOptimizerAlgo()
 : IsotropicPixelSpacing(true)
 , ProbeCalibrationAlgo(NULL)
+, OptimizationAlgorithm(POWELL)
+, RobustLoss(ROBUST_LOSS_NONE)
+, RobustLossScale(1.0)
 {
 }
 
@@ -253,6 +269,59 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
     igsioMath::LogVtkMatrix(vtkMatrix);
   }
 
+  double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+  PlusStatus status = PLUS_FAIL;
+  switch (this->OptimizationAlgorithm)
+  {
+  case POWELL:
+    status = OptimizeWithPowell();
+    break;
+  case LEVENBERG_MARQUARDT:
+    status = OptimizeWithLevenbergMarquardt();
+    break;
+  default:
+    LOG_ERROR("Invalid optimization algorithm");
+  }
+  if (status != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Optimization time: " << vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec << " sec");
+
+  // Store the matrix
+  {
+    vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
+    PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix, vtkMatrix);
+    igsioMath::LogVtkMatrix(vtkMatrix);
+  }
+
+  // Store the optimized parameters and show the results
+  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod));
+
+  LOG_INFO("Without optimization:");
+  ShowTransformation(this->ImageToProbeSeedTransformMatrix);
+
+  LOG_INFO("With optimization:");
+  ShowTransformation(this->ImageToProbeTransformMatrix);
+
+  vtkSmartPointer<vtkMatrix4x4> imageToProbeSeedTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> imageToProbeTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
+  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeSeedTransformMatrix,imageToProbeSeedTransformMatrixVtk);
+  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix,imageToProbeTransformMatrixVtk);
+  double angleDifference = igsioMath::GetOrientationDifference(imageToProbeSeedTransformMatrixVtk, imageToProbeTransformMatrixVtk);
+  LOG_INFO("Orientation difference between unoptimized and optimized matrices =  " << angleDifference << " deg");
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::OptimizeWithPowell()
+{
+  DistanceToWiresCostFunction::Pointer costFunction = new DistanceToWiresCostFunction(this);
+
+  DistanceToWiresCostFunction::ParametersType imageToProbeSeedTransformParameters(costFunction->GetNumberOfParameters());
+  DistanceToWiresCostFunction::GetTransformParameters(imageToProbeSeedTransformParameters, this->ImageToProbeSeedTransformMatrix);
+
   auto optimizer = OptimizerType::New();
   try
   {
@@ -318,31 +387,469 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::Update()
   std::string stopCondition=optimizer->GetStopConditionDescription();
   LOG_INFO("Optimization stopping condition: "<<stopCondition<<". Number of iterations: " << optimizer->GetCurrentIteration());
 
+  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, optimizer->GetCurrentPosition());
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::OptimizeWithLevenbergMarquardt()
+{
+  if ((this->OptimizationMethod == MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D && this->MiddleWirePoints_Image.empty())
+    || (this->OptimizationMethod == MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D && this->WireSegmentedX_Image.empty()))
+  {
+    LOG_ERROR("Levenberg-Marquardt optimization failed: input data is not set");
+    return PLUS_FAIL;
+  }
+  if (this->OptimizationMethod != MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D && this->OptimizationMethod != MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D)
+  {
+    LOG_ERROR("Invalid cost function");
+    return PLUS_FAIL;
+  }
+
+  // Start from the same constrained (orthogonal, with the required scaling) transform as the Powell optimizer
+  const unsigned int numberOfScales = (this->IsotropicPixelSpacing ? 1 : 2);
+  DistanceToWiresCostFunction::ParametersType imageToProbeSeedTransformParameters(6 + numberOfScales);
+  DistanceToWiresCostFunction::GetTransformParameters(imageToProbeSeedTransformParameters, this->ImageToProbeSeedTransformMatrix);
+  vnl_matrix_fixed<double,4,4> imageToProbeSeedTransform;
+  DistanceToWiresCostFunction::GetTransformMatrix(imageToProbeSeedTransform, imageToProbeSeedTransformParameters);
+
+  vnl_vector<double> scales(numberOfScales);
+  for (unsigned int i = 0; i < numberOfScales; ++i)
+  {
+    scales[i] = imageToProbeSeedTransformParameters[6 + i];
+  }
+  double columnScales[3] = { scales[0], scales[numberOfScales - 1], (scales[0] + scales[numberOfScales - 1]) / 2.0 };
+  vnl_matrix_fixed<double,3,3> rotation;
+  vnl_vector_fixed<double,3> translation;
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      rotation(row, column) = imageToProbeSeedTransform(row, column) / columnScales[column];
+    }
+    translation[row] = imageToProbeSeedTransform(row, 3);
+  }
+
+  const unsigned int numberOfParameters = 6 + numberOfScales;
+  const unsigned int residualDimension = GetResidualDimension();
+  vnl_vector<double> residuals;
+  vnl_matrix<double> jacobian;
+  ComputeResiduals(rotation, translation, scales, residuals, &jacobian);
+  const unsigned int numberOfPoints = residuals.size() / residualDimension;
+
+  double cost = 0;
+  for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    cost += ComputeRobustLoss(residuals.extract(residualDimension, pointIndex * residualDimension).magnitude());
+  }
+
+  double lambda = 1e-3;
+  int iteration = 0;
+  std::string stopCondition = "maximum number of iterations reached";
+  for (iteration = 0; iteration < LM_MAX_ITERATIONS; ++iteration)
+  {
+    // Weighted normal equations: (J^T W J) delta = -J^T W r
+    vnl_matrix<double> normalMatrix(numberOfParameters, numberOfParameters, 0.0);
+    vnl_vector<double> normalVector(numberOfParameters, 0.0);
+    for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      double weight = ComputeRobustLossWeight(residuals.extract(residualDimension, pointIndex * residualDimension).magnitude());
+      for (unsigned int component = 0; component < residualDimension; ++component)
+      {
+        const unsigned int row = pointIndex * residualDimension + component;
+        for (unsigned int i = 0; i < numberOfParameters; ++i)
+        {
+          double weightedJacobian = weight * jacobian(row, i);
+          normalVector[i] -= weightedJacobian * residuals[row];
+          for (unsigned int j = i; j < numberOfParameters; ++j)
+          {
+            normalMatrix(i, j) += weightedJacobian * jacobian(row, j);
+          }
+        }
+      }
+    }
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      for (unsigned int j = 0; j < i; ++j)
+      {
+        normalMatrix(i, j) = normalMatrix(j, i);
+      }
+    }
+
+    // Increase the damping until a step is found that decreases the cost
+    bool stepAccepted = false;
+    double costDecrease = 0;
+    vnl_vector<double> delta;
+    while (!stepAccepted && lambda <= LM_MAX_LAMBDA)
+    {
+      vnl_matrix<double> dampedNormalMatrix = normalMatrix;
+      for (unsigned int i = 0; i < numberOfParameters; ++i)
+      {
+        dampedNormalMatrix(i, i) += lambda * std::max(normalMatrix(i, i), 1e-12);
+      }
+      delta = vnl_svd<double>(dampedNormalMatrix).solve(normalVector);
+
+      double rotationIncrement[4] = { 1.0, delta[0] / 2.0, delta[1] / 2.0, delta[2] / 2.0 };
+      double rotationIncrementNorm = sqrt(rotationIncrement[0] * rotationIncrement[0] + rotationIncrement[1] * rotationIncrement[1]
+        + rotationIncrement[2] * rotationIncrement[2] + rotationIncrement[3] * rotationIncrement[3]);
+      for (int i = 0; i < 4; ++i)
+      {
+        rotationIncrement[i] /= rotationIncrementNorm;
+      }
+      double rotationIncrementMatrix[3][3];
+      vtkMath::QuaternionToMatrix3x3(rotationIncrement, rotationIncrementMatrix);
+      vnl_matrix_fixed<double,3,3> candidateRotation = rotation * vnl_matrix_fixed<double,3,3>(&rotationIncrementMatrix[0][0]);
+      vnl_vector_fixed<double,3> candidateTranslation(translation[0] + delta[3], translation[1] + delta[4], translation[2] + delta[5]);
+      vnl_vector<double> candidateScales = scales + delta.extract(numberOfScales, 6);
+
+      vnl_vector<double> candidateResiduals;
+      ComputeResiduals(candidateRotation, candidateTranslation, candidateScales, candidateResiduals, NULL);
+      double candidateCost = 0;
+      for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+      {
+        candidateCost += ComputeRobustLoss(candidateResiduals.extract(residualDimension, pointIndex * residualDimension).magnitude());
+      }
+
+      if (candidateCost < cost)
+      {
+        costDecrease = cost - candidateCost;
+        cost = candidateCost;
+        rotation = candidateRotation;
+        translation = candidateTranslation;
+        scales = candidateScales;
+        lambda = std::max(lambda / 10.0, LM_MIN_LAMBDA);
+        stepAccepted = true;
+      }
+      else
+      {
+        lambda *= 10.0;
+      }
+    }
+
+    if (!stepAccepted)
+    {
+      stopCondition = "cost function cannot be decreased further";
+      break;
+    }
+    if (costDecrease <= LM_COST_TOLERANCE * cost || delta.inf_norm() <= LM_STEP_TOLERANCE)
+    {
+      ++iteration;
+      stopCondition = "cost function converged";
+      break;
+    }
+    ComputeResiduals(rotation, translation, scales, residuals, &jacobian);
+  }
+
+  LOG_INFO("Optimization stopping condition: " << stopCondition << ". Number of iterations: " << iteration);
+
   // Store the matrix
+  columnScales[0] = scales[0];
+  columnScales[1] = scales[numberOfScales - 1];
+  columnScales[2] = (scales[0] + scales[numberOfScales - 1]) / 2.0;
+  this->ImageToProbeTransformMatrix.set_identity();
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      this->ImageToProbeTransformMatrix(row, column) = rotation(row, column) * columnScales[column];
+    }
+    this->ImageToProbeTransformMatrix(row, 3) = translation[row];
+  }
+  return PLUS_SUCCESS;
+}
 
-  costFunction->GetTransformMatrix(this->ImageToProbeTransformMatrix, optimizer->GetCurrentPosition());
+//----------------------------------------------------------------------------
+unsigned int vtkPlusProbeCalibrationOptimizerAlgo::GetResidualDimension()
+{
+  // 3D method: point position error in the probe frame, 2D method: point position error in the image plane
+  return (this->OptimizationMethod == MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D ? 3 : 2);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusProbeCalibrationOptimizerAlgo::ComputeResiduals(const vnl_matrix_fixed<double,3,3>& rotation, const vnl_vector_fixed<double,3>& translation, const vnl_vector<double>& scales,
+  vnl_vector<double>& residuals, vnl_matrix<double>* jacobian)
+{
+  const unsigned int numberOfScales = scales.size();
+  const unsigned int numberOfParameters = 6 + numberOfScales;
+  const double columnScales[3] = { scales[0], scales[numberOfScales - 1], (scales[0] + scales[numberOfScales - 1]) / 2.0 };
+
+  if (this->OptimizationMethod == MINIMIZE_DISTANCE_OF_MIDDLE_WIRES_IN_3D)
   {
-    vtkSmartPointer<vtkMatrix4x4> vtkMatrix=vtkSmartPointer<vtkMatrix4x4>::New();
-    PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix, vtkMatrix);
-    igsioMath::LogVtkMatrix(vtkMatrix);
+    // residual = rotation * diag(scales) * point_Image + translation - point_Probe
+    const unsigned int numberOfPoints = this->MiddleWirePoints_Image.size();
+    residuals.set_size(numberOfPoints * 3);
+    if (jacobian != NULL)
+    {
+      jacobian->set_size(numberOfPoints * 3, numberOfParameters);
+      jacobian->fill(0.0);
+    }
+    for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      const vnl_vector_fixed<double,3>& point_Image = this->MiddleWirePoints_Image[pointIndex];
+      vnl_vector_fixed<double,3> scaledPoint(point_Image[0] * columnScales[0], point_Image[1] * columnScales[1], point_Image[2] * columnScales[2]);
+      vnl_vector_fixed<double,3> residual = rotation * scaledPoint + translation - this->MiddleWirePoints_Probe[pointIndex];
+      for (unsigned int row = 0; row < 3; ++row)
+      {
+        residuals[pointIndex * 3 + row] = residual[row];
+      }
+      if (jacobian == NULL)
+      {
+        continue;
+      }
+      for (unsigned int row = 0; row < 3; ++row)
+      {
+        const unsigned int jacobianRow = pointIndex * 3 + row;
+        // rotation: d(R * exp(w) * p)/dw = -R * [p]x
+        (*jacobian)(jacobianRow, 0) = rotation(row, 2) * scaledPoint[1] - rotation(row, 1) * scaledPoint[2];
+        (*jacobian)(jacobianRow, 1) = rotation(row, 0) * scaledPoint[2] - rotation(row, 2) * scaledPoint[0];
+        (*jacobian)(jacobianRow, 2) = rotation(row, 1) * scaledPoint[0] - rotation(row, 0) * scaledPoint[1];
+        // translation
+        (*jacobian)(jacobianRow, 3 + row) = 1.0;
+        // scaling
+        if (numberOfScales == 1)
+        {
+          (*jacobian)(jacobianRow, 6) = rotation(row, 0) * point_Image[0] + rotation(row, 1) * point_Image[1] + rotation(row, 2) * point_Image[2];
+        }
+        else
+        {
+          (*jacobian)(jacobianRow, 6) = rotation(row, 0) * point_Image[0] + 0.5 * rotation(row, 2) * point_Image[2];
+          (*jacobian)(jacobianRow, 7) = rotation(row, 1) * point_Image[1] + 0.5 * rotation(row, 2) * point_Image[2];
+        }
+      }
+    }
+    return;
   }
 
-  // Store the optimized parameters and show the results
-  LOG_INFO("Cost function = " << GetOptimizationMethodAsString(this->OptimizationMethod));
+  // 2D method: residual = segmented position - intersection of the wire and the image plane
+  const unsigned int numberOfPoints = this->WireSegmentedX_Image.size();
+  residuals.set_size(numberOfPoints * 2);
+  if (jacobian != NULL)
+  {
+    jacobian->set_size(numberOfPoints * 2, numberOfParameters);
+    jacobian->fill(0.0);
+  }
 
-  LOG_INFO("Without optimization:");
-  ShowTransformation(this->ImageToProbeSeedTransformMatrix);
+  // Wire end points in the image frame: diag(scales)^-1 * rotation^T * (point_Probe - translation)
+  vnl_matrix_fixed<double,3,3> rotationTransposed = rotation.transpose();
+  vnl_vector_fixed<double,3> translationRotated = rotationTransposed * translation;
+  vnl_matrix_fixed<double,4,4> probeToImageTransform;
+  probeToImageTransform.set_identity();
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      probeToImageTransform(row, column) = rotationTransposed(row, column) / columnScales[row];
+    }
+    probeToImageTransform(row, 3) = -translationRotated[row] / columnScales[row];
+  }
 
-  LOG_INFO("With optimization:");
-  ShowTransformation(this->ImageToProbeTransformMatrix);
+  // Compute the residuals of all points with the same kernel as the calibration error computation
+  const double* const wireEndPointsFront_Probe[3] = { this->WireEndPointsFront_Probe[0].data(), this->WireEndPointsFront_Probe[1].data(), this->WireEndPointsFront_Probe[2].data() };
+  const double* const wireEndPointsBack_Probe[3] = { this->WireEndPointsBack_Probe[0].data(), this->WireEndPointsBack_Probe[1].data(), this->WireEndPointsBack_Probe[2].data() };
+  std::vector<double> errorsX_Image(numberOfPoints);
+  std::vector<double> errorsY_Image(numberOfPoints);
+  std::vector<unsigned char> intersectionValid(numberOfPoints);
+  vtkPlusProbeCalibrationAlgo::ComputeWireIntersectionErrors2D(probeToImageTransform, numberOfPoints, wireEndPointsFront_Probe, wireEndPointsBack_Probe,
+    this->WireSegmentedX_Image.data(), this->WireSegmentedY_Image.data(), errorsX_Image.data(), errorsY_Image.data(), intersectionValid.data());
 
-  vtkSmartPointer<vtkMatrix4x4> imageToProbeSeedTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
-  vtkSmartPointer<vtkMatrix4x4> imageToProbeTransformMatrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
-  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeSeedTransformMatrix,imageToProbeSeedTransformMatrixVtk);
-  PlusMath::ConvertVnlMatrixToVtkMatrix(this->ImageToProbeTransformMatrix,imageToProbeTransformMatrixVtk);
-  double angleDifference = igsioMath::GetOrientationDifference(imageToProbeSeedTransformMatrixVtk, imageToProbeTransformMatrixVtk);
-  LOG_INFO("Orientation difference between unoptimized and optimized matrices =  " << angleDifference << " deg");
+  for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    if (!intersectionValid[pointIndex])
+    {
+      // the wire is parallel to the image plane, there is no intersection point
+      residuals[pointIndex * 2] = 0.0;
+      residuals[pointIndex * 2 + 1] = 0.0;
+      continue;
+    }
+    residuals[pointIndex * 2] = errorsX_Image[pointIndex];
+    residuals[pointIndex * 2 + 1] = errorsY_Image[pointIndex];
+    if (jacobian == NULL)
+    {
+      continue;
+    }
+
+    vnl_vector_fixed<double,3> wireEndPointFront_Probe(wireEndPointsFront_Probe[0][pointIndex], wireEndPointsFront_Probe[1][pointIndex], wireEndPointsFront_Probe[2][pointIndex]);
+    vnl_vector_fixed<double,3> wireEndPointBack_Probe(wireEndPointsBack_Probe[0][pointIndex], wireEndPointsBack_Probe[1][pointIndex], wireEndPointsBack_Probe[2][pointIndex]);
+    vnl_vector_fixed<double,3> endPointsRotated[2] =
+    {
+      rotationTransposed * (wireEndPointFront_Probe - translation),
+      rotationTransposed * (wireEndPointBack_Probe - translation)
+    };
+    vnl_vector_fixed<double,3> endPoints_Image[2];
+    for (int endPointIndex = 0; endPointIndex < 2; ++endPointIndex)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        endPoints_Image[endPointIndex][i] = endPointsRotated[endPointIndex][i] / columnScales[i];
+      }
+    }
+    const vnl_vector_fixed<double,3>& a = endPoints_Image[0];
+    const vnl_vector_fixed<double,3>& b = endPoints_Image[1];
+    double denominator = a[2] - b[2];
+    double t = a[2] / denominator; // intersection = a + t * (b - a)
+
+    // Derivatives of the end point positions in the image frame
+    vnl_matrix<double> endPointDerivatives[2] = { vnl_matrix<double>(3, numberOfParameters, 0.0), vnl_matrix<double>(3, numberOfParameters, 0.0) };
+    for (int endPointIndex = 0; endPointIndex < 2; ++endPointIndex)
+    {
+      const vnl_vector_fixed<double,3>& u = endPointsRotated[endPointIndex];
+      const vnl_vector_fixed<double,3>& p = endPoints_Image[endPointIndex];
+      vnl_matrix<double>& derivative = endPointDerivatives[endPointIndex];
+      for (int i = 0; i < 3; ++i)
+      {
+        // rotation: d(exp(-w) * u)/dw = [u]x
+        const double skewU[3][3] = { { 0, -u[2], u[1] }, { u[2], 0, -u[0] }, { -u[1], u[0], 0 } };
+        for (int j = 0; j < 3; ++j)
+        {
+          derivative(i, j) = skewU[i][j] / columnScales[i];
+          // translation
+          derivative(i, 3 + j) = -rotation(j, i) / columnScales[i];
+        }
+      }
+      // scaling
+      if (numberOfScales == 1)
+      {
+        for (int i = 0; i < 3; ++i)
+        {
+          derivative(i, 6) = -p[i] / columnScales[i];
+        }
+      }
+      else
+      {
+        derivative(0, 6) = -p[0] / columnScales[0];
+        derivative(2, 6) = -0.5 * p[2] / columnScales[2];
+        derivative(1, 7) = -p[1] / columnScales[1];
+        derivative(2, 7) = -0.5 * p[2] / columnScales[2];
+      }
+    }
+    for (unsigned int parameterIndex = 0; parameterIndex < numberOfParameters; ++parameterIndex)
+    {
+      double da[3] = { endPointDerivatives[0](0, parameterIndex), endPointDerivatives[0](1, parameterIndex), endPointDerivatives[0](2, parameterIndex) };
+      double db[3] = { endPointDerivatives[1](0, parameterIndex), endPointDerivatives[1](1, parameterIndex), endPointDerivatives[1](2, parameterIndex) };
+      double dt = (a[2] * db[2] - b[2] * da[2]) / (denominator * denominator);
+      for (int i = 0; i < 2; ++i)
+      {
+        (*jacobian)(pointIndex * 2 + i, parameterIndex) = -((1.0 - t) * da[i] + t * db[i] + (b[i] - a[i]) * dt);
+      }
+    }
+  }
+}
 
+//----------------------------------------------------------------------------
+double vtkPlusProbeCalibrationOptimizerAlgo::ComputeRobustLoss(double residualLength)
+{
+  const double scale = this->RobustLossScale;
+  switch (this->RobustLoss)
+  {
+  case ROBUST_LOSS_HUBER:
+    return (residualLength <= scale ? 0.5 * residualLength * residualLength : scale * (residualLength - 0.5 * scale));
+  case ROBUST_LOSS_CAUCHY:
+    return 0.5 * scale * scale * log(1.0 + (residualLength / scale) * (residualLength / scale));
+  default:
+    return 0.5 * residualLength * residualLength;
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusProbeCalibrationOptimizerAlgo::ComputeRobustLossWeight(double residualLength)
+{
+  const double scale = this->RobustLossScale;
+  switch (this->RobustLoss)
+  {
+  case ROBUST_LOSS_HUBER:
+    return (residualLength <= scale ? 1.0 : scale / residualLength);
+  case ROBUST_LOSS_CAUCHY:
+    return 1.0 / (1.0 + (residualLength / scale) * (residualLength / scale));
+  default:
+    return 1.0;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::SetInputDataForMiddlePointMethod(std::vector< vnl_vector<double> > *calibrationMiddleWireIntersectionPointsPos_Image, std::vector< vnl_vector<double> > *calibrationMiddleWireIntersectionPointsPos_Probe, vnl_matrix_fixed<double,4,4> *imageToProbeTransformMatrix, std::set<int>* outliers)
+{
+  this->MiddleWirePoints_Image.clear();
+  this->MiddleWirePoints_Probe.clear();
+  if (calibrationMiddleWireIntersectionPointsPos_Image == NULL || calibrationMiddleWireIntersectionPointsPos_Probe == NULL
+    || calibrationMiddleWireIntersectionPointsPos_Image->size() != calibrationMiddleWireIntersectionPointsPos_Probe->size())
+  {
+    LOG_ERROR("Invalid input data for the middle point optimization method");
+    return PLUS_FAIL;
+  }
+  for (unsigned int pointIndex = 0; pointIndex < calibrationMiddleWireIntersectionPointsPos_Image->size(); ++pointIndex)
+  {
+    if (outliers != NULL && outliers->find(pointIndex) != outliers->end())
+    {
+      continue;
+    }
+    const vnl_vector<double>& point_Image = (*calibrationMiddleWireIntersectionPointsPos_Image)[pointIndex];
+    const vnl_vector<double>& point_Probe = (*calibrationMiddleWireIntersectionPointsPos_Probe)[pointIndex];
+    this->MiddleWirePoints_Image.push_back(vnl_vector_fixed<double,3>(point_Image[0], point_Image[1], point_Image[2]));
+    this->MiddleWirePoints_Probe.push_back(vnl_vector_fixed<double,3>(point_Probe[0], point_Probe[1], point_Probe[2]));
+  }
+  if (imageToProbeTransformMatrix != NULL)
+  {
+    SetImageToProbeSeedTransform(*imageToProbeTransformMatrix);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::SetOptimizerDataUsingNWires(std::vector< vnl_vector<double> > *calibrationAllWiresIntersectionPointsPos_Image, std::vector<PlusNWire> *nWires, std::vector< vnl_matrix_fixed<double,4,4> > *probeToPhantomTransforms, vnl_matrix_fixed<double,4,4> *imageToProbeTransformMatrix, std::set<int>* outliers)
+{
+  this->WireSegmentedX_Image.clear();
+  this->WireSegmentedY_Image.clear();
+  for (int i = 0; i < 3; ++i)
+  {
+    this->WireEndPointsFront_Probe[i].clear();
+    this->WireEndPointsBack_Probe[i].clear();
+  }
+  if (calibrationAllWiresIntersectionPointsPos_Image == NULL || nWires == NULL || probeToPhantomTransforms == NULL
+    || calibrationAllWiresIntersectionPointsPos_Image->size() != probeToPhantomTransforms->size() * nWires->size() * 3)
+  {
+    LOG_ERROR("Invalid input data for the N-wire optimization method");
+    return PLUS_FAIL;
+  }
+  const unsigned int numberOfNWires = nWires->size();
+  for (unsigned int frameIndex = 0; frameIndex < probeToPhantomTransforms->size(); ++frameIndex)
+  {
+    bool outlier = false;
+    for (unsigned int nWireIndex = 0; outliers != NULL && nWireIndex < numberOfNWires; ++nWireIndex)
+    {
+      if (outliers->find(frameIndex * numberOfNWires + nWireIndex) != outliers->end())
+      {
+        // any of the nWires is an outlier, so skip the whole frame
+        outlier = true;
+        break;
+      }
+    }
+    if (outlier)
+    {
+      continue;
+    }
+    vnl_matrix_fixed<double,4,4> phantomToProbeTransform = vnl_inverse((*probeToPhantomTransforms)[frameIndex]);
+    for (unsigned int nWireIndex = 0; nWireIndex < numberOfNWires; ++nWireIndex)
+    {
+      for (int wireIndex = 0; wireIndex < 3; ++wireIndex)
+      {
+        const PlusFidWire& wire = (*nWires)[nWireIndex].GetWires()[wireIndex];
+        const vnl_vector<double>& segmentedPoint_Image = (*calibrationAllWiresIntersectionPointsPos_Image)[(frameIndex * numberOfNWires + nWireIndex) * 3 + wireIndex];
+        vnl_vector_fixed<double,4> wireEndPointFront_Probe = phantomToProbeTransform * vnl_vector_fixed<double,4>(wire.EndPointFront[0], wire.EndPointFront[1], wire.EndPointFront[2], 1.0);
+        vnl_vector_fixed<double,4> wireEndPointBack_Probe = phantomToProbeTransform * vnl_vector_fixed<double,4>(wire.EndPointBack[0], wire.EndPointBack[1], wire.EndPointBack[2], 1.0);
+        this->WireSegmentedX_Image.push_back(segmentedPoint_Image[0]);
+        this->WireSegmentedY_Image.push_back(segmentedPoint_Image[1]);
+        for (int i = 0; i < 3; ++i)
+        {
+          this->WireEndPointsFront_Probe[i].push_back(wireEndPointFront_Probe[i]);
+          this->WireEndPointsBack_Probe[i].push_back(wireEndPointBack_Probe[i]);
+        }
+      }
+    }
+  }
+  if (imageToProbeTransformMatrix != NULL)
+  {
+    SetImageToProbeSeedTransform(*imageToProbeTransformMatrix);
+  }
   return PLUS_SUCCESS;
 }
 
@@ -414,6 +921,14 @@ PlusStatus vtkPlusProbeCalibrationOptimizerAlgo::ReadConfiguration( vtkXMLDataEl
   }
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IsotropicPixelSpacing, aConfig);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(OptimizationAlgorithm, aConfig, "POWELL", POWELL, "LEVENBERG_MARQUARDT", LEVENBERG_MARQUARDT);
+  XML_READ_ENUM3_ATTRIBUTE_OPTIONAL(RobustLoss, aConfig, "NONE", ROBUST_LOSS_NONE, "HUBER", ROBUST_LOSS_HUBER, "CAUCHY", ROBUST_LOSS_CAUCHY);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, RobustLossScale, aConfig);
+  if (this->RobustLossScale <= 0)
+  {
+    LOG_WARNING("RobustLossScale must be positive, using 1.0 instead of " << this->RobustLossScale);
+    this->RobustLossScale = 1.0;
+  }
 
   return PLUS_SUCCESS;
 }
@@ -13,7 +13,10 @@ See License.txt for details.
 
 #include "PlusFidPatternRecognitionCommon.h"
 
+#include "vnl/vnl_vector_fixed.h"
+
 #include <set>
+#include <vector>
 
 class vtkXMLDataElement;
 class vtkPlusProbeCalibrationAlgo;
@@ -31,6 +34,13 @@ class vtkPlusProbeCalibrationAlgo;
   it is more accurate to optimize the in-plane (2D) error. Also this optimizer enforces orthogonality of the image to
   probe matrix and optionally it can enforce isotropic image pixel spacing.
 
+  The default POWELL optimization algorithm only uses the value of the cost function. The LEVENBERG_MARQUARDT
+  algorithm minimizes the sum of squared residuals (one residual vector per segmented point) using the analytic
+  Jacobian of the residuals, which requires much fewer cost function evaluations. Optionally a robust loss function
+  (HUBER or CAUCHY) can be applied to the residual vector lengths to reduce the influence of the outliers.
+  The LEVENBERG_MARQUARDT algorithm requires the input data to be set by SetInputDataForMiddlePointMethod (3D method)
+  or SetOptimizerDataUsingNWires (2D method).
+
   \ingroup PlusLibCalibrationAlgo
 */
 class vtkPlusProbeCalibrationOptimizerAlgo : public vtkObject
@@ -46,6 +56,21 @@ public:
     MINIMIZE_DISTANCE_OF_ALL_WIRES_IN_2D
   };  
 
+  /* Algorithm that is used for minimizing the cost function */
+  enum OptimizationAlgorithmType
+  {
+    POWELL,
+    LEVENBERG_MARQUARDT
+  };
+
+  /* Robust loss function that is applied to the residual lengths in the Levenberg-Marquardt optimization */
+  enum RobustLossType
+  {
+    ROBUST_LOSS_NONE,
+    ROBUST_LOSS_HUBER,
+    ROBUST_LOSS_CAUCHY
+  };
+
   vtkTypeMacro(vtkPlusProbeCalibrationOptimizerAlgo,vtkObject);
   static vtkPlusProbeCalibrationOptimizerAlgo *New();
 
@@ -75,6 +100,16 @@ public:
   void SetOptimizationMethod(OptimizationMethodType optimizationMethod) { this->OptimizationMethod=optimizationMethod; }
   static const char* GetOptimizationMethodAsString(OptimizationMethodType type);
 
+  OptimizationAlgorithmType GetOptimizationAlgorithm() { return this->OptimizationAlgorithm; }
+  void SetOptimizationAlgorithm(OptimizationAlgorithmType optimizationAlgorithm) { this->OptimizationAlgorithm=optimizationAlgorithm; }
+
+  RobustLossType GetRobustLoss() { return this->RobustLoss; }
+  void SetRobustLoss(RobustLossType robustLoss) { this->RobustLoss=robustLoss; }
+
+  /*! Residual length above which the robust loss function reduces the weight of the residuals (in mm for the 3D method, in pixels for the 2D method) */
+  double GetRobustLossScale() { return this->RobustLossScale; }
+  void SetRobustLossScale(double robustLossScale) { this->RobustLossScale=robustLossScale; }
+
   void SetImageToProbeSeedTransform(const vnl_matrix_fixed<double,4,4> &imageToProbeTransformMatrix);
 
   void SetProbeCalibrationAlgo(vtkPlusProbeCalibrationAlgo* probeCalibrationAlgo);
@@ -82,6 +117,28 @@ public:
 protected:
 
   PlusStatus ShowTransformation(const vnl_matrix_fixed<double,4,4> &transformationMatrix);
+
+  /*! Optimize the image to probe transform using the Powell optimizer */
+  PlusStatus OptimizeWithPowell();
+
+  /*! Optimize the image to probe transform using the Levenberg-Marquardt algorithm */
+  PlusStatus OptimizeWithLevenbergMarquardt();
+
+  /*!
+    Compute the residual vectors and optionally their Jacobian. The transform is defined as rotation * diag(scales) + translation.
+    The Jacobian columns correspond to a rotation vector applied after the rotation (3), translation (3), and scaling (1 or 2) increments.
+  */
+  void ComputeResiduals(const vnl_matrix_fixed<double,3,3>& rotation, const vnl_vector_fixed<double,3>& translation, const vnl_vector<double>& scales,
+    vnl_vector<double>& residuals, vnl_matrix<double>* jacobian);
+
+  /*! Number of residual vector components for each point */
+  unsigned int GetResidualDimension();
+
+  /*! Compute the robust loss of a residual vector length. Without robust loss it is the half of the squared length. */
+  double ComputeRobustLoss(double residualLength);
+
+  /*! Compute the weight of a residual vector in the iteratively reweighted normal equations */
+  double ComputeRobustLossWeight(double residualLength);
   
   vtkPlusProbeCalibrationOptimizerAlgo();
   virtual  ~vtkPlusProbeCalibrationOptimizerAlgo();
@@ -101,6 +158,26 @@ protected:
    
   vtkPlusProbeCalibrationAlgo* ProbeCalibrationAlgo;
 
+  /*! Algorithm that is used for minimizing the cost function */
+  OptimizationAlgorithmType OptimizationAlgorithm;
+
+  /*! Robust loss function of the Levenberg-Marquardt optimization */
+  RobustLossType RobustLoss;
+  double RobustLossScale;
+
+  /*! Segmented middle wire positions in the image frame and the corresponding computed positions in the probe frame, for the 3D method */
+  std::vector< vnl_vector_fixed<double,3> > MiddleWirePoints_Image;
+  std::vector< vnl_vector_fixed<double,3> > MiddleWirePoints_Probe;
+
+  /*!
+    Segmented wire positions in the image frame and the corresponding wire end points in the probe frame (X, Y and Z coordinate arrays), for the 2D method.
+    Stored in the layout of vtkPlusProbeCalibrationAlgo::ComputeWireIntersectionErrors2D.
+  */
+  std::vector<double> WireSegmentedX_Image;
+  std::vector<double> WireSegmentedY_Image;
+  std::vector<double> WireEndPointsFront_Probe[3];
+  std::vector<double> WireEndPointsBack_Probe[3];
+
 };
 
 #endif
@@ -237,13 +237,13 @@ PlusStatus vtkPlusPrincipalMotionDetectionAlgo::Update()
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusPrincipalMotionDetectionAlgo::GetDetectedTimestamps(std::deque<double>& timestamps)
+void vtkPlusPrincipalMotionDetectionAlgo::GetDetectedTimestamps(std::vector<double>& timestamps)
 {
   timestamps = m_SignalTimestamps;
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusPrincipalMotionDetectionAlgo::GetDetectedPositions(std::deque<double>& positions)
+void vtkPlusPrincipalMotionDetectionAlgo::GetDetectedPositions(std::vector<double>& positions)
 {
   positions = m_SignalValues;
 }
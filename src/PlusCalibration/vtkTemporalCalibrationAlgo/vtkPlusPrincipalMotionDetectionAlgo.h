@@ -8,6 +8,7 @@
 #define __vtkPlusPrincipalMotionDetectionAlgo_h
 
 #include <deque>
+#include <vector>
 #include "vtkObject.h"
 
 //class vtkIGSIOTrackedFrameList;
@@ -40,10 +41,10 @@ public:
   PlusStatus Update();
 
   /*! Get the timestamps of the frames where a line was successfully detected*/
-  void GetDetectedTimestamps(std::deque<double>& timestamps);
+  void GetDetectedTimestamps(std::vector<double>& timestamps);
 
   /*! Get the line positions on the frames where a line was successfully detected*/
-  void GetDetectedPositions(std::deque<double>& positions);
+  void GetDetectedPositions(std::vector<double>& positions);
 
   void ComputePrincipalAxis(std::deque<itk::Point<double, 3> >& trackerPositions, itk::Point<double, 3>& principalAxisOfMotion, int numValidFrames);
 
@@ -57,8 +58,8 @@ protected:
   vtkIGSIOTrackedFrameList* m_TrackerFrames;
   std::string m_ProbeToReferenceTransformName;
 
-  std::deque<double> m_SignalValues;
-  std::deque<double> m_SignalTimestamps;
+  std::vector<double> m_SignalValues;
+  std::vector<double> m_SignalTimestamps;
 
   double m_SignalTimeRangeMin;
   double m_SignalTimeRangeMax;
@@ -5,19 +5,21 @@
 =========================================================Plus=header=end*/
 
 #include "PlusConfigure.h"
+#include "PlusMath.h"
 #include "igsioTrackedFrame.h"
 #include "vtkObjectFactory.h"
 #include "vtkDoubleArray.h"
 #include "vtkPlusLineSegmentationAlgo.h"
 #include "vtkMath.h"
-#include "vtkPiecewiseFunction.h"
 #include "vtkPlusPrincipalMotionDetectionAlgo.h"
 #include "vtkTable.h"
 #include "vtkPlusTemporalCalibrationAlgo.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <numeric>
 
 //-----------------------------------------------------------------------------
 
@@ -310,7 +312,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::GetCorrelationSignalFine(vtkTable* co
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusTemporalCalibrationAlgo::GetSignalRange(const std::deque<double>& signal, int startIndex, int stopIndex,  double& minValue, double& maxValue)
+PlusStatus vtkPlusTemporalCalibrationAlgo::GetSignalRange(const std::vector<double>& signal, int startIndex, int stopIndex,  double& minValue, double& maxValue)
 {
   if (signal.empty())
   {
@@ -325,7 +327,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::GetSignalRange(const std::deque<doubl
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, int startIndex/*=0*/, int stopIndex/*=-1*/)
+PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, int startIndex/*=0*/, int stopIndex/*=-1*/)
 {
   if (signal.size() == 0)
   {
@@ -400,7 +402,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<doub
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::deque<double>& timestamps)
+PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::vector<double>& timestamps)
 {
   if (timestamps.size() == 0)
   {
@@ -435,54 +437,42 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::NormalizeMetricValues(std::deque<doub
 
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusTemporalCalibrationAlgo::ResampleSignalLinearly(const std::deque<double>& templateSignalTimestamps,
-    const vtkSmartPointer<vtkPiecewiseFunction>& signalFunction, std::deque<double>& resampledSignalValues)
-{
-  resampledSignalValues.resize(templateSignalTimestamps.size());
-  for (unsigned int i = 0; i < templateSignalTimestamps.size(); ++i)
-  {
-    resampledSignalValues[i] = signalFunction->GetValue(templateSignalTimestamps[i]);
-  }
-  return PLUS_SUCCESS;
-}
-
-//-----------------------------------------------------------------------------
-void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues)
+void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::vector<double>& corrTimeOffsets, std::vector<double>& corrValues)
 {
   // We will let the tracker metric be the "sliding" metric and let the video metric be the "fixed" metric. Since we are assuming a maximum offset between the two streams.
 
-  // Construct piecewise function for tracker signal
-  vtkSmartPointer<vtkPiecewiseFunction> trackerPositionPiecewiseSignal = vtkSmartPointer<vtkPiecewiseFunction>::New();
-  double midpoint = 0.5;
-  double sharpness = 0;
-  for (unsigned int i = 0; i < this->MovingSignal.signalTimestamps.size(); ++i)
-  {
-    trackerPositionPiecewiseSignal->AddPoint(this->MovingSignal.signalTimestamps.at(i), this->MovingSignal.signalValues.at(i), midpoint, sharpness);
-  }
+  // Interpolation nodes of the tracker signal
+  std::vector<double> trackerPositionSignalTimestamps;
+  std::vector<double> trackerPositionSignalValues;
+  PlusMath::GetInterpolationNodes(this->MovingSignal.signalTimestamps, this->MovingSignal.signalValues, trackerPositionSignalTimestamps, trackerPositionSignalValues);
 
   // Compute alignment metric for each offset
-  std::deque<double> normalizationFactors;
+  std::vector<double> normalizationFactors;
   if (stepSizeSec < TIMESTAMP_EPSILON_SEC)
   {
     LOG_ERROR("Sampling resolution is too small: " << stepSizeSec << " sec");
     return;
   }
-  std::deque<double> slidingSignalTimestamps(this->FixedSignal.signalTimestamps.size());
-  std::deque<double> resampledTrackerPositionMetric;
+  std::vector<double> slidingSignalTimestamps(this->FixedSignal.signalTimestamps.size());
+  std::vector<double> resampledTrackerPositionMetric;
   corrValues.clear();
   corrTimeOffsets.clear();
+  const size_t numberOfOffsets = static_cast<size_t>(std::max(0.0, (maxTrackerLagSec - minTrackerLagSec) / stepSizeSec)) + 1;
+  corrValues.reserve(numberOfOffsets);
+  corrTimeOffsets.reserve(numberOfOffsets);
+  normalizationFactors.reserve(numberOfOffsets);
   for (double offsetValueSec = minTrackerLagSec; offsetValueSec <= maxTrackerLagSec; offsetValueSec += stepSizeSec)
   {
     //LOG_DEBUG("offsetValueSec = " << offsetValueSec);
     corrTimeOffsets.push_back(offsetValueSec);
-    for (unsigned int i = 0; i < slidingSignalTimestamps.size(); ++i)
+    for (size_t i = 0; i < slidingSignalTimestamps.size(); ++i)
     {
-      slidingSignalTimestamps.at(i) =  this->FixedSignal.signalTimestamps.at(i) + offsetValueSec;
+      slidingSignalTimestamps[i] = this->FixedSignal.signalTimestamps[i] + offsetValueSec;
     }
 
     NormalizeMetricValues(this->FixedSignal.signalValues, this->FixedSignalValuesNormalizationFactor, slidingSignalTimestamps.front(), slidingSignalTimestamps.back(), this->FixedSignal.signalTimestamps);
 
-    ResampleSignalLinearly(slidingSignalTimestamps, trackerPositionPiecewiseSignal, resampledTrackerPositionMetric);
+    PlusMath::ResampleSignalLinearly(slidingSignalTimestamps, trackerPositionSignalTimestamps, trackerPositionSignalValues, resampledTrackerPositionMetric);
     double normalizationFactor = 1.0;
     NormalizeMetricValues(resampledTrackerPositionMetric, normalizationFactor);
     normalizationFactors.push_back(normalizationFactor);
@@ -509,7 +499,7 @@ void vtkPlusTemporalCalibrationAlgo::ComputeCorrelationBetweenFixedAndMovingSign
   LOG_DEBUG("numberOfSamples=" << corrValues.size());
 }
 
-double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::deque<double>& signalA, const std::deque<double>& signalB)
+double vtkPlusTemporalCalibrationAlgo::ComputeAlignmentMetric(const std::vector<double>& signalA, const std::vector<double>& signalB)
 {
   if (signalA.size() != signalB.size())
   {
@@ -704,11 +694,11 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
   double bestCorrelationValue = 0;
   double bestCorrelationTimeOffset = 0;
   double bestCorrelationNormalizationFactor = 1.0;
-  std::deque<double> corrTimeOffsets;
-  std::deque<double> corrValues;
+  std::vector<double> corrTimeOffsets;
+  std::vector<double> corrValues;
   ComputeCorrelationBetweenFixedAndMovingSignal(-this->MaxMovingLagSec, this->MaxMovingLagSec, imageFramePeriodSec, bestCorrelationValue, bestCorrelationTimeOffset, bestCorrelationNormalizationFactor, corrTimeOffsets, corrValues);
-  std::deque<double> corrTimeOffsetsFine;
-  std::deque<double> corrValuesFine;
+  std::vector<double> corrTimeOffsetsFine;
+  std::vector<double> corrValuesFine;
   ComputeCorrelationBetweenFixedAndMovingSignal(bestCorrelationTimeOffset - searchRangeFineStep, bestCorrelationTimeOffset + searchRangeFineStep, this->SamplingResolutionSec, bestCorrelationValue, bestCorrelationTimeOffset, bestCorrelationNormalizationFactor, corrTimeOffsetsFine, corrValuesFine);
   LOG_DEBUG("Time offset with sign convention #1: " << bestCorrelationTimeOffset);
 
@@ -722,8 +712,8 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
   double bestCorrelationValueInvertedTracker(0);
   double bestCorrelationTimeOffsetInvertedTracker(0);
   double bestCorrelationNormalizationFactorInvertedTracker(1.0);
-  std::deque<double> corrTimeOffsetsInvertedTracker;
-  std::deque<double> corrValuesInvertedTracker;
+  std::vector<double> corrTimeOffsetsInvertedTracker;
+  std::vector<double> corrValuesInvertedTracker;
   ComputeCorrelationBetweenFixedAndMovingSignal(
     -this->MaxMovingLagSec,
     this->MaxMovingLagSec,
@@ -734,8 +724,8 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
     corrTimeOffsetsInvertedTracker,
     corrValuesInvertedTracker
   );
-  std::deque<double> corrTimeOffsetsInvertedTrackerFine;
-  std::deque<double> corrValuesInvertedTrackerFine;
+  std::vector<double> corrTimeOffsetsInvertedTrackerFine;
+  std::vector<double> corrValuesInvertedTrackerFine;
   ComputeCorrelationBetweenFixedAndMovingSignal(
     bestCorrelationTimeOffsetInvertedTracker - searchRangeFineStep,
     bestCorrelationTimeOffsetInvertedTracker + searchRangeFineStep,
@@ -801,7 +791,8 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
   // Get maximum calibration error
 
   // Get the timestamps of the sliding signal (i.e. cropped video signal) shifted by the best-found offset
-  std::deque<double> shiftedSlidingSignalTimestamps;
+  std::vector<double> shiftedSlidingSignalTimestamps;
+  shiftedSlidingSignalTimestamps.reserve(this->FixedSignal.signalTimestamps.size());
   for (unsigned int i = 0; i < this->FixedSignal.signalTimestamps.size(); ++i)
   {
     shiftedSlidingSignalTimestamps.push_back(this->FixedSignal.signalTimestamps.at(i) + this->MovingLagSec);     // TODO: check this
@@ -809,18 +800,19 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
 
   // Get the values of the tracker metric at the offset sliding signal values
 
-  // Construct piecewise function for tracker signal
-  vtkSmartPointer<vtkPiecewiseFunction> trackerPositionPiecewiseSignal = vtkSmartPointer<vtkPiecewiseFunction>::New();
-  double midpoint = 0.5;
-  double sharpness = 0;
-  for (unsigned int i = 0; i < this->MovingSignal.normalizedSignalTimestamps.size(); ++i)
+  // Interpolation nodes of the tracker signal
+  std::vector<double> trackerPositionSignalTimestamps;
+  std::vector<double> trackerPositionSignalValues;
+  PlusMath::GetInterpolationNodes(this->MovingSignal.normalizedSignalTimestamps, this->MovingSignal.normalizedSignalValues, trackerPositionSignalTimestamps, trackerPositionSignalValues);
+
+  std::vector<double> resampledNormalizedTrackerPositionMetric;
+  if (PlusMath::ResampleSignalLinearly(shiftedSlidingSignalTimestamps, trackerPositionSignalTimestamps, trackerPositionSignalValues, resampledNormalizedTrackerPositionMetric) != PLUS_SUCCESS)
   {
-    trackerPositionPiecewiseSignal->AddPoint(this->MovingSignal.normalizedSignalTimestamps.at(i), this->MovingSignal.normalizedSignalValues.at(i), midpoint, sharpness);
+    error = TEMPORAL_CALIBRATION_ERROR_CORRELATION_RESULT_EMPTY;
+    LOG_ERROR("Failed to resample the normalized moving signal");
+    return PLUS_FAIL;
   }
 
-  std::deque<double> resampledNormalizedTrackerPositionMetric;
-  ResampleSignalLinearly(shiftedSlidingSignalTimestamps, trackerPositionPiecewiseSignal, resampledNormalizedTrackerPositionMetric);
-
   this->CalibrationErrorVector.clear();
   for (unsigned int i = 0; i < resampledNormalizedTrackerPositionMetric.size(); ++i)
   {
@@ -855,7 +847,7 @@ PlusStatus vtkPlusTemporalCalibrationAlgo::ComputeMovingSignalLagSec(TEMPORAL_CA
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusTemporalCalibrationAlgo::ConstructTableSignal(std::deque<double>& x, std::deque<double>& y, vtkTable* table,
+PlusStatus vtkPlusTemporalCalibrationAlgo::ConstructTableSignal(std::vector<double>& x, std::vector<double>& y, vtkTable* table,
     double timeCorrection)
 {
   // Clear table
@@ -10,12 +10,11 @@
 #include "PlusConfigure.h"
 #include "vtkPlusCalibrationExport.h"
 
-#include <deque>
+#include <vector>
 
 #include "vtkObject.h"
 
 //class igsioTrackedFrame; 
-class vtkPiecewiseFunction;
 class vtkTable;
 //class vtkIGSIOTrackedFrameList;
 
@@ -68,13 +67,13 @@ public:
     FRAME_TYPE frameType;
     std::string probeToReferenceTransformName;
     /*! Signal metric values that is computed from the frameList */
-    std::deque<double> signalValues;
+    std::vector<double> signalValues;
     /*! Signal timestamps corresponding to the metric values in the frameList */
-    std::deque<double> signalTimestamps;
+    std::vector<double> signalTimestamps;
     /*! Normalized signal metric values that is computed from the frameList (recomputed for each offset) */
-    std::deque<double> normalizedSignalValues;
+    std::vector<double> normalizedSignalValues;
     /*! Normalized signal timestamps that is computed from the frameList (recomputed for each offset) */
-    std::deque<double> normalizedSignalTimestamps;
+    std::vector<double> normalizedSignalTimestamps;
     /*! Start of the time range that contains the frames that should be used for signal generation */
     double signalTimeRangeMin;
     /*! End of the time range that contains the frames that should be used for signal generation */
@@ -142,20 +141,18 @@ public:
 protected:
   PlusStatus ComputeMovingSignalLagSec(TEMPORAL_CALIBRATION_ERROR& error);
   PlusStatus ComputePositionSignalValues(SignalType& signal);
-  PlusStatus GetSignalRange(const std::deque<double>& signal, int startIndex, int stopIndex, double& minValue, double& maxValue);
+  PlusStatus GetSignalRange(const std::vector<double>& signal, int startIndex, int stopIndex, double& minValue, double& maxValue);
 
   /*! Determine common signal time range between the fixed and moving signals  */
   PlusStatus ComputeCommonTimeRange();
 
-  PlusStatus NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, int startIndex = 0, int stopIndex = -1);
-  PlusStatus NormalizeMetricValues(std::deque<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::deque<double>& timestamps);
-  void ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::deque<double>& corrTimeOffsets, std::deque<double>& corrValues);
+  PlusStatus NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, int startIndex = 0, int stopIndex = -1);
+  PlusStatus NormalizeMetricValues(std::vector<double>& signal, double& normalizationFactor, double startTime, double stopTime, const std::vector<double>& timestamps);
+  void ComputeCorrelationBetweenFixedAndMovingSignal(double minTrackerLagSec, double maxTrackerLagSec, double stepSizeSec, double& bestCorrelationValue, double& bestCorrelationTimeOffset, double& bestCorrelationNormalizationFactor, std::vector<double>& corrTimeOffsets, std::vector<double>& corrValues);
 
-  double ComputeAlignmentMetric(const std::deque<double>& signalA, const std::deque<double>& signalB);
+  double ComputeAlignmentMetric(const std::vector<double>& signalA, const std::vector<double>& signalB);
 
-  PlusStatus ConstructTableSignal(std::deque<double>& x, std::deque<double>& y, vtkTable* table, double timeCorrection);
-
-  PlusStatus ResampleSignalLinearly(const std::deque<double>& templateSignalTimestamps, const vtkSmartPointer<vtkPiecewiseFunction>& signalFunction, std::deque<double>& resampledSignalValues);
+  PlusStatus ConstructTableSignal(std::vector<double>& x, std::vector<double>& y, vtkTable* table, double timeCorrection);
 
 protected:
   SignalType FixedSignal;
@@ -175,14 +172,14 @@ protected:
   double SamplingResolutionSec;
 
   /*! The computed signal correlation values (corresponding to the better sign convention) */
-  std::deque<double> CorrelationValues;
+  std::vector<double> CorrelationValues;
   /*! The time-offsets used to compute the correlations */
-  std::deque<double> CorrelationTimeOffsets;
+  std::vector<double> CorrelationTimeOffsets;
 
   /*! The computed signal correlation values (corresponding to the better sign convention, in the second phase with fine resolution) */
-  std::deque<double> CorrelationValuesFine;
+  std::vector<double> CorrelationValuesFine;
   /*! The time-offsets used to compute the correlations (in the second phase with fine resolution) */
-  std::deque<double> CorrelationTimeOffsetsFine;
+  std::vector<double> CorrelationTimeOffsetsFine;
 
   /*! The highest correlation value for the tested time-offsets */
   double BestCorrelationValue;
@@ -191,7 +188,7 @@ protected:
   /*! Given time offset for the calculated best fit */
   double BestCorrelationTimeOffset;
 
-  std::deque<double> CalibrationErrorVector;
+  std::vector<double> CalibrationErrorVector;
 
   /*! Time [s] that tracker lags video. If lag < 0, the tracker leads the video */
   double MovingLagSec;
@@ -16,6 +16,10 @@
 #include "vtkMath.h"
 #include "vtkTransform.h"
 
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
 #define MINIMUM_NUMBER_OF_CALIBRATION_EQUATIONS 8
 
 //----------------------------------------------------------------------------
@@ -387,4 +391,86 @@ void PlusMath::LogMatrix(const vnl_matrix_fixed<double, 4, 4>& matrix, int preci
   vtkSmartPointer<vtkMatrix4x4> matrixVtk = vtkSmartPointer<vtkMatrix4x4>::New();
   ConvertVnlMatrixToVtkMatrix(matrix, matrixVtk);
   igsioMath::LogVtkMatrix(matrixVtk, precision);
-}
\ No newline at end of file
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusMath::ResampleSignalLinearly(const std::vector<double>& templateSignalTimestamps,
+    const std::vector<double>& signalTimestamps, const std::vector<double>& signalValues, std::vector<double>& resampledSignalValues)
+{
+  if (signalTimestamps.empty() || signalTimestamps.size() != signalValues.size())
+  {
+    LOG_ERROR("Cannot resample signal: the signal is empty or the number of timestamps and values do not match");
+    return PLUS_FAIL;
+  }
+
+  const size_t numberOfSignalSamples = signalTimestamps.size();
+  resampledSignalValues.resize(templateSignalTimestamps.size());
+
+  // Index of the first signal sample that is not before the current template timestamp.
+  // It only moves forward while the template timestamps are increasing.
+  size_t signalIndex = 0;
+  for (size_t i = 0; i < templateSignalTimestamps.size(); ++i)
+  {
+    const double t = templateSignalTimestamps[i];
+    if (i > 0 && t < templateSignalTimestamps[i - 1])
+    {
+      signalIndex = std::lower_bound(signalTimestamps.begin(), signalTimestamps.end(), t) - signalTimestamps.begin();
+    }
+    while (signalIndex < numberOfSignalSamples && t > signalTimestamps[signalIndex])
+    {
+      ++signalIndex;
+    }
+
+    if (signalIndex == 0)
+    {
+      // before (or at) the first sample
+      resampledSignalValues[i] = signalValues.front();
+    }
+    else if (signalIndex == numberOfSignalSamples)
+    {
+      // after the last sample
+      resampledSignalValues[i] = signalValues.back();
+    }
+    else
+    {
+      const double t1 = signalTimestamps[signalIndex - 1];
+      const double t2 = signalTimestamps[signalIndex];
+      const double s = (t - t1) / (t2 - t1);
+      resampledSignalValues[i] = (1 - s) * signalValues[signalIndex - 1] + s * signalValues[signalIndex];
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusMath::GetInterpolationNodes(const std::vector<double>& timestamps, const std::vector<double>& values,
+    std::vector<double>& nodeTimestamps, std::vector<double>& nodeValues)
+{
+  nodeTimestamps.clear();
+  nodeValues.clear();
+  nodeTimestamps.reserve(timestamps.size());
+  nodeValues.reserve(values.size());
+
+  if (std::adjacent_find(timestamps.begin(), timestamps.end(), std::greater_equal<double>()) == timestamps.end())
+  {
+    // Already strictly increasing (this is the usual case)
+    nodeTimestamps = timestamps;
+    nodeValues = values;
+    return;
+  }
+
+  std::vector<size_t> sortedIndices(timestamps.size());
+  std::iota(sortedIndices.begin(), sortedIndices.end(), 0);
+  std::stable_sort(sortedIndices.begin(), sortedIndices.end(), [&timestamps](size_t a, size_t b) { return timestamps[a] < timestamps[b]; });
+  for (std::vector<size_t>::const_iterator indexIt = sortedIndices.begin(); indexIt != sortedIndices.end(); ++indexIt)
+  {
+    if (!nodeTimestamps.empty() && nodeTimestamps.back() == timestamps[*indexIt])
+    {
+      // Keep the sample that was acquired later
+      nodeValues.back() = values[*indexIt];
+      continue;
+    }
+    nodeTimestamps.push_back(timestamps[*indexIt]);
+    nodeValues.push_back(values[*indexIt]);
+  }
+}
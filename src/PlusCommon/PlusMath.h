@@ -79,6 +79,16 @@ public:
   /*! Print matrix into log as info */
   static void LogMatrix(const vnl_matrix_fixed<double,4,4>& matrix, int precision = 3);
 
+  /*!
+    Linearly interpolate a signal at the template timestamps. Template timestamps before the first or after the last signal sample get the first or last signal value.
+    The signal timestamps must be strictly increasing (see GetInterpolationNodes). The template timestamps are processed with a single forward walk
+    over the signal samples if they are increasing.
+  */
+  static PlusStatus ResampleSignalLinearly(const std::vector<double>& templateSignalTimestamps, const std::vector<double>& signalTimestamps, const std::vector<double>& signalValues, std::vector<double>& resampledSignalValues);
+
+  /*! Get the samples of a signal sorted by timestamp, to be used for interpolation. If more samples have the same timestamp then only the last one is kept. */
+  static void GetInterpolationNodes(const std::vector<double>& timestamps, const std::vector<double>& values, std::vector<double>& nodeTimestamps, std::vector<double>& nodeValues);
+
 protected:
   PlusMath(); 
   ~PlusMath();
@@ -24,6 +24,7 @@ vtkPlusFakeTracker::vtkPlusFakeTracker()
   , RandomSeed(0)
   , Counter(-1)
   , PhantomLandmarks(NULL)
+  , ConnectDelaySec(0.0)
 {
   vtkSmartPointer<vtkPoints> phantomLandmarks = vtkSmartPointer<vtkPoints>::New();
   this->SetPhantomLandmarks(phantomLandmarks);
@@ -59,6 +60,12 @@ PlusStatus vtkPlusFakeTracker::InternalConnect()
 {
   LOG_TRACE("vtkPlusFakeTracker::InternalConnect");
 
+  if (this->ConnectDelaySec > 0)
+  {
+    LOG_DEBUG("Simulate connection delay of " << this->ConnectDelaySec << " sec");
+    vtkIGSIOAccurateTimer::Delay(this->ConnectDelaySec);
+  }
+
   vtkPlusDataSource* tool = NULL;
   switch (this->Mode)
   {
@@ -565,6 +572,8 @@ PlusStatus vtkPlusFakeTracker::ReadConfiguration(vtkXMLDataElement* rootConfigEl
 
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
 
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ConnectDelaySec, deviceConfig);
+
   if (!this->Recording)
   {
     // Read mode
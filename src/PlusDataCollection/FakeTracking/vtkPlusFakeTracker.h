@@ -72,6 +72,11 @@ public:
   /*! Get the phantom landmark points positions */
   vtkGetObjectMacro(PhantomLandmarks, vtkPoints);
 
+  /*! Set artificial delay of connection (in sec), for simulating slow devices */
+  vtkSetMacro(ConnectDelaySec, double);
+  /*! Get artificial delay of connection (in sec) */
+  vtkGetMacro(ConnectDelaySec, double);
+
 protected:
   /*! Set the phantom landmark points positions */
   vtkSetObjectMacro(PhantomLandmarks, vtkPoints);
@@ -113,6 +118,9 @@ protected:
     Need for setting up RecordPhantomLandmarks mode
   */
   vtkPoints* PhantomLandmarks;
+
+  /*! Artificial delay of connection (in sec) */
+  double ConnectDelaySec;
 };
 
 
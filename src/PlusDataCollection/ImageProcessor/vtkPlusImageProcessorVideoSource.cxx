@@ -15,6 +15,7 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusTrackedFrameProcessor.h"
 #include "vtkIGSIOTransformRepository.h"
+#include "vtkXMLDataElement.h"
 #include "vtksys/SystemTools.hxx"
 
 //----------------------------------------------------------------------------
@@ -26,9 +27,15 @@ vtkPlusImageProcessorVideoSource::vtkPlusImageProcessorVideoSource()
   : vtkPlusDevice()
   , LastProcessedInputDataTimestamp(0)
   , EnableProcessing(true)
+  , ProcessAllFrames(false)
+  , NumberOfProcessingThreads(1)
+  , MaximumNumberOfQueuedFrames(50)
+  , LastQueuedInputItemUid(0)
   , ProcessingAlgorithmAccessMutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , GracePeriodLogLevel(vtkPlusLogger::LOG_LEVEL_DEBUG)
-  , ProcessorAlgorithm(NULL)
+  , StopProcessingRequested(false)
+  , NumberOfProcessedFrames(0)
+  , NumberOfDroppedFrames(0)
 {
   this->MissingInputGracePeriodSec = 2.0;
 
@@ -42,22 +49,33 @@ vtkPlusImageProcessorVideoSource::vtkPlusImageProcessorVideoSource()
 //----------------------------------------------------------------------------
 vtkPlusImageProcessorVideoSource::~vtkPlusImageProcessorVideoSource()
 {
+  this->StopProcessingThreads();
   if (this->TransformRepository)
   {
     this->TransformRepository->Delete();
     this->TransformRepository = NULL;
   }
-  if (this->ProcessorAlgorithm)
-  {
-    this->ProcessorAlgorithm->Delete();
-    this->ProcessorAlgorithm = NULL;
-  }
 }
 
 //----------------------------------------------------------------------------
 void vtkPlusImageProcessorVideoSource::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "ProcessAllFrames: " << (this->ProcessAllFrames ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "NumberOfProcessingThreads: " << this->NumberOfProcessingThreads << std::endl;
+  os << indent << "MaximumNumberOfQueuedFrames: " << this->MaximumNumberOfQueuedFrames << std::endl;
+  os << indent << "NumberOfProcessedFrames: " << this->GetNumberOfProcessedFrames() << std::endl;
+  os << indent << "NumberOfDroppedFrames: " << this->GetNumberOfDroppedFrames() << std::endl;
+  os << indent << "NumberOfQueuedFrames: " << this->GetNumberOfQueuedFrames() << std::endl;
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessingStages(); ++stageIndex)
+  {
+    unsigned long numberOfFrames(0);
+    double meanTimeSec(0);
+    double maxTimeSec(0);
+    this->GetStageProcessingTimeStatistics(stageIndex, numberOfFrames, meanTimeSec, maxTimeSec);
+    os << indent << "Stage " << stageIndex << " (" << this->ProcessingStages[stageIndex].Processor->GetProcessorTypeName() << "): "
+       << numberOfFrames << " frames, mean time: " << meanTimeSec * 1000.0 << "ms, max time: " << maxTimeSec * 1000.0 << "ms" << std::endl;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -65,6 +83,9 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableProcessing, deviceConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ProcessAllFrames, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfProcessingThreads, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, MaximumNumberOfQueuedFrames, deviceConfig);
 
   // Read transform repository configuration
   if (this->TransformRepository->ReadConfiguration(rootConfigElement) != PLUS_SUCCESS)
@@ -73,12 +94,8 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
     return PLUS_FAIL;
   }
 
-  // Instantiate processor(s)
-  if (this->ProcessorAlgorithm)
-  {
-    this->ProcessorAlgorithm->Delete();
-    this->ProcessorAlgorithm = NULL;
-  }
+  // Instantiate processor(s), they are applied in the order of the elements
+  this->ProcessingStages.clear();
   int numberOfNestedElements = deviceConfig->GetNumberOfNestedElements();
   for (int nestedElemIndex = 0; nestedElemIndex < numberOfNestedElements; ++nestedElemIndex)
   {
@@ -90,65 +107,94 @@ PlusStatus vtkPlusImageProcessorVideoSource::ReadConfiguration(vtkXMLDataElement
       continue;
     }
 
-    if (this->ProcessorAlgorithm != NULL)
-    {
-      LOG_WARNING("Multiple " << processorElement->GetName() << " elements found in ImageProcessor configuration. Only the first one is used, all others are ignored");
-      break;
-    }
-
-    // Verify type
-    const char* processorType = processorElement->GetAttribute("Type");
-    if (processorType == NULL)
-    {
-      LOG_ERROR("Type attribute of Processor element is missing");
-      return PLUS_FAIL;
-    }
-
-    // Instantiate processor corresponding to the specified type
-    vtkSmartPointer<vtkPlusBoneEnhancer> boneEnhancer = vtkSmartPointer<vtkPlusBoneEnhancer>::New();
-    vtkSmartPointer<vtkPlusTransverseProcessEnhancer> TransverseProcessEnhancer = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
-    if (!(STRCASECMP(boneEnhancer->GetProcessorTypeName(), processorType)))
-    {
-      boneEnhancer->SetTransformRepository(this->TransformRepository);
-      boneEnhancer->ReadConfiguration(processorElement);
-      this->ProcessorAlgorithm = boneEnhancer;
-      this->ProcessorAlgorithm->Register(this);
-      break;                  // If only one processor is allowed per ImageProcessor class, we can break out when we find it.
-    }
-    else if (!(STRCASECMP(TransverseProcessEnhancer->GetProcessorTypeName(), processorType)))
+    ProcessingStage stage;
+    vtkPlusTrackedFrameProcessor* processor = this->CreateProcessor(processorElement, this->TransformRepository);
+    if (processor == NULL)
     {
-      TransverseProcessEnhancer->SetTransformRepository(this->TransformRepository);
-      TransverseProcessEnhancer->ReadConfiguration(processorElement);
-      this->ProcessorAlgorithm = TransverseProcessEnhancer;
-      this->ProcessorAlgorithm->Register(this);
-      break;
-    }
-    else
-    {
-      LOG_ERROR("Unknown processor type: " << processorType);
+      this->ProcessingStages.clear();
       return PLUS_FAIL;
     }
+    stage.Processor = processor;
+    processor->UnRegister(this);
+
+    // Keep the configuration for creating the processors of the worker threads
+    stage.Configuration = vtkSmartPointer<vtkXMLDataElement>::New();
+    stage.Configuration->DeepCopy(processorElement);
+    stage.WorkerProcessorsMTime = 0;
+    stage.NumberOfProcessedFrames = 0;
+    stage.TotalProcessingTimeSec = 0.0;
+    stage.MaxProcessingTimeSec = 0.0;
+    this->ProcessingStages.push_back(stage);
   }
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusTrackedFrameProcessor* vtkPlusImageProcessorVideoSource::CreateProcessor(vtkXMLDataElement* processorElement, vtkIGSIOTransformRepository* transformRepository)
+{
+  // Verify type
+  const char* processorType = processorElement->GetAttribute("Type");
+  if (processorType == NULL)
+  {
+    LOG_ERROR("Type attribute of Processor element is missing");
+    return NULL;
+  }
+
+  // Instantiate processor corresponding to the specified type
+  vtkSmartPointer<vtkPlusBoneEnhancer> boneEnhancer = vtkSmartPointer<vtkPlusBoneEnhancer>::New();
+  vtkSmartPointer<vtkPlusTransverseProcessEnhancer> TransverseProcessEnhancer = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
+  vtkPlusTrackedFrameProcessor* processor = NULL;
+  if (!(STRCASECMP(boneEnhancer->GetProcessorTypeName(), processorType)))
+  {
+    processor = boneEnhancer;
+  }
+  else if (!(STRCASECMP(TransverseProcessEnhancer->GetProcessorTypeName(), processorType)))
+  {
+    processor = TransverseProcessEnhancer;
+  }
+  else
+  {
+    LOG_ERROR("Unknown processor type: " << processorType);
+    return NULL;
+  }
+
+  processor->SetTransformRepository(transformRepository);
+  processor->ReadConfiguration(processorElement);
+  processor->Register(this);
+  return processor;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusImageProcessorVideoSource::WriteConfiguration(vtkXMLDataElement* rootConfig)
 {
   XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceElement, rootConfig);
   deviceElement->SetAttribute("EnableCapturing", this->EnableProcessing ? "TRUE" : "FALSE");
+  deviceElement->SetAttribute("ProcessAllFrames", this->ProcessAllFrames ? "TRUE" : "FALSE");
+  deviceElement->SetIntAttribute("NumberOfProcessingThreads", this->NumberOfProcessingThreads);
+  deviceElement->SetIntAttribute("MaximumNumberOfQueuedFrames", this->MaximumNumberOfQueuedFrames);
 
   // Write processor elements
-  if (this->ProcessorAlgorithm != NULL)
+  if (!this->ProcessingStages.empty())
   {
-    vtkXMLDataElement* processorElement = igsioXmlUtils::GetNestedElementWithName(deviceElement, vtkPlusTrackedFrameProcessor::GetTagName());
-    if (processorElement == NULL)
+    // Processor elements are matched to the stages by their order
+    std::vector<ProcessingStage>::iterator stageIt = this->ProcessingStages.begin();
+    int numberOfNestedElements = deviceElement->GetNumberOfNestedElements();
+    for (int nestedElemIndex = 0; nestedElemIndex < numberOfNestedElements && stageIt != this->ProcessingStages.end(); ++nestedElemIndex)
+    {
+      vtkXMLDataElement* processorElement = deviceElement->GetNestedElement(nestedElemIndex);
+      if ((processorElement == NULL) || (STRCASECMP(vtkPlusTrackedFrameProcessor::GetTagName(), processorElement->GetName())))
+      {
+        continue;
+      }
+      stageIt->Processor->WriteConfiguration(processorElement);
+      ++stageIt;
+    }
+    if (stageIt != this->ProcessingStages.end())
     {
-      LOG_ERROR("Cannot find " << vtkPlusTrackedFrameProcessor::GetTagName() << " element in XML tree!");
+      LOG_ERROR("Cannot find " << vtkPlusTrackedFrameProcessor::GetTagName() << " element in XML tree for each processing stage!");
       return PLUS_FAIL;
     }
-    this->ProcessorAlgorithm->WriteConfiguration(processorElement);
   }
   else
   {
@@ -187,6 +233,24 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalConnect()
   }
 
   this->LastProcessedInputDataTimestamp = 0;
+  this->LastQueuedInputItemUid = 0;
+
+  {
+    std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+    this->NumberOfProcessedFrames = 0;
+    this->NumberOfDroppedFrames = 0;
+    for (std::vector<ProcessingStage>::iterator stageIt = this->ProcessingStages.begin(); stageIt != this->ProcessingStages.end(); ++stageIt)
+    {
+      stageIt->NumberOfProcessedFrames = 0;
+      stageIt->TotalProcessingTimeSec = 0.0;
+      stageIt->MaxProcessingTimeSec = 0.0;
+    }
+  }
+
+  if (this->ProcessAllFrames)
+  {
+    return this->StartProcessingThreads();
+  }
 
   return PLUS_SUCCESS;
 }
@@ -196,6 +260,17 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalDisconnect()
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->ProcessingAlgorithmAccessMutex);
   this->EnableProcessing = false;
+  this->StopProcessingThreads();
+
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  LOG_INFO("Image processing stopped. Processed frames: " << this->NumberOfProcessedFrames << ", dropped frames: " << this->NumberOfDroppedFrames << ". Device ID: " << this->GetDeviceId());
+  for (unsigned int stageIndex = 0; stageIndex < this->ProcessingStages.size(); ++stageIndex)
+  {
+    const ProcessingStage& stage = this->ProcessingStages[stageIndex];
+    double meanTimeSec = (stage.NumberOfProcessedFrames > 0 ? stage.TotalProcessingTimeSec / stage.NumberOfProcessedFrames : 0.0);
+    LOG_INFO("Processing stage " << stageIndex << " (" << stage.Processor->GetProcessorTypeName() << "): mean time: " << meanTimeSec * 1000.0
+             << "ms, max time: " << stage.MaxProcessingTimeSec * 1000.0 << "ms");
+  }
   return PLUS_SUCCESS;
 }
 
@@ -225,6 +300,23 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     LOG_DYNAMIC("Processed data is not generated, as no video data is available yet. Device ID: " << this->GetDeviceId(), this->GracePeriodLogLevel);
     return PLUS_SUCCESS;
   }
+
+  if (this->OutputChannels.empty())
+  {
+    LOG_ERROR("No output channels defined");
+    return PLUS_FAIL;
+  }
+
+  if (this->ProcessAllFrames)
+  {
+    return this->UpdateAllFrames();
+  }
+  return this->UpdateLatestFrame();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::UpdateLatestFrame()
+{
   double oldestTrackingTimestamp(0);
   if (this->InputChannels[0]->GetOldestTimestamp(oldestTrackingTimestamp) == PLUS_SUCCESS)
   {
@@ -245,11 +337,6 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
 
   LOG_TRACE("Image to be processed: timestamp=" << trackedFrame.GetTimestamp());
 
-  if (this->OutputChannels.empty())
-  {
-    LOG_ERROR("No output channels defined");
-    return PLUS_FAIL;
-  }
   vtkPlusChannel* outputChannel = this->OutputChannels[0];
   double latestFrameAlreadyAddedTimestamp = 0;
   outputChannel->GetMostRecentTimestamp(latestFrameAlreadyAddedTimestamp);
@@ -261,31 +348,75 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
     return PLUS_SUCCESS;
   }
 
+  // Each stage processes the output frame of the previous stage
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackingFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  trackingFrames->AddTrackedFrame(&trackedFrame);
-  this->ProcessorAlgorithm->SetInputFrames(trackingFrames);
-  if (this->ProcessorAlgorithm->Update() != PLUS_SUCCESS)
+  igsioTrackedFrame* stageFrame = &trackedFrame;
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessingStages(); ++stageIndex)
   {
-    return PLUS_FAIL;
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (ProcessFrameWithProcessor(this->ProcessingStages[stageIndex].Processor, trackingFrames, stageFrame, stageFrame) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+    this->AddStageProcessingTime(stageIndex, vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec);
   }
 
-  vtkPlusDataSource* aSource(NULL);
-  if (outputChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  if (this->AddProcessedFrameToOutput(stageFrame, frameTimestamp) != PLUS_SUCCESS)
   {
-    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
     return PLUS_FAIL;
   }
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  this->NumberOfProcessedFrames++;
+  return PLUS_SUCCESS;
+}
 
-  PlusStatus status = PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::ProcessFrameWithProcessor(vtkPlusTrackedFrameProcessor* processor, vtkIGSIOTrackedFrameList* inputFrames,
+    igsioTrackedFrame* inputFrame, igsioTrackedFrame*& outputFrame)
+{
+  inputFrames->Clear();
+  inputFrames->AddTrackedFrame(inputFrame);
+  processor->SetInputFrames(inputFrames);
+  if (processor->Update() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
 
-  vtkIGSIOTrackedFrameList* processedFrames = this->ProcessorAlgorithm->GetOutputFrames();
+  vtkIGSIOTrackedFrameList* processedFrames = processor->GetOutputFrames();
   if (processedFrames == NULL || processedFrames->GetNumberOfTrackedFrames() < 1)
   {
     LOG_ERROR("Failed to retrieve processed frame");
     return PLUS_FAIL;
   }
+  outputFrame = processedFrames->GetTrackedFrame(0);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::AddStageProcessingTime(int stageIndex, double processingTimeSec)
+{
+  ProcessingStage& stage = this->ProcessingStages[stageIndex];
+  stage.NumberOfProcessedFrames++;
+  stage.TotalProcessingTimeSec += processingTimeSec;
+  if (processingTimeSec > stage.MaxProcessingTimeSec)
+  {
+    stage.MaxProcessingTimeSec = processingTimeSec;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::AddProcessedFrameToOutput(igsioTrackedFrame* processedTrackedFrame, double frameTimestamp)
+{
+  vtkPlusDataSource* aSource(NULL);
+  if (this->OutputChannels[0]->GetVideoSource(aSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve the video source in the image processor device.");
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
 
-  igsioTrackedFrame* processedTrackedFrame = processedFrames->GetTrackedFrame(0);
   // Generate unique frame number (not used for filtering, so the actual increment value does not matter)
   this->FrameNumber++;
 
@@ -353,6 +484,394 @@ void vtkPlusImageProcessorVideoSource::SetEnableProcessing(bool aValue)
   if (processingStartsNow)
   {
     this->LastProcessedInputDataTimestamp = 0.0;
+    this->LastQueuedInputItemUid = 0; // do not process the frames that were acquired while processing was paused
     this->RecordingStartTime = vtkIGSIOAccurateTimer::GetSystemTime(); // reset the starting time for the grace period
   }
 }
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::UpdateAllFrames()
+{
+  // Apply processor changes that were made since the last update
+  PlusStatus status = this->UpdateWorkerProcessors();
+
+  // Add processed frames to the output, in the order of acquisition
+  while (true)
+  {
+    ProcessingJob* job = NULL;
+    {
+      std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+      if (this->ProcessingJobs.empty() || !this->ProcessingJobs.front()->Completed)
+      {
+        break;
+      }
+      job = this->ProcessingJobs.front();
+      this->ProcessingJobs.pop_front();
+      if (job->Status == PLUS_SUCCESS)
+      {
+        this->NumberOfProcessedFrames++;
+      }
+      else
+      {
+        this->NumberOfDroppedFrames++;
+      }
+    }
+    if (job->Status == PLUS_SUCCESS && this->AddProcessedFrameToOutput(&job->Frame, job->Timestamp) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+    delete job;
+  }
+
+  // Queue the input frames that have been acquired since the last update
+  vtkPlusChannel* inputChannel = this->InputChannels[0];
+  vtkPlusDataSource* inputSource(NULL);
+  if (inputChannel->GetVideoSource(inputSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to retrieve the video source of the input channel in the image processor device.");
+    return PLUS_FAIL;
+  }
+  if (inputSource->GetNumberOfItems() < 1)
+  {
+    return status;
+  }
+
+  // Frames are processed only if tracking data is already available for them
+  double mostRecentTimestamp(0);
+  if (inputChannel->GetMostRecentTimestamp(mostRecentTimestamp) != PLUS_SUCCESS)
+  {
+    LOG_DYNAMIC("Processed data is not generated, as the most recent input timestamp is not available yet. Device ID: " << this->GetDeviceId(), this->GracePeriodLogLevel);
+    return status;
+  }
+
+  BufferItemUidType oldestItemUid = inputSource->GetOldestItemUidInBuffer();
+  BufferItemUidType latestItemUid = inputSource->GetLatestItemUidInBuffer();
+  BufferItemUidType firstItemUid = this->LastQueuedInputItemUid + 1;
+  if (this->LastQueuedInputItemUid == 0)
+  {
+    // Processing is just started, start from the present
+    if (inputSource->GetItemUidFromTime(mostRecentTimestamp, firstItemUid) != ITEM_OK)
+    {
+      return status;
+    }
+  }
+  else if (firstItemUid < oldestItemUid)
+  {
+    std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+    this->NumberOfDroppedFrames += static_cast<unsigned long>(oldestItemUid - firstItemUid);
+    LOG_DEBUG(oldestItemUid - firstItemUid << " input frames were overwritten in the buffer before they could be processed. Device ID: " << this->GetDeviceId());
+    firstItemUid = oldestItemUid;
+  }
+
+  for (BufferItemUidType itemUid = firstItemUid; itemUid <= latestItemUid; ++itemUid)
+  {
+    {
+      std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+      if (static_cast<int>(this->ProcessingJobs.size()) >= this->MaximumNumberOfQueuedFrames)
+      {
+        // The remaining frames stay in the input buffer until there is room in the queue
+        break;
+      }
+    }
+
+    double itemTimestamp(0);
+    if (inputSource->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK || itemTimestamp > mostRecentTimestamp)
+    {
+      break;
+    }
+
+    ProcessingJob* job = new ProcessingJob;
+    job->Timestamp = itemTimestamp;
+    job->NextStageIndex = 0;
+    job->InProgress = false;
+    job->Completed = this->ProcessingStages.empty();
+    job->Status = PLUS_SUCCESS;
+    this->LastQueuedInputItemUid = itemUid;
+    if (inputChannel->GetTrackedFrame(itemTimestamp, job->Frame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Error while getting tracked frame for processing. Timestamp: " << std::fixed << itemTimestamp << ". Device ID: " << this->GetDeviceId());
+      delete job;
+      std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+      this->NumberOfDroppedFrames++;
+      status = PLUS_FAIL;
+      continue;
+    }
+    LOG_TRACE("Image queued for processing: timestamp=" << itemTimestamp);
+
+    {
+      std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+      this->ProcessingJobs.push_back(job);
+    }
+    this->ProcessingJobAvailable.notify_all();
+  }
+
+  this->Modified();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::StartProcessingThreads()
+{
+  this->StopProcessingThreads();
+
+  if (this->ProcessingStages.empty())
+  {
+    LOG_WARNING("No processor is defined for ImageProcessor, frames are not processed. Device ID: " << this->GetDeviceId());
+  }
+
+  // Each thread uses its own processor and transform repository, as the stages may run at the same time
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessingStages(); ++stageIndex)
+  {
+    ProcessingStage& stage = this->ProcessingStages[stageIndex];
+    int numberOfThreads = this->NumberOfProcessingThreads;
+    vtkPlusBoneEnhancer* boneEnhancer = vtkPlusBoneEnhancer::SafeDownCast(stage.Processor);
+    if (boneEnhancer != NULL && boneEnhancer->GetSaveIntermediateResults() && numberOfThreads > 1)
+    {
+      LOG_INFO("Processing stage " << stageIndex << " saves intermediate results, it is processed by a single thread. Device ID: " << this->GetDeviceId());
+      numberOfThreads = 1;
+    }
+    stage.WorkerProcessorsMTime = stage.Processor->GetMTime();
+    for (int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+    {
+      vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor;
+      vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository;
+      if (this->CreateWorkerProcessor(stageIndex, threadIndex, processor, transformRepository) != PLUS_SUCCESS)
+      {
+        this->WorkerProcessors.clear();
+        this->WorkerTransformRepositories.clear();
+        this->WorkerStageIndices.clear();
+        return PLUS_FAIL;
+      }
+      this->WorkerProcessors.push_back(processor);
+      this->WorkerTransformRepositories.push_back(transformRepository);
+      this->WorkerStageIndices.push_back(stageIndex);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+    this->StopProcessingRequested = false;
+  }
+  for (unsigned int workerIndex = 0; workerIndex < this->WorkerProcessors.size(); ++workerIndex)
+  {
+    this->WorkerThreads.push_back(std::thread(&vtkPlusImageProcessorVideoSource::ProcessingThreadFunction, this, workerIndex));
+  }
+
+  LOG_DEBUG("Started " << this->WorkerThreads.size() << " frame processing threads for " << this->GetNumberOfProcessingStages() << " processing stages. Device ID: " << this->GetDeviceId());
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::StopProcessingThreads()
+{
+  if (this->WorkerThreads.empty())
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+    this->StopProcessingRequested = true;
+  }
+  this->ProcessingJobAvailable.notify_all();
+  for (std::vector<std::thread>::iterator threadIt = this->WorkerThreads.begin(); threadIt != this->WorkerThreads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+  this->WorkerThreads.clear();
+  this->WorkerProcessors.clear();
+  this->WorkerTransformRepositories.clear();
+  this->WorkerStageIndices.clear();
+
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  if (!this->ProcessingJobs.empty())
+  {
+    LOG_DEBUG(this->ProcessingJobs.size() << " queued frames are discarded. Device ID: " << this->GetDeviceId());
+  }
+  for (std::deque<ProcessingJob*>::iterator jobIt = this->ProcessingJobs.begin(); jobIt != this->ProcessingJobs.end(); ++jobIt)
+  {
+    delete *jobIt;
+  }
+  this->ProcessingJobs.clear();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::CreateWorkerProcessor(int stageIndex, int threadIndex,
+    vtkSmartPointer<vtkPlusTrackedFrameProcessor>& processor, vtkSmartPointer<vtkIGSIOTransformRepository>& transformRepository)
+{
+  // The processor of the stage may have been changed since the configuration was read
+  vtkSmartPointer<vtkXMLDataElement> processorElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  processorElement->DeepCopy(this->ProcessingStages[stageIndex].Configuration);
+  if (this->ProcessingStages[stageIndex].Processor->WriteConfiguration(processorElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get the configuration of the processor of stage " << stageIndex << ". Device ID: " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
+
+  transformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  transformRepository->DeepCopy(this->TransformRepository, true);
+  vtkPlusTrackedFrameProcessor* newProcessor = this->CreateProcessor(processorElement, transformRepository);
+  if (newProcessor == NULL)
+  {
+    LOG_ERROR("Failed to create processor for stage " << stageIndex << " processing thread " << threadIndex << ". Device ID: " << this->GetDeviceId());
+    return PLUS_FAIL;
+  }
+  processor = newProcessor;
+  newProcessor->UnRegister(this);
+
+  // The processors of the other threads would write the same intermediate image files
+  vtkPlusBoneEnhancer* boneEnhancer = vtkPlusBoneEnhancer::SafeDownCast(processor);
+  if (boneEnhancer != NULL && threadIndex > 0)
+  {
+    boneEnhancer->SetSaveIntermediateResults(false);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::UpdateWorkerProcessors()
+{
+  PlusStatus status = PLUS_SUCCESS;
+  for (int stageIndex = 0; stageIndex < this->GetNumberOfProcessingStages(); ++stageIndex)
+  {
+    ProcessingStage& stage = this->ProcessingStages[stageIndex];
+    if (stage.Processor->GetMTime() == stage.WorkerProcessorsMTime)
+    {
+      continue;
+    }
+    stage.WorkerProcessorsMTime = stage.Processor->GetMTime();
+    LOG_DEBUG("Processor of stage " << stageIndex << " has been modified, processors of the worker threads are updated. Device ID: " << this->GetDeviceId());
+
+    int threadIndex = 0;
+    for (unsigned int workerIndex = 0; workerIndex < this->WorkerProcessors.size(); ++workerIndex)
+    {
+      if (this->WorkerStageIndices[workerIndex] != stageIndex)
+      {
+        continue;
+      }
+      vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor;
+      vtkSmartPointer<vtkIGSIOTransformRepository> transformRepository;
+      if (this->CreateWorkerProcessor(stageIndex, threadIndex++, processor, transformRepository) != PLUS_SUCCESS)
+      {
+        // keep using the previous processor
+        status = PLUS_FAIL;
+        continue;
+      }
+      // A frame that is being processed keeps a reference to the previous processor, it is deleted when processing of the frame is completed
+      std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+      this->WorkerProcessors[workerIndex] = processor;
+      this->WorkerTransformRepositories[workerIndex] = transformRepository;
+    }
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusImageProcessorVideoSource::ProcessingThreadFunction(int workerIndex)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+
+  std::unique_lock<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  const int stageIndex = this->WorkerStageIndices[workerIndex];
+  while (true)
+  {
+    // Take the oldest frame that is waiting for this stage
+    ProcessingJob* job = NULL;
+    this->ProcessingJobAvailable.wait(jobsLock, [this, stageIndex, &job]
+    {
+      for (std::deque<ProcessingJob*>::iterator jobIt = this->ProcessingJobs.begin(); jobIt != this->ProcessingJobs.end(); ++jobIt)
+      {
+        if ((*jobIt)->NextStageIndex == stageIndex && !(*jobIt)->InProgress && !(*jobIt)->Completed)
+        {
+          job = *jobIt;
+          return true;
+        }
+      }
+      return this->StopProcessingRequested;
+    });
+    if (this->StopProcessingRequested)
+    {
+      break;
+    }
+    job->InProgress = true;
+    // The processor may be replaced by UpdateWorkerProcessors while the frame is processed
+    vtkSmartPointer<vtkPlusTrackedFrameProcessor> processor = this->WorkerProcessors[workerIndex];
+
+    // Processing is done without holding the lock, so that the other threads can take frames
+    jobsLock.unlock();
+    double startTimeSec = vtkIGSIOAccurateTimer::GetSystemTime();
+    igsioTrackedFrame* processedFrame = NULL;
+    PlusStatus status = ProcessFrameWithProcessor(processor, inputFrames, &job->Frame, processedFrame);
+    double processingTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
+    if (status == PLUS_SUCCESS)
+    {
+      job->Frame = *processedFrame;
+    }
+    jobsLock.lock();
+
+    this->AddStageProcessingTime(stageIndex, processingTimeSec);
+    job->InProgress = false;
+    job->NextStageIndex++;
+    job->Status = status;
+    job->Completed = (status != PLUS_SUCCESS || job->NextStageIndex >= static_cast<int>(this->ProcessingStages.size()));
+    if (!job->Completed)
+    {
+      // Threads of the next stage may be waiting for this frame
+      this->ProcessingJobAvailable.notify_all();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusImageProcessorVideoSource::GetNumberOfProcessedFrames()
+{
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  return this->NumberOfProcessedFrames;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusImageProcessorVideoSource::GetNumberOfDroppedFrames()
+{
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  return this->NumberOfDroppedFrames;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusImageProcessorVideoSource::GetNumberOfQueuedFrames()
+{
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  return static_cast<unsigned long>(this->ProcessingJobs.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusImageProcessorVideoSource::GetNumberOfProcessingStages() const
+{
+  return static_cast<int>(this->ProcessingStages.size());
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTrackedFrameProcessor* vtkPlusImageProcessorVideoSource::GetProcessor(int stageIndex)
+{
+  if (stageIndex < 0 || stageIndex >= this->GetNumberOfProcessingStages())
+  {
+    LOG_ERROR("Invalid processing stage index: " << stageIndex);
+    return NULL;
+  }
+  return this->ProcessingStages[stageIndex].Processor;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusImageProcessorVideoSource::GetStageProcessingTimeStatistics(int stageIndex, unsigned long& numberOfFrames, double& meanTimeSec, double& maxTimeSec)
+{
+  if (stageIndex < 0 || stageIndex >= this->GetNumberOfProcessingStages())
+  {
+    LOG_ERROR("Invalid processing stage index: " << stageIndex);
+    return PLUS_FAIL;
+  }
+  std::lock_guard<std::mutex> jobsLock(this->ProcessingJobsMutex);
+  const ProcessingStage& stage = this->ProcessingStages[stageIndex];
+  numberOfFrames = stage.NumberOfProcessedFrames;
+  meanTimeSec = (stage.NumberOfProcessedFrames > 0 ? stage.TotalProcessingTimeSec / stage.NumberOfProcessedFrames : 0.0);
+  maxTimeSec = stage.MaxProcessingTimeSec;
+  return PLUS_SUCCESS;
+}
@@ -10,7 +10,13 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "vtkPlusDevice.h"
+#include "igsioTrackedFrame.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 //class vtkIGSIOTransformRepository;
 class vtkPlusTrackedFrameProcessor;
@@ -19,6 +25,27 @@ class vtkPlusTrackedFrameProcessor;
 \class vtkPlusImageProcessorVideoSource 
 \brief Virtual device that performs real-time image processing on the input channel
 
+The device configuration may contain multiple Processor elements. The processors are applied in the
+order of the elements, each of them processing the output frame of the previous one in memory. The
+result is the same as using a chain of ImageProcessor devices with one processor each, without
+buffering and resampling the intermediate images in the output channels of the devices.
+Processing time of each stage is measured, see GetStageProcessingTimeStatistics().
+
+By default only the latest input frame is processed in each update, therefore frames that are
+acquired while the previous frame is being processed are skipped.
+
+If ProcessAllFrames is enabled then every input frame is processed: new frames are read from the
+input video buffer by item UID and the processing stages are pipelined: each stage is executed by
+NumberOfProcessingThreads worker threads, each of them using its own processor instance, so different
+stages process different frames at the same time. Processed frames are added to the output in the
+order of acquisition. At most MaximumNumberOfQueuedFrames frames are read ahead from the input buffer; if
+the processing cannot keep up then input frames are overwritten in the buffer before they could be
+read and they are counted as dropped frames.
+Changes of the processors of the stages (see GetProcessor()) are applied to the processors of the worker threads
+in the next update. Intermediate results of a stage are saved by its first worker thread only, because the processors
+of the worker threads would write the same files; a stage that saves intermediate results at connect is processed by a
+single thread, so that all its frames are saved.
+
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusImageProcessorVideoSource : public vtkPlusDevice
@@ -42,6 +69,43 @@ public:
   vtkGetMacro(EnableProcessing, bool);
   void SetEnableProcessing(bool aValue);
 
+  /*! Process every input frame instead of only the latest one. Takes effect at the next connect. */
+  vtkSetMacro(ProcessAllFrames, bool);
+  vtkGetMacro(ProcessAllFrames, bool);
+  vtkBooleanMacro(ProcessAllFrames, bool);
+
+  /*! Number of worker threads of each processing stage if ProcessAllFrames is enabled */
+  vtkSetClampMacro(NumberOfProcessingThreads, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfProcessingThreads, int);
+
+  /*! Maximum number of frames that are read from the input buffer but not yet added to the output if ProcessAllFrames is enabled */
+  vtkSetClampMacro(MaximumNumberOfQueuedFrames, int, 1, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfQueuedFrames, int);
+
+  /*! Number of frames that have been processed and added to the output since connect */
+  unsigned long GetNumberOfProcessedFrames();
+
+  /*! Number of input frames that have been skipped since connect (overwritten in the input buffer or failed to be processed) */
+  unsigned long GetNumberOfDroppedFrames();
+
+  /*! Number of frames that are read from the input buffer but not yet added to the output */
+  unsigned long GetNumberOfQueuedFrames();
+
+  /*! Number of processors that are applied to each frame */
+  int GetNumberOfProcessingStages() const;
+
+  /*! Get the configured processor of a processing stage. Returns NULL if the index is invalid. */
+  vtkPlusTrackedFrameProcessor* GetProcessor(int stageIndex);
+
+  /*!
+    Get the processing time statistics of a processing stage since connect
+    \param stageIndex Index of the processing stage, in the order of the Processor elements in the configuration
+    \param numberOfFrames Number of frames processed by the stage
+    \param meanTimeSec Average processing time of a frame
+    \param maxTimeSec Longest processing time of a frame
+  */
+  PlusStatus GetStageProcessingTimeStatistics(int stageIndex, unsigned long& numberOfFrames, double& meanTimeSec, double& maxTimeSec);
+
   virtual bool IsTracker() const { return false; }
   virtual bool IsVirtual() const { return true; }
 
@@ -52,10 +116,80 @@ protected:
   vtkPlusImageProcessorVideoSource();
   virtual ~vtkPlusImageProcessorVideoSource();
 
+  /*! Create a processor from its configuration element. The caller owns the returned object. Returns NULL in case of error. */
+  vtkPlusTrackedFrameProcessor* CreateProcessor(vtkXMLDataElement* processorElement, vtkIGSIOTransformRepository* transformRepository);
+
+  /*! Process the latest input frame */
+  PlusStatus UpdateLatestFrame();
+
+  /*! Add completed frames to the output and read new input frames for processing */
+  PlusStatus UpdateAllFrames();
+
+  /*! Add a processed frame to the video source of the output channel */
+  PlusStatus AddProcessedFrameToOutput(igsioTrackedFrame* processedTrackedFrame, double frameTimestamp);
+
+  /*!
+    Process a single frame with a processor. The output frame is owned by the processor and is valid until its next update.
+    \param inputFrames Frame list used for passing the input frame to the processor
+  */
+  static PlusStatus ProcessFrameWithProcessor(vtkPlusTrackedFrameProcessor* processor, vtkIGSIOTrackedFrameList* inputFrames, igsioTrackedFrame* inputFrame, igsioTrackedFrame*& outputFrame);
+
+  /*! Add a frame processing time to the statistics of a stage. Must be called with ProcessingJobsMutex locked. */
+  void AddStageProcessingTime(int stageIndex, double processingTimeSec);
+
+  /*! Create the processors of the worker threads and start the threads */
+  PlusStatus StartProcessingThreads();
+
+  /*!
+    Create a processor for a worker thread of a stage, with the current configuration of the processor of the stage.
+    Only the first worker thread of a stage may save intermediate results.
+  */
+  PlusStatus CreateWorkerProcessor(int stageIndex, int threadIndex, vtkSmartPointer<vtkPlusTrackedFrameProcessor>& processor, vtkSmartPointer<vtkIGSIOTransformRepository>& transformRepository);
+
+  /*! Recreate the processors of the worker threads of the stages whose processor has been modified since the worker processors were created */
+  PlusStatus UpdateWorkerProcessors();
+
+  /*! Stop the worker threads and discard all queued frames */
+  void StopProcessingThreads();
+
+  /*! Process queued frames in the stage of a worker thread until stop is requested */
+  void ProcessingThreadFunction(int workerIndex);
+
+  struct ProcessingStage
+  {
+    vtkSmartPointer<vtkPlusTrackedFrameProcessor> Processor;
+    /*! Copy of the processor configuration, used for creating the processors of the worker threads */
+    vtkSmartPointer<vtkXMLDataElement> Configuration;
+    /*! Modification time of Processor when the processors of the worker threads were created */
+    vtkMTimeType WorkerProcessorsMTime;
+    unsigned long NumberOfProcessedFrames;
+    double TotalProcessingTimeSec;
+    double MaxProcessingTimeSec;
+  };
+
+  struct ProcessingJob
+  {
+    /*! Input frame, replaced by the output of each stage */
+    igsioTrackedFrame Frame;
+    double Timestamp;
+    /*! Index of the stage that processes the frame next */
+    int NextStageIndex;
+    bool InProgress;
+    bool Completed;
+    PlusStatus Status;
+  };
+
   double LastProcessedInputDataTimestamp;
 
   bool EnableProcessing;
 
+  bool ProcessAllFrames;
+  int NumberOfProcessingThreads;
+  int MaximumNumberOfQueuedFrames;
+
+  /*! UID of the last input video item that has been queued for processing (0 if none) */
+  BufferItemUidType LastQueuedInputItemUid;
+
   /*!
     This repository stores all fixed (persistent) transforms, such as calibration matrices.
     It is initialized once, ReadConfig and not updated if calibration transforms are changed in the application's global transform repository.
@@ -67,7 +201,22 @@ protected:
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
 
-  vtkPlusTrackedFrameProcessor* ProcessorAlgorithm;
+  /*! Processing stages, in the order of application */
+  std::vector<ProcessingStage> ProcessingStages;
+
+  /*! Processors, transform repositories and stage indices of the worker threads. Processors may be replaced while ProcessingJobsMutex is locked. */
+  std::vector<vtkSmartPointer<vtkPlusTrackedFrameProcessor> > WorkerProcessors;
+  std::vector<vtkSmartPointer<vtkIGSIOTransformRepository> > WorkerTransformRepositories;
+  std::vector<int> WorkerStageIndices;
+  std::vector<std::thread> WorkerThreads;
+
+  /*! Frames in the order of acquisition. Completed frames are removed from the front. */
+  std::deque<ProcessingJob*> ProcessingJobs;
+  std::mutex ProcessingJobsMutex;
+  std::condition_variable ProcessingJobAvailable;
+  bool StopProcessingRequested;
+  unsigned long NumberOfProcessedFrames;
+  unsigned long NumberOfDroppedFrames;
 
 private:
   vtkPlusImageProcessorVideoSource(const vtkPlusImageProcessorVideoSource&);  // Not implemented.
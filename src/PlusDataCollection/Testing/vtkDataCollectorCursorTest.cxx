@@ -0,0 +1,358 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkDataCollectorCursorTest.cxx
+  \brief This program tests if cursor-based incremental data queries return each buffer item exactly once, in the same order as timestamp-based queries
+  With --test-invalid-frame it fills the tool buffers by hand and checks that a tracked frame that cannot be computed is left out of the
+  result, both when the frame would be newly allocated and when it would reuse a frame of the output list.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const char DEVICE_SET_CONFIG[] =
+    "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+    "<Device Id=\"TrackerDevice\" Type=\"FakeTracker\" Mode=\"Default\" AcquisitionRate=\"100\" ToolReferenceFrame=\"Tracker\">"
+    "<DataSources>"
+    "<DataSource Type=\"Tool\" Id=\"Reference\" PortName=\"0\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus\" PortName=\"1\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus-2\" PortName=\"2\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus-3\" PortName=\"3\" BufferSize=\"1000\" />"
+    "</DataSources>"
+    "<OutputChannels><OutputChannel Id=\"TrackerStream\">"
+    "<DataSource Id=\"Reference\" /><DataSource Id=\"Stylus\" /><DataSource Id=\"Stylus-2\" /><DataSource Id=\"Stylus-3\" />"
+    "</OutputChannel></OutputChannels>"
+    "</Device>"
+    "</DataCollection></PlusConfiguration>";
+
+  // The tracker is not started, items are added to the tool buffers by the test
+  const char INVALID_FRAME_DEVICE_SET_CONFIG[] =
+    "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+    "<Device Id=\"TrackerDevice\" Type=\"FakeTracker\" Mode=\"Default\" ToolReferenceFrame=\"Tracker\">"
+    "<DataSources>"
+    "<DataSource Type=\"Tool\" Id=\"Reference\" PortName=\"0\" BufferSize=\"100\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus\" PortName=\"1\" BufferSize=\"100\" />"
+    "</DataSources>"
+    "<OutputChannels><OutputChannel Id=\"TrackerStream\">"
+    "<DataSource Id=\"Reference\" /><DataSource Id=\"Stylus\" />"
+    "</OutputChannel></OutputChannels>"
+    "</Device>"
+    "</DataCollection></PlusConfiguration>";
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddToolItems(vtkPlusDataSource* tool, const std::vector<double>& timestamps, unsigned long& frameNumber)
+  {
+    vtkSmartPointer<vtkMatrix4x4> toolToTrackerTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (unsigned int i = 0; i < timestamps.size(); ++i)
+    {
+      toolToTrackerTransform->SetElement(0, 3, timestamps[i]);
+      if (tool->AddTimeStampedItem(toolToTrackerTransform, TOOL_OK, frameNumber++, timestamps[i], timestamps[i]) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item to the buffer of tool " << tool->GetId());
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckTimestamps(const std::string& queryName, vtkIGSIOTrackedFrameList* frames, const std::vector<double>& expectedTimestamps)
+  {
+    if (frames->GetNumberOfTrackedFrames() != expectedTimestamps.size())
+    {
+      LOG_ERROR(queryName << " returned " << frames->GetNumberOfTrackedFrames() << " frames, expected " << expectedTimestamps.size());
+      return 1;
+    }
+    for (unsigned int i = 0; i < expectedTimestamps.size(); ++i)
+    {
+      if (frames->GetTrackedFrame(i)->GetTimestamp() != expectedTimestamps[i])
+      {
+        LOG_ERROR(queryName << ": timestamp mismatch at frame " << i << ": " << std::fixed << frames->GetTrackedFrame(i)->GetTimestamp() << " != " << expectedTimestamps[i]);
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // The Stylus has no item near one of the Reference timestamps (the closest ones are farther than the maximum
+  // interpolation time difference), so the tracked frame cannot be computed at that timestamp
+  int TestInvalidFrame()
+  {
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(INVALID_FRAME_DEVICE_SET_CONFIG));
+    if (configRootElement == NULL)
+    {
+      LOG_ERROR("Unable to parse test device set configuration");
+      return 1;
+    }
+    vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+    if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS || dataCollector->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to connect to the test devices");
+      return 1;
+    }
+
+    vtkPlusDevice* trackerDevice = NULL;
+    vtkPlusDataSource* referenceTool = NULL;
+    vtkPlusDataSource* stylusTool = NULL;
+    vtkPlusChannel* channel = NULL;
+    if (dataCollector->GetDevice(trackerDevice, "TrackerDevice") != PLUS_SUCCESS
+        || trackerDevice->GetTool("Reference", referenceTool) != PLUS_SUCCESS
+        || trackerDevice->GetTool("Stylus", stylusTool) != PLUS_SUCCESS
+        || dataCollector->GetChannel(channel, "TrackerStream") != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to get the test tools and channel");
+      return 1;
+    }
+
+    int numberOfErrors = 0;
+    unsigned long referenceFrameNumber = 0;
+    unsigned long stylusFrameNumber = 0;
+
+    // All frames are valid, the list has 5 frames that the next query reuses
+    std::vector<double> validTimestamps;
+    for (double timestamp = 10.0; timestamp < 14.5; timestamp += 1.0)
+    {
+      validTimestamps.push_back(timestamp);
+    }
+    if (AddToolItems(referenceTool, validTimestamps, referenceFrameNumber) != PLUS_SUCCESS
+        || AddToolItems(stylusTool, validTimestamps, stylusFrameNumber) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+    vtkPlusDataCollector::DataCursor cursor;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (dataCollector->GetTrackingData(channel, cursor, frames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracking data using cursor");
+      numberOfErrors++;
+    }
+    numberOfErrors += CheckTimestamps("Query of valid frames", frames, validTimestamps);
+
+    // The frame at 22 is invalid and it would reuse the third frame of the list
+    const double invalidTimestamp = 22.0;
+    std::vector<double> referenceTimestamps;
+    std::vector<double> stylusTimestamps;
+    for (double timestamp = 20.0; timestamp < 24.5; timestamp += 1.0)
+    {
+      referenceTimestamps.push_back(timestamp);
+      if (timestamp != invalidTimestamp)
+      {
+        stylusTimestamps.push_back(timestamp);
+      }
+    }
+    if (AddToolItems(referenceTool, referenceTimestamps, referenceFrameNumber) != PLUS_SUCCESS
+        || AddToolItems(stylusTool, stylusTimestamps, stylusFrameNumber) != PLUS_SUCCESS)
+    {
+      return 1;
+    }
+    if (dataCollector->GetTrackingData(channel, cursor, frames) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Query with an invalid reused frame did not report the failure");
+      numberOfErrors++;
+    }
+    numberOfErrors += CheckTimestamps("Query with an invalid reused frame", frames, stylusTimestamps);
+    if (cursor.GetLastTimestamp() != referenceTimestamps.back())
+    {
+      LOG_ERROR("Cursor timestamp (" << std::fixed << cursor.GetLastTimestamp() << ") does not match the last item timestamp (" << referenceTimestamps.back() << ")");
+      numberOfErrors++;
+    }
+
+    // All items again, into an empty list: the invalid frame would be a newly allocated frame
+    std::vector<double> allValidTimestamps(validTimestamps);
+    allValidTimestamps.insert(allValidTimestamps.end(), stylusTimestamps.begin(), stylusTimestamps.end());
+    cursor.Reset();
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> newFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (dataCollector->GetTrackingData(channel, cursor, newFrames) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Query with an invalid new frame did not report the failure");
+      numberOfErrors++;
+    }
+    numberOfErrors += CheckTimestamps("Query with an invalid new frame", newFrames, allValidTimestamps);
+
+    dataCollector->Disconnect();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  double acquisitionTimeSec = 2.0;
+  double pollingPeriodSec = 0.05;
+  bool testInvalidFrame = false;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--acquisition-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionTimeSec, "Total time of data acquisition");
+  args.AddArgument("--polling-period-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &pollingPeriodSec, "Time between subsequent data queries");
+  args.AddArgument("--test-invalid-frame", vtksys::CommandLineArguments::NO_ARGUMENT, &testInvalidFrame, "Test that frames that cannot be computed are left out of the result, instead of the acquisition test");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (testInvalidFrame)
+  {
+    int numberOfErrors = TestInvalidFrame();
+    if (numberOfErrors > 0)
+    {
+      LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+      return EXIT_FAILURE;
+    }
+    LOG_INFO("Test completed successfully");
+    return EXIT_SUCCESS;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(DEVICE_SET_CONFIG));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse test device set configuration");
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading test device set configuration failed");
+    return EXIT_FAILURE;
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusChannel* channel = NULL;
+  if (dataCollector->GetChannel(channel, "TrackerStream") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get tracker channel");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+
+  // Collect all timestamps returned by the incremental (cursor-based) queries, using a single reused output list
+  vtkPlusDataCollector::DataCursor cursor;
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> newFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  std::vector<double> cursorTimestamps;
+  const double acquisitionStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  while (vtkIGSIOAccurateTimer::GetSystemTime() - acquisitionStartTime < acquisitionTimeSec)
+  {
+    vtkIGSIOAccurateTimer::Delay(pollingPeriodSec);
+    if (dataCollector->GetTrackingData(channel, cursor, newFrames) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracking data using cursor");
+      numberOfErrors++;
+      continue;
+    }
+    for (unsigned int i = 0; i < newFrames->GetNumberOfTrackedFrames(); ++i)
+    {
+      cursorTimestamps.push_back(newFrames->GetTrackedFrame(i)->GetTimestamp());
+    }
+    if (newFrames->GetNumberOfTrackedFrames() > 0 && cursor.GetLastTimestamp() != cursorTimestamps.back())
+    {
+      LOG_ERROR("Cursor timestamp (" << std::fixed << cursor.GetLastTimestamp() << ") does not match last returned frame timestamp (" << cursorTimestamps.back() << ")");
+      numberOfErrors++;
+    }
+  }
+  dataCollector->Stop();
+
+  // Read the remaining items, then a query with the same cursor must not return anything
+  if (dataCollector->GetTrackingData(channel, cursor, newFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get tracking data using cursor");
+    numberOfErrors++;
+  }
+  for (unsigned int i = 0; i < newFrames->GetNumberOfTrackedFrames(); ++i)
+  {
+    cursorTimestamps.push_back(newFrames->GetTrackedFrame(i)->GetTimestamp());
+  }
+  if (dataCollector->GetTrackingData(channel, cursor, newFrames) != PLUS_SUCCESS || newFrames->GetNumberOfTrackedFrames() != 0)
+  {
+    LOG_ERROR("Repeated query returned " << newFrames->GetNumberOfTrackedFrames() << " frames, expected none");
+    numberOfErrors++;
+  }
+
+  // Reference: all items in the buffer, using the timestamp-based query
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> allFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  double timestampFrom = -1;
+  if (dataCollector->GetTrackingData(channel, timestampFrom, allFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get tracking data using timestamp");
+    numberOfErrors++;
+  }
+
+  if (cursor.GetNumberOfSkippedItems() > 0)
+  {
+    LOG_ERROR("Items were skipped (" << cursor.GetNumberOfSkippedItems() << "), buffer may be too small for the test");
+    numberOfErrors++;
+  }
+  if (cursorTimestamps.empty())
+  {
+    LOG_ERROR("No tracking data was returned");
+    numberOfErrors++;
+  }
+  if (cursorTimestamps.size() != allFrames->GetNumberOfTrackedFrames())
+  {
+    LOG_ERROR("Number of frames returned by cursor-based queries (" << cursorTimestamps.size() << ") does not match the number of frames in the buffer (" << allFrames->GetNumberOfTrackedFrames() << ")");
+    numberOfErrors++;
+  }
+  else
+  {
+    for (unsigned int i = 0; i < cursorTimestamps.size(); ++i)
+    {
+      if (cursorTimestamps[i] != allFrames->GetTrackedFrame(i)->GetTimestamp())
+      {
+        LOG_ERROR("Timestamp mismatch at frame " << i << ": " << std::fixed << cursorTimestamps[i] << " != " << allFrames->GetTrackedFrame(i)->GetTimestamp());
+        numberOfErrors++;
+        break;
+      }
+    }
+  }
+
+  // Restarting the cursor must return the whole buffer again
+  cursor.Reset();
+  if (dataCollector->GetTrackingData(channel, cursor, newFrames) != PLUS_SUCCESS || newFrames->GetNumberOfTrackedFrames() != allFrames->GetNumberOfTrackedFrames())
+  {
+    LOG_ERROR("Query after cursor reset returned " << newFrames->GetNumberOfTrackedFrames() << " frames, expected " << allFrames->GetNumberOfTrackedFrames());
+    numberOfErrors++;
+  }
+
+  dataCollector->Disconnect();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully, " << cursorTimestamps.size() << " frames were returned");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,289 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkDataCollectorDumpBuffersTest.cxx
+  \brief This program dumps the buffers of a data collector in the background using multiple threads and checks
+  that the manifest file lists all data sources with the correct number of items, time range and file name, and
+  that the written files contain all the items. With --test-invalid-directories it checks that output directories
+  outside of the application output directory are rejected.
+*/
+
+#include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+#include "vtksys/SystemTools.hxx"
+
+// STL includes
+#include <cmath>
+
+namespace
+{
+  const char DEVICE_SET_CONFIG[] =
+    "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+    "<Device Id=\"TrackerDevice\" Type=\"FakeTracker\" Mode=\"Default\" AcquisitionRate=\"100\" ToolReferenceFrame=\"Tracker\">"
+    "<DataSources>"
+    "<DataSource Type=\"Tool\" Id=\"Reference\" PortName=\"0\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus\" PortName=\"1\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus-2\" PortName=\"2\" BufferSize=\"1000\" />"
+    "<DataSource Type=\"Tool\" Id=\"Stylus-3\" PortName=\"3\" BufferSize=\"1000\" />"
+    "</DataSources>"
+    "<OutputChannels><OutputChannel Id=\"TrackerStream\">"
+    "<DataSource Id=\"Reference\" /><DataSource Id=\"Stylus\" /><DataSource Id=\"Stylus-2\" /><DataSource Id=\"Stylus-3\" />"
+    "</OutputChannel></OutputChannels>"
+    "</Device>"
+    "</DataCollection></PlusConfiguration>";
+
+  //----------------------------------------------------------------------------
+  // Returns the number of errors found in the manifest file and the written buffer files
+  int CheckManifest(const std::string& manifestFilePath, vtkPlusDevice* device, bool expectedCompression)
+  {
+    vtkSmartPointer<vtkXMLDataElement> manifestElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromFile(manifestFilePath.c_str()));
+    if (manifestElement == NULL)
+    {
+      LOG_ERROR("Unable to read manifest file: " << manifestFilePath);
+      return 1;
+    }
+
+    int numberOfErrors = 0;
+    if (manifestElement->GetAttribute("Status") == NULL || STRCASECMP(manifestElement->GetAttribute("Status"), "SUCCESS") != 0)
+    {
+      LOG_ERROR("Manifest file " << manifestFilePath << " does not report success");
+      numberOfErrors++;
+    }
+    if (manifestElement->GetAttribute("Compression") == NULL || STRCASECMP(manifestElement->GetAttribute("Compression"), expectedCompression ? "TRUE" : "FALSE") != 0)
+    {
+      LOG_ERROR("Manifest file " << manifestFilePath << " reports wrong compression setting");
+      numberOfErrors++;
+    }
+
+    int numberOfTools = 0;
+    int totalNumberOfItems = 0;
+    for (DataSourceContainerConstIterator toolIt = device->GetToolIteratorBegin(); toolIt != device->GetToolIteratorEnd(); ++toolIt)
+    {
+      vtkPlusDataSource* tool = toolIt->second;
+      ++numberOfTools;
+      vtkXMLDataElement* sourceElement = manifestElement->FindNestedElementWithNameAndAttribute("DataSource", "SourceId", tool->GetSourceId().c_str());
+      if (sourceElement == NULL)
+      {
+        LOG_ERROR("Data source " << tool->GetSourceId() << " is missing from the manifest");
+        numberOfErrors++;
+        continue;
+      }
+
+      int numberOfItems = -1;
+      double oldestTimestamp = 0;
+      double latestTimestamp = 0;
+      double expectedOldestTimestamp = 0;
+      double expectedLatestTimestamp = 0;
+      tool->GetOldestTimeStamp(expectedOldestTimestamp);
+      tool->GetLatestTimeStamp(expectedLatestTimestamp);
+      if (!sourceElement->GetScalarAttribute("NumberOfItems", numberOfItems) || numberOfItems != tool->GetNumberOfItems())
+      {
+        LOG_ERROR("Data source " << tool->GetSourceId() << ": number of items in the manifest (" << numberOfItems << ") does not match the buffer (" << tool->GetNumberOfItems() << ")");
+        numberOfErrors++;
+        continue;
+      }
+      if (sourceElement->GetAttribute("Status") == NULL || STRCASECMP(sourceElement->GetAttribute("Status"), "SUCCESS") != 0)
+      {
+        LOG_ERROR("Data source " << tool->GetSourceId() << ": manifest does not report success");
+        numberOfErrors++;
+      }
+      if (numberOfItems == 0)
+      {
+        // empty buffers are not written
+        continue;
+      }
+      totalNumberOfItems += numberOfItems;
+      if (!sourceElement->GetScalarAttribute("OldestTimestamp", oldestTimestamp) || !sourceElement->GetScalarAttribute("LatestTimestamp", latestTimestamp)
+          || std::abs(oldestTimestamp - expectedOldestTimestamp) > 1e-5 || std::abs(latestTimestamp - expectedLatestTimestamp) > 1e-5)
+      {
+        LOG_ERROR("Data source " << tool->GetSourceId() << ": time range in the manifest (" << std::fixed << oldestTimestamp << " - " << latestTimestamp
+                  << ") does not match the buffer (" << expectedOldestTimestamp << " - " << expectedLatestTimestamp << ")");
+        numberOfErrors++;
+      }
+      if (sourceElement->GetAttribute("FileName") == NULL)
+      {
+        LOG_ERROR("Data source " << tool->GetSourceId() << ": file name is missing from the manifest");
+        numberOfErrors++;
+        continue;
+      }
+
+      // The written file must contain all the items of the buffer
+      std::string filePath = vtksys::SystemTools::GetFilenamePath(manifestFilePath) + "/" + sourceElement->GetAttribute("FileName");
+      vtkSmartPointer<vtkIGSIOTrackedFrameList> frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (vtkIGSIOSequenceIO::Read(filePath, frames) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to read buffer file: " << filePath);
+        numberOfErrors++;
+        continue;
+      }
+      if (static_cast<int>(frames->GetNumberOfTrackedFrames()) != numberOfItems)
+      {
+        LOG_ERROR("Buffer file " << filePath << " contains " << frames->GetNumberOfTrackedFrames() << " frames, expected " << numberOfItems);
+        numberOfErrors++;
+      }
+    }
+
+    if (numberOfTools == 0 || manifestElement->GetNumberOfNestedElements() != numberOfTools)
+    {
+      LOG_ERROR("Manifest lists " << manifestElement->GetNumberOfNestedElements() << " data sources, expected " << numberOfTools);
+      numberOfErrors++;
+    }
+    if (totalNumberOfItems == 0)
+    {
+      LOG_ERROR("No items were written, the acquisition time may be too short for the test");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  double acquisitionTimeSec = 1.0;
+  int numberOfThreads = 2;
+  bool testInvalidDirectories = false;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--acquisition-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionTimeSec, "Time of data acquisition before dumping the buffers");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of data sources written at the same time");
+  args.AddArgument("--test-invalid-directories", vtksys::CommandLineArguments::NO_ARGUMENT, &testInvalidDirectories, "Check that directories outside of the output directory are rejected (errors are logged)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(DEVICE_SET_CONFIG));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse test device set configuration");
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading test device set configuration failed");
+    return EXIT_FAILURE;
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    return EXIT_FAILURE;
+  }
+  vtkIGSIOAccurateTimer::Delay(acquisitionTimeSec);
+  // Stop acquisition, so that the buffer contents do not change while they are compared to the written files
+  dataCollector->Stop();
+
+  vtkPlusDevice* device = NULL;
+  if (dataCollector->GetDevice(device, "TrackerDevice") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get tracker device");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+
+  if (testInvalidDirectories)
+  {
+    std::string outputDirectory = vtksys::SystemTools::CollapseFullPath(vtkPlusConfig::GetInstance()->GetOutputDirectory());
+    const std::string invalidDirectories[] = { "../BufferDumpOutsideOfOutputDirectory", vtksys::SystemTools::GetParentDirectory(outputDirectory), outputDirectory + "/Dump/../../BufferDumpOutsideOfOutputDirectory" };
+    for (unsigned int i = 0; i < sizeof(invalidDirectories) / sizeof(invalidDirectories[0]); ++i)
+    {
+      if (dataCollector->StartDumpBuffersToDirectory(invalidDirectories[i], false, numberOfThreads) == PLUS_SUCCESS)
+      {
+        LOG_ERROR("Buffer dump to " << invalidDirectories[i] << " was expected to be rejected");
+        numberOfErrors++;
+        while (dataCollector->IsDumpBuffersInProgress())
+        {
+          vtkIGSIOAccurateTimer::Delay(0.05);
+        }
+      }
+      else if (dataCollector->GetDumpBuffersStatus() == PLUS_SUCCESS)
+      {
+        LOG_ERROR("Buffer dump status is expected to be failure after a rejected dump");
+        numberOfErrors++;
+      }
+      std::string manifestFilePath;
+      if (dataCollector->DumpBuffersToDirectory(invalidDirectories[i], false, numberOfThreads, &manifestFilePath) == PLUS_SUCCESS)
+      {
+        LOG_ERROR("Synchronous buffer dump to " << invalidDirectories[i] << " was expected to be rejected");
+        numberOfErrors++;
+      }
+    }
+  }
+
+  // Background dump with multiple threads
+  if (dataCollector->StartDumpBuffersToDirectory("DumpBuffersTest", false, numberOfThreads) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start buffer dump");
+    numberOfErrors++;
+  }
+  else
+  {
+    const double maxDumpTimeSec = 60.0;
+    const double dumpStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    while (dataCollector->IsDumpBuffersInProgress() && vtkIGSIOAccurateTimer::GetSystemTime() - dumpStartTime < maxDumpTimeSec)
+    {
+      vtkIGSIOAccurateTimer::Delay(0.05);
+    }
+    if (dataCollector->IsDumpBuffersInProgress())
+    {
+      LOG_ERROR("Buffer dump did not complete in " << maxDumpTimeSec << " sec");
+      return EXIT_FAILURE;
+    }
+    if (dataCollector->GetDumpBuffersStatus() != PLUS_SUCCESS || dataCollector->GetDumpBuffersProgress() != 1.0)
+    {
+      LOG_ERROR("Buffer dump is expected to complete successfully, progress: " << dataCollector->GetDumpBuffersProgress());
+      numberOfErrors++;
+    }
+    numberOfErrors += CheckManifest(dataCollector->GetDumpBuffersManifestFilePath(), device, false);
+  }
+
+  // Synchronous dump with compression, into a different directory so that the manifest file names cannot collide
+  std::string manifestFilePath;
+  if (dataCollector->DumpBuffersToDirectory("DumpBuffersTestCompressed", true, numberOfThreads, &manifestFilePath) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Compressed buffer dump failed");
+    numberOfErrors++;
+  }
+  else
+  {
+    numberOfErrors += CheckManifest(manifestFilePath, device, true);
+  }
+
+  dataCollector->Disconnect();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
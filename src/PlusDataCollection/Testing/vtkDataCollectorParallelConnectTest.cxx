@@ -0,0 +1,167 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkDataCollectorParallelConnectTest.cxx
+  \brief This program tests if independent devices are connected concurrently and dependent devices are connected after their inputs
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDevice.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+namespace
+{
+  const double CONNECT_DELAY_SEC = 1.0;
+  const int NUMBER_OF_SLOW_DEVICES = 3;
+
+  //----------------------------------------------------------------------------
+  std::string GetFakeTrackerConfig(const std::string& deviceId, double connectDelaySec, double connectTimeoutSec)
+  {
+    std::ostringstream config;
+    config << "<Device Id=\"" << deviceId << "\" Type=\"FakeTracker\" ToolReferenceFrame=\"" << deviceId << "\""
+           << " ConnectDelaySec=\"" << connectDelaySec << "\"";
+    if (connectTimeoutSec > 0)
+    {
+      config << " ConnectTimeoutSec=\"" << connectTimeoutSec << "\"";
+    }
+    config << ">"
+           << "<DataSources><DataSource Type=\"Tool\" Id=\"Stylus\" PortName=\"0\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"" << deviceId << "Stream\"><DataSource Id=\"Stylus\" /></OutputChannel></OutputChannels>"
+           << "</Device>";
+    return config.str();
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool simulateTimeout(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--simulate-timeout", vtksys::CommandLineArguments::NO_ARGUMENT, &simulateTimeout, "Configure a device that does not connect within its timeout and expect connection failure.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Create a device set with slow, independent trackers and a mixer that depends on two of them
+  std::ostringstream deviceSetConfig;
+  deviceSetConfig << "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\" ParallelConnect=\"TRUE\">";
+  for (int i = 0; i < NUMBER_OF_SLOW_DEVICES; ++i)
+  {
+    std::ostringstream deviceId;
+    deviceId << "Tracker" << i;
+    const bool timeoutDevice = simulateTimeout && (i == 0);
+    deviceSetConfig << GetFakeTrackerConfig(deviceId.str(), CONNECT_DELAY_SEC, timeoutDevice ? CONNECT_DELAY_SEC * 0.2 : 0.0);
+  }
+  deviceSetConfig << "<Device Id=\"Mixer\" Type=\"VirtualMixer\">"
+                  << "<InputChannels><InputChannel Id=\"Tracker0Stream\" /><InputChannel Id=\"Tracker1Stream\" /></InputChannels>"
+                  << "<OutputChannels><OutputChannel Id=\"MixerStream\" /></OutputChannels>"
+                  << "</Device>";
+  deviceSetConfig << "</DataCollection></PlusConfiguration>";
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(deviceSetConfig.str().c_str()));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse test device set configuration");
+    return EXIT_FAILURE;
+  }
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading test device set configuration failed");
+    return EXIT_FAILURE;
+  }
+
+  const double connectStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  PlusStatus connectStatus = dataCollector->Connect();
+  const double connectTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - connectStartTime;
+  LOG_INFO("Connecting " << NUMBER_OF_SLOW_DEVICES << " devices with " << CONNECT_DELAY_SEC << " sec connection delay took " << connectTimeSec << " sec");
+
+  if (simulateTimeout)
+  {
+    if (connectStatus == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Connection was expected to fail because of timeout, but it succeeded");
+      return EXIT_FAILURE;
+    }
+    LOG_INFO("Connection failed because of timeout, as expected");
+    return EXIT_SUCCESS;
+  }
+
+  if (connectStatus != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to connect devices");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors = 0;
+
+  // All slow devices are in the first wave, therefore total time should be close to a single device's delay
+  if (connectTimeSec > CONNECT_DELAY_SEC * (NUMBER_OF_SLOW_DEVICES - 1))
+  {
+    LOG_ERROR("Devices were not connected concurrently: connection took " << connectTimeSec << " sec");
+    numberOfErrors++;
+  }
+
+  for (int i = 0; i < NUMBER_OF_SLOW_DEVICES; ++i)
+  {
+    std::ostringstream deviceId;
+    deviceId << "Tracker" << i;
+    double deviceConnectTimeSec = 0;
+    if (dataCollector->GetDeviceConnectTimeSec(deviceId.str(), deviceConnectTimeSec) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Connection time is not available for device " << deviceId.str());
+      numberOfErrors++;
+    }
+    else if (deviceConnectTimeSec < CONNECT_DELAY_SEC * 0.9)
+    {
+      LOG_ERROR("Connection time of device " << deviceId.str() << " is shorter than the simulated delay: " << deviceConnectTimeSec << " sec");
+      numberOfErrors++;
+    }
+  }
+
+  vtkPlusDevice* mixer = NULL;
+  if (dataCollector->GetDevice(mixer, "Mixer") != PLUS_SUCCESS || !mixer->IsConnected())
+  {
+    LOG_ERROR("Mixer device is not connected");
+    numberOfErrors++;
+  }
+
+  if (dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    numberOfErrors++;
+  }
+
+  dataCollector->Stop();
+  dataCollector->Disconnect();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
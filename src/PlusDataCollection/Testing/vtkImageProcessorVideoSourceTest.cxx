@@ -0,0 +1,328 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkImageProcessorVideoSourceTest.cxx
+  \brief This program replays a recorded sequence and processes it with an ImageProcessor device that applies two
+  processors and with a chain of two ImageProcessor devices that apply one processor each, all in process-all-frames mode.
+  The output frames of the single device must be identical to the output frames of the chain of devices.
+  The output frames of the single device must be in the order of acquisition, the processed and dropped frame counters
+  must account for all input frames and, with --expect-no-dropped-frames, every input frame must be processed.
+*/
+
+#include "PlusConfigure.h"
+#include "PlusXmlUtils.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkImageData.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusImageProcessorVideoSource.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+// STL includes
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetDeviceSetConfig(const std::string& inputSequenceFileName, double acquisitionRate, int inputBufferSize, int numberOfProcessingThreads, int maximumNumberOfQueuedFrames)
+  {
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+           << "<Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << inputSequenceFileName << "\" UseData=\"IMAGE\" AcquisitionRate=\"" << acquisitionRate << "\" RepeatEnabled=\"TRUE\">"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" BufferSize=\"" << inputBufferSize << "\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "</Device>"
+           // Single device with two processing stages
+           << "<Device Id=\"ChainDevice\" Type=\"ImageProcessor\" ProcessAllFrames=\"TRUE\" NumberOfProcessingThreads=\"" << numberOfProcessingThreads << "\" MaximumNumberOfQueuedFrames=\"" << maximumNumberOfQueuedFrames << "\">"
+           << "<InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"ChainVideo\" PortUsImageOrientation=\"MF\" BufferSize=\"1000\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"ChainStream\" VideoDataSourceId=\"ChainVideo\" /></OutputChannels>"
+           << "</Device>"
+           // Chain of two devices with one processing stage each
+           << "<Device Id=\"FirstStageDevice\" Type=\"ImageProcessor\" ProcessAllFrames=\"TRUE\" NumberOfProcessingThreads=\"" << numberOfProcessingThreads << "\" MaximumNumberOfQueuedFrames=\"" << maximumNumberOfQueuedFrames << "\">"
+           << "<InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"FirstStageVideo\" PortUsImageOrientation=\"MF\" BufferSize=\"1000\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"FirstStageStream\" VideoDataSourceId=\"FirstStageVideo\" /></OutputChannels>"
+           << "</Device>"
+           << "<Device Id=\"SecondStageDevice\" Type=\"ImageProcessor\" ProcessAllFrames=\"TRUE\" NumberOfProcessingThreads=\"" << numberOfProcessingThreads << "\" MaximumNumberOfQueuedFrames=\"" << maximumNumberOfQueuedFrames << "\">"
+           << "<InputChannels><InputChannel Id=\"FirstStageStream\" /></InputChannels>"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"SecondStageVideo\" PortUsImageOrientation=\"MF\" BufferSize=\"1000\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"SecondStageStream\" VideoDataSourceId=\"SecondStageVideo\" /></OutputChannels>"
+           << "</Device>"
+           << "</DataCollection></PlusConfiguration>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void AddProcessingStage(vtkXMLDataElement* configRootElement, const char* deviceId, vtkXMLDataElement* processorElement)
+  {
+    vtkXMLDataElement* deviceElement = configRootElement->FindNestedElementWithName("DataCollection")->FindNestedElementWithNameAndAttribute("Device", "Id", deviceId);
+    vtkSmartPointer<vtkXMLDataElement> stageProcessorElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    stageProcessorElement->DeepCopy(processorElement);
+    deviceElement->AddNestedElement(stageProcessorElement);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsImageEqual(vtkImageData* image1, vtkImageData* image2)
+  {
+    if (image1 == NULL || image2 == NULL)
+    {
+      return false;
+    }
+    int* dims1 = image1->GetDimensions();
+    int* dims2 = image2->GetDimensions();
+    if (dims1[0] != dims2[0] || dims1[1] != dims2[1] || dims1[2] != dims2[2]
+        || image1->GetScalarType() != image2->GetScalarType() || image1->GetNumberOfScalarComponents() != image2->GetNumberOfScalarComponents())
+    {
+      return false;
+    }
+    size_t imageSizeBytes = static_cast<size_t>(dims1[0]) * dims1[1] * dims1[2] * image1->GetScalarSize() * image1->GetNumberOfScalarComponents();
+    return memcmp(image1->GetScalarPointer(), image2->GetScalarPointer(), imageSizeBytes) == 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  std::string inputSequenceFileName;
+  std::string processorConfigFileName;
+  double acquisitionTimeSec = 5.0;
+  int numberOfProcessingThreads = 2;
+  int minimumNumberOfComparedFrames = 5;
+  double acquisitionRate = 5.0;
+  int inputBufferSize = 1000;
+  int maximumNumberOfQueuedFrames = 1000;
+  bool expectNoDroppedFrames = false;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFileName, "Ultrasound sequence that is replayed as input of the processors");
+  args.AddArgument("--processor-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &processorConfigFileName, "Configuration file of a vtkPlusTransverseProcessEnhancer processor");
+  args.AddArgument("--acquisition-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionTimeSec, "Time of data acquisition");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfProcessingThreads, "Number of processing threads of each stage");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Frame rate of the replayed sequence");
+  args.AddArgument("--input-buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBufferSize, "Buffer size of the replayed sequence, frames are dropped if the processing falls behind by more frames");
+  args.AddArgument("--max-queued-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maximumNumberOfQueuedFrames, "Maximum number of frames queued for processing in the image processor devices");
+  args.AddArgument("--expect-no-dropped-frames", vtksys::CommandLineArguments::NO_ARGUMENT, &expectNoDroppedFrames, "Check that no frames are dropped and every input frame is processed");
+  args.AddArgument("--min-compared-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minimumNumberOfComparedFrames, "Minimum number of frames that must be processed both by the single device and by the chain of devices");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputSequenceFileName.empty() || processorConfigFileName.empty())
+  {
+    LOG_ERROR("--input-seq-file and --processor-config-file are required");
+    return EXIT_FAILURE;
+  }
+
+  // Processor configuration, the same processor is used in both stages
+  vtkSmartPointer<vtkXMLDataElement> processorConfigRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(processorConfigRootElement, processorConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << processorConfigFileName);
+    return EXIT_FAILURE;
+  }
+  vtkSmartPointer<vtkXMLDataElement> processorElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  vtkXMLDataElement* configuredProcessorElement = processorConfigRootElement->LookupElementWithName("Processor");
+  processorElement->DeepCopy(configuredProcessorElement != NULL ? configuredProcessorElement : processorConfigRootElement.GetPointer());
+  processorElement->SetName("Processor");
+  processorElement->SetAttribute("Type", "vtkPlusTransverseProcessEnhancer");
+  // The processors of the devices would write the same intermediate image files
+  vtkXMLDataElement* saveIntermediateResultsElement = processorElement->LookupElementWithName("SaveIntermediateResults");
+  if (saveIntermediateResultsElement != NULL)
+  {
+    saveIntermediateResultsElement->SetAttribute("SaveIntermediateResults", "FALSE");
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromString(GetDeviceSetConfig(inputSequenceFileName, acquisitionRate, inputBufferSize, numberOfProcessingThreads, maximumNumberOfQueuedFrames).c_str()));
+  if (configRootElement == NULL)
+  {
+    LOG_ERROR("Unable to parse test device set configuration");
+    return EXIT_FAILURE;
+  }
+  AddProcessingStage(configRootElement, "ChainDevice", processorElement);
+  AddProcessingStage(configRootElement, "ChainDevice", processorElement);
+  AddProcessingStage(configRootElement, "FirstStageDevice", processorElement);
+  AddProcessingStage(configRootElement, "SecondStageDevice", processorElement);
+  vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Reading test device set configuration failed");
+    return EXIT_FAILURE;
+  }
+  if (dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to start data collection");
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusDevice* videoDevice = NULL;
+  vtkPlusDevice* chainDevice = NULL;
+  vtkPlusDevice* secondStageDevice = NULL;
+  vtkPlusDataSource* inputVideo = NULL;
+  vtkPlusDataSource* chainVideo = NULL;
+  vtkPlusDataSource* secondStageVideo = NULL;
+  if (dataCollector->GetDevice(videoDevice, "VideoDevice") != PLUS_SUCCESS || dataCollector->GetDevice(chainDevice, "ChainDevice") != PLUS_SUCCESS
+      || dataCollector->GetDevice(secondStageDevice, "SecondStageDevice") != PLUS_SUCCESS || videoDevice->GetVideoSource("Video", inputVideo) != PLUS_SUCCESS
+      || chainDevice->GetVideoSource("ChainVideo", chainVideo) != PLUS_SUCCESS || secondStageDevice->GetVideoSource("SecondStageVideo", secondStageVideo) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get the video sources of the devices");
+    return EXIT_FAILURE;
+  }
+  vtkPlusImageProcessorVideoSource* chainProcessor = vtkPlusImageProcessorVideoSource::SafeDownCast(chainDevice);
+  if (chainProcessor->GetNumberOfProcessingStages() != 2)
+  {
+    LOG_ERROR("ChainDevice is expected to have 2 processing stages");
+    return EXIT_FAILURE;
+  }
+
+  // Processing starts at the latest input frame, find it from the first output frame while it is still in the input buffer
+  const double maxWaitTimeSec = 60.0;
+  double waitStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  while (chainVideo->GetNumberOfItems() < 1 && vtkIGSIOAccurateTimer::GetSystemTime() - waitStartTime < maxWaitTimeSec)
+  {
+    vtkIGSIOAccurateTimer::Delay(0.01);
+  }
+  double firstOutputTimestamp(0);
+  double firstInputTimestamp(-1);
+  BufferItemUidType firstInputItemUid(0);
+  if (chainVideo->GetNumberOfItems() < 1 || chainVideo->GetTimeStamp(chainVideo->GetOldestItemUidInBuffer(), firstOutputTimestamp) != ITEM_OK
+      || inputVideo->GetItemUidFromTime(firstOutputTimestamp, firstInputItemUid) != ITEM_OK
+      || inputVideo->GetTimeStamp(firstInputItemUid, firstInputTimestamp) != ITEM_OK || firstInputTimestamp != firstOutputTimestamp)
+  {
+    LOG_ERROR("Unable to find the input frame of the first processed frame");
+    return EXIT_FAILURE;
+  }
+
+  vtkIGSIOAccurateTimer::Delay(acquisitionTimeSec);
+
+  // Stop the input and wait until all input frames are processed or dropped
+  videoDevice->StopRecording();
+  BufferItemUidType latestInputItemUid = inputVideo->GetLatestItemUidInBuffer();
+  unsigned long expectedNumberOfFrames = static_cast<unsigned long>(latestInputItemUid - firstInputItemUid + 1);
+  waitStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  while (chainProcessor->GetNumberOfProcessedFrames() + chainProcessor->GetNumberOfDroppedFrames() < expectedNumberOfFrames
+         && vtkIGSIOAccurateTimer::GetSystemTime() - waitStartTime < maxWaitTimeSec)
+  {
+    vtkIGSIOAccurateTimer::Delay(0.05);
+  }
+
+  // Stop acquisition, so that the buffer contents do not change while they are compared
+  dataCollector->Stop();
+
+  int numberOfErrors = 0;
+  unsigned long numberOfProcessedFrames = chainProcessor->GetNumberOfProcessedFrames();
+  unsigned long numberOfDroppedFrames = chainProcessor->GetNumberOfDroppedFrames();
+  LOG_INFO("Input frames: " << expectedNumberOfFrames << ", processed frames: " << numberOfProcessedFrames << ", dropped frames: " << numberOfDroppedFrames);
+  if (numberOfProcessedFrames + numberOfDroppedFrames != expectedNumberOfFrames || chainProcessor->GetNumberOfQueuedFrames() != 0)
+  {
+    LOG_ERROR("Processed (" << numberOfProcessedFrames << ") and dropped (" << numberOfDroppedFrames << ") frames do not add up to the number of input frames ("
+              << expectedNumberOfFrames << "), queued frames: " << chainProcessor->GetNumberOfQueuedFrames());
+    numberOfErrors++;
+  }
+  if (static_cast<unsigned long>(chainVideo->GetNumberOfItems()) != numberOfProcessedFrames)
+  {
+    LOG_ERROR("Number of output frames (" << chainVideo->GetNumberOfItems() << ") does not match the number of processed frames (" << numberOfProcessedFrames << ")");
+    numberOfErrors++;
+  }
+
+  // Output frames must be in the order of acquisition
+  double previousTimestamp = firstOutputTimestamp;
+  for (BufferItemUidType itemUid = chainVideo->GetOldestItemUidInBuffer() + 1; itemUid <= chainVideo->GetLatestItemUidInBuffer(); ++itemUid)
+  {
+    double timestamp(0);
+    if (chainVideo->GetTimeStamp(itemUid, timestamp) != ITEM_OK || timestamp <= previousTimestamp)
+    {
+      LOG_ERROR("Output frame " << itemUid << " is out of order, timestamp: " << std::fixed << timestamp << ", previous timestamp: " << previousTimestamp);
+      numberOfErrors++;
+    }
+    previousTimestamp = timestamp;
+  }
+
+  if (expectNoDroppedFrames)
+  {
+    if (numberOfDroppedFrames != 0)
+    {
+      LOG_ERROR(numberOfDroppedFrames << " frames were dropped, expected none");
+      numberOfErrors++;
+    }
+    // Every input frame must have an output frame with the same timestamp
+    for (BufferItemUidType itemUid = firstInputItemUid; itemUid <= latestInputItemUid; ++itemUid)
+    {
+      double timestamp(0);
+      StreamBufferItem outputItem;
+      if (inputVideo->GetTimeStamp(itemUid, timestamp) != ITEM_OK || chainVideo->GetStreamBufferItemFromTime(timestamp, &outputItem, vtkPlusBuffer::EXACT_TIME) != ITEM_OK)
+      {
+        LOG_ERROR("Input frame " << itemUid << " (timestamp: " << std::fixed << timestamp << ") was not processed");
+        numberOfErrors++;
+      }
+    }
+  }
+
+  // Devices start processing at different frames, so only the frames processed by both are compared
+  int numberOfComparedFrames = 0;
+  if (secondStageVideo->GetNumberOfItems() > 0)
+  {
+    for (BufferItemUidType itemUid = secondStageVideo->GetOldestItemUidInBuffer(); itemUid <= secondStageVideo->GetLatestItemUidInBuffer(); ++itemUid)
+    {
+      StreamBufferItem secondStageItem;
+      if (secondStageVideo->GetStreamBufferItem(itemUid, &secondStageItem) != ITEM_OK)
+      {
+        LOG_ERROR("Unable to get item " << itemUid << " of the chain of devices");
+        numberOfErrors++;
+        continue;
+      }
+      double timestamp = secondStageItem.GetTimestamp(0);
+      StreamBufferItem chainItem;
+      if (chainVideo->GetStreamBufferItemFromTime(timestamp, &chainItem, vtkPlusBuffer::EXACT_TIME) != ITEM_OK)
+      {
+        // not processed by the single device
+        continue;
+      }
+      if (!IsImageEqual(chainItem.GetFrame().GetImage(), secondStageItem.GetFrame().GetImage()))
+      {
+        LOG_ERROR("Output of the single device differs from the output of the chain of devices at timestamp " << std::fixed << timestamp);
+        numberOfErrors++;
+      }
+      numberOfComparedFrames++;
+    }
+  }
+
+  dataCollector->Disconnect();
+
+  LOG_INFO("Compared frames: " << numberOfComparedFrames);
+  if (numberOfComparedFrames < minimumNumberOfComparedFrames)
+  {
+    LOG_ERROR("Only " << numberOfComparedFrames << " frames were processed both by the single device and by the chain of devices, expected at least " << minimumNumberOfComparedFrames);
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,607 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkVirtualTemporalCalibratorTest.cxx
+  This program generates synthetic video and tracker position signals with known time lag and sampling rates
+  and checks that the lag estimated by vtkPlusVirtualTemporalCalibrator matches the known lag, for both
+  polarities of the tracker signal. Synthetic signals are also fed to the device in chunks to check that the
+  incrementally updated correlation results in the same lag as the estimation from the whole window.
+  If a video and a tracker sequence are specified then the recorded frames are fed to a device in small chunks,
+  as during acquisition, and it is checked that each input frame is read and segmented only once, the signals are
+  trimmed to the window, the lag is estimated and published in the field data of the output channel and applied
+  to the tracker device.
+*/
+
+#include "PlusConfigure.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkMatrix4x4.h"
+#include "vtkObjectFactory.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDeviceFactory.h"
+#include "vtkPlusLineSegmentationAlgo.h"
+#include "vtkPlusVirtualTemporalCalibrator.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLDataElement.h"
+#include "vtkXMLUtilities.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// Gives access to the processing steps of the device, which are normally called from its data capture thread
+class vtkPlusVirtualTemporalCalibratorTester : public vtkPlusVirtualTemporalCalibrator
+{
+public:
+  static vtkPlusVirtualTemporalCalibratorTester* New();
+  vtkTypeMacro(vtkPlusVirtualTemporalCalibratorTester, vtkPlusVirtualTemporalCalibrator);
+
+  using vtkPlusVirtualTemporalCalibrator::InternalConnect;
+  using vtkPlusVirtualTemporalCalibrator::ReadNewFrames;
+  using vtkPlusVirtualTemporalCalibrator::UpdateVideoSignal;
+  using vtkPlusVirtualTemporalCalibrator::RemoveSamplesOutsideWindow;
+  using vtkPlusVirtualTemporalCalibrator::EstimateLagInWindow;
+  using vtkPlusVirtualTemporalCalibrator::PublishLag;
+  using vtkPlusVirtualTemporalCalibrator::ApplyLag;
+
+  vtkIGSIOTrackedFrameList* GetQueuedVideoFrames() { return this->QueuedVideoFrames; }
+  vtkPlusLineSegmentationAlgo* GetLineSegmenter() { return this->LineSegmenter; }
+  const std::deque<double>& GetVideoSignalTimestamps() const { return this->VideoSignalTimestamps; }
+  const std::deque<double>& GetVideoSignalValues() const { return this->VideoSignalValues; }
+  const std::deque<double>& GetTrackerSignalTimestamps() const { return this->TrackerSignalTimestamps; }
+
+  // Append samples to the signals, as ReadNewFrames and UpdateVideoSignal do
+  void AddVideoSample(double timestamp, double value)
+  {
+    this->VideoSignalTimestamps.push_back(timestamp);
+    this->VideoSignalValues.push_back(value);
+    ++this->NumberOfUncorrelatedVideoSamples;
+  }
+  void AddTrackerSample(double timestamp, const std::array<double, 3>& position)
+  {
+    this->TrackerSignalTimestamps.push_back(timestamp);
+    this->TrackerPositions.push_back(position);
+  }
+
+protected:
+  vtkPlusVirtualTemporalCalibratorTester() {}
+  virtual ~vtkPlusVirtualTemporalCalibratorTester() {}
+};
+
+vtkStandardNewMacro(vtkPlusVirtualTemporalCalibratorTester);
+
+namespace
+{
+  const double PI = 3.14159265358979323846;
+
+  //----------------------------------------------------------------------------
+  // Position metric of an irregular periodic motion
+  double GetPosition(double timeSec)
+  {
+    return 20.0 * std::sin(2 * PI * 0.4 * timeSec) + 8.0 * std::sin(2 * PI * 1.1 * timeSec + 0.3);
+  }
+
+  //----------------------------------------------------------------------------
+  // Sample the position metric. The signal at time t contains the position at t-lag.
+  void GenerateSignal(double startTimeSec, double durationSec, double samplingPeriodSec, double lagSec, double polarity, std::vector<double>& timestamps, std::vector<double>& values)
+  {
+    timestamps.clear();
+    values.clear();
+    for (double timeSec = startTimeSec; timeSec <= startTimeSec + durationSec; timeSec += samplingPeriodSec)
+    {
+      timestamps.push_back(timeSec);
+      values.push_back(polarity * GetPosition(timeSec - lagSec));
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  // Estimate the lag of synthetic signals with known lag
+  int TestEstimateLag(double maxLagErrorSec, double minConfidence)
+  {
+    int numberOfFailures = 0;
+    const double windowSec = 10.0;
+    const double maximumLagSec = 0.5;
+    const double samplingResolutionSec = 0.001;
+    const double videoSamplingPeriodSec = 1.0 / 30.0;
+    const double trackerSamplingPeriodSec = 1.0 / 100.0;
+
+    const double knownLagsSec[] = { 0.0, 0.083, -0.137 };
+    const double trackerPolarities[] = { 1.0, -1.0 };
+    for (unsigned int lagIndex = 0; lagIndex < sizeof(knownLagsSec) / sizeof(knownLagsSec[0]); ++lagIndex)
+    {
+      for (unsigned int polarityIndex = 0; polarityIndex < sizeof(trackerPolarities) / sizeof(trackerPolarities[0]); ++polarityIndex)
+      {
+        std::vector<double> videoTimestamps;
+        std::vector<double> videoValues;
+        GenerateSignal(1000.0, windowSec, videoSamplingPeriodSec, 0.0, 1.0, videoTimestamps, videoValues);
+        std::vector<double> trackerTimestamps;
+        std::vector<double> trackerValues;
+        GenerateSignal(1000.0, windowSec, trackerSamplingPeriodSec, knownLagsSec[lagIndex], trackerPolarities[polarityIndex], trackerTimestamps, trackerValues);
+
+        double lagSec = 0.0;
+        double confidence = 0.0;
+        if (vtkPlusVirtualTemporalCalibrator::EstimateLag(videoTimestamps, videoValues, trackerTimestamps, trackerValues,
+            maximumLagSec, samplingResolutionSec, lagSec, confidence) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Lag estimation failed (known lag: " << knownLagsSec[lagIndex] << " sec, polarity: " << trackerPolarities[polarityIndex] << ")");
+          ++numberOfFailures;
+          continue;
+        }
+        LOG_INFO("Known lag: " << knownLagsSec[lagIndex] << " sec, polarity: " << trackerPolarities[polarityIndex]
+                 << ", estimated lag: " << lagSec << " sec, confidence: " << confidence);
+        if (std::abs(lagSec - knownLagsSec[lagIndex]) > maxLagErrorSec)
+        {
+          LOG_ERROR("Estimated lag " << lagSec << " sec differs from the known lag " << knownLagsSec[lagIndex] << " sec by more than " << maxLagErrorSec << " sec");
+          ++numberOfFailures;
+        }
+        if (confidence < minConfidence)
+        {
+          LOG_ERROR("Confidence of the estimation " << confidence << " is lower than the expected " << minConfidence);
+          ++numberOfFailures;
+        }
+      }
+    }
+
+    // Signals that do not overlap cannot be used for the estimation
+    std::vector<double> videoTimestamps;
+    std::vector<double> videoValues;
+    GenerateSignal(1000.0, windowSec, videoSamplingPeriodSec, 0.0, 1.0, videoTimestamps, videoValues);
+    std::vector<double> trackerTimestamps;
+    std::vector<double> trackerValues;
+    GenerateSignal(2000.0, windowSec, trackerSamplingPeriodSec, 0.0, 1.0, trackerTimestamps, trackerValues);
+    double lagSec = 0.0;
+    double confidence = 0.0;
+    if (vtkPlusVirtualTemporalCalibrator::EstimateLag(videoTimestamps, videoValues, trackerTimestamps, trackerValues,
+        maximumLagSec, samplingResolutionSec, lagSec, confidence) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Lag estimation is expected to fail for signals that do not overlap");
+      ++numberOfFailures;
+    }
+
+    return numberOfFailures;
+  }
+
+  //----------------------------------------------------------------------------
+  // Feed synthetic signals to the device in chunks and compare the lag estimated from the incrementally updated correlation
+  // to the lag estimated from the whole window. The tracker moves along an oblique axis, which the device has to find.
+  int TestIncrementalEstimation(double maxLagErrorSec, double minConfidence)
+  {
+    int numberOfFailures = 0;
+    const double startTimeSec = 1000.0;
+    const double durationSec = 40.0;
+    const double chunkSec = 0.5;
+    const double knownLagSec = 0.061;
+    const double motionAxis[3] = { 0.6, -0.48, 0.64 };
+
+    vtkSmartPointer<vtkPlusVirtualTemporalCalibratorTester> calibrator = vtkSmartPointer<vtkPlusVirtualTemporalCalibratorTester>::New();
+    calibrator->SetWindowSec(10.0);
+    calibrator->SetMaximumLagSec(0.5);
+    calibrator->SetSamplingResolutionSec(0.001);
+    if (calibrator->InternalConnect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to initialize the temporal calibrator");
+      return 1;
+    }
+
+    std::vector<double> videoTimestamps;
+    std::vector<double> videoValues;
+    GenerateSignal(startTimeSec, durationSec, 1.0 / 30.0, 0.0, 1.0, videoTimestamps, videoValues);
+    std::vector<double> trackerTimestamps;
+    std::vector<double> trackerValues;
+    GenerateSignal(startTimeSec, durationSec, 1.0 / 100.0, knownLagSec, 1.0, trackerTimestamps, trackerValues);
+
+    size_t nextVideoIndex = 0;
+    size_t nextTrackerIndex = 0;
+    int numberOfEstimations = 0;
+    for (double untilTimestamp = startTimeSec + chunkSec; untilTimestamp <= startTimeSec + durationSec; untilTimestamp += chunkSec)
+    {
+      for (; nextTrackerIndex < trackerTimestamps.size() && trackerTimestamps[nextTrackerIndex] <= untilTimestamp; ++nextTrackerIndex)
+      {
+        const double value = trackerValues[nextTrackerIndex];
+        std::array<double, 3> position = {{ 300.0 + value * motionAxis[0], -200.0 + value * motionAxis[1], 1000.0 + value * motionAxis[2] }};
+        calibrator->AddTrackerSample(trackerTimestamps[nextTrackerIndex], position);
+      }
+      for (; nextVideoIndex < videoTimestamps.size() && videoTimestamps[nextVideoIndex] <= untilTimestamp; ++nextVideoIndex)
+      {
+        // Line position in pixels
+        calibrator->AddVideoSample(videoTimestamps[nextVideoIndex], 150.0 + 3.0 * videoValues[nextVideoIndex]);
+      }
+      calibrator->RemoveSamplesOutsideWindow();
+
+      double lagSec = 0.0;
+      double confidence = 0.0;
+      if (calibrator->EstimateLagInWindow(lagSec, confidence) != PLUS_SUCCESS)
+      {
+        if (untilTimestamp - startTimeSec > 2.0)
+        {
+          LOG_ERROR("Lag estimation in the window failed at " << std::fixed << untilTimestamp);
+          ++numberOfFailures;
+        }
+        continue;
+      }
+      ++numberOfEstimations;
+
+      // Reference estimation from the whole window. The whole tracker signal is used, so that the same video samples
+      // can be compared to the tracker signal as when they were added to the correlation.
+      std::vector<double> windowTimestamps(calibrator->GetVideoSignalTimestamps().begin(), calibrator->GetVideoSignalTimestamps().end());
+      std::vector<double> windowValues(calibrator->GetVideoSignalValues().begin(), calibrator->GetVideoSignalValues().end());
+      std::vector<double> acquiredTrackerTimestamps(trackerTimestamps.begin(), trackerTimestamps.begin() + nextTrackerIndex);
+      std::vector<double> acquiredTrackerValues(trackerValues.begin(), trackerValues.begin() + nextTrackerIndex);
+      double referenceLagSec = 0.0;
+      double referenceConfidence = 0.0;
+      if (vtkPlusVirtualTemporalCalibrator::EstimateLag(windowTimestamps, windowValues, acquiredTrackerTimestamps, acquiredTrackerValues,
+          calibrator->GetMaximumLagSec(), calibrator->GetSamplingResolutionSec(), referenceLagSec, referenceConfidence) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Reference lag estimation failed at " << std::fixed << untilTimestamp);
+        ++numberOfFailures;
+        continue;
+      }
+      if (std::abs(lagSec - referenceLagSec) > 1e-9 || std::abs(confidence - referenceConfidence) > 1e-6)
+      {
+        LOG_ERROR("Incrementally estimated lag " << lagSec << " sec (confidence: " << confidence << ") differs from the lag estimated from the whole window "
+                  << referenceLagSec << " sec (confidence: " << referenceConfidence << ") at " << std::fixed << untilTimestamp);
+        ++numberOfFailures;
+      }
+      if (std::abs(lagSec - knownLagSec) > maxLagErrorSec || confidence < minConfidence)
+      {
+        LOG_ERROR("Incrementally estimated lag " << lagSec << " sec (confidence: " << confidence << ") does not match the known lag " << knownLagSec << " sec");
+        ++numberOfFailures;
+      }
+    }
+    LOG_INFO("Incremental lag estimation: " << numberOfEstimations << " estimations in " << durationSec << " sec");
+    if (numberOfEstimations == 0)
+    {
+      LOG_ERROR("No lag has been estimated from the synthetic signals");
+      ++numberOfFailures;
+    }
+
+    return numberOfFailures;
+  }
+
+  //----------------------------------------------------------------------------
+  std::string GetDeviceSetConfig(const std::string& videoSequenceFileName, const std::string& trackerSequenceFileName, double windowSec)
+  {
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+           << "<Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << videoSequenceFileName << "\" UseData=\"IMAGE\">"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" BufferSize=\"5000\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "</Device>"
+           << "<Device Id=\"TrackerDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << trackerSequenceFileName << "\" UseData=\"TRANSFORM\" ToolReferenceFrame=\"Reference\">"
+           << "<DataSources><DataSource Type=\"Tool\" Id=\"Probe\" BufferSize=\"5000\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"TrackerStream\"><DataSource Id=\"Probe\" /></OutputChannel></OutputChannels>"
+           << "</Device>"
+           << "<Device Id=\"TemporalCalibrator\" Type=\"VirtualTemporalCalibratorTester\" ProbeToReferenceTransformName=\"ProbeToReference\" WindowSec=\"" << windowSec << "\">"
+           << "<vtkPlusLineSegmentationAlgo ClipRectangleOrigin=\"225 40\" ClipRectangleSize=\"350 510\" />"
+           << "<InputChannels><InputChannel Id=\"VideoStream\" /><InputChannel Id=\"TrackerStream\" /></InputChannels>"
+           << "<DataSources><DataSource Type=\"FieldData\" Id=\"Lag\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"LagStream\"><DataSource Id=\"Lag\" /></OutputChannel></OutputChannels>"
+           << "</Device>"
+           << "</DataCollection></PlusConfiguration>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  // Add the frames of the recorded sequences that are acquired until the specified time to the input buffers
+  PlusStatus AddRecordedFrames(double untilTimestamp, vtkIGSIOTrackedFrameList* videoFrames, unsigned int& nextVideoFrameIndex, vtkIGSIOTrackedFrameList* trackerFrames, unsigned int& nextTrackerFrameIndex,
+                               vtkPlusDataSource* videoSource, vtkPlusDataSource* trackerTool, unsigned int& numberOfAddedVideoFrames)
+  {
+    numberOfAddedVideoFrames = 0;
+    for (; nextVideoFrameIndex < videoFrames->GetNumberOfTrackedFrames(); ++nextVideoFrameIndex)
+    {
+      igsioTrackedFrame* frame = videoFrames->GetTrackedFrame(nextVideoFrameIndex);
+      if (frame->GetTimestamp() > untilTimestamp)
+      {
+        break;
+      }
+      if (videoSource->AddItem(frame->GetImageData(), nextVideoFrameIndex, frame->GetTimestamp(), frame->GetTimestamp()) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add video frame " << nextVideoFrameIndex << " to the input buffer");
+        return PLUS_FAIL;
+      }
+      ++numberOfAddedVideoFrames;
+    }
+
+    igsioTransformName probeToReferenceTransformName("Probe", "Reference");
+    vtkSmartPointer<vtkMatrix4x4> probeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (; nextTrackerFrameIndex < trackerFrames->GetNumberOfTrackedFrames(); ++nextTrackerFrameIndex)
+    {
+      igsioTrackedFrame* frame = trackerFrames->GetTrackedFrame(nextTrackerFrameIndex);
+      if (frame->GetTimestamp() > untilTimestamp)
+      {
+        break;
+      }
+      ToolStatus status(TOOL_OK);
+      if (frame->GetFrameTransform(probeToReferenceTransformName, probeToReferenceTransform) != PLUS_SUCCESS
+          || frame->GetFrameTransformStatus(probeToReferenceTransformName, status) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get the ProbeToReference transform of tracker frame " << nextTrackerFrameIndex);
+        return PLUS_FAIL;
+      }
+      if (trackerTool->AddTimeStampedItem(probeToReferenceTransform, status, nextTrackerFrameIndex, frame->GetTimestamp(), frame->GetTimestamp()) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tracker frame " << nextTrackerFrameIndex << " to the input buffer");
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsStrictlyIncreasing(const std::deque<double>& timestamps)
+  {
+    return std::adjacent_find(timestamps.begin(), timestamps.end(), std::greater_equal<double>()) == timestamps.end();
+  }
+
+  //----------------------------------------------------------------------------
+  // Feed the recorded sequences to the device in chunks and check the signals, the published and the applied lag
+  int TestDevice(const std::string& videoSequenceFileName, const std::string& trackerSequenceFileName, double chunkSec)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> videoFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackerFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkIGSIOSequenceIO::Read(videoSequenceFileName, videoFrames) != PLUS_SUCCESS || vtkIGSIOSequenceIO::Read(trackerSequenceFileName, trackerFrames) != PLUS_SUCCESS
+        || videoFrames->GetNumberOfTrackedFrames() == 0 || trackerFrames->GetNumberOfTrackedFrames() == 0)
+    {
+      LOG_ERROR("Unable to read the video and tracker sequences");
+      return 1;
+    }
+    const double startTimestamp = std::max(videoFrames->GetTrackedFrame(0)->GetTimestamp(), trackerFrames->GetTrackedFrame(0)->GetTimestamp());
+    const double stopTimestamp = std::min(videoFrames->GetTrackedFrame(videoFrames->GetNumberOfTrackedFrames() - 1)->GetTimestamp(),
+                                          trackerFrames->GetTrackedFrame(trackerFrames->GetNumberOfTrackedFrames() - 1)->GetTimestamp());
+    // The window is shorter than the recording, so that old samples have to be removed
+    const double windowSec = 0.6 * (stopTimestamp - startTimestamp);
+
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+          vtkXMLUtilities::ReadElementFromString(GetDeviceSetConfig(videoSequenceFileName, trackerSequenceFileName, windowSec).c_str()));
+    if (configRootElement == NULL)
+    {
+      LOG_ERROR("Unable to parse test device set configuration");
+      return 1;
+    }
+    vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+    dataCollector->GetDeviceFactory().RegisterDevice("VirtualTemporalCalibratorTester", "vtkPlusVirtualTemporalCalibratorTester",
+        (vtkPlusDeviceFactory::PointerToDevice)&vtkPlusVirtualTemporalCalibratorTester::New);
+    // Data collection is not started, the input buffers are filled by the test
+    if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS || dataCollector->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to set up the test devices");
+      return 1;
+    }
+
+    vtkPlusDevice* device = NULL;
+    vtkPlusDevice* videoDevice = NULL;
+    vtkPlusDevice* trackerDevice = NULL;
+    vtkPlusDataSource* videoSource = NULL;
+    vtkPlusDataSource* trackerTool = NULL;
+    vtkPlusDataSource* lagSource = NULL;
+    if (dataCollector->GetDevice(device, "TemporalCalibrator") != PLUS_SUCCESS || dataCollector->GetDevice(videoDevice, "VideoDevice") != PLUS_SUCCESS
+        || dataCollector->GetDevice(trackerDevice, "TrackerDevice") != PLUS_SUCCESS || videoDevice->GetVideoSource("Video", videoSource) != PLUS_SUCCESS
+        || trackerDevice->GetTool("ProbeToReference", trackerTool) != PLUS_SUCCESS || device->GetFieldDataSource("Lag", lagSource) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to get the test devices and data sources");
+      return 1;
+    }
+    vtkPlusVirtualTemporalCalibratorTester* calibrator = vtkPlusVirtualTemporalCalibratorTester::SafeDownCast(device);
+
+    int numberOfFailures = 0;
+    if (calibrator->GetLineSegmenter()->GetNumberOfThreads() != 1)
+    {
+      LOG_ERROR("Line segmentation is expected to run on the data capture thread of the device, NumberOfThreads: " << calibrator->GetLineSegmenter()->GetNumberOfThreads());
+      ++numberOfFailures;
+    }
+
+    unsigned int nextVideoFrameIndex = 0;
+    unsigned int nextTrackerFrameIndex = 0;
+    double lastReadVideoTimestamp = UNDEFINED_TIMESTAMP;
+    bool firstRead = true;
+    bool samplesRemoved = false;
+    for (double untilTimestamp = startTimestamp + chunkSec; untilTimestamp <= stopTimestamp; untilTimestamp += chunkSec)
+    {
+      unsigned int numberOfAddedVideoFrames = 0;
+      if (AddRecordedFrames(untilTimestamp, videoFrames, nextVideoFrameIndex, trackerFrames, nextTrackerFrameIndex, videoSource, trackerTool, numberOfAddedVideoFrames) != PLUS_SUCCESS)
+      {
+        return numberOfFailures + 1;
+      }
+      if (calibrator->ReadNewFrames() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Reading new frames failed at " << std::fixed << untilTimestamp);
+        return numberOfFailures + 1;
+      }
+
+      // Each video frame is read exactly once (the first read starts from the most recent frame)
+      vtkIGSIOTrackedFrameList* queuedFrames = calibrator->GetQueuedVideoFrames();
+      const unsigned int numberOfQueuedFrames = queuedFrames->GetNumberOfTrackedFrames();
+      if (!firstRead && numberOfQueuedFrames != numberOfAddedVideoFrames)
+      {
+        LOG_ERROR("Read " << numberOfQueuedFrames << " video frames, expected the " << numberOfAddedVideoFrames << " newly acquired frames");
+        ++numberOfFailures;
+      }
+      for (unsigned int i = 0; i < numberOfQueuedFrames; ++i)
+      {
+        if (lastReadVideoTimestamp != UNDEFINED_TIMESTAMP && queuedFrames->GetTrackedFrame(i)->GetTimestamp() <= lastReadVideoTimestamp)
+        {
+          LOG_ERROR("Video frame acquired at " << std::fixed << queuedFrames->GetTrackedFrame(i)->GetTimestamp() << " is read again");
+          ++numberOfFailures;
+        }
+        lastReadVideoTimestamp = queuedFrames->GetTrackedFrame(i)->GetTimestamp();
+      }
+      if (numberOfQueuedFrames > 0)
+      {
+        firstRead = false;
+      }
+
+      const size_t numberOfVideoSamples = calibrator->GetVideoSignalTimestamps().size();
+      if (calibrator->UpdateVideoSignal() != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Video signal update failed at " << std::fixed << untilTimestamp);
+        return numberOfFailures + 1;
+      }
+      if (calibrator->GetQueuedVideoFrames()->GetNumberOfTrackedFrames() != 0 || calibrator->GetVideoSignalTimestamps().size() > numberOfVideoSamples + numberOfQueuedFrames)
+      {
+        LOG_ERROR("Only the queued video frames are expected to be segmented, and only once");
+        ++numberOfFailures;
+      }
+
+      const double oldestVideoTimestamp = (calibrator->GetVideoSignalTimestamps().empty() ? UNDEFINED_TIMESTAMP : calibrator->GetVideoSignalTimestamps().front());
+      calibrator->RemoveSamplesOutsideWindow();
+      const std::deque<double>& videoTimestamps = calibrator->GetVideoSignalTimestamps();
+      const std::deque<double>& trackerTimestamps = calibrator->GetTrackerSignalTimestamps();
+      if (!IsStrictlyIncreasing(videoTimestamps) || !IsStrictlyIncreasing(trackerTimestamps))
+      {
+        LOG_ERROR("Signal timestamps are expected to be strictly increasing");
+        ++numberOfFailures;
+      }
+      if ((!videoTimestamps.empty() && videoTimestamps.back() - videoTimestamps.front() > windowSec)
+          || (!trackerTimestamps.empty() && trackerTimestamps.back() - trackerTimestamps.front() > windowSec))
+      {
+        LOG_ERROR("Signals are longer than the " << windowSec << " sec window");
+        ++numberOfFailures;
+      }
+      if (!videoTimestamps.empty() && oldestVideoTimestamp != UNDEFINED_TIMESTAMP && videoTimestamps.front() > oldestVideoTimestamp)
+      {
+        samplesRemoved = true;
+      }
+    }
+    if (!samplesRemoved)
+    {
+      LOG_ERROR("Samples are expected to be removed from the window");
+      ++numberOfFailures;
+    }
+
+    double lagSec = 0.0;
+    double confidence = 0.0;
+    if (calibrator->EstimateLagInWindow(lagSec, confidence) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Lag estimation in the window failed");
+      return numberOfFailures + 1;
+    }
+    LOG_INFO("Estimated lag: " << lagSec << " sec, confidence: " << confidence);
+    if (std::abs(lagSec) > calibrator->GetMaximumLagSec() || confidence <= 0 || confidence > 1)
+    {
+      LOG_ERROR("Invalid lag estimation result, lag: " << lagSec << " sec, confidence: " << confidence);
+      ++numberOfFailures;
+    }
+
+    // The lag is added to the field data of the output channel
+    if (calibrator->PublishLag(lagSec, confidence) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Publishing the lag failed");
+      ++numberOfFailures;
+    }
+    StreamBufferItem lagItem;
+    if (lagSource->GetNumberOfItems() != 1 || lagSource->GetStreamBufferItem(lagSource->GetLatestItemUidInBuffer(), &lagItem) != ITEM_OK)
+    {
+      LOG_ERROR("Published lag is not found in the field data source");
+      ++numberOfFailures;
+    }
+    else
+    {
+      double publishedLagSec = 0.0;
+      double publishedConfidence = 0.0;
+      if (igsioCommon::StringToNumber<double>(lagItem.GetFrameField("TemporalCalibrationLagSec"), publishedLagSec) != PLUS_SUCCESS
+          || igsioCommon::StringToNumber<double>(lagItem.GetFrameField("TemporalCalibrationConfidence"), publishedConfidence) != PLUS_SUCCESS
+          || std::abs(publishedLagSec - lagSec) > 1e-5 || std::abs(publishedConfidence - confidence) > 1e-5)
+      {
+        LOG_ERROR("Published lag (" << lagItem.GetFrameField("TemporalCalibrationLagSec") << " sec, confidence: " << lagItem.GetFrameField("TemporalCalibrationConfidence")
+                  << ") does not match the estimated lag (" << lagSec << " sec, confidence: " << confidence << ")");
+        ++numberOfFailures;
+      }
+    }
+
+    // Applying the lag changes the time offset of the tracker device and restarts the tracker signal collection
+    calibrator->SetApplyLagToDeviceId("TrackerDevice");
+    const double localTimeOffsetSec = trackerDevice->GetLocalTimeOffsetSec();
+    if (calibrator->ApplyLag(lagSec) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Applying the lag failed");
+      ++numberOfFailures;
+    }
+    if (std::abs(trackerDevice->GetLocalTimeOffsetSec() - (localTimeOffsetSec - lagSec)) > 1e-9 || std::abs(calibrator->GetTotalAppliedLagSec() - lagSec) > 1e-9)
+    {
+      LOG_ERROR("Tracker LocalTimeOffsetSec is " << trackerDevice->GetLocalTimeOffsetSec() << " sec after applying the lag, expected " << localTimeOffsetSec - lagSec
+                << " sec (total applied lag: " << calibrator->GetTotalAppliedLagSec() << " sec)");
+      ++numberOfFailures;
+    }
+    if (!calibrator->GetTrackerSignalTimestamps().empty())
+    {
+      LOG_ERROR("Tracker signal is expected to be collected again after the lag is applied");
+      ++numberOfFailures;
+    }
+
+    dataCollector->Disconnect();
+    return numberOfFailures;
+  }
+}
+
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  double maxLagErrorSec(0.002);
+  double minConfidence(0.99);
+  std::string videoSequenceFileName;
+  std::string trackerSequenceFileName;
+  double chunkSec(0.5);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--max-lag-error", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxLagErrorSec, "Maximum difference between the estimated and the known lag in seconds (Default: 0.002).");
+  args.AddArgument("--min-confidence", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &minConfidence, "Minimum confidence of the estimation (Default: 0.99).");
+  args.AddArgument("--video-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &videoSequenceFileName, "Recorded video sequence of a moving plane, fed to the device together with --tracker-seq-file.");
+  args.AddArgument("--tracker-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &trackerSequenceFileName, "Recorded tracker sequence with ProbeToReference transforms.");
+  args.AddArgument("--chunk-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &chunkSec, "Length of the recorded data that is added to the input buffers before each update of the device (Default: 0.5).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfFailures = TestEstimateLag(maxLagErrorSec, minConfidence);
+  numberOfFailures += TestIncrementalEstimation(maxLagErrorSec, minConfidence);
+
+  if (!videoSequenceFileName.empty() || !trackerSequenceFileName.empty())
+  {
+    if (videoSequenceFileName.empty() || trackerSequenceFileName.empty() || chunkSec <= 0)
+    {
+      LOG_ERROR("Both --video-seq-file and --tracker-seq-file and a positive --chunk-sec are required for the device test");
+      return EXIT_FAILURE;
+    }
+    numberOfFailures += TestDevice(videoSequenceFileName, trackerSequenceFileName, chunkSec);
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
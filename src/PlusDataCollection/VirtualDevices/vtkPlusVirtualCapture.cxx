@@ -220,8 +220,13 @@ PlusStatus vtkPlusVirtualCapture::OpenFile(const char* aFilename)
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */, std::string* resultFilename /* = NULL */)
+PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */, std::string* resultFilename /* = NULL */, const std::atomic<bool>* cancelRequested /* = NULL */, long* numberOfDiscardedFrames /* = NULL */)
 {
+  if (numberOfDiscardedFrames != NULL)
+  {
+    (*numberOfDiscardedFrames) = 0;
+  }
+
   // Fix the header to write the correct number of frames
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->WriterAccessMutex);
 
@@ -241,7 +246,20 @@ PlusStatus vtkPlusVirtualCapture::CloseFile(const char* aFilename /* = NULL */,
   // Do we have any outstanding unwritten data?
   if (this->RecordedFrames->GetNumberOfTrackedFrames() != 0)
   {
-    this->WriteFrames(true);
+    if (cancelRequested != NULL && *cancelRequested)
+    {
+      LOG_WARNING("Closing of file " << this->CurrentFilename << " cancelled, " << this->RecordedFrames->GetNumberOfTrackedFrames() << " buffered frames are discarded");
+      if (numberOfDiscardedFrames != NULL)
+      {
+        (*numberOfDiscardedFrames) = this->RecordedFrames->GetNumberOfTrackedFrames();
+      }
+      this->TotalFramesRecorded -= this->RecordedFrames->GetNumberOfTrackedFrames();
+      this->ClearRecordedFrames();
+    }
+    else
+    {
+      this->WriteFrames(true);
+    }
   }
 
   this->Writer->UpdateDimensionsCustomStrings(this->TotalFramesRecorded, this->GetIsData3D());
@@ -10,6 +10,7 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 #include "vtkPlusDevice.h"
 #include "vtkIGSIOSequenceIOBase.h"
+#include <atomic>
 #include <string>
 
 //class vtkIGSIOTrackedFrameList;
@@ -46,8 +47,12 @@ public:
     Close the output file.
     resultFilename contains the full path of the actual written file name. It may be different than the requested name
     if the requested name was not valid (for example wrong extension).
+    If cancelRequested is specified and set before the buffered frames are written then the buffered frames are discarded
+    and the file is finalized with the frames that have been already written.
+    numberOfDiscardedFrames contains the number of buffered frames that were discarded because of the cancellation
+    (0 if all the recorded frames are saved to file, even if cancellation was requested).
   */
-  virtual PlusStatus CloseFile(const char* aFilename = NULL, std::string* resultFilename = NULL);
+  virtual PlusStatus CloseFile(const char* aFilename = NULL, std::string* resultFilename = NULL, const std::atomic<bool>* cancelRequested = NULL, long* numberOfDiscardedFrames = NULL);
 
   virtual PlusStatus Reset();
 
@@ -0,0 +1,904 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "PlusMath.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkIGSIOTrackedFrameList.h"
+#include "vtkIGSIOTransformRepository.h"
+#include "vtkObjectFactory.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusLineSegmentationAlgo.h"
+#include "vtkPlusVirtualTemporalCalibrator.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+
+vtkStandardNewMacro(vtkPlusVirtualTemporalCalibrator);
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+  // If the tracker metric "swings" less than this, the lag is not estimated
+  const double MINIMUM_TRACKER_SIGNAL_PEAK_TO_PEAK_MM = 8.0;
+  // If the video metric "swings" less than this, the lag is not estimated
+  const double MINIMUM_VIDEO_SIGNAL_PEAK_TO_PEAK_PIXEL = 30.0;
+  // Minimum number of fixed signal samples that can be compared to the moving signal at all the lag candidates
+  const unsigned int MINIMUM_NUMBER_OF_OVERLAPPING_SAMPLES = 10;
+  // Temporal resolution below which two time values are considered identical
+  const double TIMESTAMP_EPSILON_SEC = 0.0001;
+  // Maximum number of frames that are read from an input channel in one update
+  const int MAX_NUMBER_OF_FRAMES_TO_ADD = 100;
+
+  const char* LAG_FIELD_NAME = "TemporalCalibrationLagSec";
+  const char* CONFIDENCE_FIELD_NAME = "TemporalCalibrationConfidence";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualTemporalCalibrator::vtkPlusVirtualTemporalCalibrator()
+  : vtkPlusDevice()
+  , WindowSec(10.0)
+  , UpdatePeriodSec(2.0)
+  , MaximumLagSec(0.5)
+  , SamplingResolutionSec(0.001)
+  , MinimumConfidenceToApplyLag(0.9)
+  , MinimumLagToApplySec(0.005)
+  , VideoChannel(NULL)
+  , TrackerChannel(NULL)
+  , LastVideoTimestamp(UNDEFINED_TIMESTAMP)
+  , LastTrackerTimestamp(UNDEFINED_TIMESTAMP)
+  , LastEstimationTime(0.0)
+  , NumberOfUncorrelatedVideoSamples(0)
+  , LagValid(false)
+  , LagSec(0.0)
+  , Confidence(0.0)
+  , TotalAppliedLagSec(0.0)
+{
+  this->LineSegmenter = vtkSmartPointer<vtkPlusLineSegmentationAlgo>::New();
+  // Only the frames of one update period are segmented at a time, which is not worth starting worker threads for in every update
+  this->LineSegmenter->SetNumberOfThreads(1);
+  this->TransformRepository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  this->QueuedVideoFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  this->NewTrackerFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+
+  // The data capture thread will be used to regularly read the input frames and estimate the lag
+  this->StartThreadForInternalUpdates = true;
+  this->AcquisitionRate = vtkPlusDevice::VIRTUAL_DEVICE_FRAME_RATE;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualTemporalCalibrator::~vtkPlusVirtualTemporalCalibrator()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ProbeToReferenceTransformName: " << this->ProbeToReferenceTransformName << std::endl;
+  os << indent << "WindowSec: " << this->WindowSec << std::endl;
+  os << indent << "UpdatePeriodSec: " << this->UpdatePeriodSec << std::endl;
+  os << indent << "MaximumLagSec: " << this->MaximumLagSec << std::endl;
+  os << indent << "SamplingResolutionSec: " << this->SamplingResolutionSec << std::endl;
+  os << indent << "ApplyLagToDeviceId: " << this->ApplyLagToDeviceId << std::endl;
+  os << indent << "MinimumConfidenceToApplyLag: " << this->MinimumConfidenceToApplyLag << std::endl;
+  os << indent << "MinimumLagToApplySec: " << this->MinimumLagToApplySec << std::endl;
+  double lagSec = 0.0;
+  double confidence = 0.0;
+  if (this->GetLagSec(lagSec, confidence) == PLUS_SUCCESS)
+  {
+    os << indent << "LagSec: " << lagSec << std::endl;
+    os << indent << "Confidence: " << confidence << std::endl;
+  }
+  os << indent << "TotalAppliedLagSec: " << this->TotalAppliedLagSec << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ReadConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_READING(deviceConfig, rootConfigElement);
+
+  XML_READ_STRING_ATTRIBUTE_REQUIRED(ProbeToReferenceTransformName, deviceConfig);
+  igsioTransformName transformName;
+  if (transformName.SetTransformName(this->ProbeToReferenceTransformName.c_str()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid ProbeToReferenceTransformName: " << this->ProbeToReferenceTransformName);
+    return PLUS_FAIL;
+  }
+
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, WindowSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, UpdatePeriodSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MaximumLagSec, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, SamplingResolutionSec, deviceConfig);
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(ApplyLagToDeviceId, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MinimumConfidenceToApplyLag, deviceConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, MinimumLagToApplySec, deviceConfig);
+
+  if (this->WindowSec <= 2 * this->MaximumLagSec)
+  {
+    LOG_ERROR("WindowSec (" << this->WindowSec << ") must be larger than two times MaximumLagSec (" << this->MaximumLagSec << ")");
+    return PLUS_FAIL;
+  }
+  if (this->SamplingResolutionSec < TIMESTAMP_EPSILON_SEC)
+  {
+    LOG_ERROR("SamplingResolutionSec is too small: " << this->SamplingResolutionSec << " sec");
+    return PLUS_FAIL;
+  }
+
+  // Line segmentation parameters are optional, by default the whole image is used
+  if (deviceConfig->FindNestedElementWithName("vtkPlusLineSegmentationAlgo") != NULL)
+  {
+    if (this->LineSegmenter->ReadConfiguration(deviceConfig) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read line segmentation parameters of " << this->GetDeviceId());
+      return PLUS_FAIL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::WriteConfiguration(vtkXMLDataElement* rootConfigElement)
+{
+  XML_FIND_DEVICE_ELEMENT_REQUIRED_FOR_WRITING(deviceConfig, rootConfigElement);
+
+  deviceConfig->SetAttribute("ProbeToReferenceTransformName", this->ProbeToReferenceTransformName.c_str());
+  deviceConfig->SetDoubleAttribute("WindowSec", this->WindowSec);
+  deviceConfig->SetDoubleAttribute("UpdatePeriodSec", this->UpdatePeriodSec);
+  deviceConfig->SetDoubleAttribute("MaximumLagSec", this->MaximumLagSec);
+  deviceConfig->SetDoubleAttribute("SamplingResolutionSec", this->SamplingResolutionSec);
+  XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(ApplyLagToDeviceId, deviceConfig);
+  deviceConfig->SetDoubleAttribute("MinimumConfidenceToApplyLag", this->MinimumConfidenceToApplyLag);
+  deviceConfig->SetDoubleAttribute("MinimumLagToApplySec", this->MinimumLagToApplySec);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::NotifyConfigured()
+{
+  if (this->InputChannels.empty() || this->InputChannels.size() > 2)
+  {
+    LOG_ERROR("Temporal calibrator requires a video and a tracker input channel (or one input channel that contains both).");
+    return PLUS_FAIL;
+  }
+  this->VideoChannel = this->InputChannels[0];
+  this->TrackerChannel = this->InputChannels[this->InputChannels.size() - 1];
+
+  if (!this->VideoChannel->HasVideoSource())
+  {
+    LOG_ERROR("Temporal calibrator input channel " << this->VideoChannel->GetChannelId() << " does not have a video source.");
+    return PLUS_FAIL;
+  }
+  if (!this->TrackerChannel->GetTrackingEnabled())
+  {
+    LOG_ERROR("Temporal calibrator input channel " << this->TrackerChannel->GetChannelId() << " does not have tracking data.");
+    return PLUS_FAIL;
+  }
+
+  if (this->OutputChannels.empty() || !this->OutputChannels[0]->GetFieldDataEnabled())
+  {
+    LOG_ERROR("Temporal calibrator requires an output channel with at least one field data source defined.");
+    return PLUS_FAIL;
+  }
+
+  if (!this->ApplyLagToDeviceId.empty())
+  {
+    vtkPlusDevice* device = NULL;
+    if (this->GetDataCollector() == NULL || this->GetDataCollector()->GetDevice(device, this->ApplyLagToDeviceId) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Temporal calibrator cannot find device " << this->ApplyLagToDeviceId << " to apply the lag to.");
+      return PLUS_FAIL;
+    }
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalConnect()
+{
+  if (this->Correlation.Initialize(this->MaximumLagSec, this->SamplingResolutionSec) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": invalid MaximumLagSec (" << this->MaximumLagSec << ") or SamplingResolutionSec (" << this->SamplingResolutionSec << ")");
+    return PLUS_FAIL;
+  }
+  this->ClearSignals();
+  this->LastEstimationTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  {
+    std::lock_guard<std::mutex> lagGuard(this->LagMutex);
+    this->LagValid = false;
+    this->LagSec = 0.0;
+    this->Confidence = 0.0;
+  }
+  this->TotalAppliedLagSec = 0.0;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalDisconnect()
+{
+  this->ClearSignals();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::ClearSignals()
+{
+  this->QueuedVideoFrames->Clear();
+  this->NewTrackerFrames->Clear();
+  this->LastVideoTimestamp = UNDEFINED_TIMESTAMP;
+  this->LastTrackerTimestamp = UNDEFINED_TIMESTAMP;
+  this->VideoSignalTimestamps.clear();
+  this->VideoSignalValues.clear();
+  this->TrackerSignalTimestamps.clear();
+  this->TrackerPositions.clear();
+  this->Correlation.Clear();
+  this->NumberOfUncorrelatedVideoSamples = 0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::GetLagSec(double& lagSec, double& confidence) const
+{
+  std::lock_guard<std::mutex> lagGuard(this->LagMutex);
+  if (!this->LagValid)
+  {
+    return PLUS_FAIL;
+  }
+  lagSec = this->LagSec;
+  confidence = this->Confidence;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::InternalUpdate()
+{
+  if (!this->HasGracePeriodExpired())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // New frames are read in every update to not miss any frames from the input buffers
+  if (this->ReadNewFrames() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  const double currentTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (currentTime - this->LastEstimationTime < this->UpdatePeriodSec)
+  {
+    return PLUS_SUCCESS;
+  }
+  this->LastEstimationTime = currentTime;
+
+  if (this->UpdateVideoSignal() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  this->RemoveSamplesOutsideWindow();
+
+  double lagSec = 0.0;
+  double confidence = 0.0;
+  if (this->EstimateLagInWindow(lagSec, confidence) != PLUS_SUCCESS)
+  {
+    // Not enough data or motion, try again in the next period
+    return PLUS_SUCCESS;
+  }
+  {
+    std::lock_guard<std::mutex> lagGuard(this->LagMutex);
+    this->LagValid = true;
+    this->LagSec = lagSec;
+    this->Confidence = confidence;
+  }
+  LOG_DEBUG(this->GetDeviceId() << ": estimated tracker lag = " << lagSec * 1000.0 << " ms, confidence = " << confidence);
+
+  PlusStatus status = this->PublishLag(lagSec, confidence);
+
+  if (!this->ApplyLagToDeviceId.empty() && confidence >= this->MinimumConfidenceToApplyLag && std::abs(lagSec) >= this->MinimumLagToApplySec)
+  {
+    if (this->ApplyLag(lagSec) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ReadNewFrames()
+{
+  const bool sharedChannel = (this->VideoChannel == this->TrackerChannel);
+
+  // Video frames are appended to the queue, they are only segmented once in every update period
+  const unsigned int numberOfQueuedVideoFrames = this->QueuedVideoFrames->GetNumberOfTrackedFrames();
+  if (this->VideoChannel->GetTrackedFrameList(this->LastVideoTimestamp, this->QueuedVideoFrames, MAX_NUMBER_OF_FRAMES_TO_ADD) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": failed to get video frames from channel " << this->VideoChannel->GetChannelId());
+    // Restart from the most recent frame
+    this->LastVideoTimestamp = UNDEFINED_TIMESTAMP;
+    return PLUS_FAIL;
+  }
+
+  vtkIGSIOTrackedFrameList* trackerFrames = this->NewTrackerFrames;
+  unsigned int firstNewTrackerFrameIndex = 0;
+  if (sharedChannel)
+  {
+    trackerFrames = this->QueuedVideoFrames;
+    firstNewTrackerFrameIndex = numberOfQueuedVideoFrames;
+  }
+  else
+  {
+    this->NewTrackerFrames->Clear();
+    if (this->TrackerChannel->GetTrackedFrameList(this->LastTrackerTimestamp, this->NewTrackerFrames, MAX_NUMBER_OF_FRAMES_TO_ADD) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": failed to get tracker frames from channel " << this->TrackerChannel->GetChannelId());
+      this->LastTrackerTimestamp = UNDEFINED_TIMESTAMP;
+      return PLUS_FAIL;
+    }
+  }
+
+  // Tracker positions are computed right away, as it is cheap and the frames don't need to be kept
+  igsioTransformName transformName;
+  transformName.SetTransformName(this->ProbeToReferenceTransformName.c_str());
+  vtkSmartPointer<vtkMatrix4x4> probeToReferenceTransform = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (unsigned int frameIndex = firstNewTrackerFrameIndex; frameIndex < trackerFrames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* trackedFrame = trackerFrames->GetTrackedFrame(frameIndex);
+    this->TransformRepository->SetTransforms(*trackedFrame);
+    ToolStatus status(TOOL_INVALID);
+    if (this->TransformRepository->GetTransform(transformName, probeToReferenceTransform, &status) != PLUS_SUCCESS || status != TOOL_OK)
+    {
+      // There is no available transform for this frame; skip that frame
+      continue;
+    }
+    if (!this->TrackerSignalTimestamps.empty() && trackedFrame->GetTimestamp() <= this->TrackerSignalTimestamps.back())
+    {
+      // The tracker signal is interpolated, so its timestamps must be strictly increasing
+      continue;
+    }
+    std::array<double, 3> position = {{ probeToReferenceTransform->GetElement(0, 3), probeToReferenceTransform->GetElement(1, 3), probeToReferenceTransform->GetElement(2, 3) }};
+    this->TrackerSignalTimestamps.push_back(trackedFrame->GetTimestamp());
+    this->TrackerPositions.push_back(position);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::UpdateVideoSignal()
+{
+  if (this->QueuedVideoFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Only the frames that have been acquired since the previous update are segmented
+  this->LineSegmenter->Reset();
+  this->LineSegmenter->SetTrackedFrameList(*this->QueuedVideoFrames);
+  this->QueuedVideoFrames->Clear();
+  if (this->LineSegmenter->Update() != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": failed to segment the video frames");
+    return PLUS_FAIL;
+  }
+
+  std::vector<double> timestamps;
+  std::vector<double> positions;
+  this->LineSegmenter->GetDetectedTimestamps(timestamps);
+  this->LineSegmenter->GetDetectedPositions(positions);
+  this->VideoSignalTimestamps.insert(this->VideoSignalTimestamps.end(), timestamps.begin(), timestamps.end());
+  this->VideoSignalValues.insert(this->VideoSignalValues.end(), positions.begin(), positions.end());
+  this->NumberOfUncorrelatedVideoSamples += static_cast<unsigned int>(timestamps.size());
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::RemoveSamplesOutsideWindow()
+{
+  if (!this->VideoSignalTimestamps.empty())
+  {
+    const double oldestTimestamp = this->VideoSignalTimestamps.back() - this->WindowSec;
+    while (this->VideoSignalTimestamps.front() < oldestTimestamp)
+    {
+      this->VideoSignalTimestamps.pop_front();
+      this->VideoSignalValues.pop_front();
+    }
+    this->NumberOfUncorrelatedVideoSamples = std::min<unsigned int>(this->NumberOfUncorrelatedVideoSamples, static_cast<unsigned int>(this->VideoSignalTimestamps.size()));
+    this->Correlation.RemoveSamplesBefore(oldestTimestamp);
+  }
+  // The tracker samples that are about to be removed may still be needed for correlating the latest video samples
+  this->UpdateLagCorrelation();
+  if (!this->TrackerSignalTimestamps.empty())
+  {
+    const double oldestTimestamp = this->TrackerSignalTimestamps.back() - this->WindowSec;
+    while (this->TrackerSignalTimestamps.front() < oldestTimestamp)
+    {
+      this->TrackerSignalTimestamps.pop_front();
+      this->TrackerPositions.pop_front();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::UpdateLagCorrelation()
+{
+  if (this->TrackerSignalTimestamps.size() < 2)
+  {
+    return;
+  }
+  const double lastTrackerTimestamp = this->TrackerSignalTimestamps.back();
+  while (this->NumberOfUncorrelatedVideoSamples > 0)
+  {
+    const size_t sampleIndex = this->VideoSignalTimestamps.size() - this->NumberOfUncorrelatedVideoSamples;
+    const double timestamp = this->VideoSignalTimestamps[sampleIndex];
+    if (timestamp + this->Correlation.GetMaximumLagSec() > lastTrackerTimestamp)
+    {
+      // Tracker data is not available yet at all the lag candidates, the sample will be added in a later update
+      break;
+    }
+    // If the tracker signal starts after the earliest lag candidate then the sample is not used
+    this->Correlation.AddSample(timestamp, this->VideoSignalValues[sampleIndex], this->TrackerSignalTimestamps, this->TrackerPositions);
+    --this->NumberOfUncorrelatedVideoSamples;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::EstimateLagInWindow(double& lagSec, double& confidence)
+{
+  this->UpdateLagCorrelation();
+  if (this->Correlation.GetNumberOfSamples() < MINIMUM_NUMBER_OF_OVERLAPPING_SAMPLES || this->TrackerPositions.size() < MINIMUM_NUMBER_OF_OVERLAPPING_SAMPLES)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": not enough samples for lag estimation (video: " << this->Correlation.GetNumberOfSamples() << ", tracker: " << this->TrackerPositions.size() << ")");
+    return PLUS_FAIL;
+  }
+
+  const double videoPeakToPeak = *std::max_element(this->VideoSignalValues.begin(), this->VideoSignalValues.end()) - *std::min_element(this->VideoSignalValues.begin(), this->VideoSignalValues.end());
+  if (videoPeakToPeak < MINIMUM_VIDEO_SIGNAL_PEAK_TO_PEAK_PIXEL)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": not enough motion for lag estimation, video position metric peak-to-peak = " << videoPeakToPeak << " pixel");
+    return PLUS_FAIL;
+  }
+
+  // Find the principal axis of motion of the tracker positions
+  double meanPosition[3] = { 0.0, 0.0, 0.0 };
+  for (std::deque<std::array<double, 3> >::const_iterator positionIt = this->TrackerPositions.begin(); positionIt != this->TrackerPositions.end(); ++positionIt)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      meanPosition[i] += (*positionIt)[i] / this->TrackerPositions.size();
+    }
+  }
+  double covariance[3][3] = { { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 } };
+  for (std::deque<std::array<double, 3> >::const_iterator positionIt = this->TrackerPositions.begin(); positionIt != this->TrackerPositions.end(); ++positionIt)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        covariance[i][j] += ((*positionIt)[i] - meanPosition[i]) * ((*positionIt)[j] - meanPosition[j]);
+      }
+    }
+  }
+  double eigenvalues[3] = { 0.0, 0.0, 0.0 };
+  double eigenvectors[3][3];
+  vtkMath::Diagonalize3x3(covariance, eigenvalues, eigenvectors);
+  const int principalAxisIndex = static_cast<int>(std::max_element(eigenvalues, eigenvalues + 3) - eigenvalues);
+  const double principalAxis[3] = { eigenvectors[0][principalAxisIndex], eigenvectors[1][principalAxisIndex], eigenvectors[2][principalAxisIndex] };
+
+  double minTrackerValue = 0.0;
+  double maxTrackerValue = 0.0;
+  for (std::deque<std::array<double, 3> >::const_iterator positionIt = this->TrackerPositions.begin(); positionIt != this->TrackerPositions.end(); ++positionIt)
+  {
+    const double trackerValue = (*positionIt)[0] * principalAxis[0] + (*positionIt)[1] * principalAxis[1] + (*positionIt)[2] * principalAxis[2];
+    if (positionIt == this->TrackerPositions.begin() || trackerValue < minTrackerValue)
+    {
+      minTrackerValue = trackerValue;
+    }
+    if (positionIt == this->TrackerPositions.begin() || trackerValue > maxTrackerValue)
+    {
+      maxTrackerValue = trackerValue;
+    }
+  }
+  const double trackerPeakToPeak = maxTrackerValue - minTrackerValue;
+  if (trackerPeakToPeak < MINIMUM_TRACKER_SIGNAL_PEAK_TO_PEAK_MM)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": not enough motion for lag estimation, tracker position metric peak-to-peak = " << trackerPeakToPeak << " mm");
+    return PLUS_FAIL;
+  }
+
+  // The correlation of the video signal and the tracker positions projected to the axis is computed from the running sums
+  if (this->Correlation.FindLag(principalAxis, lagSec, confidence) != PLUS_SUCCESS)
+  {
+    LOG_DEBUG(this->GetDeviceId() << ": the video and tracker signals are not correlated");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::EstimateLag(const std::vector<double>& fixedTimestamps, const std::vector<double>& fixedValues,
+    const std::vector<double>& movingTimestamps, const std::vector<double>& movingValues,
+    double maximumLagSec, double samplingResolutionSec, double& lagSec, double& confidence)
+{
+  if (fixedTimestamps.size() != fixedValues.size() || movingTimestamps.size() != movingValues.size())
+  {
+    LOG_ERROR("Cannot estimate lag: the number of signal timestamps and values do not match");
+    return PLUS_FAIL;
+  }
+  LagCorrelation correlation;
+  if (correlation.Initialize(maximumLagSec, samplingResolutionSec) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Cannot estimate lag: invalid maximum lag (" << maximumLagSec << " sec) or sampling resolution (" << samplingResolutionSec << " sec)");
+    return PLUS_FAIL;
+  }
+
+  std::vector<double> movingNodeTimestamps;
+  std::vector<double> movingNodeValues;
+  PlusMath::GetInterpolationNodes(movingTimestamps, movingValues, movingNodeTimestamps, movingNodeValues);
+  if (movingNodeTimestamps.size() < 2)
+  {
+    LOG_DEBUG("Cannot estimate lag: not enough moving signal samples");
+    return PLUS_FAIL;
+  }
+  // The moving signal is the first coordinate of the positions
+  std::deque<double> movingSignalTimestamps(movingNodeTimestamps.begin(), movingNodeTimestamps.end());
+  std::deque<std::array<double, 3> > movingSignalPositions;
+  for (std::vector<double>::const_iterator valueIt = movingNodeValues.begin(); valueIt != movingNodeValues.end(); ++valueIt)
+  {
+    std::array<double, 3> position = {{ *valueIt, 0.0, 0.0 }};
+    movingSignalPositions.push_back(position);
+  }
+
+  // Only those fixed samples are used that can be compared to the moving signal at all lag candidates
+  for (size_t i = 0; i < fixedTimestamps.size(); ++i)
+  {
+    correlation.AddSample(fixedTimestamps[i], fixedValues[i], movingSignalTimestamps, movingSignalPositions);
+  }
+  if (correlation.GetNumberOfSamples() < MINIMUM_NUMBER_OF_OVERLAPPING_SAMPLES)
+  {
+    LOG_DEBUG("Cannot estimate lag: only " << correlation.GetNumberOfSamples() << " fixed signal samples overlap with the moving signal");
+    return PLUS_FAIL;
+  }
+
+  const double axis[3] = { 1.0, 0.0, 0.0 };
+  if (correlation.FindLag(axis, lagSec, confidence) != PLUS_SUCCESS)
+  {
+    LOG_DEBUG("Cannot estimate lag: the signals are not correlated");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::PublishLag(double lagSec, double confidence)
+{
+  std::ostringstream lagStr;
+  lagStr << lagSec;
+  std::ostringstream confidenceStr;
+  confidenceStr << confidence;
+
+  igsioFieldMapType fieldMap;
+  fieldMap[LAG_FIELD_NAME].first = FRAMEFIELD_NONE;
+  fieldMap[LAG_FIELD_NAME].second = lagStr.str();
+  fieldMap[CONFIDENCE_FIELD_NAME].first = FRAMEFIELD_NONE;
+  fieldMap[CONFIDENCE_FIELD_NAME].second = confidenceStr.str();
+
+  PlusStatus status = PLUS_SUCCESS;
+  vtkPlusChannel* outputChannel = this->OutputChannels[0];
+  for (DataSourceContainerIterator it = outputChannel->GetFieldDataSourcesStartIterator(); it != outputChannel->GetFieldDataSourcesEndIterator(); ++it)
+  {
+    if (it->second->AddItem(fieldMap, this->FrameNumber) != PLUS_SUCCESS)
+    {
+      LOG_ERROR(this->GetDeviceId() << ": failed to add lag estimation to field data source " << it->second->GetSourceId());
+      status = PLUS_FAIL;
+    }
+  }
+  this->FrameNumber++;
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::ApplyLag(double lagSec)
+{
+  vtkPlusDevice* device = NULL;
+  if (this->GetDataCollector()->GetDevice(device, this->ApplyLagToDeviceId) != PLUS_SUCCESS)
+  {
+    LOG_ERROR(this->GetDeviceId() << ": cannot apply lag, device " << this->ApplyLagToDeviceId << " is not found");
+    return PLUS_FAIL;
+  }
+
+  // The tracker data at t+lag corresponds to the video data at t, so the tracker timestamps have to be decreased by the lag
+  const double localTimeOffsetSec = device->GetLocalTimeOffsetSec() - lagSec;
+  LOG_INFO(this->GetDeviceId() << ": tracker lag of " << lagSec * 1000.0 << " ms is applied, " << this->ApplyLagToDeviceId
+           << " LocalTimeOffsetSec is changed from " << device->GetLocalTimeOffsetSec() << " to " << localTimeOffsetSec);
+  device->SetLocalTimeOffsetSec(localTimeOffsetSec);
+  this->TotalAppliedLagSec += lagSec;
+
+  // The timestamps of the collected tracker samples are not valid anymore
+  this->TrackerSignalTimestamps.clear();
+  this->TrackerPositions.clear();
+  this->Correlation.Clear();
+  this->NumberOfUncorrelatedVideoSamples = static_cast<unsigned int>(this->VideoSignalTimestamps.size());
+  if (this->VideoChannel != this->TrackerChannel)
+  {
+    this->LastTrackerTimestamp = UNDEFINED_TIMESTAMP;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+vtkPlusVirtualTemporalCalibrator::LagCorrelation::LagCorrelation()
+  : MaximumLagSec(0.0)
+  , SamplingResolutionSec(0.0)
+  , NumberOfLags(0)
+  , NumberOfRemovedSamplesSinceRebuild(0)
+  , FixedOrigin(0.0)
+  , FixedSum(0.0)
+  , FixedSquaredSum(0.0)
+{
+  this->MovingOrigin[0] = 0.0;
+  this->MovingOrigin[1] = 0.0;
+  this->MovingOrigin[2] = 0.0;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::LagCorrelation::Initialize(double maximumLagSec, double samplingResolutionSec)
+{
+  if (maximumLagSec < 0 || samplingResolutionSec < TIMESTAMP_EPSILON_SEC)
+  {
+    return PLUS_FAIL;
+  }
+  this->MaximumLagSec = maximumLagSec;
+  this->SamplingResolutionSec = samplingResolutionSec;
+  this->NumberOfLags = static_cast<unsigned int>(std::floor(2 * maximumLagSec / samplingResolutionSec + TIMESTAMP_EPSILON_SEC)) + 1;
+  this->Clear();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::LagCorrelation::Clear()
+{
+  this->Samples.clear();
+  this->NumberOfRemovedSamplesSinceRebuild = 0;
+  this->FixedSum = 0.0;
+  this->FixedSquaredSum = 0.0;
+  this->MovingSums.assign(3 * this->NumberOfLags, 0.0);
+  this->MovingSquaredSums.assign(6 * this->NumberOfLags, 0.0);
+  this->FixedMovingSums.assign(3 * this->NumberOfLags, 0.0);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusVirtualTemporalCalibrator::LagCorrelation::AddSample(double timestamp, double value, const std::deque<double>& movingTimestamps, const std::deque<std::array<double, 3> >& movingPositions)
+{
+  if (this->NumberOfLags == 0 || movingTimestamps.size() < 2)
+  {
+    return false;
+  }
+  const double firstShiftedTimestamp = timestamp - this->MaximumLagSec;
+  const double lastShiftedTimestamp = timestamp - this->MaximumLagSec + (this->NumberOfLags - 1) * this->SamplingResolutionSec;
+  if (firstShiftedTimestamp < movingTimestamps.front() || lastShiftedTimestamp > movingTimestamps.back())
+  {
+    return false;
+  }
+
+  if (this->Samples.empty())
+  {
+    // Values are stored relative to the first sample to avoid cancellation in the sums
+    const size_t firstIndex = std::upper_bound(movingTimestamps.begin(), movingTimestamps.end(), firstShiftedTimestamp) - movingTimestamps.begin();
+    this->FixedOrigin = value;
+    for (int i = 0; i < 3; ++i)
+    {
+      this->MovingOrigin[i] = movingPositions[std::max<size_t>(firstIndex, 1) - 1][i];
+    }
+  }
+
+  Sample sample;
+  sample.Timestamp = timestamp;
+  sample.Value = value - this->FixedOrigin;
+  sample.MovingPositions.resize(3 * this->NumberOfLags);
+
+  // Copy the moving signal nodes around the shifted timestamps, as random access of deque elements is slow
+  size_t firstNodeIndex = std::upper_bound(movingTimestamps.begin(), movingTimestamps.end(), firstShiftedTimestamp) - movingTimestamps.begin();
+  firstNodeIndex = std::min(std::max<size_t>(firstNodeIndex, 1) - 1, movingTimestamps.size() - 2);
+  size_t lastNodeIndex = std::lower_bound(movingTimestamps.begin() + firstNodeIndex, movingTimestamps.end(), lastShiftedTimestamp) - movingTimestamps.begin();
+  lastNodeIndex = std::max(std::min(lastNodeIndex, movingTimestamps.size() - 1), firstNodeIndex + 1);
+  std::vector<double> nodeTimestamps(movingTimestamps.begin() + firstNodeIndex, movingTimestamps.begin() + lastNodeIndex + 1);
+  std::vector<std::array<double, 3> > nodePositions(movingPositions.begin() + firstNodeIndex, movingPositions.begin() + lastNodeIndex + 1);
+
+  // Linear interpolation of the moving positions; the shifted timestamps are increasing, so the interval is found by walking forward
+  size_t nodeIndex = 0;
+  for (unsigned int lagIndex = 0; lagIndex < this->NumberOfLags; ++lagIndex)
+  {
+    const double shiftedTimestamp = timestamp - this->MaximumLagSec + lagIndex * this->SamplingResolutionSec;
+    while (nodeIndex + 2 < nodeTimestamps.size() && nodeTimestamps[nodeIndex + 1] < shiftedTimestamp)
+    {
+      ++nodeIndex;
+    }
+    const double weight = (shiftedTimestamp - nodeTimestamps[nodeIndex]) / (nodeTimestamps[nodeIndex + 1] - nodeTimestamps[nodeIndex]);
+    const std::array<double, 3>& position0 = nodePositions[nodeIndex];
+    const std::array<double, 3>& position1 = nodePositions[nodeIndex + 1];
+    double* interpolatedPosition = &sample.MovingPositions[3 * lagIndex];
+    for (int i = 0; i < 3; ++i)
+    {
+      interpolatedPosition[i] = position0[i] + weight * (position1[i] - position0[i]) - this->MovingOrigin[i];
+    }
+  }
+
+  this->AddToSums(sample, 1.0);
+  this->Samples.push_back(sample);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::LagCorrelation::RemoveSamplesBefore(double timestamp)
+{
+  while (!this->Samples.empty() && this->Samples.front().Timestamp < timestamp)
+  {
+    this->AddToSums(this->Samples.front(), -1.0);
+    this->Samples.pop_front();
+    ++this->NumberOfRemovedSamplesSinceRebuild;
+  }
+  if (this->Samples.empty())
+  {
+    this->Clear();
+  }
+  else if (this->NumberOfRemovedSamplesSinceRebuild > this->Samples.size())
+  {
+    // Recomputing the sums costs as much as adding the remaining samples, which is amortized by the removals
+    this->RebuildSums();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::LagCorrelation::AddToSums(const Sample& sample, double sign)
+{
+  const double fixedValue = sign * sample.Value;
+  this->FixedSum += fixedValue;
+  this->FixedSquaredSum += fixedValue * sample.Value;
+  const double* position = &sample.MovingPositions[0];
+  double* movingSum = &this->MovingSums[0];
+  double* movingSquaredSum = &this->MovingSquaredSums[0];
+  double* fixedMovingSum = &this->FixedMovingSums[0];
+  for (unsigned int lagIndex = 0; lagIndex < this->NumberOfLags; ++lagIndex, position += 3, movingSum += 3, movingSquaredSum += 6, fixedMovingSum += 3)
+  {
+    const double x = position[0];
+    const double y = position[1];
+    const double z = position[2];
+    movingSum[0] += sign * x;
+    movingSum[1] += sign * y;
+    movingSum[2] += sign * z;
+    movingSquaredSum[0] += sign * x * x;
+    movingSquaredSum[1] += sign * x * y;
+    movingSquaredSum[2] += sign * x * z;
+    movingSquaredSum[3] += sign * y * y;
+    movingSquaredSum[4] += sign * y * z;
+    movingSquaredSum[5] += sign * z * z;
+    fixedMovingSum[0] += fixedValue * x;
+    fixedMovingSum[1] += fixedValue * y;
+    fixedMovingSum[2] += fixedValue * z;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusVirtualTemporalCalibrator::LagCorrelation::RebuildSums()
+{
+  // Move the origin to the oldest sample, so that values stay small if the signals drift
+  const Sample& firstSample = this->Samples.front();
+  const double fixedShift = firstSample.Value;
+  const double movingShift[3] = { firstSample.MovingPositions[0], firstSample.MovingPositions[1], firstSample.MovingPositions[2] };
+  this->FixedOrigin += fixedShift;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->MovingOrigin[i] += movingShift[i];
+  }
+
+  this->NumberOfRemovedSamplesSinceRebuild = 0;
+  this->FixedSum = 0.0;
+  this->FixedSquaredSum = 0.0;
+  std::fill(this->MovingSums.begin(), this->MovingSums.end(), 0.0);
+  std::fill(this->MovingSquaredSums.begin(), this->MovingSquaredSums.end(), 0.0);
+  std::fill(this->FixedMovingSums.begin(), this->FixedMovingSums.end(), 0.0);
+  for (std::deque<Sample>::iterator sampleIt = this->Samples.begin(); sampleIt != this->Samples.end(); ++sampleIt)
+  {
+    sampleIt->Value -= fixedShift;
+    for (unsigned int lagIndex = 0; lagIndex < this->NumberOfLags; ++lagIndex)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        sampleIt->MovingPositions[3 * lagIndex + i] -= movingShift[i];
+      }
+    }
+    this->AddToSums(*sampleIt, 1.0);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusVirtualTemporalCalibrator::LagCorrelation::FindLag(const double axis[3], double& lagSec, double& confidence) const
+{
+  if (this->Samples.size() < 2)
+  {
+    return PLUS_FAIL;
+  }
+  const double numberOfSamples = static_cast<double>(this->Samples.size());
+  const double fixedVariance = this->FixedSquaredSum - this->FixedSum * this->FixedSum / numberOfSamples;
+  if (fixedVariance <= 0.0)
+  {
+    return PLUS_FAIL;
+  }
+
+  // Correlation coefficient at each lag candidate: cov(f,m)/sqrt(var(f)*var(m)), where m = p.axis
+  const double axisProducts[6] = { axis[0] * axis[0], 2 * axis[0] * axis[1], 2 * axis[0] * axis[2], axis[1] * axis[1], 2 * axis[1] * axis[2], axis[2] * axis[2] };
+  double maxCorrelation = 0.0;
+  double minCorrelation = 0.0;
+  unsigned int maxCorrelationLagIndex = 0;
+  unsigned int minCorrelationLagIndex = 0;
+  for (unsigned int lagIndex = 0; lagIndex < this->NumberOfLags; ++lagIndex)
+  {
+    const double* movingSum = &this->MovingSums[3 * lagIndex];
+    const double* movingSquaredSum = &this->MovingSquaredSums[6 * lagIndex];
+    const double* fixedMovingSum = &this->FixedMovingSums[3 * lagIndex];
+    const double sumMoving = axis[0] * movingSum[0] + axis[1] * movingSum[1] + axis[2] * movingSum[2];
+    double sumMovingSquared = 0.0;
+    for (int i = 0; i < 6; ++i)
+    {
+      sumMovingSquared += axisProducts[i] * movingSquaredSum[i];
+    }
+    const double sumFixedMoving = axis[0] * fixedMovingSum[0] + axis[1] * fixedMovingSum[1] + axis[2] * fixedMovingSum[2];
+
+    const double movingVariance = sumMovingSquared - sumMoving * sumMoving / numberOfSamples;
+    if (movingVariance <= 0.0)
+    {
+      continue;
+    }
+    const double correlation = (sumFixedMoving - this->FixedSum * sumMoving / numberOfSamples) / std::sqrt(fixedVariance * movingVariance);
+    if (correlation > maxCorrelation)
+    {
+      maxCorrelation = correlation;
+      maxCorrelationLagIndex = lagIndex;
+    }
+    if (correlation < minCorrelation)
+    {
+      minCorrelation = correlation;
+      minCorrelationLagIndex = lagIndex;
+    }
+  }
+  if (maxCorrelation <= 0.0 && minCorrelation >= 0.0)
+  {
+    return PLUS_FAIL;
+  }
+
+  // The direction of the motion axis is arbitrary, so both polarities are tried and the smaller lag is adopted
+  const double maxCorrelationLagSec = -this->MaximumLagSec + maxCorrelationLagIndex * this->SamplingResolutionSec;
+  const double minCorrelationLagSec = -this->MaximumLagSec + minCorrelationLagIndex * this->SamplingResolutionSec;
+  if (maxCorrelation > 0.0 && (minCorrelation >= 0.0 || std::abs(maxCorrelationLagSec) <= std::abs(minCorrelationLagSec)))
+  {
+    lagSec = maxCorrelationLagSec;
+    confidence = std::min(maxCorrelation, 1.0);
+  }
+  else
+  {
+    lagSec = minCorrelationLagSec;
+    confidence = std::min(-minCorrelation, 1.0);
+  }
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,293 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusVirtualTemporalCalibrator_h
+#define __vtkPlusVirtualTemporalCalibrator_h
+
+#include "vtkPlusDataCollectionExport.h"
+
+#include "vtkPlusDevice.h"
+#include <array>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkPlusLineSegmentationAlgo;
+
+/*!
+\class vtkPlusVirtualTemporalCalibrator
+\brief Virtual device that continuously estimates the time lag between a tracker and an ultrasound video stream
+
+The device keeps a sliding window of WindowSec length of the video position metric (position of the line that
+is the image of a plane, such as the bottom of a water tank, see vtkPlusLineSegmentationAlgo) and of the tracker
+position metric (ProbeToReferenceTransformName position projected to the principal axis of motion). Each input
+frame is processed only once: new frames are read from the input channels in every update and the line is
+segmented on the newly acquired video frames once in every UpdatePeriodSec. Line segmentation parameters can be
+specified in a nested vtkPlusLineSegmentationAlgo element, the segmentation runs on the data capture thread of
+the device (NumberOfThreads=1) unless NumberOfThreads is set there.
+
+Once in every UpdatePeriodSec the tracker lag is re-estimated by finding the time offset that maximizes the
+correlation of the two signals in the window. The lag candidates are in the [-MaximumLagSec, MaximumLagSec] range
+with SamplingResolutionSec step size; the correlation at all the candidates is updated incrementally as video samples
+enter and leave the window (see LagCorrelation). The lag and the correlation (used as confidence, in the range of 0..1)
+are added to the field data sources of the output channel as TemporalCalibrationLagSec and
+TemporalCalibrationConfidence. The lag has the same meaning as in vtkPlusTemporalCalibrationAlgo: the tracker
+position metric at time t+lag corresponds to the video position metric at time t.
+
+If ApplyLagToDeviceId is set then the estimated lag is subtracted from the LocalTimeOffsetSec of that device
+(typically the tracker device that provides the tracker input channel) when the confidence is at least
+MinimumConfidenceToApplyLag and the lag is at least MinimumLagToApplySec. The tracker signal is collected again
+after the lag is applied, as the timestamps of the already collected samples are not valid anymore.
+
+The first input channel must contain the video data, the second input channel must contain the tracking data.
+If only one input channel is specified then it must contain both.
+
+\ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusVirtualTemporalCalibrator : public vtkPlusDevice
+{
+public:
+  static vtkPlusVirtualTemporalCalibrator* New();
+  vtkTypeMacro(vtkPlusVirtualTemporalCalibrator, vtkPlusDevice);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Read main configuration from xml data */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement*);
+
+  /*! Write main configuration to xml data */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement*);
+
+  /*! Callback after configuration of all devices is complete */
+  virtual PlusStatus NotifyConfigured();
+
+  virtual bool IsTracker() const { return false; }
+  virtual bool IsVirtual() const { return true; }
+
+  /*! Name of the transform that is used for computing the tracker position metric */
+  vtkSetStdStringMacro(ProbeToReferenceTransformName);
+  vtkGetStdStringMacro(ProbeToReferenceTransformName);
+
+  /*! Length of the sliding window of the signals that are used for the lag estimation */
+  vtkSetMacro(WindowSec, double);
+  vtkGetMacro(WindowSec, double);
+
+  /*! Time between two lag estimations */
+  vtkSetMacro(UpdatePeriodSec, double);
+  vtkGetMacro(UpdatePeriodSec, double);
+
+  /*! Maximum absolute value of the estimated lag. Changes take effect at the next connect. */
+  vtkSetMacro(MaximumLagSec, double);
+  vtkGetMacro(MaximumLagSec, double);
+
+  /*! Step size of the lag candidates. Changes take effect at the next connect. */
+  vtkSetMacro(SamplingResolutionSec, double);
+  vtkGetMacro(SamplingResolutionSec, double);
+
+  /*! Id of the device whose LocalTimeOffsetSec is corrected by the estimated lag. If empty then the lag is only published. */
+  vtkSetStdStringMacro(ApplyLagToDeviceId);
+  vtkGetStdStringMacro(ApplyLagToDeviceId);
+
+  /*! Lag is only applied if the confidence of the estimation is at least this value */
+  vtkSetMacro(MinimumConfidenceToApplyLag, double);
+  vtkGetMacro(MinimumConfidenceToApplyLag, double);
+
+  /*! Lag is only applied if its absolute value is at least this value */
+  vtkSetMacro(MinimumLagToApplySec, double);
+  vtkGetMacro(MinimumLagToApplySec, double);
+
+  /*! Get the most recent lag estimate. Returns with failure if no lag has been estimated since connect. Can be called from any thread. */
+  PlusStatus GetLagSec(double& lagSec, double& confidence) const;
+
+  /*! Sum of the lags that have been applied to the LocalTimeOffsetSec of the ApplyLagToDeviceId device since connect */
+  vtkGetMacro(TotalAppliedLagSec, double);
+
+  /*!
+    Estimate the lag of the moving signal relative to the fixed signal: moving(t+lag) corresponds to fixed(t).
+    All the lag candidates are evaluated, with the same computation as the incremental estimation of the device.
+    Both signal polarities are considered (as the direction of the principal axis of motion is arbitrary), similarly
+    to vtkPlusTemporalCalibrationAlgo the one that results in the smaller absolute lag is chosen.
+    \param maximumLagSec The lag is searched in the [-maximumLagSec, maximumLagSec] range
+    \param samplingResolutionSec Step size of the lag candidates
+    \param lagSec Estimated lag
+    \param confidence Correlation of the fixed and shifted moving signal at the estimated lag (0..1)
+    Returns with failure if the signals do not overlap enough for the estimation.
+  */
+  static PlusStatus EstimateLag(const std::vector<double>& fixedTimestamps, const std::vector<double>& fixedValues,
+                                const std::vector<double>& movingTimestamps, const std::vector<double>& movingValues,
+                                double maximumLagSec, double samplingResolutionSec, double& lagSec, double& confidence);
+
+protected:
+  /*!
+    \class LagCorrelation
+    \brief Correlation of a fixed signal and a 3D moving signal at all the lag candidates, updated as samples are added and removed
+
+    The lag candidates are -maximumLagSec + k * samplingResolutionSec. For each candidate the running sums of the moving
+    positions interpolated at the shifted fixed sample timestamps (p) are kept: sum(p), sum(p*p^T) and sum(f*p), where f is
+    the fixed value; sum(f) and sum(f^2) are the same for all candidates. Adding or removing a fixed sample updates the sums
+    in O(number of candidates), independently of the number of samples in the window. As the interpolation commutes with
+    projection, the correlation with the moving positions projected to any axis can be computed from the sums, so the
+    principal axis of motion does not have to be known when the samples are added.
+    The interpolated positions of each sample are stored, so that exactly the same values are subtracted when the sample is
+    removed. Values are stored relative to an origin to avoid cancellation, and the sums are recomputed from the stored
+    values after as many removals as there are samples, so that rounding errors do not accumulate.
+  */
+  class LagCorrelation
+  {
+  public:
+    LagCorrelation();
+
+    /*! Set the lag candidates and remove all samples */
+    PlusStatus Initialize(double maximumLagSec, double samplingResolutionSec);
+
+    /*! Remove all samples */
+    void Clear();
+
+    /*!
+      Add a fixed signal sample. The moving positions are linearly interpolated at timestamp+lag for all the lag candidates.
+      Returns false (and the sample is not added) if the moving signal does not cover all the lag candidates.
+      The moving signal timestamps must be strictly increasing.
+    */
+    bool AddSample(double timestamp, double value, const std::deque<double>& movingTimestamps, const std::deque<std::array<double, 3> >& movingPositions);
+
+    /*! Remove the samples that are older than the timestamp. Samples must have been added in increasing timestamp order. */
+    void RemoveSamplesBefore(double timestamp);
+
+    /*! Maximum absolute value of the lag candidates */
+    double GetMaximumLagSec() const { return this->MaximumLagSec; }
+
+    /*! Number of fixed signal samples in the sums */
+    unsigned int GetNumberOfSamples() const { return static_cast<unsigned int>(this->Samples.size()); }
+
+    /*!
+      Find the lag candidate where the correlation of the fixed signal and the moving positions projected to the axis is maximal.
+      Both signal polarities are considered, the one that results in the smaller absolute lag is chosen.
+      Returns with failure if the signals are not correlated.
+    */
+    PlusStatus FindLag(const double axis[3], double& lagSec, double& confidence) const;
+
+  protected:
+    struct Sample
+    {
+      double Timestamp;
+      /*! Fixed signal value relative to FixedOrigin */
+      double Value;
+      /*! Interpolated moving positions relative to MovingOrigin, 3 values per lag candidate */
+      std::vector<double> MovingPositions;
+    };
+
+    /*! Add (sign=1) or subtract (sign=-1) the values of the sample to the sums */
+    void AddToSums(const Sample& sample, double sign);
+
+    /*! Recompute the sums from the stored samples, relative to the first sample */
+    void RebuildSums();
+
+    double MaximumLagSec;
+    double SamplingResolutionSec;
+    unsigned int NumberOfLags;
+
+    std::deque<Sample> Samples;
+    unsigned int NumberOfRemovedSamplesSinceRebuild;
+
+    double FixedOrigin;
+    double MovingOrigin[3];
+
+    double FixedSum;
+    double FixedSquaredSum;
+    /*! sum(p) for each lag candidate, 3 values per candidate */
+    std::vector<double> MovingSums;
+    /*! Upper triangle of sum(p*p^T) (xx, xy, xz, yy, yz, zz) for each lag candidate, 6 values per candidate */
+    std::vector<double> MovingSquaredSums;
+    /*! sum(f*p) for each lag candidate, 3 values per candidate */
+    std::vector<double> FixedMovingSums;
+  };
+
+protected:
+  vtkPlusVirtualTemporalCalibrator();
+  virtual ~vtkPlusVirtualTemporalCalibrator();
+
+  virtual PlusStatus InternalConnect();
+  virtual PlusStatus InternalDisconnect();
+
+  virtual PlusStatus InternalUpdate();
+
+  /*! Read the newly acquired frames from the input channels. Tracker positions are stored, video frames are queued for line segmentation. */
+  PlusStatus ReadNewFrames();
+
+  /*! Segment the queued video frames and append the results to the video signal */
+  PlusStatus UpdateVideoSignal();
+
+  /*! Remove the samples that are older than WindowSec, also from the lag correlation */
+  void RemoveSamplesOutsideWindow();
+
+  /*! Add the video samples to the lag correlation for which the tracker signal is available at all the lag candidates */
+  void UpdateLagCorrelation();
+
+  /*! Compute the signals in the window and estimate the lag. Returns with failure if there is not enough data or motion for the estimation. */
+  PlusStatus EstimateLagInWindow(double& lagSec, double& confidence);
+
+  /*! Add the lag estimation results to the field data sources of the output channel */
+  PlusStatus PublishLag(double lagSec, double confidence);
+
+  /*! Apply the lag to the ApplyLagToDeviceId device */
+  PlusStatus ApplyLag(double lagSec);
+
+  /*! Remove all collected samples */
+  void ClearSignals();
+
+protected:
+  std::string ProbeToReferenceTransformName;
+  double WindowSec;
+  double UpdatePeriodSec;
+  double MaximumLagSec;
+  double SamplingResolutionSec;
+  std::string ApplyLagToDeviceId;
+  double MinimumConfidenceToApplyLag;
+  double MinimumLagToApplySec;
+
+  /*! Channel that provides the video frames */
+  vtkPlusChannel* VideoChannel;
+  /*! Channel that provides the tracking data (may be the same as VideoChannel) */
+  vtkPlusChannel* TrackerChannel;
+
+  vtkSmartPointer<vtkPlusLineSegmentationAlgo> LineSegmenter;
+  vtkSmartPointer<vtkIGSIOTransformRepository> TransformRepository;
+
+  /*! Video frames that are read from the input but not segmented yet */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> QueuedVideoFrames;
+  /*! Frames read from the tracker input channel in an update */
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> NewTrackerFrames;
+
+  /*! Timestamp of the last frame that has been read from the video and tracker input channel */
+  double LastVideoTimestamp;
+  double LastTrackerTimestamp;
+
+  /*! System time of the last lag estimation */
+  double LastEstimationTime;
+
+  std::deque<double> VideoSignalTimestamps;
+  std::deque<double> VideoSignalValues;
+  std::deque<double> TrackerSignalTimestamps;
+  std::deque<std::array<double, 3> > TrackerPositions;
+
+  /*! Correlation of the video signal and the tracker positions at all the lag candidates */
+  LagCorrelation Correlation;
+  /*! Number of samples at the end of the video signal that have not been added to the lag correlation yet */
+  unsigned int NumberOfUncorrelatedVideoSamples;
+
+  /*! Protects LagValid, LagSec and Confidence, which are written by the data capture thread and read by GetLagSec */
+  mutable std::mutex LagMutex;
+  bool LagValid;
+  double LagSec;
+  double Confidence;
+  double TotalAppliedLagSec;
+
+private:
+  vtkPlusVirtualTemporalCalibrator(const vtkPlusVirtualTemporalCalibrator&);  // Not implemented.
+  void operator=(const vtkPlusVirtualTemporalCalibrator&);  // Not implemented.
+};
+
+#endif
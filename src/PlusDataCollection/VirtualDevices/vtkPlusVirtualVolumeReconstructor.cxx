@@ -297,9 +297,14 @@ void vtkPlusVirtualVolumeReconstructor::InternalWriteOutputChannels(vtkXMLDataEl
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage)
+PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage,
+    const std::atomic<bool>* cancelRequested /*=NULL*/, std::atomic<double>* progressPercent /*=NULL*/)
 {
   errorMessage.clear();
+  if (progressPercent != NULL)
+  {
+    *progressPercent = 0.0;
+  }
 
   // Read image sequence
   if (inputSeqFilename.empty())
@@ -316,6 +321,12 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
     LOG_INFO(errorMessage);
     return PLUS_FAIL;
   }
+  if (cancelRequested != NULL && *cancelRequested)
+  {
+    errorMessage = "Volume reconstruction cancelled";
+    LOG_INFO(errorMessage);
+    return PLUS_FAIL;
+  }
 
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
 
@@ -328,9 +339,16 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
     return PLUS_FAIL;
   }
   // Paste slices
-  if (AddFrames(trackedFrameList) != PLUS_SUCCESS)
+  if (AddFrames(trackedFrameList, cancelRequested, progressPercent) != PLUS_SUCCESS)
   {
-    errorMessage = "vtkPlusReconstructVolumeCommand::Execute: failed, add frames failed";
+    if (cancelRequested != NULL && *cancelRequested)
+    {
+      errorMessage = "Volume reconstruction cancelled";
+    }
+    else
+    {
+      errorMessage = "vtkPlusReconstructVolumeCommand::Execute: failed, add frames failed";
+    }
     LOG_INFO(errorMessage);
     return PLUS_FAIL;
   }
@@ -340,6 +358,10 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolumeFromFile(con
     LOG_INFO(errorMessage);
     return PLUS_FAIL;
   }
+  if (progressPercent != NULL)
+  {
+    *progressPercent = 100.0;
+  }
   return PLUS_SUCCESS;
 }
 
@@ -369,7 +391,7 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::GetReconstructedVolume(vtkImageDat
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList)
+PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList, const std::atomic<bool>* cancelRequested /*=NULL*/, std::atomic<double>* progressPercent /*=NULL*/)
 {
   igsioLockGuard<vtkIGSIORecursiveCriticalSection> writerLock(this->VolumeReconstructorAccessMutex);
 
@@ -378,6 +400,16 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::AddFrames(vtkIGSIOTrackedFrameList
   int numberOfFramesAddedToVolume = 0;
   for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex += this->VolumeReconstructor->GetSkipInterval())
   {
+    if (cancelRequested != NULL && *cancelRequested)
+    {
+      LOG_INFO("Adding frames to the volume cancelled after " << frameIndex << " out of " << numberOfFrames << " frames");
+      status = PLUS_FAIL;
+      break;
+    }
+    if (progressPercent != NULL)
+    {
+      *progressPercent = 100.0 * frameIndex / numberOfFrames;
+    }
     LOG_TRACE("Adding frame to volume reconstructor: " << frameIndex);
     igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
     if (this->TransformRepository->SetTransforms(*frame) != PLUS_SUCCESS)
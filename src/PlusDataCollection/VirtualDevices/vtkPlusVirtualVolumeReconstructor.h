@@ -10,6 +10,7 @@ See License.txt for details.
 #include "vtkPlusDataCollectionExport.h"
 
 #include "vtkPlusDevice.h"
+#include <atomic>
 #include <string>
 
 class vtkPlusVolumeReconstructor;
@@ -29,8 +30,11 @@ public:
 
   /*!
     This method is safe to be called from any thread.
+    \param cancelRequested If specified, reconstruction stops (and the method returns with failure) as soon as the flag is set
+    \param progressPercent If specified, it is updated with the percentage of the processed frames
   */
-  virtual PlusStatus GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage);
+  virtual PlusStatus GetReconstructedVolumeFromFile(const std::string& inputSeqFilename, vtkImageData* reconstructedVolume, std::string& errorMessage,
+      const std::atomic<bool>* cancelRequested = NULL, std::atomic<double>* progressPercent = NULL);
 
   /*!
     This method is safe to be called from any thread.
@@ -113,7 +117,12 @@ protected:
   virtual PlusStatus InternalConnect();
   virtual PlusStatus InternalDisconnect();
 
-  PlusStatus AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList);
+  /*!
+    Paste frames into the volume. The frame list is cleared.
+    \param cancelRequested If specified, pasting of frames stops (and the method returns with failure) as soon as the flag is set
+    \param progressPercent If specified, it is updated with the percentage of the processed frames
+  */
+  PlusStatus AddFrames(vtkIGSIOTrackedFrameList* trackedFrameList, const std::atomic<bool>* cancelRequested = NULL, std::atomic<double>* progressPercent = NULL);
 
   /*! Get the sampling period length (in seconds). Frames are copied from the devices to the data collection buffer once in every sampling period. */
   double GetSamplingPeriodSec();
@@ -25,7 +25,13 @@ See License.txt for details.
 #endif
 
 // STD includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
 #include <set>
+#include <thread>
 
 // VTK includes
 #include <vtkObjectFactory.h>
@@ -36,13 +42,59 @@ See License.txt for details.
 
 vtkStandardNewMacro(vtkPlusDataCollector);
 
+namespace
+{
+  /*! Result of an operation (connect, start) performed on a single device */
+  struct DeviceOperationState
+  {
+    DeviceOperationState()
+      : Status(PLUS_FAIL)
+      , Finished(false)
+      , TimedOut(false)
+      , ElapsedTimeSec(0.0)
+    {
+    }
+    PlusStatus Status;
+    bool Finished;
+    bool TimedOut;
+    double ElapsedTimeSec;
+  };
+
+  /*! Buffer of a single data source that is written to file by DumpBuffersToDirectory */
+  struct BufferDumpTask
+  {
+    BufferDumpTask()
+      : Source(NULL)
+      , Status(PLUS_FAIL)
+      , NumberOfItems(0)
+      , OldestTimestamp(UNDEFINED_TIMESTAMP)
+      , LatestTimestamp(UNDEFINED_TIMESTAMP)
+    {
+    }
+    std::string DeviceId;
+    std::string SourceType;
+    vtkPlusDataSource* Source;
+    std::string FileName;
+    PlusStatus Status;
+    int NumberOfItems;
+    double OldestTimestamp;
+    double LatestTimestamp;
+  };
+}
+
 //----------------------------------------------------------------------------
 vtkPlusDataCollector::vtkPlusDataCollector()
   : vtkObject()
   , StartupDelaySec(0.0)
   , DeviceFactory(vtkSmartPointer<vtkPlusDeviceFactory>::New())
+  , ParallelConnect(false)
+  , ConnectTimeoutSec(0.0)
   , Connected(false)
   , Started(false)
+  , DumpBuffersInProgress(false)
+  , DumpBuffersTotalTaskCount(0)
+  , DumpBuffersCompletedTaskCount(0)
+  , DumpBuffersStatus(PLUS_SUCCESS)
 {
   vtkStreamingVolumeCodecFactory* factory = vtkStreamingVolumeCodecFactory::GetInstance();
 #if defined PLUS_USE_VP9
@@ -55,6 +107,11 @@ vtkPlusDataCollector::vtkPlusDataCollector()
 vtkPlusDataCollector::~vtkPlusDataCollector()
 {
   LOG_TRACE("vtkPlusDataCollector::~vtkPlusDataCollector()");
+  if (this->DumpBuffersThread.joinable())
+  {
+    // buffers must not be deleted while they are being written
+    this->DumpBuffersThread.join();
+  }
   if (this->Started)
   {
     this->Stop();
@@ -105,6 +162,9 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
     LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec);
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(ParallelConnect, dataCollectionElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, ConnectTimeoutSec, dataCollectionElement);
+
   std::set<std::string> existingDeviceIds;
 
   for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
@@ -142,6 +202,11 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       LOG_ERROR("Failed to read parameters of device: " << deviceElement->GetAttribute("Id") << " (type: " << deviceElement->GetAttribute("Type") << ")");
       return PLUS_FAIL;
     }
+    double connectTimeoutSec(0.0);
+    if (deviceElement->GetScalarAttribute("ConnectTimeoutSec", connectTimeoutSec))
+    {
+      this->SetDeviceConnectTimeoutSec(deviceId, connectTimeoutSec);
+    }
     Devices.push_back(device);
   }
 
@@ -281,6 +346,14 @@ PlusStatus vtkPlusDataCollector::WriteConfiguration(vtkXMLDataElement* aConfig)
   }
 
   dataCollectionConfig->SetDoubleAttribute("StartupDelaySec", GetStartupDelaySec());
+  if (this->ParallelConnect)
+  {
+    dataCollectionConfig->SetAttribute("ParallelConnect", "TRUE");
+  }
+  if (this->ConnectTimeoutSec > 0)
+  {
+    dataCollectionConfig->SetDoubleAttribute("ConnectTimeoutSec", this->ConnectTimeoutSec);
+  }
 
   PlusStatus status = PLUS_SUCCESS;
 
@@ -322,17 +395,23 @@ PlusStatus vtkPlusDataCollector::Start()
 
   const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  std::function<PlusStatus(vtkPlusDevice*)> startDevice = [startTime](vtkPlusDevice * device) -> PlusStatus
   {
-    vtkPlusDevice* device = *it;
-
+    PlusStatus deviceStatus = PLUS_SUCCESS;
     if (device->StartRecording() != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
+      deviceStatus = PLUS_FAIL;
     }
     device->SetStartTime(startTime);
+    return deviceStatus;
+  };
+
+  if (this->ExecuteOnDevices("start", startDevice, false, this->DeviceStartTimesSec) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
   }
+  this->LogDeviceTimingReport("start", this->DeviceStartTimesSec);
 
   LOG_DEBUG("vtkPlusDataCollector::Start -- wait " << std::fixed << this->StartupDelaySec << " sec for buffer init...");
 
@@ -360,16 +439,21 @@ PlusStatus vtkPlusDataCollector::Connect()
 
   PlusStatus status = PLUS_SUCCESS;
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  std::function<PlusStatus(vtkPlusDevice*)> connectDevice = [](vtkPlusDevice * device) -> PlusStatus
   {
-    vtkPlusDevice* device = *it;
-
     if (device->Connect() != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to connect device: " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
+      return PLUS_FAIL;
     }
+    return PLUS_SUCCESS;
+  };
+
+  if (this->ExecuteOnDevices("connect", connectDevice, true, this->DeviceConnectTimesSec) != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
   }
+  this->LogDeviceTimingReport("connect", this->DeviceConnectTimesSec);
 
   if (status != PLUS_SUCCESS)
   {
@@ -387,6 +471,245 @@ PlusStatus vtkPlusDataCollector::Connect()
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetDeviceWaves(std::vector<DeviceCollection>& waves) const
+{
+  waves.clear();
+
+  std::set<vtkPlusDevice*> allDevices(this->Devices.begin(), this->Devices.end());
+  std::set<vtkPlusDevice*> processedDevices;
+  DeviceCollection remainingDevices(this->Devices);
+  while (!remainingDevices.empty())
+  {
+    DeviceCollection wave;
+    DeviceCollection deferredDevices;
+    for (DeviceCollectionConstIterator it = remainingDevices.begin(); it != remainingDevices.end(); ++it)
+    {
+      std::vector<vtkPlusDevice*> inputDevices;
+      (*it)->GetInputDevices(inputDevices);
+      bool inputsReady = true;
+      for (std::vector<vtkPlusDevice*>::const_iterator inputIt = inputDevices.begin(); inputIt != inputDevices.end(); ++inputIt)
+      {
+        // Input devices that are not managed by this data collector do not constrain the order
+        if (allDevices.count(*inputIt) > 0 && processedDevices.count(*inputIt) == 0)
+        {
+          inputsReady = false;
+          break;
+        }
+      }
+      if (inputsReady)
+      {
+        wave.push_back(*it);
+      }
+      else
+      {
+        deferredDevices.push_back(*it);
+      }
+    }
+
+    if (wave.empty())
+    {
+      std::string deviceIds;
+      for (DeviceCollectionConstIterator it = remainingDevices.begin(); it != remainingDevices.end(); ++it)
+      {
+        deviceIds += (deviceIds.empty() ? "" : ", ") + (*it)->GetDeviceId();
+      }
+      LOG_ERROR("Circular input channel dependency found between devices: " << deviceIds);
+      return PLUS_FAIL;
+    }
+
+    processedDevices.insert(wave.begin(), wave.end());
+    waves.push_back(wave);
+    remainingDevices.swap(deferredDevices);
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ExecuteOnDevices(const std::string& operationName, const std::function<PlusStatus(vtkPlusDevice*)>& operation, bool applyConnectTimeout, std::map<std::string, double>& operationTimesSec)
+{
+  operationTimesSec.clear();
+
+  std::vector<DeviceCollection> waves;
+  if (this->GetDeviceWaves(waves) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<DeviceCollection>::const_iterator waveIt = waves.begin(); waveIt != waves.end(); ++waveIt)
+  {
+    const DeviceCollection& wave = *waveIt;
+    std::vector<DeviceOperationState> states(wave.size());
+
+    if (!this->ParallelConnect || wave.size() == 1)
+    {
+      // Process devices one by one in the calling thread (some device SDKs require this)
+      for (size_t i = 0; i < wave.size(); ++i)
+      {
+        const double operationStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+        states[i].Status = operation(wave[i]);
+        states[i].ElapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - operationStartTime;
+        states[i].Finished = true;
+        const double timeoutSec = applyConnectTimeout ? this->GetDeviceConnectTimeoutSec(wave[i]->GetDeviceId()) : 0.0;
+        if (timeoutSec > 0 && states[i].ElapsedTimeSec > timeoutSec)
+        {
+          LOG_ERROR("Device " << wave[i]->GetDeviceId() << " did not " << operationName << " within " << timeoutSec << " sec (took " << std::fixed << std::setprecision(3) << states[i].ElapsedTimeSec << " sec)");
+          states[i].TimedOut = true;
+        }
+      }
+    }
+    else
+    {
+      LOG_DEBUG("Devices " << operationName << " concurrently: " << wave.size() << " devices");
+      std::mutex stateMutex;
+      std::condition_variable stateChanged;
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < wave.size(); ++i)
+      {
+        vtkPlusDevice* device = wave[i];
+        DeviceOperationState* state = &states[i];
+        workers.push_back(std::thread([device, state, &operation, &stateMutex, &stateChanged]()
+        {
+          const double operationStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+          PlusStatus result = operation(device);
+          const double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - operationStartTime;
+          std::lock_guard<std::mutex> lock(stateMutex);
+          state->Status = result;
+          state->ElapsedTimeSec = elapsedTimeSec;
+          state->Finished = true;
+          stateChanged.notify_all();
+        }));
+      }
+
+      // Wait for all devices, report the ones that exceed their timeout as soon as the timeout expires.
+      // Device SDK calls cannot be interrupted safely, therefore the calls are always waited for before returning.
+      {
+        const std::chrono::steady_clock::time_point waveStartTime = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(stateMutex);
+        while (true)
+        {
+          bool allFinished = true;
+          bool deadlineSet = false;
+          std::chrono::steady_clock::time_point nextDeadline = waveStartTime;
+          const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+          for (size_t i = 0; i < wave.size(); ++i)
+          {
+            if (states[i].Finished)
+            {
+              continue;
+            }
+            allFinished = false;
+            const double timeoutSec = applyConnectTimeout ? this->GetDeviceConnectTimeoutSec(wave[i]->GetDeviceId()) : 0.0;
+            if (timeoutSec <= 0 || states[i].TimedOut)
+            {
+              continue;
+            }
+            const std::chrono::steady_clock::time_point deadline = waveStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeoutSec));
+            if (now >= deadline)
+            {
+              LOG_ERROR("Device " << wave[i]->GetDeviceId() << " did not " << operationName << " within " << timeoutSec << " sec. Waiting for the device to return before continuing.");
+              states[i].TimedOut = true;
+            }
+            else if (!deadlineSet || deadline < nextDeadline)
+            {
+              nextDeadline = deadline;
+              deadlineSet = true;
+            }
+          }
+          if (allFinished)
+          {
+            break;
+          }
+          if (deadlineSet)
+          {
+            stateChanged.wait_until(lock, nextDeadline);
+          }
+          else
+          {
+            stateChanged.wait(lock);
+          }
+        }
+      }
+
+      for (std::vector<std::thread>::iterator workerIt = workers.begin(); workerIt != workers.end(); ++workerIt)
+      {
+        workerIt->join();
+      }
+    }
+
+    for (size_t i = 0; i < wave.size(); ++i)
+    {
+      operationTimesSec[wave[i]->GetDeviceId()] = states[i].ElapsedTimeSec;
+      if (states[i].Status != PLUS_SUCCESS || states[i].TimedOut)
+      {
+        status = PLUS_FAIL;
+      }
+    }
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::LogDeviceTimingReport(const std::string& operationName, const std::map<std::string, double>& operationTimesSec) const
+{
+  // Report in configuration order
+  std::ostringstream report;
+  for (DeviceCollectionConstIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    std::map<std::string, double>::const_iterator timeIt = operationTimesSec.find((*it)->GetDeviceId());
+    if (timeIt == operationTimesSec.end())
+    {
+      continue;
+    }
+    report << std::endl << "  " << timeIt->first << ": " << std::fixed << std::setprecision(3) << timeIt->second << " sec";
+  }
+  LOG_INFO("Device " << operationName << " times:" << report.str());
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::SetDeviceConnectTimeoutSec(const std::string& aDeviceId, double timeoutSec)
+{
+  this->DeviceConnectTimeoutsSec[aDeviceId] = timeoutSec;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDataCollector::GetDeviceConnectTimeoutSec(const std::string& aDeviceId) const
+{
+  std::map<std::string, double>::const_iterator timeoutIt = this->DeviceConnectTimeoutsSec.find(aDeviceId);
+  if (timeoutIt != this->DeviceConnectTimeoutsSec.end())
+  {
+    return timeoutIt->second;
+  }
+  return this->ConnectTimeoutSec;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetDeviceConnectTimeSec(const std::string& aDeviceId, double& connectTimeSec) const
+{
+  std::map<std::string, double>::const_iterator timeIt = this->DeviceConnectTimesSec.find(aDeviceId);
+  if (timeIt == this->DeviceConnectTimesSec.end())
+  {
+    return PLUS_FAIL;
+  }
+  connectTimeSec = timeIt->second;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetDeviceStartTimeSec(const std::string& aDeviceId, double& startTimeSec) const
+{
+  std::map<std::string, double>::const_iterator timeIt = this->DeviceStartTimesSec.find(aDeviceId);
+  if (timeIt == this->DeviceStartTimesSec.end())
+  {
+    return PLUS_FAIL;
+  }
+  startTimeSec = timeIt->second;
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::Disconnect()
 {
@@ -473,32 +796,286 @@ bool vtkPlusDataCollector::GetConnected() const
 
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::DumpBuffersToDirectory(const char* aDirectory)
+{
+  return this->DumpBuffersToDirectory(std::string(aDirectory ? aDirectory : ""), false, 0);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::DumpBuffersToDirectory(const std::string& aDirectory, bool useCompression, unsigned int numberOfThreads, std::string* manifestFilePath /*=NULL*/)
 {
   LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << aDirectory << ")");
 
-  // Assemble file names
+  bool dumpInProgress = false;
+  if (!this->DumpBuffersInProgress.compare_exchange_strong(dumpInProgress, true))
+  {
+    LOG_ERROR("Unable to dump buffers: a buffer dump is already in progress");
+    return PLUS_FAIL;
+  }
+
+  std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
+  std::string outputDirectory;
+  std::string outputManifestFilePath;
+  if (this->GetDumpBuffersOutputPaths(aDirectory, dateAndTime, outputDirectory, outputManifestFilePath) != PLUS_SUCCESS)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+      this->DumpBuffersStatus = PLUS_FAIL;
+    }
+    this->DumpBuffersInProgress = false;
+    return PLUS_FAIL;
+  }
+  if (manifestFilePath != NULL)
+  {
+    *manifestFilePath = outputManifestFilePath;
+  }
+
+  PlusStatus status = this->WriteBufferDump(outputDirectory, dateAndTime, outputManifestFilePath, useCompression, numberOfThreads);
+  this->DumpBuffersInProgress = false;
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::StartDumpBuffersToDirectory(const std::string& aDirectory, bool useCompression, unsigned int numberOfThreads)
+{
+  LOG_TRACE("vtkPlusDataCollector::StartDumpBuffersToDirectory(" << aDirectory << ")");
+
+  bool dumpInProgress = false;
+  if (!this->DumpBuffersInProgress.compare_exchange_strong(dumpInProgress, true))
+  {
+    LOG_ERROR("Unable to start buffer dump: a buffer dump is already in progress");
+    return PLUS_FAIL;
+  }
+
+  if (this->DumpBuffersThread.joinable())
+  {
+    // previous dump is completed, release its thread
+    this->DumpBuffersThread.join();
+  }
+
   std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
+  std::string outputDirectory;
+  std::string manifestFilePath;
+  if (this->GetDumpBuffersOutputPaths(aDirectory, dateAndTime, outputDirectory, manifestFilePath) != PLUS_SUCCESS)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+      this->DumpBuffersStatus = PLUS_FAIL;
+    }
+    this->DumpBuffersInProgress = false;
+    return PLUS_FAIL;
+  }
+
+  // Reset status before the thread starts, so that it can be queried immediately
+  {
+    std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+    this->DumpBuffersManifestFilePath = manifestFilePath;
+    this->DumpBuffersStatus = PLUS_FAIL;
+  }
+  this->DumpBuffersCompletedTaskCount = 0;
+  this->DumpBuffersTotalTaskCount = 0;
+
+  this->DumpBuffersThread = std::thread([this, outputDirectory, dateAndTime, manifestFilePath, useCompression, numberOfThreads]()
+  {
+    this->WriteBufferDump(outputDirectory, dateAndTime, manifestFilePath, useCompression, numberOfThreads);
+    this->DumpBuffersInProgress = false;
+  });
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::IsDumpBuffersInProgress() const
+{
+  return this->DumpBuffersInProgress;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDataCollector::GetDumpBuffersProgress() const
+{
+  const int totalTaskCount = this->DumpBuffersTotalTaskCount;
+  if (totalTaskCount <= 0)
+  {
+    return this->DumpBuffersInProgress ? 0.0 : 1.0;
+  }
+  return static_cast<double>(this->DumpBuffersCompletedTaskCount) / totalTaskCount;
+}
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetDumpBuffersStatus() const
+{
+  std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+  return this->DumpBuffersStatus;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusDataCollector::GetDumpBuffersManifestFilePath() const
+{
+  std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+  return this->DumpBuffersManifestFilePath;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetDumpBuffersOutputPaths(const std::string& aDirectory, const std::string& dateAndTime, std::string& outputDirectory, std::string& manifestFilePath) const
+{
+  std::string defaultOutputDirectory = vtksys::SystemTools::CollapseFullPath(vtkPlusConfig::GetInstance()->GetOutputDirectory());
+  if (aDirectory.empty())
+  {
+    outputDirectory = defaultOutputDirectory;
+  }
+  else
+  {
+    outputDirectory = vtksys::SystemTools::CollapseFullPath(aDirectory, defaultOutputDirectory);
+    // The directory may be specified by a remote client, do not allow writing files anywhere else than in the output directory
+    if (!vtksys::SystemTools::ComparePath(outputDirectory, defaultOutputDirectory)
+        && !vtksys::SystemTools::IsSubDirectory(outputDirectory, defaultOutputDirectory))
+    {
+      LOG_ERROR("Unable to dump buffers to " << outputDirectory << ": the directory must be inside the output directory (" << defaultOutputDirectory << ")");
+      return PLUS_FAIL;
+    }
+  }
+  manifestFilePath = outputDirectory + "/BufferDump_" + dateAndTime + "_Manifest.xml";
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::WriteBufferDump(const std::string& outputDirectory, const std::string& dateAndTime, const std::string& manifestFilePath, bool useCompression, unsigned int numberOfThreads)
+{
+  // Collect all data sources. Virtual devices may share data sources with other devices, write each of them only once.
+  std::vector<BufferDumpTask> tasks;
+  std::set<vtkPlusDataSource*> addedSources;
   for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
   {
     vtkPlusDevice* device = *it;
+    std::vector<std::pair<DataSourceContainerConstIterator, DataSourceContainerConstIterator> > containers;
+    containers.push_back(std::make_pair(device->GetVideoSourceIteratorBegin(), device->GetVideoSourceIteratorEnd()));
+    containers.push_back(std::make_pair(device->GetToolIteratorBegin(), device->GetToolIteratorEnd()));
+    containers.push_back(std::make_pair(device->GetFieldDataSourcessIteratorBegin(), device->GetFieldDataSourcessIteratorEnd()));
+    const std::string sourceTypes[3] = { vtkPlusDataSource::DATA_SOURCE_TYPE_VIDEO_TAG, vtkPlusDataSource::DATA_SOURCE_TYPE_TOOL_TAG, vtkPlusDataSource::DATA_SOURCE_TYPE_FIELDDATA_TAG };
+    for (size_t containerIndex = 0; containerIndex < containers.size(); ++containerIndex)
+    {
+      for (DataSourceContainerConstIterator sourceIt = containers[containerIndex].first; sourceIt != containers[containerIndex].second; ++sourceIt)
+      {
+        vtkPlusDataSource* source = sourceIt->second;
+        if (source == NULL || addedSources.count(source) > 0)
+        {
+          continue;
+        }
+        addedSources.insert(source);
+        BufferDumpTask task;
+        task.DeviceId = device->GetDeviceId();
+        task.SourceType = sourceTypes[containerIndex];
+        task.Source = source;
+        task.FileName = std::string("BufferDump_") + device->GetDeviceId() + "_" + source->GetSourceId() + "_" + dateAndTime + ".nrrd";
+        tasks.push_back(task);
+      }
+    }
+  }
 
-    std::string outputDeviceBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(std::string("BufferDump_") + device->GetDeviceId() + "_" + dateAndTime + ".nrrd");
+  {
+    std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+    this->DumpBuffersManifestFilePath = manifestFilePath;
+    this->DumpBuffersStatus = PLUS_FAIL;
+  }
+  this->DumpBuffersCompletedTaskCount = 0;
+  this->DumpBuffersTotalTaskCount = static_cast<int>(tasks.size());
+
+  vtksys::SystemTools::MakeDirectory(outputDirectory);
+
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  numberOfThreads = std::min(numberOfThreads, static_cast<unsigned int>(std::max<size_t>(tasks.size(), 1)));
 
-    LOG_INFO("Write device buffer to " << outputDeviceBufferSequenceFileName);
-    vtkPlusDataSource* aSource(NULL);
-    for (ChannelContainerIterator chanIt = device->GetOutputChannelsStart(); chanIt != device->GetOutputChannelsEnd(); ++chanIt)
+  LOG_INFO("Write buffers of " << tasks.size() << " data sources to " << outputDirectory << " using " << numberOfThreads << " threads");
+
+  // Each worker picks the next unprocessed data source until all of them are written
+  std::atomic<size_t> nextTaskIndex(0);
+  std::function<void()> worker = [this, &tasks, &nextTaskIndex, &outputDirectory, useCompression]()
+  {
+    for (size_t taskIndex = nextTaskIndex++; taskIndex < tasks.size(); taskIndex = nextTaskIndex++)
     {
-      if ((*chanIt)->GetVideoSource(aSource) != PLUS_SUCCESS)
+      BufferDumpTask& task = tasks[taskIndex];
+      task.NumberOfItems = task.Source->GetNumberOfItems();
+      task.Source->GetOldestTimeStamp(task.OldestTimestamp);
+      task.Source->GetLatestTimeStamp(task.LatestTimestamp);
+      if (task.NumberOfItems == 0)
+      {
+        // nothing to write
+        task.Status = PLUS_SUCCESS;
+      }
+      else
       {
-        LOG_ERROR("Unable to retrieve the video source in the device.");
-        return PLUS_FAIL;
+        std::string filePath = outputDirectory + "/" + task.FileName;
+        LOG_INFO("Write " << task.SourceType << " buffer " << task.DeviceId << "/" << task.Source->GetSourceId() << " to " << filePath);
+        task.Status = task.Source->WriteToSequenceFile(filePath.c_str(), useCompression);
+        if (task.Status != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to write buffer of data source " << task.Source->GetSourceId() << " of device " << task.DeviceId << " to " << filePath);
+        }
       }
-      aSource->WriteToSequenceFile(outputDeviceBufferSequenceFileName.c_str(), false);
+      this->DumpBuffersCompletedTaskCount++;
     }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    workers.push_back(std::thread(worker));
+  }
+  // the calling thread is also used as a worker
+  worker();
+  for (std::vector<std::thread>::iterator workerIt = workers.begin(); workerIt != workers.end(); ++workerIt)
+  {
+    workerIt->join();
   }
 
-  return PLUS_SUCCESS;
+  // Write manifest
+  PlusStatus status = PLUS_SUCCESS;
+  vtkSmartPointer<vtkXMLDataElement> manifestElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  manifestElement->SetName("BufferDump");
+  manifestElement->SetAttribute("DateTime", dateAndTime.c_str());
+  manifestElement->SetAttribute("Compression", useCompression ? "TRUE" : "FALSE");
+  for (std::vector<BufferDumpTask>::const_iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+  {
+    vtkSmartPointer<vtkXMLDataElement> sourceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+    sourceElement->SetName("DataSource");
+    sourceElement->SetAttribute("DeviceId", taskIt->DeviceId.c_str());
+    sourceElement->SetAttribute("SourceId", taskIt->Source->GetSourceId().c_str());
+    sourceElement->SetAttribute("Type", taskIt->SourceType.c_str());
+    sourceElement->SetIntAttribute("NumberOfItems", taskIt->NumberOfItems);
+    if (taskIt->NumberOfItems > 0)
+    {
+      sourceElement->SetAttribute("FileName", taskIt->FileName.c_str());
+      // Write timestamps with fixed precision, the default precision of numeric XML attributes is not enough for timestamps
+      std::ostringstream oldestTimestamp;
+      oldestTimestamp << std::fixed << std::setprecision(6) << taskIt->OldestTimestamp;
+      sourceElement->SetAttribute("OldestTimestamp", oldestTimestamp.str().c_str());
+      std::ostringstream latestTimestamp;
+      latestTimestamp << std::fixed << std::setprecision(6) << taskIt->LatestTimestamp;
+      sourceElement->SetAttribute("LatestTimestamp", latestTimestamp.str().c_str());
+    }
+    sourceElement->SetAttribute("Status", taskIt->Status == PLUS_SUCCESS ? "SUCCESS" : "FAIL");
+    manifestElement->AddNestedElement(sourceElement);
+    if (taskIt->Status != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  manifestElement->SetAttribute("Status", status == PLUS_SUCCESS ? "SUCCESS" : "FAIL");
+  if (igsioCommon::XML::PrintXML(manifestFilePath, manifestElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write buffer dump manifest file: " << manifestFilePath);
+    status = PLUS_FAIL;
+  }
+
+  LOG_INFO("Buffer dump " << (status == PLUS_SUCCESS ? "completed" : "failed") << ", manifest: " << manifestFilePath);
+
+  {
+    std::lock_guard<std::mutex> lock(this->DumpBuffersMutex);
+    this->DumpBuffersStatus = status;
+  }
+  return status;
 }
 
 //----------------------------------------------------------------------------
@@ -648,6 +1225,217 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
   return status;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::GetNewItemUidRange(vtkPlusDataSource* aSource, DataCursor& aCursor, BufferItemUidType& firstItemUid, BufferItemUidType& lastItemUid)
+{
+  if (aSource->GetNumberOfItems() == 0)
+  {
+    return false;
+  }
+  BufferItemUidType oldestItemUid = aSource->GetOldestItemUidInBuffer();
+  BufferItemUidType latestItemUid = aSource->GetLatestItemUidInBuffer();
+  firstItemUid = oldestItemUid;
+  lastItemUid = latestItemUid;
+
+  std::map<vtkPlusDataSource*, BufferItemUidType>::iterator lastReturnedUidIt = aCursor.LastItemUids.find(aSource);
+  if (lastReturnedUidIt == aCursor.LastItemUids.end())
+  {
+    // this data source has not been read using this cursor yet, return all items
+    return true;
+  }
+  BufferItemUidType lastReturnedItemUid = lastReturnedUidIt->second;
+  if (lastReturnedItemUid == latestItemUid)
+  {
+    // no new items
+    return false;
+  }
+  if (lastReturnedItemUid > latestItemUid)
+  {
+    // the buffer has been cleared since the last call, start from the oldest item
+    LOG_DEBUG("Buffer of data source " << aSource->GetSourceId() << " has been reset, reading restarts from the oldest item");
+    return true;
+  }
+  if (lastReturnedItemUid + 1 < oldestItemUid)
+  {
+    // the client could not keep up with the acquisition, some items are not available anymore
+    aCursor.NumberOfSkippedItems += static_cast<unsigned long>(oldestItemUid - lastReturnedItemUid - 1);
+    return true;
+  }
+  firstItemUid = lastReturnedItemUid + 1;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+igsioTrackedFrame* vtkPlusDataCollector::GetReusableTrackedFrame(vtkIGSIOTrackedFrameList* aTrackedFrameList, unsigned int frameIndex)
+{
+  if (frameIndex >= aTrackedFrameList->GetNumberOfTrackedFrames())
+  {
+    return NULL;
+  }
+  igsioTrackedFrame* trackedFrame = aTrackedFrameList->GetTrackedFrame(frameIndex);
+  // Remove fields of the previous content, as not all frames have the same set of fields
+  std::vector<std::string> fieldNames;
+  trackedFrame->GetFrameFieldNameList(fieldNames);
+  for (std::vector<std::string>::iterator fieldNameIt = fieldNames.begin(); fieldNameIt != fieldNames.end(); ++fieldNameIt)
+  {
+    trackedFrame->DeleteFrameField(fieldNameIt->c_str());
+  }
+  return trackedFrame;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChannel, DataCursor& aCursor, vtkIGSIOTrackedFrameList* aTrackedFrameList)
+{
+  if (aTrackedFrameList == NULL)
+  {
+    LOG_ERROR("Unable to get tracked frame list - output tracked frame list is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (!aRequestedChannel->GetTrackingEnabled())
+  {
+    LOG_ERROR("Unable to get tracked frame list - Tracking is not enabled");
+    return PLUS_FAIL;
+  }
+
+  // Get the first tool, transforms will be returned at the timestamps of this first tool
+  vtkPlusDataSource* firstActiveTool = NULL;
+  if (aRequestedChannel->GetOwnerDevice()->GetFirstActiveTool(firstActiveTool) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get tracked frame list - there is no active tool!");
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  unsigned int numberOfFrames = 0;
+  BufferItemUidType firstItemUid = 0;
+  BufferItemUidType lastItemUid = 0;
+  if (this->GetNewItemUidRange(firstActiveTool, aCursor, firstItemUid, lastItemUid))
+  {
+    for (BufferItemUidType itemUid = firstItemUid; itemUid <= lastItemUid; ++itemUid)
+    {
+      double itemTimestamp = 0;
+      if (firstActiveTool->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
+      {
+        // probably the buffer item is not available anymore
+        continue;
+      }
+      aCursor.LastItemUids[firstActiveTool] = itemUid;
+      aCursor.LastTimestamp = itemTimestamp;
+
+      igsioTrackedFrame* reusedFrame = GetReusableTrackedFrame(aTrackedFrameList, numberOfFrames);
+      igsioTrackedFrame* trackedFrame = (reusedFrame != NULL ? reusedFrame : new igsioTrackedFrame);
+      if (aRequestedChannel->GetTrackedFrame(itemTimestamp, *trackedFrame, false /* get tracking data only */) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to get tracking data by time: " << std::fixed << itemTimestamp);
+        status = PLUS_FAIL;
+        // Skip the item. A reused frame is overwritten by the next item or removed from the list at the end.
+        if (reusedFrame == NULL)
+        {
+          delete trackedFrame;
+        }
+        continue;
+      }
+      if (reusedFrame == NULL)
+      {
+        if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Unable to add tracking data to the list!");
+          status = PLUS_FAIL;
+        }
+        // invalid frames are not added to the list
+        numberOfFrames = aTrackedFrameList->GetNumberOfTrackedFrames();
+      }
+      else
+      {
+        ++numberOfFrames;
+      }
+    }
+  }
+
+  // Remove frames that remained from the previous call
+  if (aTrackedFrameList->GetNumberOfTrackedFrames() > numberOfFrames)
+  {
+    aTrackedFrameList->RemoveTrackedFrameRange(numberOfFrames, aTrackedFrameList->GetNumberOfTrackedFrames() - 1);
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel, DataCursor& aCursor, vtkIGSIOTrackedFrameList* aTrackedFrameList)
+{
+  if (aTrackedFrameList == NULL)
+  {
+    LOG_ERROR("Unable to get tracked frame list - output tracked frame list is NULL");
+    return PLUS_FAIL;
+  }
+
+  vtkPlusDataSource* videoSource = NULL;
+  if (aRequestedChannel->GetVideoSource(videoSource) != PLUS_SUCCESS || videoSource == NULL)
+  {
+    LOG_ERROR("Unable to get tracked frame list - there is no video source in channel " << aRequestedChannel->GetChannelId());
+    return PLUS_FAIL;
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  unsigned int numberOfFrames = 0;
+  BufferItemUidType firstItemUid = 0;
+  BufferItemUidType lastItemUid = 0;
+  if (this->GetNewItemUidRange(videoSource, aCursor, firstItemUid, lastItemUid))
+  {
+    StreamBufferItem currentStreamBufferItem;
+    for (BufferItemUidType itemUid = firstItemUid; itemUid <= lastItemUid; ++itemUid)
+    {
+      if (videoSource->GetStreamBufferItem(itemUid, &currentStreamBufferItem) != ITEM_OK)
+      {
+        // probably the buffer item is not available anymore
+        continue;
+      }
+      const double itemTimestamp = currentStreamBufferItem.GetTimestamp(videoSource->GetLocalTimeOffsetSec());
+      aCursor.LastItemUids[videoSource] = itemUid;
+      aCursor.LastTimestamp = itemTimestamp;
+
+      igsioTrackedFrame* reusedFrame = GetReusableTrackedFrame(aTrackedFrameList, numberOfFrames);
+      igsioTrackedFrame* trackedFrame = (reusedFrame != NULL ? reusedFrame : new igsioTrackedFrame);
+
+      // Copy frame
+      trackedFrame->SetImageData(currentStreamBufferItem.GetFrame());
+      trackedFrame->SetTimestamp(itemTimestamp);
+
+      // Copy all custom fields
+      const igsioFieldMapType& fieldMap = currentStreamBufferItem.GetFrameFieldMap();
+      for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); ++fieldIterator)
+      {
+        trackedFrame->SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      }
+
+      if (reusedFrame == NULL)
+      {
+        if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Unable to add video data to the list!");
+          status = PLUS_FAIL;
+        }
+        // invalid frames are not added to the list
+        numberOfFrames = aTrackedFrameList->GetNumberOfTrackedFrames();
+      }
+      else
+      {
+        ++numberOfFrames;
+      }
+    }
+  }
+
+  // Remove frames that remained from the previous call
+  if (aTrackedFrameList->GetNumberOfTrackedFrames() > numberOfFrames)
+  {
+    aTrackedFrameList->RemoveTrackedFrameRange(numberOfFrames, aTrackedFrameList->GetNumberOfTrackedFrames() - 1);
+  }
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::SetLoopTimes()
 {
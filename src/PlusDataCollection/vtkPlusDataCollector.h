@@ -15,6 +15,13 @@ See License.txt for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
 //class igsioTrackedFrame; 
 class vtkPlusChannel;
 class vtkPlusDeviceFactory;
@@ -27,6 +34,9 @@ class vtkXMLDataElement;
 
 Provides an interface for clients to connect to a device set, and request data to the currently active devices.
 
+Devices are connected and started in dependency-ordered waves: a device is only processed after all devices
+that provide its input channels. If ParallelConnect is enabled then the devices within a wave are processed concurrently.
+
 \ingroup PlusLibDataCollection
 */
 class vtkPlusDataCollectionExport vtkPlusDataCollector : public vtkObject
@@ -115,10 +125,64 @@ public:
   /*!
     Have each device dump their buffers to disk
     \param aDirectory directory to dump to
-    \param maxTimeLimitSec Maximum time spent in the function (in sec)
   */
   PlusStatus DumpBuffersToDirectory(const char* aDirectory);
 
+  /*!
+    Write the buffer of each data source into a separate sequence file and write a manifest file that lists
+    all the written files with their time range. Data sources are written concurrently.
+    \param aDirectory Output directory. If empty then the application output directory is used, relative paths are interpreted relative to the output directory.
+      Directories outside the application output directory are rejected.
+    \param useCompression If enabled then the sequence files are compressed
+    \param numberOfThreads Maximum number of data sources written at the same time. If 0 then the number of hardware threads is used.
+    \param manifestFilePath If not NULL then the full path of the manifest file is returned in it
+  */
+  PlusStatus DumpBuffersToDirectory(const std::string& aDirectory, bool useCompression, unsigned int numberOfThreads, std::string* manifestFilePath = NULL);
+
+  /*!
+    Start writing buffers to disk in a background thread (see DumpBuffersToDirectory). Fails if a buffer dump is already in progress.
+    Progress can be queried by GetDumpBuffersProgress and IsDumpBuffersInProgress.
+  */
+  PlusStatus StartDumpBuffersToDirectory(const std::string& aDirectory, bool useCompression, unsigned int numberOfThreads);
+  /*! Returns true if a buffer dump is in progress */
+  bool IsDumpBuffersInProgress() const;
+  /*! Get progress of the current or last buffer dump (0.0 = not started, 1.0 = completed) */
+  double GetDumpBuffersProgress() const;
+  /*! Get result of the last buffer dump. PLUS_FAIL is returned while a dump is in progress or if the last dump could not be started. */
+  PlusStatus GetDumpBuffersStatus() const;
+  /*! Get full path of the manifest file of the current or last buffer dump */
+  std::string GetDumpBuffersManifestFilePath() const;
+
+  /*!
+    \class DataCursor
+    \brief Read position of a client in the data source buffers
+
+    Stores the UID of the last item that has been returned from each data source.
+    Callers keep the cursor between calls, so that each call only has to process the newly acquired items.
+  */
+  class DataCursor
+  {
+  public:
+    DataCursor() : LastTimestamp(UNDEFINED_TIMESTAMP), NumberOfSkippedItems(0) {}
+    /*! Forget the read position, the next call returns all items that are in the buffer */
+    void Reset()
+    {
+      this->LastItemUids.clear();
+      this->LastTimestamp = UNDEFINED_TIMESTAMP;
+      this->NumberOfSkippedItems = 0;
+    }
+    /*! Timestamp of the last returned item (UNDEFINED_TIMESTAMP if no item has been returned yet) */
+    double GetLastTimestamp() const { return this->LastTimestamp; }
+    /*! Number of items that had been overwritten in the buffer before they could be returned */
+    unsigned long GetNumberOfSkippedItems() const { return this->NumberOfSkippedItems; }
+
+  protected:
+    friend class vtkPlusDataCollector;
+    std::map<vtkPlusDataSource*, BufferItemUidType> LastItemUids;
+    double LastTimestamp;
+    unsigned long NumberOfSkippedItems;
+  };
+
   /*!
     Get tracking data in a tracked frame list since time specified
     \param aTimestamp The oldest timestamp we search for in the buffer. If -1 get all frames in the time range since the most recent timestamp. Out parameter - changed to timestamp of last added frame
@@ -133,6 +197,25 @@ public:
   */
   virtual PlusStatus GetVideoData(vtkPlusChannel* aRequestedChannel, double& aTimestamp, vtkIGSIOTrackedFrameList* aTrackedFrameList);
 
+  /*!
+    Get tracking data that has been acquired since the previous call with the same cursor.
+    The tracked frame list content is replaced by the new frames. Frames that are already in the list are overwritten in place,
+    therefore passing the same list (that is only used for tracking data of this channel) in each call avoids reallocation of frames.
+    Items for which the tracked frame cannot be computed are left out of the list and PLUS_FAIL is returned, the cursor still moves past them.
+    \param aCursor Read position, updated to the last returned item
+    \param aTrackedFrameList Caller-owned tracked frame list that receives the new frames
+  */
+  PlusStatus GetTrackingData(vtkPlusChannel* aRequestedChannel, DataCursor& aCursor, vtkIGSIOTrackedFrameList* aTrackedFrameList);
+
+  /*!
+    Get video data that has been acquired since the previous call with the same cursor.
+    The tracked frame list content is replaced by the new frames. Frames that are already in the list are overwritten in place,
+    therefore passing the same list (that is only used for video data of this channel) in each call avoids reallocation of frames.
+    \param aCursor Read position, updated to the last returned item
+    \param aTrackedFrameList Caller-owned tracked frame list that receives the new frames
+  */
+  PlusStatus GetVideoData(vtkPlusChannel* aRequestedChannel, DataCursor& aCursor, vtkIGSIOTrackedFrameList* aTrackedFrameList);
+
   /*
   * Functions to manage the currently active stream mixers
   */
@@ -154,10 +237,65 @@ public:
   /*! Get startup delay in sec to give some time to the buffers for proper initialization */
   vtkGetMacro(StartupDelaySec, double);
 
+  /*! If enabled then devices that do not depend on each other are connected and started concurrently */
+  vtkSetMacro(ParallelConnect, bool);
+  vtkGetMacro(ParallelConnect, bool);
+  vtkBooleanMacro(ParallelConnect, bool);
+
+  /*! Default maximum time allowed for connecting a single device (in sec). Zero or negative value means no limit. */
+  vtkSetMacro(ConnectTimeoutSec, double);
+  vtkGetMacro(ConnectTimeoutSec, double);
+
+  /*! Set the maximum time allowed for connecting the specified device (overrides ConnectTimeoutSec) */
+  void SetDeviceConnectTimeoutSec(const std::string& aDeviceId, double timeoutSec);
+  /*! Get the maximum time allowed for connecting the specified device */
+  double GetDeviceConnectTimeoutSec(const std::string& aDeviceId) const;
+
+  /*! Get the time spent in the last Connect call of the specified device (in sec) */
+  PlusStatus GetDeviceConnectTimeSec(const std::string& aDeviceId, double& connectTimeSec) const;
+  /*! Get the time spent in the last StartRecording call of the specified device (in sec) */
+  PlusStatus GetDeviceStartTimeSec(const std::string& aDeviceId, double& startTimeSec) const;
+
 protected:
   vtkPlusDataCollector();
   virtual ~vtkPlusDataCollector();
 
+  /*!
+    Group the devices into waves, where each device only depends on (receives input channels from) devices in earlier waves
+    \param waves Device groups in the order they have to be processed
+  */
+  PlusStatus GetDeviceWaves(std::vector<DeviceCollection>& waves) const;
+
+  /*!
+    Perform an operation on all devices, wave by wave. Devices within a wave are processed concurrently if ParallelConnect is enabled.
+    \param operationName Name of the operation, used in log messages
+    \param operation Function that is called for each device
+    \param applyConnectTimeout If true then devices that do not complete the operation within their connect timeout are reported as failed
+    \param operationTimesSec Time spent in the operation for each device (in sec), indexed by device Id
+  */
+  PlusStatus ExecuteOnDevices(const std::string& operationName, const std::function<PlusStatus(vtkPlusDevice*)>& operation, bool applyConnectTimeout, std::map<std::string, double>& operationTimesSec);
+
+  /*! Log the time spent in an operation for each device */
+  void LogDeviceTimingReport(const std::string& operationName, const std::map<std::string, double>& operationTimesSec) const;
+
+  /*!
+    Get the range of item UIDs in aSource that has not been returned yet to the owner of aCursor.
+    Returns false if there are no new items.
+  */
+  bool GetNewItemUidRange(vtkPlusDataSource* aSource, DataCursor& aCursor, BufferItemUidType& firstItemUid, BufferItemUidType& lastItemUid);
+
+  /*! Get the frame at the given index of the list for overwriting. Returns NULL if the list does not have such frame yet. */
+  static igsioTrackedFrame* GetReusableTrackedFrame(vtkIGSIOTrackedFrameList* aTrackedFrameList, unsigned int frameIndex);
+
+  /*!
+    Get full path of the buffer dump output directory and manifest file.
+    Returns with failure if the output directory is not inside the application output directory.
+  */
+  PlusStatus GetDumpBuffersOutputPaths(const std::string& aDirectory, const std::string& dateAndTime, std::string& outputDirectory, std::string& manifestFilePath) const;
+
+  /*! Write the buffers of all data sources and the manifest file, updates dump progress */
+  PlusStatus WriteBufferDump(const std::string& outputDirectory, const std::string& dateAndTime, const std::string& manifestFilePath, bool useCompression, unsigned int numberOfThreads);
+
   /*! The timestamp filtering methods require some time to initialize. Synchronization will ignore data that are acquired during startup delay. */
   double StartupDelaySec;
 
@@ -165,9 +303,34 @@ protected:
 
   DeviceCollection Devices;
 
+  /*! Connect and start independent devices concurrently */
+  bool ParallelConnect;
+
+  /*! Default maximum time allowed for connecting a device (in sec) */
+  double ConnectTimeoutSec;
+
+  /*! Device-specific connection timeouts (in sec), indexed by device Id */
+  std::map<std::string, double> DeviceConnectTimeoutsSec;
+
+  /*! Time spent with connecting each device (in sec), indexed by device Id */
+  std::map<std::string, double> DeviceConnectTimesSec;
+
+  /*! Time spent with starting each device (in sec), indexed by device Id */
+  std::map<std::string, double> DeviceStartTimesSec;
+
   bool Connected;
   bool Started;
 
+  /*! Background thread that writes buffers to disk */
+  std::thread DumpBuffersThread;
+  /*! Protects the buffer dump status members */
+  mutable std::mutex DumpBuffersMutex;
+  std::atomic<bool> DumpBuffersInProgress;
+  std::atomic<int> DumpBuffersTotalTaskCount;
+  std::atomic<int> DumpBuffersCompletedTaskCount;
+  PlusStatus DumpBuffersStatus;
+  std::string DumpBuffersManifestFilePath;
+
 private:
   vtkPlusDataCollector(const vtkPlusDataCollector&);
   void operator=(const vtkPlusDataCollector&);
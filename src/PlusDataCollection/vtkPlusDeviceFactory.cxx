@@ -19,6 +19,7 @@ See License.txt for details.
 #include "vtkPlusVirtualCapture.h"
 #include "vtkPlusVirtualVolumeReconstructor.h"
 #include "vtkPlusVirtualDeinterlacer.h"
+#include "vtkPlusVirtualTemporalCalibrator.h"
 #include "vtkPlusImageProcessorVideoSource.h"
 #include "vtkPlusGenericSerialDevice.h"
 #ifdef PLUS_USE_TextRecognizer
@@ -476,6 +477,7 @@ RegisterDevice("GenericSensor", "vtkPlusGenericSensorTracker", (PointerToDevice)
     RegisterDevice("VirtualBufferedCapture", "vtkPlusVirtualCapture", (PointerToDevice)&vtkPlusVirtualCapture::New); // for backward compatibility
     RegisterDevice("VirtualVolumeReconstructor", "vtkPlusVirtualVolumeReconstructor", (PointerToDevice)&vtkPlusVirtualVolumeReconstructor::New);
     RegisterDevice("VirtualDeinterlacer", "vtkPlusVirtualDeinterlacer", (PointerToDevice)&vtkPlusVirtualDeinterlacer::New);
+    RegisterDevice("VirtualTemporalCalibrator", "vtkPlusVirtualTemporalCalibrator", (PointerToDevice)&vtkPlusVirtualTemporalCalibrator::New);
 }
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,146 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusBoneEnhancerMorphologyTest.cxx
+This program checks that the erosion and dilation of vtkPlusBoneEnhancer produce the same images as vtkImageDilateErode3D,
+for random binary images and various kernel sizes.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBoneEnhancer.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkImageDilateErode3D.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Random binary image with a mixture of isolated pixels and larger blobs
+  void FillRandomBinaryImage(vtkImageData* image, vtkMinimalStandardRandomSequence* randomSequence, double foregroundRatio)
+  {
+    int dims[3] = { 0, 0, 0 };
+    image->GetDimensions(dims);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int y = 0; y < dims[1]; ++y)
+    {
+      for (int x = 0; x < dims[0]; ++x)
+      {
+        randomSequence->Next();
+        bool foreground = randomSequence->GetValue() < foregroundRatio;
+        // Horizontal stripes make runs longer than the kernels
+        if ((y / 7) % 3 == 0 && (x / 11) % 2 == 0)
+        {
+          foreground = !foreground;
+        }
+        pixels[y * dims[0] + x] = foreground ? 255 : 0;
+      }
+    }
+    image->Modified();
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareToReference(vtkPlusBoneEnhancer* enhancer, vtkImageData* inputImage, const int kernelSize[2], unsigned char erodeValue, unsigned char dilateValue)
+  {
+    vtkSmartPointer<vtkImageDilateErode3D> referenceFilter = vtkSmartPointer<vtkImageDilateErode3D>::New();
+    referenceFilter->SetKernelSize(kernelSize[0], kernelSize[1], 1);
+    referenceFilter->SetErodeValue(erodeValue);
+    referenceFilter->SetDilateValue(dilateValue);
+    referenceFilter->SetInputData(inputImage);
+    referenceFilter->Update();
+    vtkImageData* referenceImage = referenceFilter->GetOutput();
+
+    vtkSmartPointer<vtkImageData> outputImage = vtkSmartPointer<vtkImageData>::New();
+    if (enhancer->ErodeDilate(inputImage, outputImage, kernelSize, erodeValue, dilateValue) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Erosion/dilation failed with kernel size " << kernelSize[0] << "x" << kernelSize[1]);
+      return 1;
+    }
+
+    const unsigned char* referencePixels = static_cast<unsigned char*>(referenceImage->GetScalarPointer());
+    const unsigned char* outputPixels = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+    vtkIdType numberOfPixels = inputImage->GetNumberOfPoints();
+    vtkIdType numberOfMismatches = 0;
+    for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex)
+    {
+      if (referencePixels[pixelIndex] != outputPixels[pixelIndex])
+      {
+        numberOfMismatches++;
+      }
+    }
+    if (numberOfMismatches > 0)
+    {
+      LOG_ERROR((erodeValue == 255 ? "Erosion" : "Dilation") << " with kernel size " << kernelSize[0] << "x" << kernelSize[1]
+                << " differs from vtkImageDilateErode3D in " << numberOfMismatches << " pixels");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  int numberOfImages = 5;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--number-of-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfImages, "Number of random images to test with each kernel (default: 5).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const int kernelSizes[][2] = { { 1, 1 }, { 3, 3 }, { 5, 5 }, { 2, 1 }, { 4, 6 }, { 7, 3 }, { 9, 9 } };
+  const int numberOfKernelSizes = sizeof(kernelSizes) / sizeof(kernelSizes[0]);
+
+  vtkSmartPointer<vtkPlusBoneEnhancer> enhancer = vtkSmartPointer<vtkPlusBoneEnhancer>::New();
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> randomSequence = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  randomSequence->SetSeed(2017);
+
+  vtkSmartPointer<vtkImageData> inputImage = vtkSmartPointer<vtkImageData>::New();
+  inputImage->SetExtent(0, 127, 0, 95, 0, 0);
+  inputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  int numberOfFailures = 0;
+  for (int imageIndex = 0; imageIndex < numberOfImages; ++imageIndex)
+  {
+    FillRandomBinaryImage(inputImage, randomSequence, 0.3 + 0.1 * imageIndex);
+    for (int kernelIndex = 0; kernelIndex < numberOfKernelSizes; ++kernelIndex)
+    {
+      // Erosion and dilation as used by vtkPlusBoneEnhancer::RemoveNoise
+      numberOfFailures += CompareToReference(enhancer, inputImage, kernelSizes[kernelIndex], 255, 0);
+      numberOfFailures += CompareToReference(enhancer, inputImage, kernelSizes[kernelIndex], 0, 255);
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " mismatching images");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
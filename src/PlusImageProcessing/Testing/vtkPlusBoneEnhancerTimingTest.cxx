@@ -0,0 +1,204 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusBoneEnhancerTimingTest.cxx
+This program measures the processing time per frame of vtkPlusBoneEnhancer or vtkPlusTransverseProcessEnhancer on synthetic
+linear transducer images (speckle and bone surfaces with acoustic shadow). The lines image has the same size as the input images,
+512x512 by default.
+The first frame allocates the scratch images, so it is reported separately. If a maximum time is specified then the test fails
+if the mean time per frame exceeds it.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusBoneEnhancer.h"
+#include "vtkPlusTransverseProcessEnhancer.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMinimalStandardRandomSequence.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  const double PI = 3.14159265358979323846;
+  const double PIXEL_SPACING_MM = 0.1;
+
+  //----------------------------------------------------------------------------
+  // Linear transducer that covers the whole input image, one scanline per image column and one sample per image row
+  std::string GetProcessorConfiguration(const std::string& processorType, int imageSize)
+  {
+    std::ostringstream config;
+    config << "<Processor Type=\"" << processorType << "\" NumberOfScanLines=\"" << imageSize << "\" NumberOfSamplesPerScanLine=\"" << imageSize << "\">"
+           << "<ScanConversion TransducerName=\"SyntheticLinear\" TransducerGeometry=\"LINEAR\""
+           << " ImagingDepthMm=\"" << imageSize * PIXEL_SPACING_MM << "\" TransducerWidthMm=\"" << imageSize * PIXEL_SPACING_MM << "\""
+           << " OutputImageSizePixel=\"" << imageSize << " " << imageSize << "\""
+           << " OutputImageSpacingMmPerPixel=\"" << PIXEL_SPACING_MM << " " << PIXEL_SPACING_MM << "\""
+           << " TransducerCenterPixel=\"" << imageSize / 2 << " 0\" />"
+           << "</Processor>";
+    return config.str();
+  }
+
+  //----------------------------------------------------------------------------
+  // Bone surfaces at varying depth with gaps between them, moving laterally from frame to frame
+  void FillSyntheticImage(vtkImageData* image, vtkMinimalStandardRandomSequence* randomSequence, int frameIndex)
+  {
+    const int surfaceThicknessPx = 6;
+    int dims[3] = { 0, 0, 0 };
+    image->GetDimensions(dims);
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (int x = 0; x < dims[0]; ++x)
+    {
+      double phase = 2 * PI * (x + 4 * frameIndex) / dims[0];
+      int surfaceDepthPx = static_cast<int>(dims[1] * (0.5 + 0.15 * std::sin(2 * phase)));
+      bool bone = std::sin(3 * phase) > -0.3;
+      for (int y = 0; y < dims[1]; ++y)
+      {
+        randomSequence->Next();
+        double speckle = randomSequence->GetValue();
+        double intensity = 20 + 60 * speckle;
+        if (bone && y >= surfaceDepthPx)
+        {
+          intensity = (y < surfaceDepthPx + surfaceThicknessPx) ? 200 + 55 * speckle : 8 * speckle;
+        }
+        pixels[y * dims[0] + x] = static_cast<unsigned char>(intensity);
+      }
+    }
+    image->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::string processorType = "vtkPlusBoneEnhancer";
+  int imageSize = 512;
+  int numberOfFrames = 50;
+  double maxFrameTimeMs = 0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--processor-type", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &processorType, "Processor to measure: vtkPlusBoneEnhancer (default) or vtkPlusTransverseProcessEnhancer.");
+  args.AddArgument("--image-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &imageSize, "Width and height of the input images and of the lines image in pixels (default: 512).");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames to process, at least 2 (default: 50).");
+  args.AddArgument("--max-frame-time-ms", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxFrameTimeMs, "If positive then the test fails if the mean processing time per frame (without the first frame) is longer.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (imageSize < 16 || numberOfFrames < 2)
+  {
+    LOG_ERROR("The image size must be at least 16 and the number of frames at least 2");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPlusBoneEnhancer> enhancer;
+  if (processorType == "vtkPlusBoneEnhancer")
+  {
+    enhancer = vtkSmartPointer<vtkPlusBoneEnhancer>::New();
+  }
+  else if (processorType == "vtkPlusTransverseProcessEnhancer")
+  {
+    enhancer = vtkSmartPointer<vtkPlusTransverseProcessEnhancer>::New();
+  }
+  else
+  {
+    LOG_ERROR("Unknown processor type: " << processorType);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> processorElement = vtkSmartPointer<vtkXMLDataElement>::Take(
+        vtkXMLUtilities::ReadElementFromString(GetProcessorConfiguration(processorType, imageSize).c_str()));
+  if (processorElement == NULL || enhancer->ReadConfiguration(processorElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to configure " << processorType);
+    return EXIT_FAILURE;
+  }
+
+  igsioVideoFrame inputImage;
+  FrameSizeType frameSize = { static_cast<unsigned int>(imageSize), static_cast<unsigned int>(imageSize), 1 };
+  if (inputImage.AllocateFrame(frameSize, VTK_UNSIGNED_CHAR, 1) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to allocate the input image");
+    return EXIT_FAILURE;
+  }
+  inputImage.SetImageOrientation(US_IMG_ORIENT_MF);
+  inputImage.SetImageType(US_IMG_BRIGHTNESS);
+  igsioTrackedFrame inputFrame;
+  inputFrame.SetImageData(inputImage);
+  igsioTrackedFrame outputFrame;
+
+  vtkSmartPointer<vtkMinimalStandardRandomSequence> randomSequence = vtkSmartPointer<vtkMinimalStandardRandomSequence>::New();
+  randomSequence->SetSeed(2017);
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  std::vector<double> frameTimesMs;
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    FillSyntheticImage(inputFrame.GetImageData()->GetImage(), randomSequence, frameIndex);
+    inputFrame.SetTimestamp(frameIndex * 0.05);
+    timer->StartTimer();
+    if (enhancer->ProcessFrame(&inputFrame, &outputFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Processing frame " << frameIndex << " failed");
+      return EXIT_FAILURE;
+    }
+    timer->StopTimer();
+    frameTimesMs.push_back(timer->GetElapsedTime() * 1000.0);
+  }
+
+  const double firstFrameTimeMs = frameTimesMs[0];
+  std::vector<double> sortedFrameTimesMs(frameTimesMs.begin() + 1, frameTimesMs.end());
+  std::sort(sortedFrameTimesMs.begin(), sortedFrameTimesMs.end());
+  double sumFrameTimesMs = 0;
+  for (std::vector<double>::iterator frameTimeIt = sortedFrameTimesMs.begin(); frameTimeIt != sortedFrameTimesMs.end(); ++frameTimeIt)
+  {
+    sumFrameTimesMs += *frameTimeIt;
+  }
+  const double meanFrameTimeMs = sumFrameTimesMs / sortedFrameTimesMs.size();
+  const double medianFrameTimeMs = sortedFrameTimesMs[sortedFrameTimesMs.size() / 2];
+  const double p95FrameTimeMs = sortedFrameTimesMs[std::min<size_t>(sortedFrameTimesMs.size() - 1, static_cast<size_t>(0.95 * sortedFrameTimesMs.size()))];
+  LOG_INFO(processorType << " processing time per " << imageSize << "x" << imageSize << " frame (" << sortedFrameTimesMs.size() << " frames): mean=" << meanFrameTimeMs
+           << " ms, median=" << medianFrameTimeMs << " ms, 95th percentile=" << p95FrameTimeMs << " ms, max=" << sortedFrameTimesMs.back()
+           << " ms (" << 1000.0 / meanFrameTimeMs << " frames per second); first frame: " << firstFrameTimeMs << " ms");
+
+  if (maxFrameTimeMs > 0 && meanFrameTimeMs > maxFrameTimeMs)
+  {
+    LOG_ERROR("Mean processing time per frame (" << meanFrameTimeMs << " ms) is longer than the maximum (" << maxFrameTimeMs << " ms)");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
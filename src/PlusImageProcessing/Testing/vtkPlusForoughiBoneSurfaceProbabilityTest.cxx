@@ -0,0 +1,147 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusForoughiBoneSurfaceProbabilityTest.cxx
+This program runs vtkPlusForoughiBoneSurfaceProbability on an ultrasound sequence with the portable implementation and,
+if Plus is built with Intel MKL, compares the result to the Intel MKL implementation.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusForoughiBoneSurfaceProbability.h"
+
+// VTK includes
+#include <vtkImageCast.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::string inputFileName;
+  double pixelTolerance = 0.5;
+  double maxMismatchRatio = 0.0001;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
+  args.AddArgument("--pixel-tolerance", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &pixelTolerance, "Maximum difference between output pixel values (range: 0-255) of the two implementations that is considered a match (default: 0.5).");
+  args.AddArgument("--max-mismatch-ratio", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxMismatchRatio,
+                   "Maximum ratio of mismatching pixels. Pixels close to the bone threshold may be classified differently due to rounding (default: 0.0001).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputFileName.empty())
+  {
+    LOG_ERROR("The argument --input-seq-file is required");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputFileName, trackedFrameList) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read sequence file: " << inputFileName);
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkImageCast> castToDouble = vtkSmartPointer<vtkImageCast>::New();
+  castToDouble->SetOutputScalarTypeToDouble();
+
+  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> portableFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+  portableFilter->UseIntelMklOff();
+  portableFilter->SetInputConnection(castToDouble->GetOutputPort());
+
+#ifdef PLUS_USE_INTEL_MKL
+  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> mklFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+  mklFilter->UseIntelMklOn();
+  mklFilter->SetInputConnection(castToDouble->GetOutputPort());
+#else
+  LOG_INFO("Plus is built without Intel MKL, only the portable implementation is tested");
+#endif
+
+  int numberOfFailures = 0;
+  vtkIdType numberOfComparedPixels = 0;
+  vtkIdType numberOfMismatchingPixels = 0;
+  double maxDifference = 0.0;
+  for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+    castToDouble->SetInputData(frame->GetImageData()->GetImage());
+    portableFilter->Update();
+
+    vtkImageData* portableOutput = portableFilter->GetOutput();
+    const double* portablePixels = static_cast<const double*>(portableOutput->GetScalarPointer());
+    vtkIdType numberOfPixels = portableOutput->GetNumberOfPoints() * portableOutput->GetNumberOfScalarComponents();
+    for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex)
+    {
+      // NaN fails this check as well
+      if (!(portablePixels[pixelIndex] >= 0.0 && portablePixels[pixelIndex] <= 255.0))
+      {
+        LOG_ERROR("Invalid output pixel value in frame " << frameIndex << ": " << portablePixels[pixelIndex]);
+        numberOfFailures++;
+        break;
+      }
+    }
+
+#ifdef PLUS_USE_INTEL_MKL
+    mklFilter->Update();
+    const double* mklPixels = static_cast<const double*>(mklFilter->GetOutput()->GetScalarPointer());
+    for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex)
+    {
+      double difference = fabs(portablePixels[pixelIndex] - mklPixels[pixelIndex]);
+      maxDifference = std::max(maxDifference, difference);
+      if (difference > pixelTolerance)
+      {
+        numberOfMismatchingPixels++;
+      }
+    }
+    numberOfComparedPixels += numberOfPixels;
+#endif
+  }
+
+  if (numberOfComparedPixels > 0)
+  {
+    double mismatchRatio = static_cast<double>(numberOfMismatchingPixels) / numberOfComparedPixels;
+    LOG_INFO("Portable vs. Intel MKL implementation: " << numberOfMismatchingPixels << " of " << numberOfComparedPixels
+             << " pixels differ by more than " << pixelTolerance << ", maximum difference: " << maxDifference);
+    if (mismatchRatio > maxMismatchRatio)
+    {
+      LOG_ERROR("Portable and Intel MKL implementation results differ: mismatch ratio " << mismatchRatio << " (maximum allowed: " << maxMismatchRatio << ")");
+      numberOfFailures++;
+    }
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusRfProcessorPrecisionTest.cxx
+This program processes an RF sequence with vtkPlusRfProcessor in double precision with unsigned char output (default)
+and in single precision with float output, and checks that the brightness and scan converted images of the two
+computations differ by less than the specified maximum deviation.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusRfProcessor.h"
+#include "vtkPlusRfToBrightnessConvert.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Compute the maximum and the sum of the absolute pixel value differences
+  PlusStatus ComputeDeviation(vtkImageData* referenceImage, vtkImageData* image, double& maxDeviation, double& sumDeviation, vtkIdType& numberOfPixels)
+  {
+    int referenceDims[3] = { 0, 0, 0 };
+    int dims[3] = { 0, 0, 0 };
+    referenceImage->GetDimensions(referenceDims);
+    image->GetDimensions(dims);
+    if (!std::equal(referenceDims, referenceDims + 3, dims))
+    {
+      LOG_ERROR("Image size mismatch: " << referenceDims[0] << "x" << referenceDims[1] << "x" << referenceDims[2]
+                << " (double precision) != " << dims[0] << "x" << dims[1] << "x" << dims[2] << " (single precision)");
+      return PLUS_FAIL;
+    }
+    vtkDataArray* referenceScalars = referenceImage->GetPointData()->GetScalars();
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    for (vtkIdType pixelIndex = 0; pixelIndex < referenceScalars->GetNumberOfTuples(); ++pixelIndex)
+    {
+      double deviation = std::abs(scalars->GetTuple1(pixelIndex) - referenceScalars->GetTuple1(pixelIndex));
+      maxDeviation = std::max(maxDeviation, deviation);
+      sumDeviation += deviation;
+    }
+    numberOfPixels += referenceScalars->GetNumberOfTuples();
+    return PLUS_SUCCESS;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::string inputConfigFileName;
+  std::string inputRfFileName;
+  double maxAllowedDeviation = 4.0;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file containing the RF processing parameters");
+  args.AddArgument("--rf-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRfFileName, "File name of input RF image data");
+  args.AddArgument("--max-deviation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxAllowedDeviation,
+                   "Maximum difference between pixel values (range: 0-255) of the single and double precision computation (default: 4). The double precision output is truncated to integer, which alone can cause a difference of up to 1.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputConfigFileName.empty() || inputRfFileName.empty())
+  {
+    LOG_ERROR("The arguments --config-file and --rf-file are required");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, inputConfigFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << inputConfigFileName);
+    return EXIT_FAILURE;
+  }
+  vtkXMLDataElement* dataCollectionConfig = configRootElement->FindNestedElementWithName("DataCollection");
+  vtkXMLDataElement* deviceConfig = (dataCollectionConfig != NULL ? dataCollectionConfig->FindNestedElementWithName("Device") : NULL);
+  vtkXMLDataElement* outputChannelsElement = (deviceConfig != NULL ? deviceConfig->FindNestedElementWithName("OutputChannels") : NULL);
+  vtkXMLDataElement* outputChannelElement = (outputChannelsElement != NULL ? outputChannelsElement->FindNestedElementWithName("OutputChannel") : NULL);
+  vtkXMLDataElement* rfProcessingElement = (outputChannelElement != NULL ? outputChannelElement->FindNestedElementWithName("RfProcessing") : NULL);
+  if (rfProcessingElement == NULL)
+  {
+    LOG_ERROR("Cannot find DataCollection/Device/OutputChannels/OutputChannel/RfProcessing element in the configuration");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkPlusRfProcessor> doublePrecisionProcessor = vtkSmartPointer<vtkPlusRfProcessor>::New();
+  vtkSmartPointer<vtkPlusRfProcessor> singlePrecisionProcessor = vtkSmartPointer<vtkPlusRfProcessor>::New();
+  if (doublePrecisionProcessor->ReadConfiguration(rfProcessingElement) != PLUS_SUCCESS
+      || singlePrecisionProcessor->ReadConfiguration(rfProcessingElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read RF processing parameters from the configuration file");
+    return EXIT_FAILURE;
+  }
+  doublePrecisionProcessor->GetRfToBrightnessConverter()->SetComputationPrecision(vtkPlusRfToBrightnessConvert::DOUBLE_PRECISION);
+  doublePrecisionProcessor->GetRfToBrightnessConverter()->SetOutputScalarTypeToUnsignedChar();
+  singlePrecisionProcessor->GetRfToBrightnessConverter()->SetComputationPrecision(vtkPlusRfToBrightnessConvert::SINGLE_PRECISION);
+  singlePrecisionProcessor->GetRfToBrightnessConverter()->SetOutputScalarTypeToFloat();
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> rfFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputRfFileName, rfFrameList) != PLUS_SUCCESS || rfFrameList->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("Unable to read RF sequence file: " << inputRfFileName);
+    return EXIT_FAILURE;
+  }
+
+  double maxBrightnessDeviation = 0;
+  double sumBrightnessDeviation = 0;
+  vtkIdType numberOfBrightnessPixels = 0;
+  double maxScanConvertedDeviation = 0;
+  double sumScanConvertedDeviation = 0;
+  vtkIdType numberOfScanConvertedPixels = 0;
+  for (unsigned int frameIndex = 0; frameIndex < rfFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    igsioTrackedFrame* rfFrame = rfFrameList->GetTrackedFrame(frameIndex);
+    doublePrecisionProcessor->SetRfFrame(rfFrame->GetImageData()->GetImage(), rfFrame->GetImageData()->GetImageType());
+    singlePrecisionProcessor->SetRfFrame(rfFrame->GetImageData()->GetImage(), rfFrame->GetImageData()->GetImageType());
+
+    vtkImageData* singlePrecisionBrightnessImage = singlePrecisionProcessor->GetBrightnessConvertedImage();
+    if (singlePrecisionBrightnessImage->GetScalarType() != VTK_FLOAT)
+    {
+      LOG_ERROR("Single precision brightness image is expected to be float, found " << singlePrecisionBrightnessImage->GetScalarTypeAsString());
+      return EXIT_FAILURE;
+    }
+    if (ComputeDeviation(doublePrecisionProcessor->GetBrightnessConvertedImage(), singlePrecisionBrightnessImage,
+                         maxBrightnessDeviation, sumBrightnessDeviation, numberOfBrightnessPixels) != PLUS_SUCCESS
+        || ComputeDeviation(doublePrecisionProcessor->GetBrightnessScanConvertedImage(), singlePrecisionProcessor->GetBrightnessScanConvertedImage(),
+                            maxScanConvertedDeviation, sumScanConvertedDeviation, numberOfScanConvertedPixels) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to compare the processed images of frame " << frameIndex);
+      return EXIT_FAILURE;
+    }
+  }
+
+  LOG_INFO("Brightness converted image deviation: max = " << maxBrightnessDeviation
+           << ", mean = " << (numberOfBrightnessPixels > 0 ? sumBrightnessDeviation / numberOfBrightnessPixels : 0));
+  LOG_INFO("Scan converted image deviation: max = " << maxScanConvertedDeviation
+           << ", mean = " << (numberOfScanConvertedPixels > 0 ? sumScanConvertedDeviation / numberOfScanConvertedPixels : 0));
+  if (maxBrightnessDeviation > maxAllowedDeviation || maxScanConvertedDeviation > maxAllowedDeviation)
+  {
+    LOG_ERROR("Single precision RF processing deviates from the double precision result by more than " << maxAllowedDeviation);
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,13 @@ See License.txt for details.
 /*!
 \file vtkPlusTransverseProcessEnhancerTest.cxx
 This is a program meant to test vtkPlusTransverseProcessEnhancer.cxx from the command line.
+If a baseline sequence is specified then the output images must be identical to the baseline images. No baseline is registered
+as a test: to check that a change does not modify the output, run the test with --output-seq-file before the change,
+then with that file as --baseline-seq-file after the change.
+If a baseline intermediate image file prefix is specified then the intermediate images of the steps that use the bone areas
+(shadow outline, off-camera bone removal, shadow area comparison) must be identical to the baseline images as well. To create
+them, run the test before the change with --save-intermediate-images=true and --intermediate-image-frame-stride=1, and use
+the prefix of the intermediate image files that it writes to the output directory. No frames are dropped in this mode.
 */
 
 #include "PlusConfigure.h"
@@ -15,6 +22,7 @@ This is a program meant to test vtkPlusTransverseProcessEnhancer.cxx from the co
 
 // VTK includes
 #include "vtkImageCast.h"
+#include <vtkImageData.h>
 #include <vtkSmartPointer.h>
 #include <vtksys/CommandLineArguments.hxx>
 
@@ -22,6 +30,65 @@ This is a program meant to test vtkPlusTransverseProcessEnhancer.cxx from the co
 #include <igsioTrackedFrame.h>
 #include <vtkIGSIOTrackedFrameList.h>
 
+//----------------------------------------------------------------------------
+PlusStatus CompareFramesToBaseline(vtkIGSIOTrackedFrameList* frames, const std::string& baselineFileName)
+{
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> baselineFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkPlusSequenceIO::Read(baselineFileName, baselineFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to read baseline sequence file: " << baselineFileName);
+    return PLUS_FAIL;
+  }
+  if (frames->GetNumberOfTrackedFrames() != baselineFrames->GetNumberOfTrackedFrames())
+  {
+    LOG_ERROR("Number of frames differs from the baseline " << baselineFileName << ": current=" << frames->GetNumberOfTrackedFrames()
+              << ", baseline=" << baselineFrames->GetNumberOfTrackedFrames());
+    return PLUS_FAIL;
+  }
+
+  int numberOfDifferentFrames = 0;
+  for (unsigned int frameIndex = 0; frameIndex < frames->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    vtkImageData* image = frames->GetTrackedFrame(frameIndex)->GetImageData()->GetImage();
+    vtkImageData* baselineImage = baselineFrames->GetTrackedFrame(frameIndex)->GetImageData()->GetImage();
+    int dimensions[3] = { 0, 0, 0 };
+    int baselineDimensions[3] = { 0, 0, 0 };
+    image->GetDimensions(dimensions);
+    baselineImage->GetDimensions(baselineDimensions);
+    if (dimensions[0] != baselineDimensions[0] || dimensions[1] != baselineDimensions[1] || dimensions[2] != baselineDimensions[2]
+        || image->GetScalarType() != baselineImage->GetScalarType() || image->GetNumberOfScalarComponents() != baselineImage->GetNumberOfScalarComponents())
+    {
+      LOG_ERROR("Frame " << frameIndex << " image size or pixel type differs from the baseline " << baselineFileName);
+      ++numberOfDifferentFrames;
+      continue;
+    }
+
+    const unsigned char* pixels = static_cast<const unsigned char*>(image->GetScalarPointer());
+    const unsigned char* baselinePixels = static_cast<const unsigned char*>(baselineImage->GetScalarPointer());
+    vtkIdType numberOfBytes = image->GetNumberOfPoints() * image->GetNumberOfScalarComponents() * image->GetScalarSize();
+    vtkIdType numberOfDifferentBytes = 0;
+    for (vtkIdType byteIndex = 0; byteIndex < numberOfBytes; ++byteIndex)
+    {
+      if (pixels[byteIndex] != baselinePixels[byteIndex])
+      {
+        ++numberOfDifferentBytes;
+      }
+    }
+    if (numberOfDifferentBytes > 0)
+    {
+      LOG_ERROR("Frame " << frameIndex << " differs from the baseline " << baselineFileName << " in " << numberOfDifferentBytes << " of " << numberOfBytes << " bytes");
+      ++numberOfDifferentFrames;
+    }
+  }
+
+  if (numberOfDifferentFrames > 0)
+  {
+    return PLUS_FAIL;
+  }
+  LOG_INFO("All " << frames->GetNumberOfTrackedFrames() << " frames are identical to the baseline " << baselineFileName);
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
@@ -34,7 +101,10 @@ int main(int argc, char** argv)
   std::string inputConfigFileName;
   std::string outputConfigFileName;
   std::string outputFileName;
+  std::string baselineFileName;
+  std::string baselineIntermediateImageFileNamePrefix;
   bool saveIntermediateResults = false;
+  int intermediateImageFrameStride = 0;
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   //Get command line arguments
@@ -44,7 +114,10 @@ int main(int argc, char** argv)
   args.AddArgument("--input-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "The filename for input config file.");
   args.AddArgument("--output-config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputConfigFileName, "Optional filename for output config file. Creates new config file with paramaters used during this test");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
+  args.AddArgument("--baseline-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &baselineFileName, "Optional filename of the expected output sequence. The processed images must be identical to the baseline images.");
+  args.AddArgument("--baseline-intermediate-file-prefix", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &baselineIntermediateImageFileNamePrefix, "Optional filename prefix of the expected intermediate images of the bone area steps (<prefix>_Plus<step>.mha). Requires --save-intermediate-images=true.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--intermediate-image-frame-stride", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &intermediateImageFrameStride, "Save the intermediate images of every n-th frame only (default: value of the configuration file)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -75,6 +148,12 @@ int main(int argc, char** argv)
     commandCheckStatus = EXIT_FAILURE;
   }
 
+  if (!baselineIntermediateImageFileNamePrefix.empty() && !saveIntermediateResults)
+  {
+    LOG_ERROR("The argument --baseline-intermediate-file-prefix requires --save-intermediate-images=true");
+    commandCheckStatus = EXIT_FAILURE;
+  }
+
   if (commandCheckStatus == EXIT_FAILURE)
   {
     return EXIT_FAILURE;
@@ -143,15 +222,7 @@ int main(int argc, char** argv)
 
   // Process the frames for the input file
   enhancer->SetSaveIntermediateResults(saveIntermediateResults);
-  LOG_INFO("Processing frames...");
-
-  if (enhancer->Update() == PLUS_FAIL)
-  {
-    LOG_ERROR("Processing frames failed!");
-    return EXIT_FAILURE;
-  }
-
-  LOG_INFO("Processing frames successful");
+  std::string intermediateImageFileName;
   if (saveIntermediateResults)
   {
     // Find out where to add the unique suffix for each intermediate image
@@ -174,10 +245,32 @@ int main(int argc, char** argv)
       startOutputFileNameIndex = outputFileName.rfind("\\") + 1;
     }
 
-    // Saves the intermediate results that were recorded during the call to enhancer->Update()
-    enhancer->SetIntermediateImageFileName(
-      outputFileName.substr(0, startOutputFileNameIndex) + inputFileName.substr(startInputFileNameIndex, inputFileName.find(".") - startInputFileNameIndex));
-    enhancer->SaveAllIntermediateResultsToFile();
+    // Intermediate results are written while enhancer->Update() is running
+    intermediateImageFileName = outputFileName.substr(0, startOutputFileNameIndex) + inputFileName.substr(startInputFileNameIndex, inputFileName.find(".") - startInputFileNameIndex);
+    enhancer->SetIntermediateImageFileName(intermediateImageFileName);
+    if (intermediateImageFrameStride > 0)
+    {
+      enhancer->SetIntermediateImageFrameStride(intermediateImageFrameStride);
+    }
+    if (!baselineIntermediateImageFileNamePrefix.empty())
+    {
+      // Every captured frame must be written to be comparable to the baseline, so wait for the writer instead of dropping frames
+      enhancer->SetIntermediateImageDropFramesWhenQueueFull(false);
+    }
+  }
+
+  LOG_INFO("Processing frames...");
+  if (enhancer->Update() == PLUS_FAIL)
+  {
+    LOG_ERROR("Processing frames failed!");
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Processing frames successful");
+
+  if (saveIntermediateResults && enhancer->SaveAllIntermediateResultsToFile() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Saving intermediate images failed!");
+    return EXIT_FAILURE;
   }
 
   if (vtkPlusSequenceIO::Write(outputFileName, enhancer->GetOutputFrames()) == PLUS_FAIL)
@@ -186,6 +279,40 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  if (!baselineFileName.empty() && CompareFramesToBaseline(enhancer->GetOutputFrames(), baselineFileName) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Processed frames differ from the baseline");
+    return EXIT_FAILURE;
+  }
+
+  if (!baselineIntermediateImageFileNamePrefix.empty())
+  {
+    // Steps that create, filter, and use the bone areas
+    const char* boneAreaStepPostfixes[] = { "_09PostFilters_1ShadowOutline", "_09PostFilters_2PostRemoveOffCamera", "_09PostFilters_3PostCompareShadowAreas" };
+    int numberOfDifferentSteps = 0;
+    for (const char* stepPostfix : boneAreaStepPostfixes)
+    {
+      // The intermediate image writer interprets the file name in the output directory
+      std::string stepFileName = vtkPlusConfig::GetInstance()->GetOutputPath(intermediateImageFileName + "_Plus" + stepPostfix + ".mha");
+      vtkSmartPointer<vtkIGSIOTrackedFrameList> stepFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+      if (vtkPlusSequenceIO::Read(stepFileName, stepFrames) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Unable to read intermediate image file: " << stepFileName);
+        ++numberOfDifferentSteps;
+        continue;
+      }
+      if (CompareFramesToBaseline(stepFrames, baselineIntermediateImageFileNamePrefix + "_Plus" + stepPostfix + ".mha") != PLUS_SUCCESS)
+      {
+        ++numberOfDifferentSteps;
+      }
+    }
+    if (numberOfDifferentSteps > 0)
+    {
+      LOG_ERROR("Intermediate images of " << numberOfDifferentSteps << " bone area steps differ from the baseline");
+      return EXIT_FAILURE;
+    }
+  }
+
   // Test the ability to Write to the config file
   if (!outputConfigFileName.empty())
   {
@@ -0,0 +1,213 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+\file vtkPlusUsScanConvertSamplingTableTest.cxx
+This program extracts the scanlines of an ultrasound sequence using the cached scanline sampling table of the scan converter
+and verifies that the result is identical to sampling each scanline point by point. The comparison is repeated after the
+number of scanlines is changed, to verify that the sampling table is recomputed when the geometry changes.
+The input image of the scan converter is set for each frame (as in vtkPlusBoneEnhancer), which must not cause the
+sampling table to be recomputed.
+*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusUsScanConvert.h"
+#include "vtkPlusUsScanConvertCurvilinear.h"
+#include "vtkPlusUsScanConvertLinear.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// STL includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// Sample the scanlines point by point
+void ExtractScanLinesPointByPoint(vtkPlusUsScanConvert* scanConverter, vtkImageData* inputImageData, vtkImageData* outputImageData)
+{
+  int* linesImageExtent = scanConverter->GetInputImageExtent();
+  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
+  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
+
+  int* inputExtent = inputImageData->GetExtent();
+  for (int scanLine = 0; scanLine < numScanLines; scanLine++)
+  {
+    double start[4] = {0};
+    double end[4] = {0};
+    scanConverter->GetScanLineEndPoints(scanLine, start, end);
+
+    double directionVectorX = static_cast<double>(end[0] - start[0]) / (lineLengthPx - 1);
+    double directionVectorY = static_cast<double>(end[1] - start[1]) / (lineLengthPx - 1);
+    for (int pointIndex = 0; pointIndex < lineLengthPx; ++pointIndex)
+    {
+      int pixelCoordX = start[0] + directionVectorX * pointIndex;
+      int pixelCoordY = start[1] + directionVectorY * pointIndex;
+      if (pixelCoordX < inputExtent[0] || pixelCoordX > inputExtent[1] || pixelCoordY < inputExtent[2] || pixelCoordY > inputExtent[3])
+      {
+        outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
+        continue; // outside of the specified extent
+      }
+      float inputPixelValue = inputImageData->GetScalarComponentAsFloat(pixelCoordX, pixelCoordY, 0, 0);
+      outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, inputPixelValue);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Returns the number of frames where the two methods gave different results or the sampling table was not reused
+int CompareScanLines(vtkPlusUsScanConvert* scanConverter, vtkIGSIOTrackedFrameList* frameList, int numberOfScanLines, int numberOfSamplesPerScanLine)
+{
+  int linesImageExtent[6] = {0, numberOfSamplesPerScanLine - 1, 0, numberOfScanLines - 1, 0, 0};
+  scanConverter->SetInputImageExtent(linesImageExtent);
+
+  vtkSmartPointer<vtkImageData> referenceLinesImage = vtkSmartPointer<vtkImageData>::New();
+  referenceLinesImage->SetExtent(linesImageExtent);
+  referenceLinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkSmartPointer<vtkImageData> linesImage = vtkSmartPointer<vtkImageData>::New();
+  linesImage->SetExtent(linesImageExtent);
+  linesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  const size_t numberOfBytes = static_cast<size_t>(numberOfScanLines) * numberOfSamplesPerScanLine;
+
+  int numberOfMismatchingFrames = 0;
+  vtkMTimeType samplingTableBuildTime = 0;
+  for (unsigned int frameIndex = 0; frameIndex < frameList->GetNumberOfTrackedFrames(); ++frameIndex)
+  {
+    vtkImageData* inputImage = frameList->GetTrackedFrame(frameIndex)->GetImageData()->GetImage();
+    // Setting the input modifies the scan converter, but the geometry is unchanged
+    scanConverter->SetInputData(inputImage);
+    ExtractScanLinesPointByPoint(scanConverter, inputImage, referenceLinesImage);
+    // Fill with a non-zero value to detect samples that are not written
+    memset(linesImage->GetScalarPointer(), 0xAB, numberOfBytes);
+    if (scanConverter->ExtractScanLines(inputImage, linesImage) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to extract scanlines from frame " << frameIndex);
+      numberOfMismatchingFrames++;
+      continue;
+    }
+    if (memcmp(referenceLinesImage->GetScalarPointer(), linesImage->GetScalarPointer(), numberOfBytes) != 0)
+    {
+      LOG_ERROR("Scanlines of frame " << frameIndex << " do not match the point by point sampling (" << numberOfScanLines << " scanlines, " << numberOfSamplesPerScanLine << " samples)");
+      numberOfMismatchingFrames++;
+    }
+    if (frameIndex == 0)
+    {
+      samplingTableBuildTime = scanConverter->GetScanLineSamplingTableBuildTime();
+    }
+    else if (scanConverter->GetScanLineSamplingTableBuildTime() != samplingTableBuildTime)
+    {
+      LOG_ERROR("Scanline sampling table was recomputed for frame " << frameIndex << ", although the geometry did not change");
+      numberOfMismatchingFrames++;
+      samplingTableBuildTime = scanConverter->GetScanLineSamplingTableBuildTime();
+    }
+  }
+  return numberOfMismatchingFrames;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp = false;
+  std::string inputFileName;
+  std::string configFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help");
+  args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
+  args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    LOG_ERROR("Problem parsing arguments");
+    LOG_INFO("Help: " << args.GetHelp());
+    exit(EXIT_FAILURE);
+  }
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (inputFileName.empty() || configFileName.empty())
+  {
+    LOG_ERROR("The arguments --input-seq-file and --config-file are required");
+    return EXIT_FAILURE;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  if (PlusXmlUtils::ReadDeviceSetConfigurationFromFile(configRootElement, configFileName.c_str()) == PLUS_FAIL)
+  {
+    LOG_ERROR("Unable to read configuration from file " << configFileName);
+    return EXIT_FAILURE;
+  }
+  vtkXMLDataElement* scanConversionElement = configRootElement->FindNestedElementWithName("ScanConversion");
+  if (scanConversionElement == NULL)
+  {
+    LOG_ERROR("Cannot find ScanConversion element in XML tree!");
+    return EXIT_FAILURE;
+  }
+  const char* transducerGeometry = scanConversionElement->GetAttribute("TransducerGeometry");
+  vtkSmartPointer<vtkPlusUsScanConvert> scanConverter;
+  if (transducerGeometry != NULL && STRCASECMP(transducerGeometry, "CURVILINEAR") == 0)
+  {
+    scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertCurvilinear::New());
+  }
+  else if (transducerGeometry != NULL && STRCASECMP(transducerGeometry, "LINEAR") == 0)
+  {
+    scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertLinear::New());
+  }
+  else
+  {
+    LOG_ERROR("Invalid scan converter TransducerGeometry: " << (transducerGeometry ? transducerGeometry : "(undefined)"));
+    return EXIT_FAILURE;
+  }
+  if (scanConverter->ReadConfiguration(scanConversionElement) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read scan converter configuration");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfScanLines = 100;
+  int numberOfSamplesPerScanLine = 200;
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, NumberOfScanLines, numberOfScanLines, scanConversionElement)
+  XML_READ_SCALAR_ATTRIBUTE_NONMEMBER_OPTIONAL(int, NumberOfSamplesPerScanLine, numberOfSamplesPerScanLine, scanConversionElement)
+
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> frameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  if (vtkIGSIOSequenceIO::Read(inputFileName, frameList) != PLUS_SUCCESS || frameList->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("Unable to read sequence file: " << inputFileName);
+    return EXIT_FAILURE;
+  }
+
+  int numberOfMismatchingFrames = CompareScanLines(scanConverter, frameList, numberOfScanLines, numberOfSamplesPerScanLine);
+  vtkMTimeType samplingTableBuildTime = scanConverter->GetScanLineSamplingTableBuildTime();
+  // The sampling table has to be recomputed for the changed geometry
+  numberOfMismatchingFrames += CompareScanLines(scanConverter, frameList, numberOfScanLines / 2 + 1, numberOfSamplesPerScanLine * 2);
+  if (scanConverter->GetScanLineSamplingTableBuildTime() <= samplingTableBuildTime)
+  {
+    LOG_ERROR("Scanline sampling table was not recomputed after the number of scanlines changed");
+    numberOfMismatchingFrames++;
+  }
+  if (numberOfMismatchingFrames > 0)
+  {
+    LOG_ERROR("Scanline sampling table test failed: " << numberOfMismatchingFrames << " frames do not match");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
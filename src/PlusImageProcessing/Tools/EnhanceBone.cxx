@@ -8,15 +8,19 @@ See License.txt for details.
 #include "igsioVideoFrame.h"
 #include "igsioTrackedFrame.h"
 #include "vtkPlusForoughiBoneSurfaceProbability.h"
+#include "vtkPlusStreamingSequenceProcessor.h"
 #include "vtkImageCast.h"
 #include "vtkImageData.h"
 #include "vtkMetaImageReader.h"
 #include "vtkMetaImageWriter.h"
+#include "vtkIGSIOMetaImageSequenceIO.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkSmartPointer.h"
+#include "vtkTimerLog.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkXMLUtilities.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include <vector>
 
 //----------------------------------------------------------------------------
 int main(int argc, char** argv)
@@ -26,6 +30,12 @@ int main(int argc, char** argv)
   std::string inputImgSeqFileName;
   std::string outputImgSeqFileName;
   std::string inputConfigFileName;
+  bool compareShadowComputation(false);
+  double maxShadowComputationDifference(1e-6);
+  bool useCompression(true);
+  bool streaming(false);
+  int numberOfThreads(0);
+  int chunkSize(32);
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   vtksys::CommandLineArguments args;
@@ -33,6 +43,12 @@ int main(int argc, char** argv)
 
   args.AddArgument("--source-seq-file",vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputImgSeqFileName, "The ultrasound sequence to draw the scanlines on.");
   args.AddArgument("--output-seq-file",vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgSeqFileName, "The output ultrasound sequence with scanlines overlaid on the images.");
+  args.AddArgument("--compare-shadow-computation", vtksys::CommandLineArguments::NO_ARGUMENT, &compareShadowComputation, "Process each frame with both the fast and the direct shadow value computation, report timing and fail if the results differ.");
+  args.AddArgument("--max-shadow-computation-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxShadowComputationDifference, "Maximum allowed absolute difference between the outputs of the two shadow value computation methods (default: 1e-6).");
+  args.AddArgument("--use-compression", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useCompression, "Use compression when outputting data (metaimage files are written uncompressed in streaming mode).");
+  args.AddArgument("--streaming", vtksys::CommandLineArguments::NO_ARGUMENT, &streaming, "Process frames on multiple threads and write the output file incrementally, in chunks.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of processing threads in streaming mode (default: 0 = number of hardware threads).");
+  args.AddArgument("--chunk-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &chunkSize, "Number of frames that are processed before they are written in streaming mode (default: 32).");
   args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -58,6 +74,32 @@ int main(int argc, char** argv)
     LOG_ERROR("--seq-file required");
     exit(EXIT_FAILURE);
   }
+  if (streaming && compareShadowComputation)
+  {
+    LOG_ERROR("--compare-shadow-computation cannot be used with --streaming");
+    exit(EXIT_FAILURE);
+  }
+  if (numberOfThreads < 0)
+  {
+    LOG_ERROR("Invalid --number-of-threads: " << numberOfThreads << ". It must be 0 (number of hardware threads) or positive.");
+    exit(EXIT_FAILURE);
+  }
+  if (chunkSize < 1)
+  {
+    LOG_ERROR("Invalid --chunk-size: " << chunkSize << ". It must be positive.");
+    exit(EXIT_FAILURE);
+  }
+
+  if (outputImgSeqFileName.empty())
+  {
+    int extensionDot = inputImgSeqFileName.find_last_of(".");
+    std::string inputImgSeqFileNameWithoutExtension = inputImgSeqFileName;
+    if (extensionDot != std::string::npos)
+    {
+      inputImgSeqFileNameWithoutExtension = inputImgSeqFileName.substr(0,extensionDot);
+    }
+    outputImgSeqFileName = inputImgSeqFileNameWithoutExtension + "-Bones.nrrd";
+  }
 
   // Read the image sequence
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
@@ -67,42 +109,113 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
-  vtkSmartPointer<vtkImageCast> castToDouble = vtkSmartPointer<vtkImageCast>::New();
-  castToDouble->SetOutputScalarTypeToDouble();
+  vtkSmartPointer<vtkPlusStreamingSequenceProcessor> streamingProcessor = vtkSmartPointer<vtkPlusStreamingSequenceProcessor>::New();
+  streamingProcessor->SetNumberOfThreads(numberOfThreads);
+  streamingProcessor->SetChunkSize(chunkSize);
+  // Compressed metaimage files cannot be written incrementally
+  streamingProcessor->SetUseCompression(useCompression && !vtkIGSIOMetaImageSequenceIO::CanWriteFile(outputImgSeqFileName.c_str()));
+
+  // Each processing thread uses its own filter pipeline
+  unsigned int numberOfPipelines = (streaming ? streamingProcessor->GetNumberOfWorkerThreads() : 1);
+  std::vector<vtkSmartPointer<vtkImageCast> > castToDoubleFilters(numberOfPipelines);
+  std::vector<vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> > boneSurfaceFilters(numberOfPipelines);
+  std::vector<vtkSmartPointer<vtkImageCast> > castToUnsignedCharFilters(numberOfPipelines);
+  for (unsigned int threadIndex = 0; threadIndex < numberOfPipelines; ++threadIndex)
+  {
+    castToDoubleFilters[threadIndex] = vtkSmartPointer<vtkImageCast>::New();
+    castToDoubleFilters[threadIndex]->SetOutputScalarTypeToDouble();
+
+    boneSurfaceFilters[threadIndex] = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
+    boneSurfaceFilters[threadIndex]->SetInputConnection(castToDoubleFilters[threadIndex]->GetOutputPort());
+
+    castToUnsignedCharFilters[threadIndex] = vtkSmartPointer<vtkImageCast>::New();
+    castToUnsignedCharFilters[threadIndex]->SetOutputScalarTypeToUnsignedChar();
+    castToUnsignedCharFilters[threadIndex]->SetInputConnection(boneSurfaceFilters[threadIndex]->GetOutputPort());
+  }
+  vtkImageCast* castToDouble = castToDoubleFilters[0];
+  vtkPlusForoughiBoneSurfaceProbability* boneSurfaceFilter = boneSurfaceFilters[0];
+  vtkImageCast* castToUnsignedChar = castToUnsignedCharFilters[0];
+
+  if (streaming)
+  {
+    // Process on multiple threads and write the output while processing
+    vtkPlusStreamingSequenceProcessor::FrameProcessingFunction enhanceFrame =
+      [&castToDoubleFilters, &castToUnsignedCharFilters](unsigned int threadIndex, igsioTrackedFrame& frame) -> PlusStatus
+    {
+      castToDoubleFilters[threadIndex]->SetInputData(frame.GetImageData()->GetImage());
+      castToUnsignedCharFilters[threadIndex]->Update();
+      return frame.GetImageData()->DeepCopyFrom(castToUnsignedCharFilters[threadIndex]->GetOutput());
+    };
+    if (streamingProcessor->Process(trackedFrameList, outputImgSeqFileName, enhanceFrame) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
 
-  vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability> boneSurfaceFilter = vtkSmartPointer<vtkPlusForoughiBoneSurfaceProbability>::New();
-  boneSurfaceFilter->SetInputConnection(castToDouble->GetOutputPort());
-  
-  vtkSmartPointer<vtkImageCast> castToUnsignedChar = vtkSmartPointer<vtkImageCast>::New();
-  castToUnsignedChar->SetOutputScalarTypeToUnsignedChar();
-  castToUnsignedChar->SetInputConnection(boneSurfaceFilter->GetOutputPort());
+  vtkSmartPointer<vtkTimerLog> timer = vtkSmartPointer<vtkTimerLog>::New();
+  double fastShadowComputationTimeSec = 0.0;
+  double directShadowComputationTimeSec = 0.0;
+  double maxDifference = 0.0;
 
   int numberOfFrames = trackedFrameList->GetNumberOfTrackedFrames();
   LOG_INFO("Processing "<<numberOfFrames<<" frames...");
   for (int frameIndex = 0; frameIndex < numberOfFrames; frameIndex++)
   {
-    TrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
+    igsioTrackedFrame* frame = trackedFrameList->GetTrackedFrame(frameIndex);
     vtkImageData* imageData = frame->GetImageData()->GetImage();
 
     castToDouble->SetInputData(imageData);
+
+    if (compareShadowComputation)
+    {
+      // Reference result computed by summing the full shadow model for each pixel
+      boneSurfaceFilter->FastShadowComputationOff();
+      boneSurfaceFilter->Modified();
+      timer->StartTimer();
+      boneSurfaceFilter->Update();
+      timer->StopTimer();
+      directShadowComputationTimeSec += timer->GetElapsedTime();
+      vtkSmartPointer<vtkImageData> directOutput = vtkSmartPointer<vtkImageData>::New();
+      directOutput->DeepCopy(boneSurfaceFilter->GetOutput());
+
+      boneSurfaceFilter->FastShadowComputationOn();
+      boneSurfaceFilter->Modified();
+      timer->StartTimer();
+      boneSurfaceFilter->Update();
+      timer->StopTimer();
+      fastShadowComputationTimeSec += timer->GetElapsedTime();
+
+      // Both outputs are double images of the same size
+      const double* fastPixels = static_cast<const double*>(boneSurfaceFilter->GetOutput()->GetScalarPointer());
+      const double* directPixels = static_cast<const double*>(directOutput->GetScalarPointer());
+      vtkIdType numberOfPixels = directOutput->GetNumberOfPoints() * directOutput->GetNumberOfScalarComponents();
+      for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex)
+      {
+        maxDifference = std::max(maxDifference, fabs(fastPixels[pixelIndex] - directPixels[pixelIndex]));
+      }
+    }
+
     castToUnsignedChar->Update();
 
     // Write back the processed output to the input trackedframelist
     frame->GetImageData()->DeepCopyFrom(castToUnsignedChar->GetOutput());
   }
 
-  // Write the new TrackedFrameList to metafile
-  LOG_INFO("Writing new sequence to file...");
-  if (outputImgSeqFileName.empty())
+  if (compareShadowComputation)
   {
-    int extensionDot = inputImgSeqFileName.find_last_of(".");
-    if (extensionDot != std::string::npos)
+    LOG_INFO("Shadow computation comparison on " << numberOfFrames << " frames: direct " << directShadowComputationTimeSec << " sec, fast " << fastShadowComputationTimeSec
+             << " sec, maximum difference: " << maxDifference);
+    if (maxDifference > maxShadowComputationDifference)
     {
-      inputImgSeqFileName = inputImgSeqFileName.substr(0,extensionDot);
+      LOG_ERROR("Fast shadow computation result differs from the direct computation by " << maxDifference << " (maximum allowed: " << maxShadowComputationDifference << ")");
+      return EXIT_FAILURE;
     }
-    outputImgSeqFileName = inputImgSeqFileName + "-Bones.nrrd";
   }
-  if( vtkIGSIOSequenceIO::Write(outputImgSeqFileName, trackedFrameList) != PLUS_SUCCESS )
+
+  // Write the new TrackedFrameList to metafile
+  LOG_INFO("Writing new sequence to file...");
+  if( vtkIGSIOSequenceIO::Write(outputImgSeqFileName, trackedFrameList, US_IMG_ORIENT_MF, useCompression) != PLUS_SUCCESS )
   {
     LOG_ERROR("Failed to save output volume to " << outputImgSeqFileName); 
     return EXIT_FAILURE;
@@ -22,6 +22,7 @@ int main(int argc, char **argv)
   std::string outputFileName;
   std::string configFileName;
   bool saveIntermediateResults = false;
+  int intermediateImageFrameStride = 0;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   args.Initialize(argc, argv);
@@ -30,6 +31,7 @@ int main(int argc, char **argv)
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
   args.AddArgument("--save-intermediate-images", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &saveIntermediateResults, "If intermediate images should be saved to output files");
+  args.AddArgument("--intermediate-image-frame-stride", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &intermediateImageFrameStride, "Save the intermediate images of every n-th frame only (default: value of the configuration file)");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -121,15 +123,6 @@ int main(int argc, char **argv)
   boneFilter->SetInputFrames(trackedFrameList);
   boneFilter->ReadConfiguration(processorElement);
 
-  PlusStatus filterStatus = boneFilter->Update();
-  if (filterStatus != PlusStatus::PLUS_SUCCESS)
-  {
-    LOG_ERROR("Failed processing frames");
-    return EXIT_FAILURE;
-  }
-
-  LOG_INFO("Writing output to file");
-
   if (saveIntermediateResults)
   {
     // Find out where to add the unique suffix for each intermediate image
@@ -152,9 +145,26 @@ int main(int argc, char **argv)
       startOutputFileNameIndex = outputFileName.rfind("\\") + 1;
     }
 
-    // Saves the intermediate results that were recorded during the call to boneFilter->Update()
+    // Intermediate results are written while boneFilter->Update() is running
     boneFilter->SetIntermediateImageFileName(
       outputFileName.substr(0, startOutputFileNameIndex) + inputFileName.substr(startInputFileNameIndex, inputFileName.find(".") - startInputFileNameIndex) );
+    if (intermediateImageFrameStride > 0)
+    {
+      boneFilter->SetIntermediateImageFrameStride(intermediateImageFrameStride);
+    }
+  }
+
+  PlusStatus filterStatus = boneFilter->Update();
+  if (filterStatus != PlusStatus::PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed processing frames");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Writing output to file");
+
+  if (saveIntermediateResults)
+  {
     boneFilter->SaveAllIntermediateResultsToFile();
   }
 
@@ -13,39 +13,6 @@
 #include "vtksys/CommandLineArguments.hxx"
 
 
-void extractScanLines(vtkPlusUsScanConvert* scanConverter, vtkImageData* inputImageData, vtkImageData* outputImageData)
-{
-  int* linesImageExtent = scanConverter->GetInputImageExtent();
-  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
-  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
-
-  float inputPixelValue = 0.0;
-
-  int* inputExtent = inputImageData->GetExtent();
-  for (int scanLine = 0; scanLine < numScanLines; scanLine ++ )
-  {
-    double start[4] = {0};
-    double end[4] = {0};
-    scanConverter->GetScanLineEndPoints(scanLine, start, end);
-
-    double directionVectorX = static_cast<double>(end[0]-start[0])/(lineLengthPx-1);
-    double directionVectorY = static_cast<double>(end[1]-start[1])/(lineLengthPx-1);
-    for (int pointIndex=0; pointIndex<lineLengthPx; ++pointIndex)
-    {
-      int pixelCoordX = start[0] + directionVectorX * pointIndex;
-      int pixelCoordY = start[1] + directionVectorY * pointIndex;
-      if ( pixelCoordX<inputExtent[0] ||  pixelCoordX>inputExtent[1] || pixelCoordY<inputExtent[2] ||  pixelCoordY>inputExtent[3] )
-      {
-        outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
-        continue; // outside of the specified extent
-      }
-      inputPixelValue = inputImageData->GetScalarComponentAsFloat(pixelCoordX, pixelCoordY, 0, 0);
-      outputImageData->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, inputPixelValue);
-    }
-  }
-}
-
-
 int main(int argc, char** argv)
 {
   bool printHelp = false;
@@ -182,7 +149,11 @@ int main(int argc, char** argv)
     linesFrame->GetImageData()->DeepCopyFrom(linesImage);  // Would there be a more efficient way to create this tracked frame?
 
     // Extract scan lines from image.
-    extractScanLines(scanConverter, inputFrame->GetImageData()->GetImage(), linesFrame->GetImageData()->GetImage() );
+    if (scanConverter->ExtractScanLines(inputFrame->GetImageData()->GetImage(), linesFrame->GetImageData()->GetImage()) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to extract scan lines from frame " << frameIndex);
+      return EXIT_FAILURE;
+    }
   }
 
   std::cout << "Writing output to file. Setting log level to 1, regardless of user specified verbose level." << std::endl;
@@ -9,7 +9,9 @@ See License.txt for details.
 #include "vtkImageData.h" 
 #include "vtkPlusRfProcessor.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusStreamingSequenceProcessor.h"
 #include "vtkSmartPointer.h"
+#include "vtkIGSIOMetaImageSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkTransform.h"
 #include "vtkXMLUtilities.h"
@@ -17,6 +19,7 @@ See License.txt for details.
 #include "vtksys/SystemTools.hxx"
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 
 //-----------------------------------------------------------------------------
@@ -28,6 +31,9 @@ int main(int argc, char **argv)
   std::string outputImgFile;
   std::string operation="BRIGHTNESS_SCAN_CONVERT";
   bool useCompression(true);
+  bool streaming(false);
+  int numberOfThreads(0);
+  int chunkSize(32);
 
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -38,7 +44,10 @@ int main(int argc, char **argv)
   args.AddArgument("--rf-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputRfFile, "File name of input RF image data");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputConfigFileName, "Config file containing processing parameters");
   args.AddArgument("--output-img-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputImgFile, "File name of the generated output brightness image");
-  args.AddArgument("--use-compression", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useCompression, "Use compression when outputting data");
+  args.AddArgument("--use-compression", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useCompression, "Use compression when outputting data (metaimage files are written uncompressed in streaming mode).");
+  args.AddArgument("--streaming", vtksys::CommandLineArguments::NO_ARGUMENT, &streaming, "Process frames on multiple threads and write the output file incrementally, in chunks.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of processing threads in streaming mode (default: 0 = number of hardware threads).");
+  args.AddArgument("--chunk-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &chunkSize, "Number of frames that are processed before they are written in streaming mode (default: 32).");
   args.AddArgument("--operation", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &operation, "Processing operation to be applied on the input file (BRIGHTNESS_CONVERT, BRIGHTNESS_SCAN_CONVERT, default: BRIGHTNESS_SCAN_CONVERT");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
@@ -74,6 +83,21 @@ int main(int argc, char **argv)
     std::cerr << "Missing --output-img-file parameter. Specification of the output image file name is required." << std::endl;
     exit(EXIT_FAILURE);
   }
+  if (STRCASECMP(operation.c_str(), "BRIGHTNESS_CONVERT") != 0 && STRCASECMP(operation.c_str(), "BRIGHTNESS_SCAN_CONVERT") != 0)
+  {
+    LOG_ERROR("Unknown operation: " << operation);
+    exit(EXIT_FAILURE);
+  }
+  if (numberOfThreads < 0)
+  {
+    LOG_ERROR("Invalid --number-of-threads: " << numberOfThreads << ". It must be 0 (number of hardware threads) or positive.");
+    exit(EXIT_FAILURE);
+  }
+  if (chunkSize < 1)
+  {
+    LOG_ERROR("Invalid --chunk-size: " << chunkSize << ". It must be positive.");
+    exit(EXIT_FAILURE);
+  }
 
   // Read transformations data 
   LOG_DEBUG("Reading input meta file..."); 
@@ -115,6 +139,23 @@ int main(int argc, char **argv)
     return PLUS_FAIL;
   }
 
+  vtkSmartPointer<vtkPlusStreamingSequenceProcessor> streamingProcessor = vtkSmartPointer<vtkPlusStreamingSequenceProcessor>::New();
+  streamingProcessor->SetNumberOfThreads(numberOfThreads);
+  streamingProcessor->SetChunkSize(chunkSize);
+  // Compressed metaimage files cannot be written incrementally
+  streamingProcessor->SetUseCompression(useCompression && !vtkIGSIOMetaImageSequenceIO::CanWriteFile(outputImgFile.c_str()));
+  streamingProcessor->SetImageOrientationInFile(frameList->GetImageOrientation());
+
+  // Index of the last output channel, input frames can be released while it is processed in streaming mode
+  int lastOutputChannelIndex = -1;
+  for ( int i = 0; i < outputChannelsElement->GetNumberOfNestedElements(); ++i )
+  {
+    if (STRCASECMP(outputChannelsElement->GetNestedElement(i)->GetName(), "OutputChannel") == 0 )
+    {
+      lastOutputChannelIndex = i;
+    }
+  }
+
   for ( int i = 0; i < outputChannelsElement->GetNumberOfNestedElements(); ++i )
   {
     vtkXMLDataElement* outputChannelElement = outputChannelsElement->GetNestedElement(i); 
@@ -131,43 +172,52 @@ int main(int argc, char **argv)
       return PLUS_FAIL;
     }
 
-    // Create converter
-    vtkSmartPointer<vtkPlusRfProcessor> rfProcessor = vtkSmartPointer<vtkPlusRfProcessor>::New(); 
-    if ( rfProcessor->ReadConfiguration(rfProcesingElement) != PLUS_SUCCESS )
+    // Create converter(s), each processing thread uses its own instance
+    std::vector<vtkSmartPointer<vtkPlusRfProcessor> > rfProcessors(streaming ? streamingProcessor->GetNumberOfWorkerThreads() : 1);
+    for (unsigned int threadIndex = 0; threadIndex < rfProcessors.size(); ++threadIndex)
     {
-      LOG_ERROR("Failed to read conversion parameters from the configuration file"); 
-      exit(EXIT_FAILURE); 
+      rfProcessors[threadIndex] = vtkSmartPointer<vtkPlusRfProcessor>::New(); 
+      if ( rfProcessors[threadIndex]->ReadConfiguration(rfProcesingElement) != PLUS_SUCCESS )
+      {
+        LOG_ERROR("Failed to read conversion parameters from the configuration file"); 
+        exit(EXIT_FAILURE); 
+      }
     }
 
-    // Process the frames
-    for (unsigned int j = 0; j < frameList->GetNumberOfTrackedFrames(); j++)
+    // Replaces the RF data of the frame by the processed image
+    vtkPlusStreamingSequenceProcessor::FrameProcessingFunction processRfFrame = [&rfProcessors, &operation](unsigned int threadIndex, igsioTrackedFrame& rfFrame) -> PlusStatus
     {
-      igsioTrackedFrame* rfFrame = frameList->GetTrackedFrame(j);
+      vtkPlusRfProcessor* rfProcessor = rfProcessors[threadIndex];
 
       // Do the conversion
-      rfProcessor->SetRfFrame(rfFrame->GetImageData()->GetImage(), rfFrame->GetImageData()->GetImageType());
+      rfProcessor->SetRfFrame(rfFrame.GetImageData()->GetImage(), rfFrame.GetImageData()->GetImageType());
 
       if (STRCASECMP(operation.c_str(),"BRIGHTNESS_CONVERT")==0)
       {
         // do brightness conversion only
         vtkImageData* brightnessImage = rfProcessor->GetBrightnessConvertedImage();
         // Update the pixel data in the frame
-        rfFrame->GetImageData()->DeepCopyFrom(brightnessImage);  
-        rfFrame->GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
+        rfFrame.GetImageData()->DeepCopyFrom(brightnessImage);  
+        rfFrame.GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
       }
-      else if (STRCASECMP(operation.c_str(),"BRIGHTNESS_SCAN_CONVERT")==0)
+      else
       {
         // do brightness and scan conversion
         vtkImageData* brightnessImage = rfProcessor->GetBrightnessScanConvertedImage();
         // Update the pixel data in the frame
-        rfFrame->GetImageData()->DeepCopyFrom(brightnessImage);    
-        rfFrame->GetImageData()->SetImageOrientation(US_IMG_ORIENT_MF); 
-        rfFrame->GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
+        rfFrame.GetImageData()->DeepCopyFrom(brightnessImage);    
+        rfFrame.GetImageData()->SetImageOrientation(US_IMG_ORIENT_MF); 
+        rfFrame.GetImageData()->SetImageType(US_IMG_BRIGHTNESS);
       }
-      else
+      return PLUS_SUCCESS;
+    };
+
+    if (!streaming)
+    {
+      // Process the frames
+      for (unsigned int j = 0; j < frameList->GetNumberOfTrackedFrames(); j++)
       {
-        LOG_ERROR("Unknown operation: "<<operation);
-        exit(EXIT_FAILURE);
+        processRfFrame(0, *frameList->GetTrackedFrame(j));
       }
     }
 
@@ -186,7 +236,17 @@ int main(int argc, char **argv)
       ss << vtksys::SystemTools::GetFilenameWithoutExtension(outputImgFile) << "_OutputChannel_" << i << vtksys::SystemTools::GetFilenameExtension(outputImgFile);
     }
 
-    if(vtkPlusSequenceIO::Write(ss.str(), frameList, frameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS )
+    if (streaming)
+    {
+      // Input frames are kept until the last output channel is processed
+      streamingProcessor->SetReleaseInputFrames(i == lastOutputChannelIndex);
+      if (streamingProcessor->Process(frameList, vtkPlusConfig::GetInstance()->GetOutputPath(ss.str()), processRfFrame) != PLUS_SUCCESS)
+      {
+        // Error has already been logged
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if(vtkPlusSequenceIO::Write(ss.str(), frameList, frameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS )
     {
       // Error has already been logged
       exit(EXIT_FAILURE);
@@ -2,11 +2,14 @@
 #include "igsioTrackedFrame.h"
 #include "vtkSmartPointer.h"
 #include "vtksys/CommandLineArguments.hxx"
+#include "vtkIGSIOMetaImageSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPlusUsScanConvert.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusStreamingSequenceProcessor.h"
+#include <vector>
 
 int main(int argc, char **argv)
 {
@@ -16,6 +19,10 @@ int main(int argc, char **argv)
   std::string inputFileName;
   std::string outputFileName;
   std::string configFileName;
+  bool useCompression = true;
+  bool streaming = false;
+  int numberOfThreads = 0;
+  int chunkSize = 32;
   int verboseLevel=vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
   args.Initialize(argc, argv);
@@ -23,6 +30,10 @@ int main(int argc, char **argv)
   args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputFileName, "The filename for the input ultrasound sequence to process.");
   args.AddArgument("--config-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &configFileName, "The filename for input config file.");
   args.AddArgument("--output-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &outputFileName, "The filename to write the processed sequence to.");
+  args.AddArgument("--use-compression", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &useCompression, "Use compression when outputting data (metaimage files are written uncompressed in streaming mode).");
+  args.AddArgument("--streaming", vtksys::CommandLineArguments::NO_ARGUMENT, &streaming, "Process frames on multiple threads and write the output file incrementally, in chunks.");
+  args.AddArgument("--number-of-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfThreads, "Number of processing threads in streaming mode (default: 0 = number of hardware threads).");
+  args.AddArgument("--chunk-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &chunkSize, "Number of frames that are processed before they are written in streaming mode (default: 32).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -58,6 +69,17 @@ int main(int argc, char **argv)
     return EXIT_FAILURE;
   }
 
+  if (numberOfThreads < 0)
+  {
+    LOG_ERROR("Invalid --number-of-threads: " << numberOfThreads << ". It must be 0 (number of hardware threads) or positive.");
+    return EXIT_FAILURE;
+  }
+  if (chunkSize < 1)
+  {
+    LOG_ERROR("Invalid --chunk-size: " << chunkSize << ". It must be positive.");
+    return EXIT_FAILURE;
+  }
+
   // Read config file.
 
   vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::New();
@@ -81,29 +103,60 @@ int main(int argc, char **argv)
     return PLUS_FAIL;
   }
 
-  // Create scan converter.
-
-  vtkSmartPointer<vtkPlusUsScanConvert> scanConverter;
-  if (STRCASECMP(transducerGeometry, "CURVILINEAR")==0)
+  if (STRCASECMP(transducerGeometry, "CURVILINEAR")!=0 && STRCASECMP(transducerGeometry, "LINEAR")!=0)
   {
-    scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertCurvilinear::New());
+    LOG_ERROR("Invalid scan converter TransducerGeometry: " << transducerGeometry);
+    return PLUS_FAIL;
   }
-  else if (STRCASECMP(transducerGeometry, "LINEAR")==0)
+
+  vtkSmartPointer<vtkPlusStreamingSequenceProcessor> streamingProcessor = vtkSmartPointer<vtkPlusStreamingSequenceProcessor>::New();
+  streamingProcessor->SetNumberOfThreads(numberOfThreads);
+  streamingProcessor->SetChunkSize(chunkSize);
+  // Compressed metaimage files cannot be written incrementally
+  std::string outputFilePath = vtkPlusConfig::GetInstance()->GetOutputPath(outputFileName);
+  streamingProcessor->SetUseCompression(useCompression && !vtkIGSIOMetaImageSequenceIO::CanWriteFile(outputFilePath.c_str()));
+
+  // Create scan converter(s), each processing thread uses its own instance.
+
+  std::vector<vtkSmartPointer<vtkPlusUsScanConvert> > scanConverters(streaming ? streamingProcessor->GetNumberOfWorkerThreads() : 1);
+  for (std::vector<vtkSmartPointer<vtkPlusUsScanConvert> >::iterator scanConverterIt = scanConverters.begin(); scanConverterIt != scanConverters.end(); ++scanConverterIt)
   {
-    scanConverter = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertLinear::New());
+    if (STRCASECMP(transducerGeometry, "CURVILINEAR")==0)
+    {
+      *scanConverterIt = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertCurvilinear::New());
+    }
+    else
+    {
+      *scanConverterIt = vtkSmartPointer<vtkPlusUsScanConvert>::Take(vtkPlusUsScanConvertLinear::New());
+    }
+    (*scanConverterIt)->ReadConfiguration(scanConversionElement);
   }
-  else
+
+  // Replaces the image of the frame by the scan converted image.
+
+  vtkPlusStreamingSequenceProcessor::FrameProcessingFunction scanConvertFrame = [&scanConverters](unsigned int threadIndex, igsioTrackedFrame& frame) -> PlusStatus
   {
-    LOG_ERROR("Invalid scan converter TransducerGeometry: " << transducerGeometry);
-    return PLUS_FAIL;
-  }
-  scanConverter->ReadConfiguration(scanConversionElement);
+    vtkPlusUsScanConvert* scanConverter = scanConverters[threadIndex];
+    scanConverter->SetInputData( frame.GetImageData()->GetImage() );
+    scanConverter->Update();
+    return frame.GetImageData()->DeepCopyFrom(scanConverter->GetOutput());
+  };
   
   // Read input image.
 
   vtkSmartPointer<vtkIGSIOTrackedFrameList> inputFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
   vtkPlusSequenceIO::Read(inputFileName.c_str(), inputFrameList);
   int numberOfFrames = inputFrameList->GetNumberOfTrackedFrames();
+
+  if (streaming)
+  {
+    // Process on multiple threads and write the output while processing.
+    if (streamingProcessor->Process(inputFrameList, outputFilePath, scanConvertFrame) != PLUS_SUCCESS)
+    {
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
   
   // Create output frame list.
 
@@ -115,20 +168,17 @@ int main(int argc, char **argv)
   {
     igsioTrackedFrame* inputFrame = inputFrameList->GetTrackedFrame(frameIndex);
     
-    scanConverter->SetInputData( inputFrame->GetImageData()->GetImage() );
-    scanConverter->Update();
-    
     // Allocate and store output image.
 
     outputFrameList->AddTrackedFrame(inputFrame);
     igsioTrackedFrame* outputFrame = outputFrameList->GetTrackedFrame(outputFrameList->GetNumberOfTrackedFrames()-1);
-    outputFrame->GetImageData()->DeepCopyFrom(scanConverter->GetOutput());
+    scanConvertFrame(0, *outputFrame);
   }
 
   std::cout << "Writing output to file. Setting log level to error only, regardless of user specified verbose level." << std::endl;
   vtkPlusLogger::Instance()->SetLogLevel(1);
   
-  vtkPlusSequenceIO::Write(outputFileName.c_str(), outputFrameList);
+  vtkPlusSequenceIO::Write(outputFileName.c_str(), outputFrameList, US_IMG_ORIENT_MF, useCompression);
 
   return EXIT_SUCCESS;
 }
@@ -8,16 +8,14 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "PlusMath.h"
 #include "vtkPlusBoneEnhancer.h"
+#include "vtkPlusIntermediateImageWriter.h"
 #include "vtkPlusUsScanConvertCurvilinear.h"
 #include "vtkPlusUsScanConvertLinear.h"
-#include "vtkPlusSequenceIO.h"
 
 // VTK includes
-#include <vtkImageDilateErode3D.h>
 #include <vtkImageGaussianSmooth.h>
 #include <vtkImageIslandRemoval2D.h>
 #include <vtkImageSobel2D.h>
-#include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 #include "vtkImageAlgorithm.h"
 
@@ -25,9 +23,16 @@ See License.txt for details.
 #include <igsioVideoFrame.h>
 #include <vtkIGSIOTrackedFrameList.h>
 
-
+#include <algorithm>
 #include <cmath>
 
+namespace
+{
+  // Edge magnitude range that is considered as edge in the binarized image (inclusive)
+  const unsigned char EDGE_MAGNITUDE_THRESHOLD_LOWER = 55;
+  const unsigned char EDGE_MAGNITUDE_THRESHOLD_UPPER = 255;
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlusBoneEnhancer);
 
@@ -44,11 +49,10 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
 
   GaussianSmooth(NULL),
   EdgeDetector(NULL),
-  ImageBinarizer(NULL),
   BinaryImageForMorphology(NULL),
   IslandRemover(NULL),
-  ImageEroder(NULL),
-  ImageDialator(NULL),
+  EdgeMaskImage(NULL),
+  ErodedImage(NULL),
 
   ConversionImage(NULL),
   IslandAreaThreshold(-1),
@@ -64,12 +68,10 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
 
   this->GaussianSmooth = vtkSmartPointer<vtkImageGaussianSmooth>::New();    // Used to smooth the image
   this->EdgeDetector = vtkSmartPointer<vtkImageSobel2D>::New();             // Used to outline edges of the image
-  this->ImageBinarizer = vtkSmartPointer<vtkImageThreshold>::New();         // Used to convert into a binary image
   this->BinaryImageForMorphology = vtkSmartPointer<vtkImageData>::New();    // The Binary image
   this->IslandRemover = vtkSmartPointer<vtkImageIslandRemoval2D>::New();    // Used to remove islands (small isolated groups of pixels)
-  this->ImageEroder = vtkSmartPointer<vtkImageDilateErode3D>::New();        // Used to Erode the image
-  this->ImageDialator = vtkSmartPointer<vtkImageDilateErode3D>::New();      // Used to Dilate the image
-
+  this->EdgeMaskImage = vtkSmartPointer<vtkImageData>::New();               // Binarized edge image, input of the island removal
+  this->ErodedImage = vtkSmartPointer<vtkImageData>::New();                 // Output of the erosion, input of the dilation
 
   // Set the default parameters for the filters mentioned above
   this->SetDilationKernelSize(1, 1);
@@ -82,37 +84,27 @@ vtkPlusBoneEnhancer::vtkPlusBoneEnhancer()
   this->ConversionImage->SetExtent(0, 0, 0, 0, 0, 0);
 
   this->BinaryImageForMorphology->SetExtent(0, 0, 0, 0, 0, 0);
-  this->ImageBinarizer->SetInValue(255);
-  this->ImageBinarizer->SetOutValue(0);
-  this->ImageBinarizer->ThresholdBetween(55, 255);
+  this->EdgeMaskImage->SetExtent(0, 0, 0, 0, 0, 0);
+  this->ErodedImage->SetExtent(0, 0, 0, 0, 0, 0);
 
   this->IslandRemover->SetIslandValue(255);
   this->IslandRemover->SetReplaceValue(0);
   this->IslandRemover->SetAreaThreshold(0);
 
-  this->ImageEroder->SetKernelSize(this->ErosionKernelSize[0], this->ErosionKernelSize[1], 1);
-  this->ImageEroder->SetErodeValue(255);
-  this->ImageEroder->SetDilateValue(0);
-
-  this->ImageDialator->SetKernelSize(this->DilationKernelSize[0], this->DilationKernelSize[1], 1);
-  this->ImageDialator->SetErodeValue(0);
-  this->ImageDialator->SetDilateValue(255);
-
   this->LinesImage = vtkSmartPointer<vtkImageData>::New();
   this->ProcessedLinesImage = vtkSmartPointer<vtkImageData>::New();
 
   this->LinesImage->SetExtent(0, 0, 0, 0, 0, 0);
   this->ProcessedLinesImage->SetExtent(0, 0, 0, 0, 0, 0);
 
-  this->IntermediateImageMap.clear();
+  this->IntermediateImageWriter = vtkSmartPointer<vtkPlusIntermediateImageWriter>::New();
 }
 
 //----------------------------------------------------------------------------
 vtkPlusBoneEnhancer::~vtkPlusBoneEnhancer()
 {
-  // Make sure contained smart pointers are deleted
-  this->IntermediateImageMap.clear();
-  this->IntermediatePostfixes.clear();
+  // Write the intermediate images that are still in the queue
+  this->IntermediateImageWriter->Close();
 }
 
 //----------------------------------------------------------------------------
@@ -182,6 +174,8 @@ PlusStatus vtkPlusBoneEnhancer::ReadConfiguration(vtkSmartPointer<vtkXMLDataElem
     else
     {
       XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateResults, saveIntermediateResultsBool);
+      XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, IntermediateImageFrameStride, saveIntermediateResultsBool);
+      XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, IntermediateImageQueueLength, saveIntermediateResultsBool);
     }
     
     // Read tags related to the Gaussian filter
@@ -269,6 +263,8 @@ PlusStatus vtkPlusBoneEnhancer::WriteConfiguration(vtkSmartPointer<vtkXMLDataEle
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(saveIntermediateResultsBool, imageProcessingOperations, "SaveIntermediateResults");
   XML_WRITE_BOOL_ATTRIBUTE(SaveIntermediateResults, saveIntermediateResultsBool)
+  saveIntermediateResultsBool->SetIntAttribute("IntermediateImageFrameStride", this->GetIntermediateImageFrameStride());
+  saveIntermediateResultsBool->SetIntAttribute("IntermediateImageQueueLength", this->GetIntermediateImageQueueLength());
 
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(gaussianParameters, imageProcessingOperations, "GaussianSmoothing");
   gaussianParameters->SetDoubleAttribute("GaussianStdDev", this->GaussianStdDev);
@@ -300,6 +296,15 @@ PlusStatus vtkPlusBoneEnhancer::ProcessImageExtents()
   this->BinaryImageForMorphology->SetExtent(linesImageExtent);
   this->BinaryImageForMorphology->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
+  this->EdgeMaskImage->SetExtent(linesImageExtent);
+  this->EdgeMaskImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  this->ErodedImage->SetExtent(linesImageExtent);
+  this->ErodedImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  this->ConversionImage->SetExtent(linesImageExtent);
+  this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
   this->LinesImage->SetExtent(linesImageExtent);
   this->LinesImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
 
@@ -313,83 +318,175 @@ PlusStatus vtkPlusBoneEnhancer::ProcessImageExtents()
 //----------------------------------------------------------------------------
 // Fills the lines image by subsampling the input image along scanlines.
 // Also computes pixel statistics.
-void vtkPlusBoneEnhancer::FillLinesImage(vtkSmartPointer<vtkImageData> inputImageData)
+PlusStatus vtkPlusBoneEnhancer::FillLinesImage(vtkSmartPointer<vtkImageData> inputImageData)
 {
-  int* linesImageExtent = this->ScanConverter->GetInputImageExtent();
-  int lineLengthPx = linesImageExtent[1] - linesImageExtent[0] + 1;
-  int numScanLines = linesImageExtent[3] - linesImageExtent[2] + 1;
-
-  // For calculating pixel intensity mean and variance. Algorithm taken from:
-  // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Online_algorithm
+  // Sample positions are cached in the scan converter, they are only recomputed if the geometry changes
+  if (this->ScanConverter->ExtractScanLines(inputImageData, this->LinesImage) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to extract scanlines from the input image");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
 
-  double mean = 0.0;
-  double sumSquareDiff = 0.0; //named M2 in online notes
-  long pixelCount = 0;
-  double currentValue = 0.0; //temporary value for each loop. //Named value in online notes
-  double valueMeanDiff = 0.0; //Named delta in online notes
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::EdgeImageToBinary(vtkImageData* edgeImage, vtkImageData* binaryImage, vtkImageData* magnitudeImage)
+{
+  const int numberOfComponents = edgeImage->GetNumberOfScalarComponents();
+  if (edgeImage->GetScalarType() != VTK_DOUBLE || numberOfComponents < 2)
+  {
+    LOG_ERROR("Edge detector output is expected to contain two double components");
+    return;
+  }
+  const vtkIdType numberOfPixels = edgeImage->GetNumberOfPoints();
+  if (binaryImage->GetNumberOfPoints() != numberOfPixels || (magnitudeImage != NULL && magnitudeImage->GetNumberOfPoints() != numberOfPixels))
+  {
+    LOG_ERROR("Edge detector output size does not match the lines image size");
+    return;
+  }
 
-  double directionVectorX;
-  double directionVectorY;
-  int pixelCoordX;
-  int pixelCoordY;
+  const double* edgePixels = static_cast<double*>(edgeImage->GetScalarPointer());
+  unsigned char* binaryPixels = static_cast<unsigned char*>(binaryImage->GetScalarPointer());
+  unsigned char* magnitudePixels = (magnitudeImage != NULL) ? static_cast<unsigned char*>(magnitudeImage->GetScalarPointer()) : NULL;
 
-  int* inputExtent = inputImageData->GetExtent();
-  for (int scanLine = 0; scanLine < numScanLines; ++scanLine)
+  for (vtkIdType pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex, edgePixels += numberOfComponents)
   {
-    double start[4] = { 0, 0, 0, 0 };
-    double end[4] = { 0, 0, 0, 0 };
-    ScanConverter->GetScanLineEndPoints(scanLine, start, end);
+    // Components are truncated to unsigned char, negative gradients wrap around
+    unsigned char edgeDetectorOutput0 = static_cast<unsigned char>(static_cast<int>(static_cast<float>(edgePixels[0])));
+    unsigned char edgeDetectorOutput1 = static_cast<unsigned char>(static_cast<int>(static_cast<float>(edgePixels[1])));
+    float output = (float)(edgeDetectorOutput0 + edgeDetectorOutput1) / (float)2;   // Not mathematically correct, but a quick approximation of sqrt(x^2 + y^2)
+    unsigned char magnitude = (unsigned char)std::max(0, std::min(255, (int)output));
 
-    directionVectorX = static_cast<double>(end[0] - start[0]) / (lineLengthPx - 1);
-    directionVectorY = static_cast<double>(end[1] - start[1]) / (lineLengthPx - 1);
-    for (int pointIndex = 0; pointIndex < lineLengthPx; ++pointIndex)
+    if (magnitudePixels != NULL)
     {
-      pixelCoordX = start[0] + directionVectorX * pointIndex;
-      pixelCoordY = start[1] + directionVectorY * pointIndex;
-      if (pixelCoordX < inputExtent[0] || pixelCoordX > inputExtent[1]
-        || pixelCoordY < inputExtent[2] || pixelCoordY > inputExtent[3])
-      {
-        this->LinesImage->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, 0);
-        continue; // outside of the specified extent
-      }
-      currentValue = inputImageData->GetScalarComponentAsDouble(pixelCoordX, pixelCoordY, 0, 0);
-      this->LinesImage->SetScalarComponentFromFloat(pointIndex, scanLine, 0, 0, currentValue);
-
-      ++pixelCount;
-      valueMeanDiff = currentValue - mean;
-      mean = mean + valueMeanDiff / pixelCount;
-      sumSquareDiff = sumSquareDiff + valueMeanDiff * (currentValue - mean);
+      magnitudePixels[pixelIndex] = magnitude;
     }
+    // Since we perform morphological operations, we must binarize the image
+    binaryPixels[pixelIndex] = (magnitude >= EDGE_MAGNITUDE_THRESHOLD_LOWER && magnitude <= EDGE_MAGNITUDE_THRESHOLD_UPPER) ? 255 : 0;
+  }
+
+  // Pixels were written directly, notify the pipeline so that the downstream filters are re-executed
+  binaryImage->Modified();
+  if (magnitudeImage != NULL)
+  {
+    magnitudeImage->Modified();
   }
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBoneEnhancer::VectorImageToUchar(vtkSmartPointer<vtkImageData> inputImage)
+PlusStatus vtkPlusBoneEnhancer::ErodeDilate(vtkImageData* inputImage, vtkImageData* outputImage, const int kernelSize[2], unsigned char erodeValue, unsigned char dilateValue)
 {
-  unsigned char* vOutput = 0;
-  unsigned char edgeDetectorOutput0;
-  unsigned char edgeDetectorOutput1;
-  float output = 0.0;     // Keep this in [0..255] instead [0..1] for possible future optimization.
-  float output2 = 0.0;
+  if (inputImage->GetScalarType() != VTK_UNSIGNED_CHAR || inputImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("Erosion/dilation requires a single component unsigned char image");
+    return PLUS_FAIL;
+  }
+  if (kernelSize[0] < 1 || kernelSize[1] < 1)
+  {
+    LOG_ERROR("Invalid erosion/dilation kernel size: " << kernelSize[0] << "x" << kernelSize[1]);
+    return PLUS_FAIL;
+  }
+
+  int* inputExtent = inputImage->GetExtent();
+  int* outputExtent = outputImage->GetExtent();
+  if (!std::equal(inputExtent, inputExtent + 6, outputExtent) || outputImage->GetScalarType() != VTK_UNSIGNED_CHAR
+      || outputImage->GetNumberOfScalarComponents() != 1 || outputImage->GetScalarPointer() == NULL)
+  {
+    outputImage->SetExtent(inputExtent);
+    outputImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  }
 
   int dims[3] = { 0, 0, 0 };
-  this->LinesImage->GetDimensions(dims);
-  this->ConversionImage->SetExtent(this->LinesImage->GetExtent());
-  this->ConversionImage->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-  for (int y = dims[1] - 1; y >= 0; --y)
+  inputImage->GetDimensions(dims);
+  if (dims[2] != 1)
   {
-    // Initialize variables for a new scan line.
+    LOG_ERROR("Erosion/dilation is only implemented for 2D images");
+    return PLUS_FAIL;
+  }
+  const int width = dims[0];
+  const int height = dims[1];
+  const unsigned char* inputPixels = static_cast<unsigned char*>(inputImage->GetScalarPointer());
+  unsigned char* outputPixels = static_cast<unsigned char*>(outputImage->GetScalarPointer());
+
+  // Kernel footprint: the ellipse that vtkImageDilateErode3D uses as mask (vtkImageEllipsoidSource with
+  // center (size-1)/2 and radius size/2), stored as the range of x offsets in each kernel row.
+  // Offsets are relative to the kernel middle (size/2).
+  std::vector<int> kernelRowMinOffset(kernelSize[1], 0);
+  std::vector<int> kernelRowMaxOffset(kernelSize[1], -1);
+  const double kernelCenter[2] = { (kernelSize[0] - 1) * 0.5, (kernelSize[1] - 1) * 0.5 };
+  const double kernelRadius[2] = { kernelSize[0] * 0.5, kernelSize[1] * 0.5 };
+  const int kernelMiddle[2] = { kernelSize[0] / 2, kernelSize[1] / 2 };
+  for (int kernelY = 0; kernelY < kernelSize[1]; ++kernelY)
+  {
+    double normalizedY = (kernelY - kernelCenter[1]) / kernelRadius[1];
+    bool emptyRow = true;
+    for (int kernelX = 0; kernelX < kernelSize[0]; ++kernelX)
+    {
+      double normalizedX = (kernelX - kernelCenter[0]) / kernelRadius[0];
+      if (normalizedY * normalizedY + normalizedX * normalizedX > 1.0)
+      {
+        continue;
+      }
+      if (emptyRow)
+      {
+        kernelRowMinOffset[kernelY] = kernelX - kernelMiddle[0];
+        emptyRow = false;
+      }
+      kernelRowMaxOffset[kernelY] = kernelX - kernelMiddle[0];
+    }
+  }
 
-    for (int x = dims[0] - 1; x >= 0; --x)   // Go towards transducer
+  // Number of dilateValue pixels in each row before each position, so that a kernel row lookup is a single subtraction
+  const int rowCountsLength = width + 1;
+  this->MorphologyRowCounts.resize(static_cast<size_t>(rowCountsLength) * height);
+  for (int y = 0; y < height; ++y)
+  {
+    const unsigned char* inputRow = inputPixels + static_cast<size_t>(y) * width;
+    int* rowCounts = &this->MorphologyRowCounts[static_cast<size_t>(y) * rowCountsLength];
+    rowCounts[0] = 0;
+    for (int x = 0; x < width; ++x)
     {
-      edgeDetectorOutput0 = static_cast<unsigned char>(inputImage->GetScalarComponentAsFloat(x, y, 0, 0));
-      edgeDetectorOutput1 = static_cast<unsigned char>(inputImage->GetScalarComponentAsFloat(x, y, 0, 1));
-      vOutput = static_cast<unsigned char*>(this->ConversionImage->GetScalarPointer(x, y, 0));
-      output = (float)(edgeDetectorOutput0 + edgeDetectorOutput1) / (float)2;                                         // Not mathematically correct, but a quick approximation of sqrt(x^2 + y^2)
+      rowCounts[x + 1] = rowCounts[x] + (inputRow[x] == dilateValue ? 1 : 0);
+    }
+  }
 
-      *vOutput = (unsigned char)std::max(0, std::min(255, (int)output));
+  for (int y = 0; y < height; ++y)
+  {
+    const unsigned char* inputRow = inputPixels + static_cast<size_t>(y) * width;
+    unsigned char* outputRow = outputPixels + static_cast<size_t>(y) * width;
+    for (int x = 0; x < width; ++x)
+    {
+      outputRow[x] = inputRow[x];
+      if (inputRow[x] != erodeValue)
+      {
+        continue;
+      }
+      for (int kernelY = 0; kernelY < kernelSize[1]; ++kernelY)
+      {
+        // Neighbors outside of the image are ignored, same as in vtkImageDilateErode3D
+        int neighborY = y + kernelY - kernelMiddle[1];
+        if (neighborY < 0 || neighborY >= height || kernelRowMinOffset[kernelY] > kernelRowMaxOffset[kernelY])
+        {
+          continue;
+        }
+        int neighborXMin = std::max(x + kernelRowMinOffset[kernelY], 0);
+        int neighborXMax = std::min(x + kernelRowMaxOffset[kernelY], width - 1);
+        if (neighborXMin > neighborXMax)
+        {
+          continue;
+        }
+        const int* rowCounts = &this->MorphologyRowCounts[static_cast<size_t>(neighborY) * rowCountsLength];
+        if (rowCounts[neighborXMax + 1] - rowCounts[neighborXMin] > 0)
+        {
+          outputRow[x] = dilateValue;
+          break;
+        }
+      }
     }
   }
+
+  outputImage->Modified();
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
@@ -409,7 +506,7 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
   int lastVistedValue = 0;
 
   //Setup variables for recording bone areas
-  std::map<std::string, int> currentBoneArea;
+  BoneArea currentBoneArea;
   int boneAreaStart = dims[1] - 1;  //The y coordinate of where the bone outline starts
   int boneDepthSum = 0;             //The sum of the x coordinates of each pixel in the bone outline
   int boneMaxDepth = dims[0] - 1;   //The x coordinate of the right-most pixel in the bone outline
@@ -422,10 +519,11 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
     //When an image is detected, keep up to this many pixles after it
     keepInfoCounter = this->BoneOutlineDepthPx + this->BonePushBackPx;
     foundBone = false;
+    unsigned char* rowPixels = static_cast<unsigned char*>(inputImage->GetScalarPointer(0, y, 0));
 
     for (int x = dims[0] - 1; x >= 0; --x)
     {
-      vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
+      vOutput = rowPixels + x;
 
       //If an image is detected
       if (*vOutput != 0)
@@ -449,13 +547,12 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
               if (boneDepthSum != 0)
               {
                 //Save info related to where the bone area
-                currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-                currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-                currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-                currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-                currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
+                currentBoneArea.Depth = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
+                currentBoneArea.XMax = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
+                currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
+                currentBoneArea.YMax = boneAreaStart;                                        // Store the outline's maximum y-coordinate
+                currentBoneArea.YMin = y + 1;                                                // Store the outline's minimum y-coordinate
                 this->BoneAreasInfo.push_back(currentBoneArea);
-                currentBoneArea.clear();
               }
               boneAreaStart = y;
               boneDepthSum = 0;
@@ -496,14 +593,13 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
       if (boneDepthSum != 0)
       {
         //Save info related to where the bone area
-        currentBoneArea["depth"] = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
-        currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-        currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-        currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-        currentBoneArea["yMin"] = y + 1;                                                // Store the outline's minimum y-coordinate
+        currentBoneArea.Depth = boneDepthSum / (boneAreaStart - y);                  // Store the outline's average x-coordinate
+        currentBoneArea.XMax = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
+        currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
+        currentBoneArea.YMax = boneAreaStart;                                        // Store the outline's maximum y-coordinate
+        currentBoneArea.YMin = y + 1;                                                // Store the outline's minimum y-coordinate
         this->BoneAreasInfo.push_back(currentBoneArea);
         boneDepthSum = 0;
-        currentBoneArea.clear();
       }
       boneMaxDepth = dims[0] - 1;
       boneMinDepth = 0;
@@ -516,13 +612,12 @@ void vtkPlusBoneEnhancer::MarkShadowOutline(vtkSmartPointer<vtkImageData> inputI
   if (boneDepthSum != 0)
   {
     //Save info related to where the bone area
-    currentBoneArea["depth"] = boneDepthSum / (boneAreaStart + 1);                  // Store the outline's average x-coordinate
-    currentBoneArea["xMax"] = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
-    currentBoneArea["xMin"] = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
-    currentBoneArea["yMax"] = boneAreaStart;                                        // Store the outline's maximum y-coordinate
-    currentBoneArea["yMin"] = 0;                                                    // Store the outline's minimum y-coordinate
+    currentBoneArea.Depth = boneDepthSum / (boneAreaStart + 1);                  // Store the outline's average x-coordinate
+    currentBoneArea.XMax = boneMaxDepth;                                         // Store the outline's maximum x-coordinate (Used for efficiency)
+    currentBoneArea.XMin = std::max(boneMinDepth - this->BoneOutlineDepthPx, 0); // Store the outline's minimum x-coordinate (Used for efficiency)
+    currentBoneArea.YMax = boneAreaStart;                                        // Store the outline's maximum y-coordinate
+    currentBoneArea.YMin = 0;                                                    // Store the outline's minimum y-coordinate
     this->BoneAreasInfo.push_back(currentBoneArea);
-    currentBoneArea.clear();
   }
 }
 
@@ -532,6 +627,12 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
 {
   int fatLayerToCut = 20; //The area of fat too close to the transducer should not be considered
 
+  if (inputImage->GetScalarType() != VTK_UNSIGNED_CHAR || inputImage->GetNumberOfScalarComponents() != 1)
+  {
+    LOG_ERROR("Threshold via standard deviation requires a single component unsigned char image");
+    return;
+  }
+
   float vInput = 0;
   unsigned char* vOutput = 0;
 
@@ -556,10 +657,12 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
     squearSum = 0;
     pixelAverage = 0;
 
+    unsigned char* rowPixels = static_cast<unsigned char*>(inputImage->GetScalarPointer(0, y, 0));
+
     //determine the average, sum, and max of the row
     for (int x = dims[0] - 1; x >= fatLayerToCut; --x)
     {
-      vInput = inputImage->GetScalarComponentAsFloat(x, y, 0, 0);
+      vInput = rowPixels[x];
       pixelSum += vInput;
       squearSum += vInput * vInput;
 
@@ -581,7 +684,7 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
     {
       for (int x = dims[0] - 1; x >= 0; --x)
       {
-        vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
+        vOutput = rowPixels + x;
         if (*vOutput < thresholdValue && *vOutput != 0)
         {
           *vOutput = 0;
@@ -589,6 +692,7 @@ void vtkPlusBoneEnhancer::ThresholdViaStdDeviation(vtkSmartPointer<vtkImageData>
       }
     }
   }
+  inputImage->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -604,17 +708,14 @@ void vtkPlusBoneEnhancer::ImageConjunction(vtkSmartPointer<vtkImageData> InputIm
   for (int y = dims[1] - 1; y >= 0; --y)
   {
     // Initialize variables for a new scan line.
+    inputPixelPointer = static_cast<unsigned char*>(InputImage->GetScalarPointer(0, y, 0));
+    const unsigned char* maskPixelPointer = static_cast<unsigned char*>(MaskImage->GetScalarPointer(0, y, 0));
 
     for (int x = dims[0] - 1; x >= 0; --x)   // Go towards transducer
     {
-      if (static_cast<unsigned char>(MaskImage->GetScalarComponentAsFloat(x, y, 0, 0)) > 0)
-      {
-        //do nothing
-      }
-      else
+      if (maskPixelPointer[x] == 0)
       {
-        inputPixelPointer = static_cast<unsigned char*>(InputImage->GetScalarPointer(x, y, 0));
-        *inputPixelPointer = 0;
+        inputPixelPointer[x] = 0;
       }
     }
   }
@@ -627,6 +728,10 @@ PlusStatus vtkPlusBoneEnhancer::ProcessFrame(igsioTrackedFrame* inputFrame, igsi
 {
   //Process the input into a linear image
   vtkSmartPointer<vtkImageData> intermediateImage = this->UnprocessedFrameToLinearImage(inputFrame);
+  if (intermediateImage == NULL)
+  {
+    return PLUS_FAIL;
+  }
   //Remove noise and mark all possible bones
   this->RemoveNoise(intermediateImage);
   //Reconvert the image back into a fan-image and return it
@@ -658,6 +763,10 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
     this->FirstFrame = false;
   }
   this->BoneAreasInfo.clear();
+  if (this->SaveIntermediateResults)
+  {
+    this->IntermediateImageWriter->StartFrame();
+  }
 
   igsioVideoFrame* inputImage = inputFrame->GetImageData();
   //an image used to transport output between filters
@@ -666,12 +775,15 @@ vtkSmartPointer<vtkImageData> vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage
   //Convert the image to a readable non-fan image
   this->ScanConverter->SetInputData(inputImage->GetImage());
   // Generate lines image.
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateFromFilter("_01Lines_1PreFillLines", this->ScanConverter);
   }
-  this->FillLinesImage(inputImage->GetImage());
-  if (this->SaveIntermediateResults)
+  if (this->FillLinesImage(inputImage->GetImage()) != PLUS_SUCCESS)
+  {
+    return NULL;
+  }
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_01Lines_2FilterEnd", this->LinesImage);
   }
@@ -688,14 +800,14 @@ void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
 
   //Threashold the image based on the standard deviation of a pixel's columns
   this->ThresholdViaStdDeviation(inputImage);
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_02Threshold_1FilterEnd", inputImage);
   }
 
   //Use gaussian smoothing
   this->GaussianSmooth->SetInputData(inputImage);
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateFromFilter("_03Gaussian_1FilterEnd", this->GaussianSmooth);
   }
@@ -703,146 +815,129 @@ void vtkPlusBoneEnhancer::RemoveNoise(vtkSmartPointer<vtkImageData> inputImage)
   //Edge detection
   this->EdgeDetector->SetInputConnection(this->GaussianSmooth->GetOutputPort());
   this->EdgeDetector->Update();
-  this->VectorImageToUchar(this->EdgeDetector->GetOutput());
-  if (this->SaveIntermediateResults)
-  {
-    this->AddIntermediateImage("_04EdgeDetector_1FilterEnd", this->ConversionImage);
-  }
 
-  // Since we perform morphological operations, we must binarize the image
-  this->ImageBinarizer->SetInputData(this->ConversionImage);
-  if (this->SaveIntermediateResults)
+  // Edge magnitude and binarization in one pass, the magnitude image is only needed for the intermediate results
+  this->EdgeImageToBinary(this->EdgeDetector->GetOutput(), this->EdgeMaskImage, this->IsIntermediateFrameCaptured() ? this->ConversionImage.GetPointer() : NULL);
+  if (this->IsIntermediateFrameCaptured())
   {
-    this->AddIntermediateFromFilter("_05BinaryImageForMorphology_1FilterEnd", this->ImageBinarizer);
+    this->AddIntermediateImage("_04EdgeDetector_1FilterEnd", this->ConversionImage);
+    this->AddIntermediateImage("_05BinaryImageForMorphology_1FilterEnd", this->EdgeMaskImage);
   }
 
   //Remove small clusters of pixels
-  this->IslandRemover->SetInputConnection(this->ImageBinarizer->GetOutputPort());
+  this->IslandRemover->SetInputData(this->EdgeMaskImage);
   this->IslandRemover->Update();
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_06Island_1FilterEnd", this->IslandRemover->GetOutput());
   }
 
   //Erode the image
-  this->ImageEroder->SetKernelSize(this->ErosionKernelSize[0], this->ErosionKernelSize[1], 1);
-  this->ImageEroder->SetInputConnection(this->IslandRemover->GetOutputPort());
-  if (this->SaveIntermediateResults)
+  this->ErodeDilate(this->IslandRemover->GetOutput(), this->ErodedImage, this->ErosionKernelSize, 255, 0);
+  if (this->IsIntermediateFrameCaptured())
   {
-    this->AddIntermediateFromFilter("_07Erosion_1FilterEnd", this->ImageEroder);
+    this->AddIntermediateImage("_07Erosion_1FilterEnd", this->ErodedImage);
   }
 
   //Dilate the image
-  this->ImageDialator->SetKernelSize(this->DilationKernelSize[0], this->DilationKernelSize[1], 1);
-  this->ImageDialator->SetInputConnection(this->ImageEroder->GetOutputPort());
-  this->ImageDialator->Update();
-  this->BinaryImageForMorphology->DeepCopy(this->ImageDialator->GetOutput());
-  if (this->SaveIntermediateResults)
+  this->ErodeDilate(this->ErodedImage, this->BinaryImageForMorphology, this->DilationKernelSize, 0, 255);
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_08Dilation_1FilterEnd", this->BinaryImageForMorphology);
   }
 
   //Detect each possible bone area, then subject it to various tests to confirm if it is valid
   this->MarkShadowOutline(this->BinaryImageForMorphology);
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_09PostFilters_1ShadowOutline", this->BinaryImageForMorphology);
   }
 
-  // Save all stored intermediate images to mha files in output
-  if (this->SaveIntermediateResults)
-  {
-    this->SaveAllIntermediateResultsToFile();
-  }
-  
   inputImage->DeepCopy(this->BinaryImageForMorphology);
 }
 
 
 //----------------------------------------------------------------------------
 /*
-Finds and saves all intermediate images that have been recorded.
-Saves the images by calling this->SaveIntermediateResultToFile()
-Returns PLUS_FAIL if this->SaveIntermediateResultToFile() encounters an error occured during this
-process, returns PLUS_SUCCESS otherwise.
+Writes all intermediate images that are still waiting in the write queue and closes the intermediate image files.
+Intermediate images that are added afterwards are written to new files.
+Returns PLUS_FAIL if an error occured while writing any of the files, returns PLUS_SUCCESS otherwise.
 */
 PlusStatus vtkPlusBoneEnhancer::SaveAllIntermediateResultsToFile()
 {
-  for (int postfixIndex = this->IntermediatePostfixes.size() - 1; postfixIndex >= 0; postfixIndex -= 1)
-  {
-    if (this->SaveIntermediateResultToFile(this->IntermediatePostfixes.at(postfixIndex)) == PLUS_FAIL)
-    {
-      return PLUS_FAIL;
-    }
-  }
-  return PLUS_SUCCESS;
+  return this->IntermediateImageWriter->Close();
 }
 
 //----------------------------------------------------------------------------
-/*
-Takes a postfix as an argument and saves the intermediate image associated with that postfix
-Returns PLUS_FAIL if an error occured during this process, returns PLUS_SUCCESS otherwise
-*/
-PlusStatus vtkPlusBoneEnhancer::SaveIntermediateResultToFile(char* fileNamePostfix)
+bool vtkPlusBoneEnhancer::IsIntermediateFrameCaptured()
 {
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> >::iterator indexIterator = this->IntermediateImageMap.find(fileNamePostfix);
-  if (indexIterator != this->IntermediateImageMap.end())
-  {
-    //Try to save the intermediate image
-    if (vtkPlusSequenceIO::Write(this->IntermediateImageFileName + "_Plus" + std::string(fileNamePostfix) + ".mha", this->IntermediateImageMap[fileNamePostfix], US_IMG_ORIENT_MF, false) == PLUS_FAIL)
-    {
-      LOG_ERROR("An issue occured when trying to save the intermediate image with the postfix: " << fileNamePostfix);
-      return PLUS_FAIL;
-    }
-    else
-    {
-      LOG_INFO("Sucessfully wrote the intermediate image with the postfix: " << fileNamePostfix);
-    }
-  }
+  return this->SaveIntermediateResults && this->IntermediateImageWriter->IsCurrentFrameCaptured();
+}
 
-  return PLUS_SUCCESS;
+//----------------------------------------------------------------------------
+// The image is copied, so it can be modified by the following processing steps
+void vtkPlusBoneEnhancer::AddIntermediateImage(const char* fileNamePostfix, vtkSmartPointer<vtkImageData> image)
+{
+  this->IntermediateImageWriter->AddImage(fileNamePostfix, image);
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBoneEnhancer::AddIntermediateImage(char* fileNamePostfix, vtkSmartPointer<vtkImageData> image)
+// Given a vtk filter, get the image that would display at that point and save it
+void vtkPlusBoneEnhancer::AddIntermediateFromFilter(const char* fileNamePostfix, vtkImageAlgorithm* imageFilter)
 {
-  if (fileNamePostfix == "")
-  {
-    LOG_WARNING("The empty string was given as an intermediate image file postfix.");
-  }
+  imageFilter->Update();
+  this->AddIntermediateImage(fileNamePostfix, imageFilter->GetOutput());
+}
 
-  // See if the intermediate image should be created
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> >::iterator indexIterator = this->IntermediateImageMap.find(fileNamePostfix);
-  if (indexIterator != this->IntermediateImageMap.end()){}
-  else
-  {
-    // Create if not found
-    this->IntermediateImageMap[fileNamePostfix] = vtkIGSIOTrackedFrameList::New();
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::SetIntermediateImageFileName(const std::string& fileName)
+{
+  this->IntermediateImageFileName = fileName;
+  this->IntermediateImageWriter->SetFileNamePrefix(fileName);
+}
 
-    this->IntermediatePostfixes.push_back(fileNamePostfix);
-  }
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::SetIntermediateImageFrameStride(int frameStride)
+{
+  this->IntermediateImageWriter->SetFrameStride(frameStride);
+}
 
-  //Add the current frame to its vtkIGSIOTrackedFrameList
-  igsioVideoFrame linesVideoFrame;
-  linesVideoFrame.DeepCopyFrom(image);
-  igsioTrackedFrame linesTrackedFrame;
-  linesTrackedFrame.SetImageData(linesVideoFrame);
-  this->IntermediateImageMap[fileNamePostfix]->AddTrackedFrame(&linesTrackedFrame);
+//----------------------------------------------------------------------------
+int vtkPlusBoneEnhancer::GetIntermediateImageFrameStride()
+{
+  return this->IntermediateImageWriter->GetFrameStride();
 }
 
 //----------------------------------------------------------------------------
-// Given a vtk filter, get the image that would display at that point and save it
-void vtkPlusBoneEnhancer::AddIntermediateFromFilter(char* fileNamePostfix, vtkImageAlgorithm* imageFilter)
+void vtkPlusBoneEnhancer::SetIntermediateImageQueueLength(int queueLength)
 {
-  if (fileNamePostfix == "")
+  // A shorter queue could not hold all the images of a frame, so every frame would be dropped
+  int numberOfStages = this->GetNumberOfIntermediateImageStages();
+  if (queueLength < numberOfStages)
   {
-    LOG_WARNING("The empty string was given as an intermediate image file postfix.");
+    LOG_ERROR("IntermediateImageQueueLength " << queueLength << " is smaller than the number of intermediate images per frame ("
+              << numberOfStages << "). Queue length is set to " << numberOfStages << ".");
+    queueLength = numberOfStages;
   }
+  this->IntermediateImageWriter->SetMaximumQueueLength(queueLength);
+}
 
-  vtkSmartPointer<vtkImageData> tempOutputImage = vtkSmartPointer<vtkImageData>::New();
-  imageFilter->SetOutput(tempOutputImage);
-  imageFilter->Update();
-  this->AddIntermediateImage(fileNamePostfix, tempOutputImage);
+//----------------------------------------------------------------------------
+int vtkPlusBoneEnhancer::GetIntermediateImageQueueLength()
+{
+  return this->IntermediateImageWriter->GetMaximumQueueLength();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBoneEnhancer::SetIntermediateImageDropFramesWhenQueueFull(bool dropFrames)
+{
+  this->IntermediateImageWriter->SetDropFramesWhenQueueFull(dropFrames);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBoneEnhancer::GetIntermediateImageDropFramesWhenQueueFull()
+{
+  return this->IntermediateImageWriter->GetDropFramesWhenQueueFull();
 }
 
 //----------------------------------------------------------------------------
@@ -16,12 +16,14 @@ See License.txt for details.
 #include <vtkSmartPointer.h>
 #include <vtkSetGet.h>
 
+// STL includes
+#include <vector>
+
 class vtkImageData;
-class vtkImageThreshold;
 class vtkImageGaussianSmooth;
 class vtkImageSobel2D;
 class vtkImageIslandRemoval2D;
-class vtkImageDilateErode3D;
+class vtkPlusIntermediateImageWriter;
 class vtkPlusUsScanConvert;
 
 /*!
@@ -48,10 +50,32 @@ public:
   /*! Get the Type attribute of the configuration element */
   virtual const char* GetProcessorTypeName() { return "vtkPlusBoneEnhancer"; };
 
-  /*! If optional output files for intermediate images should saved */
-  vtkSetMacro(IntermediateImageFileName, std::string);
+  /*!
+    If optional output files for intermediate images should saved.
+    Intermediate images are streamed to <IntermediateImageFileName>_Plus<step>.mha files during processing,
+    so the file name must be set before the first frame is processed.
+  */
+  void SetIntermediateImageFileName(const std::string& fileName);
   vtkSetMacro(SaveIntermediateResults, bool);
   vtkGetMacro(SaveIntermediateResults, bool);
+
+  /*! Save the intermediate images of every n-th frame only (1 = save all frames) */
+  void SetIntermediateImageFrameStride(int frameStride);
+  int GetIntermediateImageFrameStride();
+
+  /*!
+    Maximum number of intermediate images waiting to be written. Further frames are dropped (in all stages) until the queue is processed.
+    The queue must hold the images of at least one frame, a shorter queue length is rejected with an error and clamped.
+  */
+  void SetIntermediateImageQueueLength(int queueLength);
+  int GetIntermediateImageQueueLength();
+
+  /*! If disabled then processing waits for the intermediate images to be written instead of dropping frames (enabled by default) */
+  void SetIntermediateImageDropFramesWhenQueueFull(bool dropFrames);
+  bool GetIntermediateImageDropFramesWhenQueueFull();
+
+  /*! Number of intermediate images that are saved per processed frame */
+  virtual int GetNumberOfIntermediateImageStages() { return 10; };
   
   /*! Get and Set methods for variables related to the scanner used */
   vtkSetMacro(NumberOfScanLines, int);
@@ -92,28 +116,44 @@ public:
   vtkImageData* GetProcessedLinesImage() { return (this->ProcessedLinesImage); }
 
   void RemoveNoise(vtkSmartPointer<vtkImageData> inputImage);
+  /*! Returns the lines image of the input frame, or NULL if the scanlines cannot be extracted */
   vtkSmartPointer<vtkImageData> UnprocessedFrameToLinearImage(igsioTrackedFrame* inputFrame);
   void LinearToFanImage(vtkSmartPointer<vtkImageData> inputImage, igsioTrackedFrame* outputFrame);
 
   /*! Steps to note and eliminate false boen areas */
   void MarkShadowOutline(vtkSmartPointer<vtkImageData> inputImage);
 
-  /*! Methods related to intermediate images */
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> > GetIntermediateImageMap() { return (this->IntermediateImageMap); };
+  /*!
+    Morphological erosion/dilation of an unsigned char image, with the same result as vtkImageDilateErode3D
+    with a (kernelSize[0], kernelSize[1], 1) kernel: pixels with erodeValue are replaced by dilateValue
+    if any pixel with dilateValue is inside the elliptical kernel footprint, all other pixels are copied.
+    Neighbor lookups use per-row running counts, so the cost does not depend on the kernel width.
+    The output image is (re)allocated if its extent does not match the input.
+  */
+  PlusStatus ErodeDilate(vtkImageData* inputImage, vtkImageData* outputImage, const int kernelSize[2], unsigned char erodeValue, unsigned char dilateValue);
+
+  /*! Write all pending intermediate images and close the intermediate image files */
   PlusStatus SaveAllIntermediateResultsToFile();
-  PlusStatus SaveIntermediateResultToFile(char* fileNamePostfix);
 
 protected:
   vtkPlusBoneEnhancer();
   virtual ~vtkPlusBoneEnhancer();
 
-  void FillLinesImage(vtkSmartPointer<vtkImageData> inputImageData);
-  void VectorImageToUchar(vtkSmartPointer<vtkImageData> inputImage);
+  PlusStatus FillLinesImage(vtkSmartPointer<vtkImageData> inputImageData);
+
+  /*!
+    Converts the edge detector output to an approximate gradient magnitude and binarizes it for the morphological
+    operations, in a single pass. The magnitude is only stored if magnitudeImage is not NULL (intermediate results).
+  */
+  void EdgeImageToBinary(vtkImageData* edgeImage, vtkImageData* binaryImage, vtkImageData* magnitudeImage);
 
   void ImageConjunction(vtkSmartPointer<vtkImageData> inputImage, vtkSmartPointer<vtkImageData> maskImage);
 
-  void AddIntermediateImage(char* fileNamePostfix, vtkSmartPointer<vtkImageData> image);
-  void AddIntermediateFromFilter(char* fileNamePostfix, vtkImageAlgorithm* imageAlgorithm);
+  /*! Returns true if intermediate images of the current frame are saved (SaveIntermediateResults and frame stride) */
+  bool IsIntermediateFrameCaptured();
+
+  void AddIntermediateImage(const char* fileNamePostfix, vtkSmartPointer<vtkImageData> image);
+  void AddIntermediateFromFilter(const char* fileNamePostfix, vtkImageAlgorithm* imageAlgorithm);
 
   virtual PlusStatus ProcessImageExtents();
 
@@ -121,11 +161,15 @@ protected:
   vtkSmartPointer<vtkPlusUsScanConvert>     ScanConverter;
   vtkSmartPointer<vtkImageGaussianSmooth>   GaussianSmooth; // Trying to incorporate existing GaussianSmooth vtkThreadedAlgorithm class
   vtkSmartPointer<vtkImageSobel2D>          EdgeDetector;
-  vtkSmartPointer<vtkImageThreshold>        ImageBinarizer;
   vtkSmartPointer<vtkImageData>             BinaryImageForMorphology;
   vtkSmartPointer<vtkImageIslandRemoval2D>  IslandRemover;
-  vtkSmartPointer<vtkImageDilateErode3D>    ImageEroder;
-  vtkSmartPointer<vtkImageDilateErode3D>    ImageDialator;
+
+  /*! Scratch images (uchar) of the noise removal steps, allocated once for the lines image extent */
+  vtkSmartPointer<vtkImageData>             EdgeMaskImage;
+  vtkSmartPointer<vtkImageData>             ErodedImage;
+
+  /*! Per-row running count of kernel hit pixels, used by ErodeDilate */
+  std::vector<int>                          MorphologyRowCounts;
 
   int NumberOfScanLines;
   int NumberOfSamplesPerScanLine;
@@ -152,17 +196,27 @@ protected:
 
   bool SaveIntermediateResults;
   std::string IntermediateImageFileName;
-  std::vector<char*> IntermediatePostfixes;
 
-  /*! Image after some of the processing operations have been applied */
-  std::map<char*, vtkSmartPointer<vtkIGSIOTrackedFrameList> > IntermediateImageMap;
+  /*! Writes the images after some of the processing operations have been applied */
+  vtkSmartPointer<vtkPlusIntermediateImageWriter> IntermediateImageWriter;
 
   /*! Image for pixels (uchar) along scan lines only */
   vtkSmartPointer<vtkImageData> LinesImage;
   /*! Pixels (float) store probability of belonging to shadow */
   vtkSmartPointer<vtkImageData> ProcessedLinesImage;
 
-  std::vector<std::map<std::string, int> > BoneAreasInfo;
+  /*! Location of a possible bone outline in the lines image, found by MarkShadowOutline */
+  struct BoneArea
+  {
+    int Depth;  // Average x-coordinate of the outline
+    int XMin;   // Minimum x-coordinate of the outline, extended by the outline depth
+    int XMax;   // Maximum x-coordinate of the outline
+    int YMin;   // Minimum y-coordinate of the outline
+    int YMax;   // Maximum y-coordinate of the outline
+  };
+
+  /*! Bone areas of the current frame. The vector is cleared at each frame but its storage is reused. */
+  std::vector<BoneArea> BoneAreasInfo;
   bool FirstFrame;
 
 private:
@@ -15,24 +15,52 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkImageData.h>
 #include <vtkDoubleArray.h>
+#include <vtkSMPTools.h>
 #include <vtkTimerLog.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 
 // Other includes
-#include "mkl.h"
-#ifdef NDEBUG
+#ifdef PLUS_USE_INTEL_MKL
+  #include "mkl.h"
+#endif
+#if defined(NDEBUG) && defined(_OPENMP)
   #include <omp.h>
 #endif
 
-#define MKL_FREE_IF_NULL(var) \
+#define FREE_BUFFER_IF_NOT_NULL(var) \
   if (var != NULL) \
   { \
-    mkl_free(var); \
+    FreeBuffer(var); \
     var = NULL; \
   }
 
+namespace
+{
+  //----------------------------------------------------------------------------
+  double* AllocateBuffer(size_t numberOfElements)
+  {
+#ifdef PLUS_USE_INTEL_MKL
+    // Allocating memory for matrices aligned on 64-byte boundary for better performance
+    return static_cast<double*>(mkl_malloc(numberOfElements * sizeof(double), 64));
+#else
+    return new double[numberOfElements];
+#endif
+  }
+
+  //----------------------------------------------------------------------------
+  void FreeBuffer(double* buffer)
+  {
+#ifdef PLUS_USE_INTEL_MKL
+    mkl_free(buffer);
+#else
+    delete[] buffer;
+#endif
+  }
+}
+
 vtkStandardNewMacro(vtkPlusForoughiBoneSurfaceProbability);
 
 //----------------------------------------------------------------------------
@@ -44,23 +72,33 @@ vtkPlusForoughiBoneSurfaceProbability::vtkPlusForoughiBoneSurfaceProbability()
   this->ShadowVSIntensity = 5;
   this->SmoothingSigma = 5.0;
   this->TransducerMargin = 60;
+  this->FastShadowComputation = true;
+#ifdef PLUS_USE_INTEL_MKL
+  this->UseIntelMkl = true;
+#else
+  this->UseIntelMkl = false;
+#endif
 
   this->KernelUpdateRequested = true;
 
   this->GaussianKernelSize = 0;
+  this->ShadowModelSaturationIndex = 0;
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
   this->FrameSize[2] = 1;
 
-  this->MklGaussianBuffer = NULL;
-  this->MklLaplacianOfGaussianBuffer = NULL;
-  this->MklGaussianBufferTemp = NULL;
-  this->MklLaplacianOfGaussianBufferTemp = NULL;
-  this->MklReflectionNumberBuffer = NULL;
-  this->MklShadowValueBuffer = NULL;
-  this->MklShadowModel = NULL;
-  this->MklGaussianKernel = NULL;
-  this->MklLaplacianKernel = NULL;
+  this->GaussianBuffer = NULL;
+  this->LaplacianOfGaussianBuffer = NULL;
+  this->GaussianBufferTemp = NULL;
+  this->LaplacianOfGaussianBufferTemp = NULL;
+  this->ReflectionNumberBuffer = NULL;
+  this->ShadowValueBuffer = NULL;
+  this->ShadowModel = NULL;
+  this->ShadowModelCumulativeSum = NULL;
+  this->ColumnSuffixSumBuffer = NULL;
+  this->GaussianKernel = NULL;
+  this->GaussianKernel1D = NULL;
+  this->LaplacianKernel = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -91,6 +129,13 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     this->FrameSize[2] = 1;
     this->KernelUpdateRequested = true;
   }
+#ifndef PLUS_USE_INTEL_MKL
+  if (this->UseIntelMkl)
+  {
+    LOG_WARNING("Intel MKL backend is requested but Plus was built without Intel MKL support (PLUS_USE_INTEL_MKL). The portable implementation is used instead.");
+    this->UseIntelMkl = false;
+  }
+#endif
   if (this->KernelUpdateRequested)
   {
     UpdateKernels();
@@ -117,28 +162,57 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
     {
       // Convolve with Gaussian kernel and normalize result between zero and one
       timer->StartTimer();
-      Conv2(inputSlicePtr, this->MklGaussianKernel, this->MklGaussianBufferTemp, this->MklGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), this->GaussianKernelSize, this->GaussianKernelSize);
+#ifdef PLUS_USE_INTEL_MKL
+      if (this->UseIntelMkl)
+      {
+        Conv2(inputSlicePtr, this->GaussianKernel, this->GaussianBufferTemp, this->GaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), this->GaussianKernelSize, this->GaussianKernelSize);
+      }
+      else
+#endif
+      {
+        GaussianBlur(inputSlicePtr, this->GaussianBufferTemp, this->GaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]));
+      }
       timer->StopTimer();
       LOG_INFO("Conv2 1: " << timer->GetElapsedTime());
 
       timer->StartTimer();
-      Normalize(this->MklGaussianBuffer, sliceSize, false);
+      Normalize(this->GaussianBuffer, sliceSize, false);
       timer->StopTimer();
       LOG_INFO("Normalize 1: " << timer->GetElapsedTime());
 
       // Convolve blurred image with Laplacian kernel
       timer->StartTimer();
-      Conv2(this->MklGaussianBuffer, this->MklLaplacianKernel, this->MklLaplacianOfGaussianBufferTemp, this->MklLaplacianOfGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), 3, 3);
+#ifdef PLUS_USE_INTEL_MKL
+      if (this->UseIntelMkl)
+      {
+        Conv2(this->GaussianBuffer, this->LaplacianKernel, this->LaplacianOfGaussianBufferTemp, this->LaplacianOfGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]), 3, 3);
+      }
+      else
+#endif
+      {
+        Laplacian(this->GaussianBuffer, this->LaplacianOfGaussianBuffer, static_cast<int>(this->FrameSize[0]), static_cast<int>(this->FrameSize[1]));
+      }
       timer->StopTimer();
       LOG_INFO("Conv2 2: " << timer->GetElapsedTime());
 
+      // Sum of each blurred image column from each row to the bottom, for computing the saturated part of the shadow values
+      if (this->FastShadowComputation)
+      {
+        timer->StartTimer();
+        ComputeColumnSuffixSums(this->GaussianBuffer, this->ColumnSuffixSumBuffer, static_cast<int>(nx), static_cast<int>(ny));
+        timer->StopTimer();
+        LOG_INFO("Column sums: " << timer->GetElapsedTime());
+      }
+
       // Main loop calculating reflection number and shadow value
       timer->StartTimer();
       double sumG = 0;
       double sumGI = 0;
       double sumHist = 0;
       int i, pixelIdx, x, y;
-#ifdef NDEBUG
+      // Shadow model elements are zero from this index
+      const int shadowModelLength = std::max(static_cast<int>(ny) - 5, 0);
+#if defined(NDEBUG) && defined(_OPENMP)
       #pragma omp parallel for reduction(+:sumG,sumGI, sumHist), private(i, x, pixelIdx)
 #endif
       for (y = 0; y < ny; ++y)
@@ -148,36 +222,55 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
           pixelIdx = x + y * nx;
 
           // Only include pixels with intensity value larger than a specified threshold
-          if (this->MklGaussianBuffer[pixelIdx] >= this->BoneThreshold && pixelIdx > this->TransducerMargin * nx)
+          if (this->GaussianBuffer[pixelIdx] >= this->BoneThreshold && pixelIdx > this->TransducerMargin * nx)
           {
             // Set outermost border pixels to zero and exclude negative pixels
-            if ((x == nx - 1 || x == 0 || y == ny - 1 || y == 0) || this->MklLaplacianOfGaussianBuffer[pixelIdx] <= 0)
+            if ((x == nx - 1 || x == 0 || y == ny - 1 || y == 0) || this->LaplacianOfGaussianBuffer[pixelIdx] <= 0)
             {
-              this->MklLaplacianOfGaussianBuffer[pixelIdx] = 0.0;
+              this->LaplacianOfGaussianBuffer[pixelIdx] = 0.0;
             }
             else
             {
               // Divide by small number to increase image intensity (What! :)
-              this->MklLaplacianOfGaussianBuffer[pixelIdx] = this->MklLaplacianOfGaussianBuffer[pixelIdx] / 0.005;
+              this->LaplacianOfGaussianBuffer[pixelIdx] = this->LaplacianOfGaussianBuffer[pixelIdx] / 0.005;
             }
 
             // Calculate reflection number
-            this->MklReflectionNumberBuffer[pixelIdx] = pow(this->MklGaussianBuffer[pixelIdx], this->BlurredVSBLoG) + this->MklLaplacianOfGaussianBuffer[pixelIdx];
+            this->ReflectionNumberBuffer[pixelIdx] = pow(this->GaussianBuffer[pixelIdx], this->BlurredVSBLoG) + this->LaplacianOfGaussianBuffer[pixelIdx];
 
             // Calculate shadow value
-            sumG = 0;
-            sumGI = 0;
-            for (i = y; i < ny; ++i)
+            if (this->FastShadowComputation)
+            {
+              // Weighted sum over the unsaturated part of the model, plain column sum where the model is exactly 1
+              int numberOfWeights = std::min(static_cast<int>(ny) - y, shadowModelLength);
+              int numberOfUnsaturatedWeights = std::min(numberOfWeights, this->ShadowModelSaturationIndex);
+              sumGI = 0;
+              for (i = 0; i < numberOfUnsaturatedWeights; ++i)
+              {
+                sumGI += this->ShadowModel[i] * this->GaussianBuffer[x + (y + i) * nx];
+              }
+              if (numberOfWeights > numberOfUnsaturatedWeights)
+              {
+                sumGI += this->ColumnSuffixSumBuffer[x + (y + numberOfUnsaturatedWeights) * nx] - this->ColumnSuffixSumBuffer[x + (y + numberOfWeights) * nx];
+              }
+              sumG = this->ShadowModelCumulativeSum[ny - y];
+            }
+            else
             {
-              sumG += this->MklShadowModel[i - y];
-              sumGI += this->MklShadowModel[i - y] * this->MklGaussianBuffer[x + i * nx];
+              sumG = 0;
+              sumGI = 0;
+              for (i = y; i < ny; ++i)
+              {
+                sumG += this->ShadowModel[i - y];
+                sumGI += this->ShadowModel[i - y] * this->GaussianBuffer[x + i * nx];
+              }
             }
-            this->MklShadowValueBuffer[pixelIdx] = sumGI / sumG;
+            this->ShadowValueBuffer[pixelIdx] = sumGI / sumG;
           }
           else
           {
-            this->MklReflectionNumberBuffer[pixelIdx] = 0.0;
-            this->MklShadowValueBuffer[pixelIdx] = 0.0;
+            this->ReflectionNumberBuffer[pixelIdx] = 0.0;
+            this->ShadowValueBuffer[pixelIdx] = 0.0;
           }
         }
       }
@@ -187,15 +280,24 @@ void vtkPlusForoughiBoneSurfaceProbability::SimpleExecute(vtkImageData* input, v
 
       // Normalize both reflection numbers and shadow values
       timer->StartTimer();
-      Normalize(this->MklReflectionNumberBuffer, sliceSize, false);
-      Normalize(this->MklShadowValueBuffer, sliceSize, true);
+      Normalize(this->ReflectionNumberBuffer, sliceSize, false);
+      Normalize(this->ShadowValueBuffer, sliceSize, true);
       timer->StopTimer();
       LOG_INFO("Normalize 2x: " << timer->GetElapsedTime());
 
       // Calculate BSP
       timer->StartTimer();
-      vdPowx(sliceSize, this->MklShadowValueBuffer, this->ShadowVSIntensity, this->MklShadowValueBuffer);
-      vdMul(sliceSize, this->MklShadowValueBuffer, this->MklReflectionNumberBuffer, outputSlicePtr);
+#ifdef PLUS_USE_INTEL_MKL
+      if (this->UseIntelMkl)
+      {
+        vdPowx(sliceSize, this->ShadowValueBuffer, this->ShadowVSIntensity, this->ShadowValueBuffer);
+        vdMul(sliceSize, this->ShadowValueBuffer, this->ReflectionNumberBuffer, outputSlicePtr);
+      }
+      else
+#endif
+      {
+        PowerAndMultiply(this->ShadowValueBuffer, this->ShadowVSIntensity, this->ReflectionNumberBuffer, outputSlicePtr, static_cast<int>(sliceSize));
+      }
       timer->StopTimer();
       LOG_INFO("Non-linear transform: " << timer->GetElapsedTime());
 
@@ -215,30 +317,47 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
 
   this->GaussianKernelSize = floor(this->SmoothingSigma * 3) * 2 + 1;
 
-  // Allocating memory for matrices aligned on 64-byte boundary for better performance
-  this->MklGaussianBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
-  this->MklLaplacianOfGaussianBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
-  this->MklGaussianBufferTemp = (double*)mkl_malloc((this->FrameSize[0] + GaussianKernelSize - 1) * (this->FrameSize[1]  + GaussianKernelSize - 1) * sizeof(double), 64);
-  this->MklLaplacianOfGaussianBufferTemp = (double*)mkl_malloc((this->FrameSize[0] + 2) * (this->FrameSize[1]  + 2) * sizeof(double), 64);
-  this->MklReflectionNumberBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
-  this->MklShadowValueBuffer = (double*)mkl_malloc(this->FrameSize[0] * this->FrameSize[1] * sizeof(double), 64);
-  this->MklShadowModel = (double*)mkl_malloc(this->FrameSize[1] * sizeof(double), 64);
-  this->MklGaussianKernel = (double*)mkl_malloc(GaussianKernelSize * GaussianKernelSize * sizeof(double), 64);
-  this->MklLaplacianKernel = (double*)mkl_malloc(3 * 3 * sizeof(double), 64);
+  this->GaussianBuffer = AllocateBuffer(this->FrameSize[0] * this->FrameSize[1]);
+  this->LaplacianOfGaussianBuffer = AllocateBuffer(this->FrameSize[0] * this->FrameSize[1]);
+  this->GaussianBufferTemp = AllocateBuffer((this->FrameSize[0] + GaussianKernelSize - 1) * (this->FrameSize[1]  + GaussianKernelSize - 1));
+  this->LaplacianOfGaussianBufferTemp = AllocateBuffer((this->FrameSize[0] + 2) * (this->FrameSize[1]  + 2));
+  this->ReflectionNumberBuffer = AllocateBuffer(this->FrameSize[0] * this->FrameSize[1]);
+  this->ShadowValueBuffer = AllocateBuffer(this->FrameSize[0] * this->FrameSize[1]);
+  this->ShadowModel = AllocateBuffer(this->FrameSize[1]);
+  this->ShadowModelCumulativeSum = AllocateBuffer((this->FrameSize[1] + 1));
+  this->ColumnSuffixSumBuffer = AllocateBuffer(this->FrameSize[0] * (this->FrameSize[1] + 1));
+  this->GaussianKernel = AllocateBuffer(GaussianKernelSize * GaussianKernelSize);
+  this->LaplacianKernel = AllocateBuffer(3 * 3);
+  this->GaussianKernel1D = AllocateBuffer(GaussianKernelSize);
 
   // Calculate shadow model
   for (int i = 0; i < this->FrameSize[1]; ++i)
   {
     if (i < this->FrameSize[1] - 5)
     {
-      this->MklShadowModel[i] = 1 - exp(- (i * i - 1) / (2 * this->ShadowSigma * this->ShadowSigma));
+      this->ShadowModel[i] = 1 - exp(- (i * i - 1) / (2 * this->ShadowSigma * this->ShadowSigma));
     }
     else
     {
-      this->MklShadowModel[i] = 0.0;
+      this->ShadowModel[i] = 0.0;
     }
   }
 
+  // Sums of the shadow model, accumulated in the same order as in the direct summation, so sumG is exactly the same
+  this->ShadowModelCumulativeSum[0] = 0.0;
+  for (int i = 0; i < this->FrameSize[1]; ++i)
+  {
+    this->ShadowModelCumulativeSum[i + 1] = this->ShadowModelCumulativeSum[i] + this->ShadowModel[i];
+  }
+
+  // The model converges to 1 quickly (1-exp(-i^2/(2*sigma^2)) is exactly 1.0 in double precision after a few sigmas),
+  // from there the weighted sum is a plain column sum
+  this->ShadowModelSaturationIndex = std::max(static_cast<int>(this->FrameSize[1]) - 5, 0);
+  while (this->ShadowModelSaturationIndex > 0 && this->ShadowModel[this->ShadowModelSaturationIndex - 1] == 1.0)
+  {
+    --this->ShadowModelSaturationIndex;
+  }
+
   // Calculate Gaussian kernel
   int idx = 0;
   int intervall = (GaussianKernelSize - 1) / 2;
@@ -246,38 +365,49 @@ void vtkPlusForoughiBoneSurfaceProbability::UpdateKernels()
   {
     for (double y = -intervall; y <= intervall; ++y)
     {
-      this->MklGaussianKernel [idx] = exp(-((x * x) / (2 * this->SmoothingSigma * this->SmoothingSigma) + (y * y) / (2 * this->SmoothingSigma * this->SmoothingSigma)));
+      this->GaussianKernel [idx] = exp(-((x * x) / (2 * this->SmoothingSigma * this->SmoothingSigma) + (y * y) / (2 * this->SmoothingSigma * this->SmoothingSigma)));
       ++idx;
     }
   }
 
+  // The Gaussian kernel is separable, the portable implementation filters rows and columns with the same 1D kernel
+  for (int i = 0; i < GaussianKernelSize; ++i)
+  {
+    double x = i - intervall;
+    this->GaussianKernel1D[i] = exp(-(x * x) / (2 * this->SmoothingSigma * this->SmoothingSigma));
+  }
+
   // Calculate Laplacian kernel
-  this->MklLaplacianKernel[0] = 0;
-  this->MklLaplacianKernel[1] = -1;
-  this->MklLaplacianKernel[2] = 0;
-  this->MklLaplacianKernel[3] = -1;
-  this->MklLaplacianKernel[4] = 4;
-  this->MklLaplacianKernel[5] = -1;
-  this->MklLaplacianKernel[6] = 0;
-  this->MklLaplacianKernel[7] = -1;
-  this->MklLaplacianKernel[8] = 0;
+  this->LaplacianKernel[0] = 0;
+  this->LaplacianKernel[1] = -1;
+  this->LaplacianKernel[2] = 0;
+  this->LaplacianKernel[3] = -1;
+  this->LaplacianKernel[4] = 4;
+  this->LaplacianKernel[5] = -1;
+  this->LaplacianKernel[6] = 0;
+  this->LaplacianKernel[7] = -1;
+  this->LaplacianKernel[8] = 0;
 }
 
 //-----------------------------------------------------------------------------
 void vtkPlusForoughiBoneSurfaceProbability::DeleteKernels()
 {
   // Free memory
-  MKL_FREE_IF_NULL(this->MklGaussianBuffer);
-  MKL_FREE_IF_NULL(this->MklLaplacianOfGaussianBuffer);
-  MKL_FREE_IF_NULL(this->MklGaussianBufferTemp);
-  MKL_FREE_IF_NULL(this->MklLaplacianOfGaussianBufferTemp);
-  MKL_FREE_IF_NULL(this->MklReflectionNumberBuffer);
-  MKL_FREE_IF_NULL(this->MklShadowValueBuffer);
-  MKL_FREE_IF_NULL(this->MklShadowModel);
-  MKL_FREE_IF_NULL(this->MklGaussianKernel);
-  MKL_FREE_IF_NULL(this->MklLaplacianKernel);
+  FREE_BUFFER_IF_NOT_NULL(this->GaussianBuffer);
+  FREE_BUFFER_IF_NOT_NULL(this->LaplacianOfGaussianBuffer);
+  FREE_BUFFER_IF_NOT_NULL(this->GaussianBufferTemp);
+  FREE_BUFFER_IF_NOT_NULL(this->LaplacianOfGaussianBufferTemp);
+  FREE_BUFFER_IF_NOT_NULL(this->ReflectionNumberBuffer);
+  FREE_BUFFER_IF_NOT_NULL(this->ShadowValueBuffer);
+  FREE_BUFFER_IF_NOT_NULL(this->ShadowModel);
+  FREE_BUFFER_IF_NOT_NULL(this->ShadowModelCumulativeSum);
+  FREE_BUFFER_IF_NOT_NULL(this->ColumnSuffixSumBuffer);
+  FREE_BUFFER_IF_NOT_NULL(this->GaussianKernel);
+  FREE_BUFFER_IF_NOT_NULL(this->LaplacianKernel);
+  FREE_BUFFER_IF_NOT_NULL(this->GaussianKernel1D);
 }
 
+#ifdef PLUS_USE_INTEL_MKL
 //-----------------------------------------------------------------------------
 // Performs a 2D convolution using Intel MKL defined by the kernel buffer.
 void vtkPlusForoughiBoneSurfaceProbability::Conv2(const double* inputBuffer, const double* kernelBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny, int kx, int ky)
@@ -298,6 +428,115 @@ void vtkPlusForoughiBoneSurfaceProbability::Conv2(const double* inputBuffer, con
   timer->StopTimer();
   LOG_INFO("Resizematrix: " << timer->GetElapsedTime());
 }
+#endif
+
+//-----------------------------------------------------------------------------
+// Same result as Conv2 with the 2D Gaussian kernel (zero padding, output cropped to the input size), computed by two 1D passes
+void vtkPlusForoughiBoneSurfaceProbability::GaussianBlur(const double* inputBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny)
+{
+  const double* kernel = this->GaussianKernel1D;
+  const int radius = (this->GaussianKernelSize - 1) / 2;
+
+  // Filter rows
+  auto filterRows = [ = ](vtkIdType beginRow, vtkIdType endRow)
+  {
+    for (vtkIdType y = beginRow; y < endRow; ++y)
+    {
+      const double* inputRow = inputBuffer + y * nx;
+      double* outputRow = tempBuffer + y * nx;
+      for (int x = 0; x < nx; ++x)
+      {
+        int firstOffset = std::max(-radius, x - (nx - 1));
+        int lastOffset = std::min(radius, x);
+        double sum = 0.0;
+        for (int offset = firstOffset; offset <= lastOffset; ++offset)
+        {
+          sum += kernel[offset + radius] * inputRow[x - offset];
+        }
+        outputRow[x] = sum;
+      }
+    }
+  };
+  vtkSMPTools::For(0, ny, filterRows);
+
+  // Filter columns, processing whole rows to keep memory access sequential
+  auto filterColumns = [ = ](vtkIdType beginRow, vtkIdType endRow)
+  {
+    for (vtkIdType y = beginRow; y < endRow; ++y)
+    {
+      double* outputRow = outputBuffer + y * nx;
+      for (int x = 0; x < nx; ++x)
+      {
+        outputRow[x] = 0.0;
+      }
+      int firstOffset = std::max(-radius, static_cast<int>(y) - (ny - 1));
+      int lastOffset = std::min(radius, static_cast<int>(y));
+      for (int offset = firstOffset; offset <= lastOffset; ++offset)
+      {
+        const double weight = kernel[offset + radius];
+        const double* inputRow = tempBuffer + (y - offset) * nx;
+        for (int x = 0; x < nx; ++x)
+        {
+          outputRow[x] += weight * inputRow[x];
+        }
+      }
+    }
+  };
+  vtkSMPTools::For(0, ny, filterColumns);
+}
+
+//-----------------------------------------------------------------------------
+// Same result as Conv2 with the 3x3 Laplacian kernel (zero padding, output cropped to the input size)
+void vtkPlusForoughiBoneSurfaceProbability::Laplacian(const double* inputBuffer, double* outputBuffer, int nx, int ny)
+{
+  auto filterRows = [ = ](vtkIdType beginRow, vtkIdType endRow)
+  {
+    for (vtkIdType y = beginRow; y < endRow; ++y)
+    {
+      const double* row = inputBuffer + y * nx;
+      const double* rowAbove = (y > 0) ? row - nx : NULL;
+      const double* rowBelow = (y < ny - 1) ? row + nx : NULL;
+      double* outputRow = outputBuffer + y * nx;
+      for (int x = 0; x < nx; ++x)
+      {
+        double value = 4 * row[x];
+        if (x > 0)
+        {
+          value -= row[x - 1];
+        }
+        if (x < nx - 1)
+        {
+          value -= row[x + 1];
+        }
+        if (rowAbove != NULL)
+        {
+          value -= rowAbove[x];
+        }
+        if (rowBelow != NULL)
+        {
+          value -= rowBelow[x];
+        }
+        outputRow[x] = value;
+      }
+    }
+  };
+  vtkSMPTools::For(0, ny, filterRows);
+}
+
+//-----------------------------------------------------------------------------
+// Same result as vdPowx followed by vdMul
+void vtkPlusForoughiBoneSurfaceProbability::PowerAndMultiply(double* baseBuffer, double exponent, const double* factorBuffer, double* outputBuffer, int size)
+{
+  auto computeRange = [ = ](vtkIdType begin, vtkIdType end)
+  {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      baseBuffer[i] = pow(baseBuffer[i], exponent);
+      outputBuffer[i] = baseBuffer[i] * factorBuffer[i];
+    }
+  };
+  vtkSMPTools::For(0, size, computeRange);
+}
 
 //-----------------------------------------------------------------------------
 void vtkPlusForoughiBoneSurfaceProbability::ResizeMatrix(const double* inputBuffer, double* outputBuffer, int xClipping, int yClipping, int xInputSize, int yInputSize)
@@ -321,6 +560,27 @@ void vtkPlusForoughiBoneSurfaceProbability::ResizeMatrix(const double* inputBuff
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusForoughiBoneSurfaceProbability::ComputeColumnSuffixSums(const double* inputBuffer, double* suffixSumBuffer, int nx, int ny)
+{
+  // Row ny is all zero, each row above adds the corresponding image row (processing whole rows keeps memory access sequential)
+  double* lastRow = suffixSumBuffer + ny * nx;
+  for (int x = 0; x < nx; ++x)
+  {
+    lastRow[x] = 0.0;
+  }
+  for (int y = ny - 1; y >= 0; --y)
+  {
+    const double* inputRow = inputBuffer + y * nx;
+    const double* belowRow = suffixSumBuffer + (y + 1) * nx;
+    double* row = suffixSumBuffer + y * nx;
+    for (int x = 0; x < nx; ++x)
+    {
+      row[x] = belowRow[x] + inputRow[x];
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 double vtkPlusForoughiBoneSurfaceProbability::GetMaxPixelValue(const double* buffer, int size)
 {
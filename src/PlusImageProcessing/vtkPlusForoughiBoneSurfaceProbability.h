@@ -18,9 +18,11 @@ Foroughi, P., et al. (2007) Ultrasound bone segmentation using dynamic programmi
 
 Implemented (with some modifications) by Mikael Brudfors, March 2014.
 
-The *Intel MKL* code uses double data at this moment, therefore input and output must be double scalar type image.
+The filter uses double data at this moment, therefore input and output must be double scalar type image.
 
-The module uses *OpenMP* and *Intel MKL*. A free trial of *Intel MKL* can be downloaded from here:
+The filter has a portable implementation (separable Gaussian filtering, 3x3 Laplacian stencil, parallelized by vtkSMPTools)
+and an implementation that uses *Intel MKL* for the convolutions and the vector operations. The Intel MKL implementation
+is available if Plus is built with PLUS_USE_INTEL_MKL enabled (it also enables *OpenMP*). A free trial of *Intel MKL* can be downloaded from here:
 
 [https://software.intel.com/en-us/intel-mkl/try-buy](https://software.intel.com/en-us/intel-mkl/try-buy)
 
@@ -62,6 +64,23 @@ public:
   vtkSetMacro(TransducerMargin, int);
   vtkGetMacro(TransducerMargin, int);
 
+  /*!
+    If enabled then the shadow value is computed from per-column sums in the part of the shadow model that is saturated to 1,
+    which makes the computation linear in the image height. The result matches the direct weighted sum within floating-point tolerance.
+    Enabled by default, the direct summation is kept for comparison.
+  */
+  vtkSetMacro(FastShadowComputation, bool);
+  vtkGetMacro(FastShadowComputation, bool);
+  vtkBooleanMacro(FastShadowComputation, bool);
+
+  /*!
+    Use Intel MKL for convolutions and vector operations. Enabled by default if Plus is built with Intel MKL support.
+    If Intel MKL is not available then the portable implementation is used.
+  */
+  vtkSetMacro(UseIntelMkl, bool);
+  vtkGetMacro(UseIntelMkl, bool);
+  vtkBooleanMacro(UseIntelMkl, bool);
+
 protected:
   vtkPlusForoughiBoneSurfaceProbability();
   virtual ~vtkPlusForoughiBoneSurfaceProbability();
@@ -70,8 +89,17 @@ protected:
   void DeleteKernels();
 
   void Foroughi2007(double* inputBuffer, double* outputBuffer, double smoothingSigma, int transducerMargin, double shadowSigma, double boneThreshold, int blurredVSBLoG, int shadowVSIntensity, int nx, int ny, int nz);
+  /*! Intel MKL convolution (only available if Plus is built with PLUS_USE_INTEL_MKL) */
   void Conv2(const double* inputBuffer, const double* kernelBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny, int kx, int ky);
+  /*! Portable Gaussian filtering by separable row and column passes. tempBuffer must hold at least nx*ny elements. */
+  void GaussianBlur(const double* inputBuffer, double* tempBuffer, double* outputBuffer, int nx, int ny);
+  /*! Portable 3x3 Laplacian filtering */
+  void Laplacian(const double* inputBuffer, double* outputBuffer, int nx, int ny);
+  /*! Portable computation of outputBuffer = baseBuffer^exponent * factorBuffer. baseBuffer is overwritten by baseBuffer^exponent. */
+  void PowerAndMultiply(double* baseBuffer, double exponent, const double* factorBuffer, double* outputBuffer, int size);
   void ResizeMatrix(const double* inputBuffer, double* outputBuffer, int xClipping, int yClipping, int xInputSize, int yInputSize);
+  /*! Compute the sum of each image column from each row to the bottom of the image. Output size is nx*(ny+1), the last row is zero. */
+  void ComputeColumnSuffixSums(const double* inputBuffer, double* suffixSumBuffer, int nx, int ny);
   double GetMaxPixelValue(const double* buffer, int size);
   void Normalize(double* buffer, int size, bool doInverse, double maxValue = 1.0);
 
@@ -83,21 +111,31 @@ protected:
   int ShadowVSIntensity;
   double SmoothingSigma;
   int TransducerMargin;
+  bool FastShadowComputation;
+  bool UseIntelMkl;
 
   bool KernelUpdateRequested;
 
   int GaussianKernelSize;
+
+  /*! Index of the first shadow model element from which all (non-zero) elements are exactly 1 */
+  int ShadowModelSaturationIndex;
   FrameSizeType FrameSize;
 
-  double* MklGaussianBuffer;
-  double* MklLaplacianOfGaussianBuffer;
-  double* MklGaussianBufferTemp;
-  double* MklLaplacianOfGaussianBufferTemp;
-  double* MklReflectionNumberBuffer;
-  double* MklShadowValueBuffer;
-  double* MklShadowModel;
-  double* MklGaussianKernel;
-  double* MklLaplacianKernel;
+  double* GaussianBuffer;
+  double* LaplacianOfGaussianBuffer;
+  double* GaussianBufferTemp;
+  double* LaplacianOfGaussianBufferTemp;
+  double* ReflectionNumberBuffer;
+  double* ShadowValueBuffer;
+  double* ShadowModel;
+  /*! Element i is the sum of the first i elements of the shadow model (size: ny+1) */
+  double* ShadowModelCumulativeSum;
+  /*! Element (x, y) is the sum of the blurred image column x from row y to the bottom (size: nx*(ny+1)) */
+  double* ColumnSuffixSumBuffer;
+  double* GaussianKernel;
+  double* GaussianKernel1D;
+  double* LaplacianKernel;
 
 private:
   vtkPlusForoughiBoneSurfaceProbability(const vtkPlusForoughiBoneSurfaceProbability&);  // Not implemented.
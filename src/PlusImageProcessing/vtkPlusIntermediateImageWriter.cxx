@@ -0,0 +1,353 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusIntermediateImageWriter.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <igsioVideoFrame.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOSequenceIOBase.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusIntermediateImageWriter);
+
+//----------------------------------------------------------------------------
+vtkPlusIntermediateImageWriter::vtkPlusIntermediateImageWriter()
+  : FrameStride(1)
+  , MaximumQueueLength(50)
+  , DropFramesWhenQueueFull(true)
+  , FrameCounter(0)
+  , CurrentFrameCaptured(true)
+  , StopRequested(false)
+  , NumberOfDroppedFrames(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusIntermediateImageWriter::~vtkPlusIntermediateImageWriter()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileNamePrefix: " << this->FileNamePrefix << std::endl;
+  os << indent << "FrameStride: " << this->FrameStride << std::endl;
+  os << indent << "MaximumQueueLength: " << this->MaximumQueueLength << std::endl;
+  os << indent << "DropFramesWhenQueueFull: " << (this->DropFramesWhenQueueFull ? "true" : "false") << std::endl;
+  os << indent << "NumberOfDroppedFrames: " << this->GetNumberOfDroppedFrames() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::SetMaximumQueueLength(int maximumQueueLength)
+{
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  int minimumQueueLength = std::max<int>(1, static_cast<int>(this->Stages.size()));
+  if (maximumQueueLength < minimumQueueLength)
+  {
+    LOG_ERROR("Intermediate image queue length " << maximumQueueLength << " is invalid, it must be at least the number of stages ("
+              << minimumQueueLength << "). Queue length is set to " << minimumQueueLength << ".");
+    maximumQueueLength = minimumQueueLength;
+  }
+  if (this->MaximumQueueLength != maximumQueueLength)
+  {
+    this->MaximumQueueLength = maximumQueueLength;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIntermediateImageWriter::StartFrame()
+{
+  this->CurrentFrameCaptured = (this->FrameCounter % this->FrameStride == 0);
+  this->FrameCounter++;
+  if (!this->CurrentFrameCaptured)
+  {
+    return false;
+  }
+
+  // Keep or drop all the images of the frame, so that the files of the stages contain the same frames.
+  // The stages that have been seen so far are expected to add an image for this frame.
+  std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+  int numberOfImagesInFrame = std::max<int>(1, static_cast<int>(this->Stages.size()));
+  if (numberOfImagesInFrame > this->MaximumQueueLength)
+  {
+    // All the frames would be dropped
+    LOG_ERROR("Intermediate image queue length (" << this->MaximumQueueLength << ") is smaller than the number of stages ("
+              << numberOfImagesInFrame << "). Queue length is set to " << numberOfImagesInFrame << ".");
+    this->MaximumQueueLength = numberOfImagesInFrame;
+  }
+  if (!this->DropFramesWhenQueueFull)
+  {
+    // The queue is not empty, so the writer thread is running and makes room
+    this->ImageWritten.wait(queueLock, [this, numberOfImagesInFrame]
+    {
+      return static_cast<int>(this->Queue.size()) + numberOfImagesInFrame <= this->MaximumQueueLength;
+    });
+  }
+  else if (static_cast<int>(this->Queue.size()) + numberOfImagesInFrame > this->MaximumQueueLength)
+  {
+    // Never stall the processing because of the diagnostic output
+    LOG_DEBUG("Intermediate image write queue is full, images of frame " << this->FrameCounter - 1 << " are dropped");
+    this->NumberOfDroppedFrames++;
+    this->CurrentFrameCaptured = false;
+  }
+  return this->CurrentFrameCaptured;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusIntermediateImageWriter::IsCurrentFrameCaptured() const
+{
+  return this->CurrentFrameCaptured;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIntermediateImageWriter::GetNumberOfDroppedFrames()
+{
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  return this->NumberOfDroppedFrames;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::AddImage(const std::string& stagePostfix, vtkImageData* image)
+{
+  if (!this->CurrentFrameCaptured)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (image == NULL || image->GetScalarPointer() == NULL)
+  {
+    LOG_ERROR("Invalid intermediate image for stage " << stagePostfix);
+    return PLUS_FAIL;
+  }
+  if (stagePostfix.empty())
+  {
+    LOG_WARNING("The empty string was given as an intermediate image file postfix.");
+  }
+
+  std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+
+  // StartFrame reserved room for one image of each stage known at that time. An image of a stage that appears
+  // for the first time in this frame was not counted, so it (and the images after it) may have to wait for the
+  // writer thread. The queue is full, hence not empty, so the writer thread is running.
+  this->ImageWritten.wait(queueLock, [this] { return static_cast<int>(this->Queue.size()) < this->MaximumQueueLength; });
+
+  int stageIndex = this->GetStageIndex(stagePostfix);
+  if (stageIndex < 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  QueuedImage queuedImage;
+  queuedImage.StageIndex = stageIndex;
+  if (this->FreeImages.empty())
+  {
+    queuedImage.Image = vtkSmartPointer<vtkImageData>::New();
+  }
+  else
+  {
+    queuedImage.Image = this->FreeImages.back();
+    this->FreeImages.pop_back();
+  }
+
+  // Reuse the buffer memory if the image geometry has not changed
+  int* extent = image->GetExtent();
+  int* bufferExtent = queuedImage.Image->GetExtent();
+  if (!std::equal(extent, extent + 6, bufferExtent) || queuedImage.Image->GetScalarPointer() == NULL
+      || queuedImage.Image->GetScalarType() != image->GetScalarType()
+      || queuedImage.Image->GetNumberOfScalarComponents() != image->GetNumberOfScalarComponents())
+  {
+    queuedImage.Image->SetExtent(extent);
+    queuedImage.Image->AllocateScalars(image->GetScalarType(), image->GetNumberOfScalarComponents());
+  }
+  queuedImage.Image->SetSpacing(image->GetSpacing());
+  queuedImage.Image->SetOrigin(image->GetOrigin());
+  size_t numberOfBytes = static_cast<size_t>(image->GetNumberOfPoints()) * image->GetNumberOfScalarComponents() * image->GetScalarSize();
+  memcpy(queuedImage.Image->GetScalarPointer(), image->GetScalarPointer(), numberOfBytes);
+  queuedImage.Image->Modified();
+
+  this->Queue.push_back(queuedImage);
+  if (!this->WriterThread.joinable())
+  {
+    this->StopRequested = false;
+    this->WriterThread = std::thread(&vtkPlusIntermediateImageWriter::WriterThreadFunction, this);
+  }
+  this->QueueChanged.notify_one();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusIntermediateImageWriter::GetStageIndex(const std::string& stagePostfix)
+{
+  std::map<std::string, int>::iterator stageIndexIt = this->StageIndices.find(stagePostfix);
+  if (stageIndexIt != this->StageIndices.end())
+  {
+    return stageIndexIt->second;
+  }
+
+  StageFile stage;
+  stage.FileName = this->FileNamePrefix + "_Plus" + stagePostfix + ".mha";
+  stage.HeaderPrepared = false;
+  stage.Failed = false;
+  stage.NumberOfWrittenFrames = 0;
+  stage.Frames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+  stage.Writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(stage.FileName));
+  if (stage.Writer == NULL)
+  {
+    LOG_ERROR("Could not create writer for intermediate image file: " << stage.FileName);
+    return -1;
+  }
+  stage.Writer->SetUseCompression(false);
+  stage.Writer->SetImageOrientationInFile(US_IMG_ORIENT_MF);
+  stage.Writer->SetTrackedFrameList(stage.Frames);
+  stage.Writer->SetFileName(vtkPlusConfig::GetInstance()->GetOutputPath(stage.FileName));
+
+  this->Stages.push_back(stage);
+  int stageIndex = static_cast<int>(this->Stages.size()) - 1;
+  this->StageIndices[stagePostfix] = stageIndex;
+  return stageIndex;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusIntermediateImageWriter::WriterThreadFunction()
+{
+  std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+  while (true)
+  {
+    this->QueueChanged.wait(queueLock, [this] { return this->StopRequested || !this->Queue.empty(); });
+    if (this->Queue.empty())
+    {
+      // Stop was requested and all images are written
+      break;
+    }
+
+    QueuedImage queuedImage = this->Queue.front();
+    this->Queue.pop_front();
+    StageFile& stage = this->Stages[queuedImage.StageIndex];
+
+    // File writing is done without holding the lock, so that the processing thread can keep adding images
+    queueLock.unlock();
+    this->WriteImage(stage, queuedImage.Image);
+    queueLock.lock();
+
+    this->FreeImages.push_back(queuedImage.Image);
+    this->ImageWritten.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::WriteImage(StageFile& stage, vtkImageData* image)
+{
+  if (stage.Failed)
+  {
+    return PLUS_FAIL;
+  }
+
+  igsioVideoFrame videoFrame;
+  videoFrame.DeepCopyFrom(image);
+  igsioTrackedFrame trackedFrame;
+  trackedFrame.SetImageData(videoFrame);
+  stage.Frames->AddTrackedFrame(&trackedFrame);
+
+  if (!stage.HeaderPrepared)
+  {
+    if (stage.Writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of intermediate image file: " << stage.FileName);
+      stage.Failed = true;
+      stage.Frames->Clear();
+      return PLUS_FAIL;
+    }
+    stage.HeaderPrepared = true;
+  }
+
+  if (stage.Writer->AppendImagesToHeader() != PLUS_SUCCESS || stage.Writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to append image to intermediate image file: " << stage.FileName);
+    stage.Failed = true;
+    stage.Frames->Clear();
+    return PLUS_FAIL;
+  }
+  stage.Frames->Clear();
+  stage.NumberOfWrittenFrames++;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::CloseStage(StageFile& stage)
+{
+  if (!stage.HeaderPrepared)
+  {
+    // Nothing has been written
+    return stage.Failed ? PLUS_FAIL : PLUS_SUCCESS;
+  }
+
+  // Fix the header to contain the correct number of frames
+  stage.Writer->UpdateDimensionsCustomStrings(stage.NumberOfWrittenFrames, false);
+  stage.Writer->UpdateFieldInImageHeader(stage.Writer->GetDimensionSizeString());
+  stage.Writer->UpdateFieldInImageHeader(stage.Writer->GetDimensionKindsString());
+  stage.Writer->FinalizeHeader();
+  stage.Writer->Close();
+  stage.HeaderPrepared = false;
+
+  if (stage.Failed)
+  {
+    LOG_ERROR("Intermediate image file is incomplete: " << stage.FileName);
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Sucessfully wrote " << stage.NumberOfWrittenFrames << " frames to the intermediate image file: " << stage.FileName);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIntermediateImageWriter::Close()
+{
+  if (this->WriterThread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+      this->StopRequested = true;
+    }
+    this->QueueChanged.notify_one();
+    this->WriterThread.join();
+  }
+
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::deque<StageFile>::iterator stageIt = this->Stages.begin(); stageIt != this->Stages.end(); ++stageIt)
+  {
+    if (this->CloseStage(*stageIt) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  this->Stages.clear();
+  this->StageIndices.clear();
+
+  if (this->NumberOfDroppedFrames > 0)
+  {
+    LOG_WARNING("Intermediate images of " << this->NumberOfDroppedFrames << " frames were not saved because the write queue was full. Increase the frame stride or the queue length to capture all frames.");
+    this->NumberOfDroppedFrames = 0;
+  }
+  this->StopRequested = false;
+  return status;
+}
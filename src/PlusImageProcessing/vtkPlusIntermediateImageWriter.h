@@ -0,0 +1,159 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusIntermediateImageWriter_h
+#define __vtkPlusIntermediateImageWriter_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusImageProcessingExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class vtkIGSIOSequenceIOBase;
+class vtkIGSIOTrackedFrameList;
+class vtkImageData;
+
+/*!
+  \class vtkPlusIntermediateImageWriter
+  \brief Streams intermediate images of an image processing algorithm to sequence files
+
+  Images are added by processing stage (identified by a file name postfix) and are written to
+  <FileNamePrefix>_Plus<postfix>.mha by a background thread, one file per stage. Each image is
+  appended to its file as soon as it is written, so memory usage does not grow with the number of
+  processed frames and the files are usable even while the capture is running.
+
+  AddImage() copies the image into a recycled buffer. Only every FrameStride-th frame is captured,
+  see StartFrame(). StartFrame() also drops the frame if the images of all the stages would not fit
+  in the queue of MaximumQueueLength images, so that a frame is either written to the files of all
+  the stages or to none of them. If DropFramesWhenQueueFull is disabled then StartFrame() waits for
+  the writer thread instead, so that all the frames are written (e.g., in tests).
+
+  The queue never holds more than MaximumQueueLength images. The queue length must be at least the
+  number of stages, otherwise no frame could be captured; a smaller length is rejected with an error
+  and replaced by the number of stages. AddImage() only waits for the writer thread if an image of a
+  stage that was not known when the frame was started does not fit in the queue.
+
+  \ingroup PlusLibImageProcessingAlgo
+*/
+class vtkPlusImageProcessingExport vtkPlusIntermediateImageWriter : public vtkObject
+{
+public:
+  static vtkPlusIntermediateImageWriter* New();
+  vtkTypeMacro(vtkPlusIntermediateImageWriter, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Prefix of the output file names. Relative paths are interpreted in the output directory. Applies to files that are opened after the call. */
+  vtkSetMacro(FileNamePrefix, std::string);
+  vtkGetMacro(FileNamePrefix, std::string);
+
+  /*! Capture the images of every FrameStride-th frame only (1 = capture all frames) */
+  vtkSetClampMacro(FrameStride, int, 1, VTK_INT_MAX);
+  vtkGetMacro(FrameStride, int);
+
+  /*!
+    Maximum number of images waiting to be written. Frames whose images do not fit in the queue are dropped.
+    Values smaller than the number of stages seen so far (or smaller than 1) are rejected with an error and clamped.
+  */
+  void SetMaximumQueueLength(int maximumQueueLength);
+  vtkGetMacro(MaximumQueueLength, int);
+
+  /*! If enabled (default) then frames that do not fit in the queue are dropped, otherwise StartFrame() waits until they fit */
+  vtkSetMacro(DropFramesWhenQueueFull, bool);
+  vtkGetMacro(DropFramesWhenQueueFull, bool);
+  vtkBooleanMacro(DropFramesWhenQueueFull, bool);
+
+  /*!
+    Notify the writer that processing of a new frame is started. Returns true if the images of this frame are captured,
+    i.e., the frame is selected by FrameStride and there is room in the queue for the images of all the stages.
+    If the queue is shorter than the number of stages then an error is logged and the queue length is increased.
+  */
+  bool StartFrame();
+
+  /*! Returns true if the images of the current frame are captured (see StartFrame) */
+  bool IsCurrentFrameCaptured() const;
+
+  /*! Queue a copy of the image for writing to the file of the stage. Images of frames that are not captured are ignored. */
+  PlusStatus AddImage(const std::string& stagePostfix, vtkImageData* image);
+
+  /*! Write all queued images, then finalize and close all files. Images added afterwards are written to new files. */
+  PlusStatus Close();
+
+  /*! Number of frames whose images were dropped because the queue was full, since the last Close() */
+  int GetNumberOfDroppedFrames();
+
+protected:
+  vtkPlusIntermediateImageWriter();
+  virtual ~vtkPlusIntermediateImageWriter();
+
+  struct StageFile
+  {
+    std::string FileName;
+    vtkSmartPointer<vtkIGSIOSequenceIOBase> Writer;
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> Frames;
+    bool HeaderPrepared;
+    bool Failed;
+    int NumberOfWrittenFrames;
+  };
+
+  struct QueuedImage
+  {
+    int StageIndex;
+    vtkSmartPointer<vtkImageData> Image;
+  };
+
+  /*! Find the file of a stage, open a new one if not found. Must be called with QueueMutex locked. */
+  int GetStageIndex(const std::string& stagePostfix);
+
+  /*! Append an image to the file of a stage. Called from the writer thread. */
+  PlusStatus WriteImage(StageFile& stage, vtkImageData* image);
+
+  /*! Update the header of a file with the final number of frames and close it */
+  PlusStatus CloseStage(StageFile& stage);
+
+  /*! Write queued images until stop is requested and the queue is empty */
+  void WriterThreadFunction();
+
+  std::string FileNamePrefix;
+  int FrameStride;
+  int MaximumQueueLength;
+  bool DropFramesWhenQueueFull;
+
+  int FrameCounter;
+  bool CurrentFrameCaptured;
+
+  /*! Stage files, deque keeps references valid while new stages are added */
+  std::deque<StageFile> Stages;
+  std::map<std::string, int> StageIndices;
+
+  std::mutex QueueMutex;
+  std::condition_variable QueueChanged;
+  /*! Notified by the writer thread when an image is removed from the queue */
+  std::condition_variable ImageWritten;
+  std::deque<QueuedImage> Queue;
+  /*! Image buffers that were already written and can be reused */
+  std::vector<vtkSmartPointer<vtkImageData> > FreeImages;
+  std::thread WriterThread;
+  bool StopRequested;
+  int NumberOfDroppedFrames;
+
+private:
+  vtkPlusIntermediateImageWriter(const vtkPlusIntermediateImageWriter&);  // Not implemented.
+  void operator=(const vtkPlusIntermediateImageWriter&);  // Not implemented.
+};
+
+#endif
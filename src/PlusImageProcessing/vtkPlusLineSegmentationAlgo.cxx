@@ -15,10 +15,8 @@ See License.txt for details.
 
 // ITK includes
 #include <itkBinaryThresholdImageFilter.h>
-#include <itkImageDuplicator.h>
 #include <itkImageFileWriter.h>
 #include <itkImageRegionIterator.h>
-#include <itkLineIterator.h>
 #include <itkOtsuThresholdImageFilter.h>
 #include <itkRGBPixel.h>
 #include <itkResampleImageFilter.h>
@@ -41,6 +39,13 @@ See License.txt for details.
 #include <vtkRenderer.h>
 #include <vtkTable.h>
 
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
 static const double INTESNITY_THRESHOLD_PERCENTAGE_OF_PEAK = 0.5; // threshold (as the percentage of the peak intensity along a scanline) for COG
 static const double MAX_CONSECUTIVE_INVALID_VIDEO_FRAMES = 10; // the maximum number of consecutive invalid frames before warning message issued
 static const double MAX_PERCENTAGE_OF_INVALID_VIDEO_FRAMES = 0.1; // the maximum percentage of the invalid frames before warning message issued
@@ -71,6 +76,7 @@ vtkPlusLineSegmentationAlgo::vtkPlusLineSegmentationAlgo()
   , m_SaveIntermediateImages(false)
   , IntermediateFilesOutputDirectory("")
   , PlotIntensityProfile(false)
+  , NumberOfThreads(0)
   , m_SignalTimeRangeMin(0.0)
   , m_SignalTimeRangeMax(-1.0)
 {
@@ -196,203 +202,255 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric()
   m_LineParameters.assign(m_TrackedFrameList->GetNumberOfTrackedFrames(), nonDetectedLineParams);
 
   //  For each video frame, detect line and extract mindpoint and slope parameters
-  int numberOfSuccessfulLineSegmentations = 0;
-  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
-  for (unsigned int frameNumber = 0; frameNumber < m_TrackedFrameList->GetNumberOfTrackedFrames(); ++frameNumber)
+  const int numberOfFrames = static_cast<int>(m_TrackedFrameList->GetNumberOfTrackedFrames());
+  std::vector<double> signalValues(numberOfFrames, 0.0);
+
+  // Intensity profile plotting and intermediate image writing are only performed on the calling thread
+  unsigned int numberOfThreads = GetNumberOfWorkerThreads();
+  if (this->PlotIntensityProfile || m_SaveIntermediateImages)
   {
-    LOG_TRACE("Calculating video position metric for frame " << frameNumber);
-    igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
-    if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
-    {
-      // frame is out of the specified signal range
-      LOG_TRACE("Skip frame, it is out of the valid signal range");
-      continue;
-    }
+    numberOfThreads = 1;
+  }
 
-    // Get current image
-    if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  // Each worker picks the next unprocessed frame until all of them are processed
+  std::atomic<int> nextFrameNumber(0);
+  std::function<void()> worker = [this, numberOfFrames, &nextFrameNumber, &signalValues]()
+  {
+    // Scratch buffers of the thread, reused for all the processed frames
+    std::vector<int> intensityProfile;
+    std::vector<itk::Point<double, 2> > intensityPeakPositions;
+    for (int frameNumber = nextFrameNumber++; frameNumber < numberOfFrames; frameNumber = nextFrameNumber++)
     {
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
-      continue;
-    }
-    auto localImage = CharImageType::New();
-    PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(trackedFrame->GetImageData()->GetImage(), localImage);
-    if (localImage.IsNull())
-    {
-      // Dropped frame
-      LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
-      continue;
+      ComputeVideoPositionMetricForFrame(frameNumber, intensityProfile, intensityPeakPositions, m_LineParameters[frameNumber], signalValues[frameNumber]);
     }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned int threadIndex = 1; threadIndex < std::min<unsigned int>(numberOfThreads, numberOfFrames); ++threadIndex)
+  {
+    workers.push_back(std::thread(worker));
+  }
+  // the calling thread is also used as a worker
+  worker();
+  for (std::vector<std::thread>::iterator workerIt = workers.begin(); workerIt != workers.end(); ++workerIt)
+  {
+    workerIt->join();
+  }
 
-    // Create an image duplicator to copy the original image
-    typedef itk::ImageDuplicator<CharImageType> DuplicatorType;
-    auto duplicator = DuplicatorType::New();
-    CharImageType::Pointer scanlineImage;
-    if (m_SaveIntermediateImages == true)
+  // Store the results in the order of the frames
+  int numberOfSuccessfulLineSegmentations = 0;
+  for (int frameNumber = 0; frameNumber < numberOfFrames; ++frameNumber)
+  {
+    if (!m_LineParameters[frameNumber].lineDetected)
     {
-      duplicator->SetInputImage(localImage);
-      duplicator->Update();
-
-      // Create an image copy to draw the scanlines on
-      scanlineImage = duplicator->GetOutput();
+      continue;
     }
+    ++numberOfSuccessfulLineSegmentations;
+    m_SignalValues.push_back(signalValues[frameNumber]);
+    //  Store timestamp for image frame
+    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+  }
 
-    std::vector<itk::Point<double, 2> > intensityPeakPositions;
-    CharImageType::RegionType region = localImage->GetLargestPossibleRegion();
-    LimitToClipRegion(region);
-
-    int numOfValidScanlines = 0;
+  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
+  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  {
+    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+  }
 
-    for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
-    {
-      // Set the scanline start pixel
-      CharImageType::IndexType startPixel;
-      double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
-      startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
-      startPixel[1] = region.GetIndex()[1];
-
-      // Set the scanline end pixel
-      CharImageType::IndexType endPixel;
-      endPixel[0] = startPixel[0];
-      endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
-
-      std::deque<int> intensityProfile; // Holds intensity profile of the line
-      itk::LineIterator<CharImageType> it(localImage, startPixel, endPixel);
-      it.GoToBegin();
-
-      itk::LineIterator<CharImageType>* itScanlineImage = NULL;
-      if (m_SaveIntermediateImages == true)
-      {
-        // Iterator for the scanline image copy
-        // it's time-consuming to instantiate this iterator, so only do it if intermediate image saving is requested
-        itScanlineImage = new itk::LineIterator<CharImageType>(scanlineImage, startPixel, endPixel);
-        itScanlineImage->GoToBegin();
-      }
+  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
+  if (plotVideoMetric)
+  {
+    PlotDoubleArray(m_SignalValues);
+  }
 
-      while (!it.IsAtEnd())
-      {
-        intensityProfile.push_back((int)it.Get());
-        if (m_SaveIntermediateImages == true)
-        {
-          // Set the pixels on the scanline image copy to white
-          itScanlineImage->Set(255);
-          ++(*itScanlineImage);
-        }
-        ++it;
-      }
+  return PLUS_SUCCESS;
 
-      // Delete the iterator declared with new()
-      if (itScanlineImage != NULL)
-      {
-        delete itScanlineImage;
-        itScanlineImage = NULL;
-      }
+} //  End LineDetection
 
-      if (this->PlotIntensityProfile)
-      {
-        // Plot the intensity profile
-        PlotIntArray(intensityProfile);
-      }
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetricForFrame(int frameNumber, std::vector<int>& intensityProfile, std::vector<itk::Point<double, 2> >& intensityPeakPositions,
+    LineParameters& lineParameters, double& signalValue)
+{
+  LOG_TRACE("Calculating video position metric for frame " << frameNumber);
+  igsioTrackedFrame* trackedFrame = m_TrackedFrameList->GetTrackedFrame(frameNumber);
+  bool signalTimeRangeDefined = (m_SignalTimeRangeMin <= m_SignalTimeRangeMax);
+  if (signalTimeRangeDefined && (trackedFrame->GetTimestamp() < m_SignalTimeRangeMin || trackedFrame->GetTimestamp() > m_SignalTimeRangeMax))
+  {
+    // frame is out of the specified signal range
+    LOG_TRACE("Skip frame, it is out of the valid signal range");
+    return PLUS_FAIL;
+  }
 
-      // Find the max intensity value from the peak with the largest area
-      int maxFromLargestArea = -1;
-      int maxFromLargestAreaIndex = -1;
-      int startOfMaxArea = -1;
-      if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
-      {
-        double currPeakPos_y = -1;
-        switch (PEAK_POS_METRIC)
-        {
-          case PEAK_POS_COG:
-            {
-              /* Use center-of-gravity (COG) as peak-position metric*/
-              if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute center-of-gravity; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-          case PEAK_POS_START:
-            {
-              /* Use peak start as peak-position metric*/
-              if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
-              {
-                // unable to compute peak start; this scanline is invalid
-                continue;
-              }
-              break;
-            }
-        }
+  // Get current image
+  if (trackedFrame->GetImageData()->GetVTKScalarPixelType() != VTK_UNSIGNED_CHAR)
+  {
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric only supports 8-bit images");
+    return PLUS_FAIL;
+  }
+  vtkImageData* image = trackedFrame->GetImageData()->GetImage();
+  const unsigned char* imageBuffer = (image != NULL ? static_cast<const unsigned char*>(image->GetScalarPointer()) : NULL);
+  if (imageBuffer == NULL)
+  {
+    // Dropped frame
+    LOG_ERROR("vtkPlusLineSegmentationAlgo::ComputeVideoPositionMetric failed to retrieve image data from frame");
+    return PLUS_FAIL;
+  }
+  int extent[6] = { 0, 0, 0, 0, 0, 0 };
+  image->GetExtent(extent);
+  vtkIdType increments[3] = { 0, 0, 0 };
+  image->GetIncrements(increments);
 
-        itk::Point<double, 2> currPeakPos;
-        currPeakPos[0] = static_cast<double>(startPixel[0]);
-        currPeakPos[1] = startPixel[1] + currPeakPos_y;
-        intensityPeakPositions.push_back(currPeakPos);
-        ++numOfValidScanlines;
+  // Pixel (x, y) of the image is imageBuffer[x * increments[0] + y * increments[1]]
+  CharImageType::RegionType region;
+  {
+    CharImageType::IndexType imageOrigin;
+    imageOrigin[0] = 0;
+    imageOrigin[1] = 0;
+    CharImageType::SizeType imageSize;
+    imageSize[0] = extent[1] - extent[0] + 1;
+    imageSize[1] = extent[3] - extent[2] + 1;
+    region.SetIndex(imageOrigin);
+    region.SetSize(imageSize);
+  }
+  LimitToClipRegion(region);
 
-      } // end if() found intensity peak
+  CharImageType::Pointer scanlineImage;
+  if (m_SaveIntermediateImages == true)
+  {
+    // Create an image copy to draw the scanlines on
+    scanlineImage = CharImageType::New();
+    PlusCommon::DeepCopyVtkVolumeToItkImage<CharPixelType>(image, scanlineImage);
+  }
 
-    } // end currScanlineNum loop
+  intensityPeakPositions.clear();
+  int numOfValidScanlines = 0;
 
-    if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  for (int currScanlineNum = 0; currScanlineNum < NUMBER_OF_SCANLINES; ++currScanlineNum)
+  {
+    // Set the scanline start pixel
+    CharImageType::IndexType startPixel;
+    double scanlineSpacingPix = static_cast<double>(region.GetSize()[0] - 1) / (NUMBER_OF_SCANLINES - 1);
+    startPixel[0] = region.GetIndex()[0] + scanlineSpacingPix * (currScanlineNum);
+    startPixel[1] = region.GetIndex()[1];
+
+    // Set the scanline end pixel
+    CharImageType::IndexType endPixel;
+    endPixel[0] = startPixel[0];
+    endPixel[1] = startPixel[1] + region.GetSize()[1] - 1;
+
+    // Holds intensity profile of the line (scanlines are vertical)
+    intensityProfile.clear();
+    const unsigned char* scanlinePixel = imageBuffer + startPixel[0] * increments[0] + startPixel[1] * increments[1];
+    for (CharImageType::IndexValueType y = startPixel[1]; y <= endPixel[1]; ++y, scanlinePixel += increments[1])
     {
-      //TODO: drop the frame from the analysis
-      LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+      intensityProfile.push_back((int)(*scanlinePixel));
     }
 
-    LineParameters params;
-    ComputeLineParameters(intensityPeakPositions, params);
-    if (!params.lineDetected)
+    if (m_SaveIntermediateImages == true)
     {
-      LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
-      continue;
+      // Set the pixels on the scanline image copy to white
+      CharImageType::IndexType scanlineImagePixel = startPixel;
+      for (; scanlineImagePixel[1] <= endPixel[1]; ++scanlineImagePixel[1])
+      {
+        scanlineImage->SetPixel(scanlineImagePixel, 255);
+      }
     }
-    if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+
+    if (this->PlotIntensityProfile)
     {
-      // Line is close to vertical, skip frame because intersection of
-      // line with image's horizontal half point is unstable
-      LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
-      continue;
+      // Plot the intensity profile
+      PlotIntArray(intensityProfile);
     }
 
-    ++numberOfSuccessfulLineSegmentations;
-    m_LineParameters[frameNumber] = params;
+    // Find the max intensity value from the peak with the largest area
+    int maxFromLargestArea = -1;
+    int maxFromLargestAreaIndex = -1;
+    int startOfMaxArea = -1;
+    if (FindLargestPeak(intensityProfile, maxFromLargestArea, maxFromLargestAreaIndex, startOfMaxArea) == PLUS_SUCCESS)
+    {
+      double currPeakPos_y = -1;
+      switch (PEAK_POS_METRIC)
+      {
+        case PEAK_POS_COG:
+          {
+            /* Use center-of-gravity (COG) as peak-position metric*/
+            if (ComputeCenterOfGravity(intensityProfile, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute center-of-gravity; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+        case PEAK_POS_START:
+          {
+            /* Use peak start as peak-position metric*/
+            if (FindPeakStart(intensityProfile, maxFromLargestArea, startOfMaxArea, currPeakPos_y) != PLUS_SUCCESS)
+            {
+              // unable to compute peak start; this scanline is invalid
+              continue;
+            }
+            break;
+          }
+      }
 
-    // Store the y-value of the line, when the line's x-value is half of the image's width
-    double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
-    m_SignalValues.push_back(std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]));
+      itk::Point<double, 2> currPeakPos;
+      currPeakPos[0] = static_cast<double>(startPixel[0]);
+      currPeakPos[1] = startPixel[1] + currPeakPos_y;
+      intensityPeakPositions.push_back(currPeakPos);
+      ++numOfValidScanlines;
 
-    //  Store timestamp for image frame
-    m_SignalTimestamps.push_back(m_TrackedFrameList->GetTrackedFrame(frameNumber)->GetTimestamp());
+    } // end if() found intensity peak
 
-    if (m_SaveIntermediateImages == true)
-    {
-      SaveIntermediateImage(frameNumber, scanlineImage,
-                            params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
-                            numOfValidScanlines, intensityPeakPositions);
-    }
+  } // end currScanlineNum loop
 
-  } // end frameNum loop
+  if (numOfValidScanlines < MINIMUM_NUMBER_OF_VALID_SCANLINES)
+  {
+    //TODO: drop the frame from the analysis
+    LOG_DEBUG("Only " << numOfValidScanlines << " valid scanlines; this is less than the required " << MINIMUM_NUMBER_OF_VALID_SCANLINES << ". Skipping frame" << frameNumber);
+  }
 
-  double segmentationSuccessRate = double(numberOfSuccessfulLineSegmentations) / m_TrackedFrameList->GetNumberOfTrackedFrames();
-  if (segmentationSuccessRate < EXPECTED_LINE_SEGMENTATION_SUCCESS_RATE)
+  LineParameters params;
+  ComputeLineParameters(intensityPeakPositions, static_cast<unsigned int>(frameNumber), params);
+  if (!params.lineDetected)
   {
-    LOG_WARNING("Line segmentation success rate is very low (" << segmentationSuccessRate * 100 << "%): a line could only be detected on " << numberOfSuccessfulLineSegmentations << " frames out of " << m_TrackedFrameList->GetNumberOfTrackedFrames());
+    LOG_DEBUG("Unable to compute line parameters for frame " << frameNumber);
+    return PLUS_FAIL;
+  }
+  if (params.lineDirectionVector_Image[0] < MIN_X_SLOPE_COMPONENT_FOR_DETECTED_LINE)
+  {
+    // Line is close to vertical, skip frame because intersection of
+    // line with image's horizontal half point is unstable
+    LOG_TRACE("Line on frame " << frameNumber << " is too close to vertical, skip the frame");
+    return PLUS_FAIL;
   }
 
-  bool plotVideoMetric = vtkPlusLogger::Instance()->GetLogLevel() >= vtkPlusLogger::LOG_LEVEL_TRACE;
-  if (plotVideoMetric)
+  lineParameters = params;
+
+  // Store the y-value of the line, when the line's x-value is half of the image's width
+  double t = (region.GetIndex()[0] + 0.5 * region.GetSize()[0] - params.lineOriginPoint_Image[0]) / params.lineDirectionVector_Image[0];
+  signalValue = std::abs(params.lineOriginPoint_Image[1] + t * params.lineDirectionVector_Image[1]);
+
+  if (m_SaveIntermediateImages == true)
   {
-    PlotDoubleArray(m_SignalValues);
+    SaveIntermediateImage(frameNumber, scanlineImage,
+                          params.lineOriginPoint_Image[0], params.lineOriginPoint_Image[1], params.lineDirectionVector_Image[0], params.lineDirectionVector_Image[1],
+                          numOfValidScanlines, intensityPeakPositions);
   }
 
   return PLUS_SUCCESS;
+}
 
-} //  End LineDetection
+//-----------------------------------------------------------------------------
+unsigned int vtkPlusLineSegmentationAlgo::GetNumberOfWorkerThreads() const
+{
+  if (this->NumberOfThreads == 0)
+  {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  return static_cast<unsigned int>(this->NumberOfThreads);
+}
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
+PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak)
 {
   // Start of peak is defined as the location at which it reaches 50% of its maximum value.
   double startPeakValue = maxFromLargestArea * 0.5;
@@ -410,7 +468,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindPeakStart(std::deque<int>& intensity
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
+PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea)
 {
   int currentLargestArea = 0;
   int currentArea = 0;
@@ -489,7 +547,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::FindLargestPeak(std::deque<int>& intensi
 }
 //-----------------------------------------------------------------------------
 
-PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
+PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity)
 {
   if (intensityProfile.size() == 0)
   {
@@ -528,7 +586,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::ComputeCenterOfGravity(std::deque<int>&
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, LineParameters& outputParameters)
+void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, unsigned int randomSeed, LineParameters& outputParameters)
 {
   outputParameters.lineDetected = false;
 
@@ -557,6 +615,10 @@ void vtkPlusLineSegmentationAlgo::ComputeLineParameters(std::vector<itk::Point<d
   //create and initialize the RANSAC algorithm
   double desiredProbabilityForNoOutliers = 0.999;
   auto ransacEstimator = RANSACType::New();
+  // RANSAC runs on the calling thread (default NumberOfThreads=1) with its own random number generator,
+  // so frames can be fitted in parallel. A fixed seed is used instead of the current time so that the
+  // result is reproducible.
+  ransacEstimator->SetRandomSeed(randomSeed);
 
   try
   {
@@ -731,7 +793,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::Update()
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::deque<int>& intensityValues)
+void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::vector<int>& intensityValues)
 {
 #ifdef PLUS_RENDERING_ENABLED
   //  Create table
@@ -779,7 +841,7 @@ void vtkPlusLineSegmentationAlgo::PlotIntArray(const std::deque<int>& intensityV
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::PlotDoubleArray(const std::deque<double>& intensityValues)
+void vtkPlusLineSegmentationAlgo::PlotDoubleArray(const std::vector<double>& intensityValues)
 {
 #ifdef PLUS_RENDERING_ENABLED
   //  Create table
@@ -827,13 +889,13 @@ void vtkPlusLineSegmentationAlgo::PlotDoubleArray(const std::deque<double>& inte
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::GetDetectedTimestamps(std::deque<double>& timestamps)
+void vtkPlusLineSegmentationAlgo::GetDetectedTimestamps(std::vector<double>& timestamps)
 {
   timestamps = m_SignalTimestamps;
 }
 
 //-----------------------------------------------------------------------------
-void vtkPlusLineSegmentationAlgo::GetDetectedPositions(std::deque<double>& positions)
+void vtkPlusLineSegmentationAlgo::GetDetectedPositions(std::vector<double>& positions)
 {
   positions = m_SignalValues;
 }
@@ -926,6 +988,7 @@ PlusStatus vtkPlusLineSegmentationAlgo::ReadConfiguration(vtkXMLDataElement* aCo
 
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(SaveIntermediateImages, lineSegmentationElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(PlotIntensityProfile, lineSegmentationElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, lineSegmentationElement);
 
   this->IntermediateFilesOutputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory();
   XML_READ_CSTRING_ATTRIBUTE_OPTIONAL(IntermediateFilesOutputDirectory, lineSegmentationElement);
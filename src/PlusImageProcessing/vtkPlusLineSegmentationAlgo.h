@@ -8,9 +8,9 @@
 #define __vtkPlusLineSegmentationAlgo_h
 
 #include "itkImage.h"
-#include "vtkPlusCalibrationExport.h"
+#include "vtkPlusImageProcessingExport.h"
 #include "vtkObject.h"
-#include <deque>
+#include <vector>
 
 //class igsioTrackedFrame; 
 //class vtkIGSIOTrackedFrameList;
@@ -18,9 +18,9 @@
 /*!
   \class vtkPlusLineSegmentationAlgo
   \brief Detect the position of a line (image of a plane) in an US image sequence.
-  \ingroup PlusLibCalibrationAlgorithm
+  \ingroup PlusLibImageProcessingAlgo
 */
-class vtkPlusCalibrationExport vtkPlusLineSegmentationAlgo : public vtkObject
+class vtkPlusImageProcessingExport vtkPlusLineSegmentationAlgo : public vtkObject
 {
 public:
   struct LineParameters /*!< Line parameters is defined in the Image coordinate system (orientation is MF, origin is in the image corner, unit is pixel) */
@@ -62,10 +62,10 @@ public:
   PlusStatus Update();
 
   /*! Get the timestamps of the frames where a line was successfully detected. Frames where the line detection was failed are skipped. */
-  void GetDetectedTimestamps(std::deque<double>& timestamps);
+  void GetDetectedTimestamps(std::vector<double>& timestamps);
 
   /*! Get the line positions on the frames where a line was successfully detected. Frames where the line detection was failed are skipped. */
-  void GetDetectedPositions(std::deque<double>& positions);
+  void GetDetectedPositions(std::vector<double>& positions);
 
   /*! Get the parameters of the plane where a line was successfully detected. No frames are skipped, the size of the vector matches the number of input tracked frames. If line detection failed on an image then the lineDetected parameter of the item is set to false. */
   void GetDetectedLineParameters(std::vector<LineParameters>& parameters);
@@ -81,6 +81,13 @@ public:
   vtkGetMacro(PlotIntensityProfile, bool);
   vtkSetMacro(PlotIntensityProfile, bool);
 
+  /*! Number of threads that process the frames in parallel. 0 means the number of hardware threads. Only one thread is used if intensity profile plotting or intermediate image saving is enabled. */
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /*! Number of processing threads that are actually used (NumberOfThreads, with 0 resolved to the number of hardware threads) */
+  unsigned int GetNumberOfWorkerThreads() const;
+
 protected:
   vtkPlusLineSegmentationAlgo();
   virtual ~vtkPlusLineSegmentationAlgo();
@@ -89,17 +96,28 @@ protected:
 
   PlusStatus ComputeVideoPositionMetric();
 
-  PlusStatus FindPeakStart(std::deque<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
+  /*!
+    Detect the line on a single frame. Called concurrently for different frames, the intensity profile and peak position vectors are scratch buffers of the calling thread.
+    Returns with failure if no line is detected on the frame. The line parameters and the signal value are only set if a line is detected.
+  */
+  PlusStatus ComputeVideoPositionMetricForFrame(int frameNumber, std::vector<int>& intensityProfile, std::vector<itk::Point<double, 2> >& intensityPeakPositions,
+      LineParameters& lineParameters, double& signalValue);
+
+  PlusStatus FindPeakStart(std::vector<int>& intensityProfile, int maxFromLargestArea, int startOfMaxArea, double& startOfPeak);
 
-  PlusStatus FindLargestPeak(std::deque<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
+  PlusStatus FindLargestPeak(std::vector<int>& intensityProfile, int& maxFromLargestArea, int& maxFromLargestAreaIndex, int& startOfMaxArea);
 
-  PlusStatus ComputeCenterOfGravity(std::deque<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
+  PlusStatus ComputeCenterOfGravity(std::vector<int>& intensityProfile, int startOfMaxArea, double& centerOfGravity);
 
-  void ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, LineParameters& outputParameters);
+  /*!
+    Fit a line to the intensity peak positions with RANSAC. The random number generators of RANSAC are seeded with randomSeed,
+    so that the result only depends on the frame and not on the thread or on the time when the frame is processed.
+  */
+  void ComputeLineParameters(std::vector<itk::Point<double, 2> >& data, unsigned int randomSeed, LineParameters& outputParameters);
 
-  void PlotIntArray(const std::deque<int>& intensityValues);
+  void PlotIntArray(const std::vector<int>& intensityValues);
 
-  void PlotDoubleArray(const std::deque<double>& intensityValues);
+  void PlotDoubleArray(const std::vector<double>& intensityValues);
 
   void SaveIntermediateImage(int frameNumber, CharImageType::Pointer scanlineImage, double x_0, double y_0, double r_x, double r_y, int numOfValidScanlines, const std::vector<itk::Point<double, 2> >& intensityPeakPositions);
 
@@ -109,8 +127,8 @@ protected:
 protected:
   vtkSmartPointer<vtkIGSIOTrackedFrameList> m_TrackedFrameList;
 
-  std::deque<double> m_SignalValues;
-  std::deque<double> m_SignalTimestamps;
+  std::vector<double> m_SignalValues;
+  std::vector<double> m_SignalTimestamps;
   std::vector<LineParameters> m_LineParameters;
 
   /*! If "true" then images of intermediate steps (i.e. scanlines used, detected lines) are saved in local directory */
@@ -122,6 +140,9 @@ protected:
   /*! Plot intensity profile for each scanline. Enable for debugging. */
   bool PlotIntensityProfile;
 
+  /*! Number of threads that process the frames in parallel, 0 means the number of hardware threads */
+  int NumberOfThreads;
+
   double m_SignalTimeRangeMin;
   double m_SignalTimeRangeMax;
 
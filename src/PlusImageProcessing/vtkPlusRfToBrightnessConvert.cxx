@@ -15,7 +15,8 @@ See License.txt for details.
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkMath.h"
 
-#include <math.h>
+#include <algorithm>
+#include <cmath>
 
 vtkStandardNewMacro(vtkPlusRfToBrightnessConvert);
 
@@ -28,6 +29,8 @@ vtkPlusRfToBrightnessConvert::vtkPlusRfToBrightnessConvert()
   this->ImageType = US_IMG_TYPE_XX;
   this->BrightnessScale = 10.0;
   this->NumberOfHilbertFilterCoeffs = 64;
+  this->ComputationPrecision = DOUBLE_PRECISION;
+  this->OutputScalarType = VTK_UNSIGNED_CHAR;
 }
 
 //----------------------------------------------------------------------------
@@ -95,8 +98,16 @@ int vtkPlusRfToBrightnessConvert::RequestInformation(vtkInformation*,
   // Set the updated output image size
   outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), outExt, 6);
 
-  // Output is B-mode image, the pixel type is always unsigned 8-bit integer
-  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, -1);
+  // Output is B-mode image, the pixel type is unsigned 8-bit integer or float
+  if (this->OutputScalarType != VTK_UNSIGNED_CHAR && this->OutputScalarType != VTK_FLOAT)
+  {
+    vtkErrorMacro("Unsupported output scalar type: " << vtkImageScalarTypeNameMacro(this->OutputScalarType));
+    return 0;
+  }
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, this->OutputScalarType, -1);
+
+  // The coefficients are shared by all threads, so compute them before the threaded execution
+  this->ComputeHilbertTransformCoeffs();
 
   return 1;
 }
@@ -110,9 +121,9 @@ void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
   vtkImageData** outData,
   int outExt[6], int id)
 {
-  if (outData[0]->GetScalarType() != VTK_UNSIGNED_CHAR)
+  if (outData[0]->GetScalarType() != this->OutputScalarType)
   {
-    vtkErrorMacro("Expecting VTK_UNSIGNED_CHAR output pixel type");
+    vtkErrorMacro("Expecting " << vtkImageScalarTypeNameMacro(this->OutputScalarType) << " output pixel type");
     return;
   }
 
@@ -190,6 +201,33 @@ void vtkPlusRfToBrightnessConvert::ThreadedRequestData(
 
 template<typename ScalarType>
 void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[6], int outExt[6], vtkImageData*** inData, vtkImageData** outData, int threadId)
+{
+  if (this->ComputationPrecision == SINGLE_PRECISION)
+  {
+    if (this->OutputScalarType == VTK_FLOAT)
+    {
+      ThreadedLineByLineEnvelopeDetection<ScalarType, float, float, float>(inExt, outExt, inData, outData, threadId, this->HilbertTransformCoeffsSinglePrecision.data());
+    }
+    else
+    {
+      ThreadedLineByLineEnvelopeDetection<ScalarType, float, float, unsigned char>(inExt, outExt, inData, outData, threadId, this->HilbertTransformCoeffsSinglePrecision.data());
+    }
+  }
+  else
+  {
+    if (this->OutputScalarType == VTK_FLOAT)
+    {
+      ThreadedLineByLineEnvelopeDetection<ScalarType, double, ScalarType, float>(inExt, outExt, inData, outData, threadId, this->HilbertTransformCoeffs.data());
+    }
+    else
+    {
+      ThreadedLineByLineEnvelopeDetection<ScalarType, double, ScalarType, unsigned char>(inExt, outExt, inData, outData, threadId, this->HilbertTransformCoeffs.data());
+    }
+  }
+}
+
+template<typename ScalarType, typename ComputeType, typename HilbertType, typename OutputType>
+void vtkPlusRfToBrightnessConvert::ThreadedLineByLineEnvelopeDetection(int inExt[6], int outExt[6], vtkImageData*** inData, vtkImageData** outData, int threadId, const ComputeType* hilbertTransformCoeffs)
 {
   vtkIdType inInc0 = 0;
   vtkIdType inInc1 = 0;
@@ -201,7 +239,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
   vtkIdType outInc1 = 0;
   vtkIdType outInc2 = 0;
   outData[0]->GetContinuousIncrements(outExt, outInc0, outInc1, outInc2);
-  unsigned char* outPtr = static_cast<unsigned char*>(outData[0]->GetScalarPointerForExtent(outExt));
+  OutputType* outPtr = static_cast<OutputType*>(outData[0]->GetScalarPointerForExtent(outExt));
 
   unsigned long target = static_cast<unsigned long>((outExt[5] - outExt[4] + 1) * (outExt[3] - outExt[2] + 1) / 50.0);
   target++;
@@ -230,7 +268,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
           }
           count++;
         }
-        memcpy(outPtr, inPtrByte, numberOfRfSamplesInScanline + inInc1);
+        std::copy(inPtrByte, inPtrByte + numberOfRfSamplesInScanline, outPtr);
         inPtrByte += numberOfRfSamplesInScanline + inInc1;
         outPtr += numberOfRfSamplesInScanline + outInc1;
       }
@@ -240,7 +278,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
     return;
   }
 
-  ScalarType* hilbertTransformBuffer = new ScalarType[numberOfRfSamplesInScanline + 1];
+  std::vector<HilbertType> hilbertTransformBuffer(numberOfRfSamplesInScanline + 1);
   for (int idx2 = outExt[4]; idx2 <= outExt[5]; ++idx2)
   {
     for (int idx1 = outExt[2]; !this->AbortExecute && idx1 <= outExt[3]; ++idx1)
@@ -265,7 +303,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
             inPtr += numberOfRfSamplesInScanline + inInc1;
             ScalarType* phaseShiftedSignal = inPtr;
             inPtr += numberOfRfSamplesInScanline + inInc1;
-            ComputeAmplitudeILineQLine(outPtr, originalSignal, phaseShiftedSignal, numberOfRfSamplesInScanline);
+            ComputeAmplitudeILineQLine<ComputeType>(outPtr, originalSignal, phaseShiftedSignal, numberOfRfSamplesInScanline);
             outPtr += numberOfBmodeSamplesInScanline + outInc1;
           }
           break;
@@ -273,8 +311,8 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
           {
             // e.g., Ultrasonix
             // RF data: IIIII..., IIIII...
-            ComputeHilbertTransform(hilbertTransformBuffer, inPtr, numberOfRfSamplesInScanline);
-            ComputeAmplitudeILineQLine(outPtr, inPtr, hilbertTransformBuffer, numberOfRfSamplesInScanline);
+            ComputeHilbertTransform(hilbertTransformBuffer.data(), inPtr, numberOfRfSamplesInScanline, hilbertTransformCoeffs);
+            ComputeAmplitudeILineQLine<ComputeType>(outPtr, inPtr, hilbertTransformBuffer.data(), numberOfRfSamplesInScanline);
             inPtr += numberOfRfSamplesInScanline + inInc1;
             outPtr += numberOfBmodeSamplesInScanline + outInc1;
           }
@@ -282,7 +320,7 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
         case US_IMG_RF_IQ_LINE:
           {
             // RF data: IQIQIQ....., IQIQIQIQ.....
-            ComputeAmplitudeIqLine(outPtr, inPtr, numberOfRfSamplesInScanline);
+            ComputeAmplitudeIqLine<ComputeType>(outPtr, inPtr, numberOfRfSamplesInScanline);
             inPtr += numberOfRfSamplesInScanline + inInc1;
             outPtr += numberOfBmodeSamplesInScanline + outInc1;
           }
@@ -298,9 +336,6 @@ void vtkPlusRfToBrightnessConvert::ThreadedLineByLineHilbertTransform(int inExt[
   {
     LOG_ERROR("Unsupported image type for brightness conversion: "<< igsioCommon::GetStringFromUsImageType(this->ImageType));
   }
-
-  delete[] hilbertTransformBuffer;
-  hilbertTransformBuffer = NULL;
 }
 
 void vtkPlusRfToBrightnessConvert::PrintSelf(ostream& os, vtkIndent indent)
@@ -315,6 +350,8 @@ PlusStatus vtkPlusRfToBrightnessConvert::ReadConfiguration(vtkXMLDataElement* rf
   XML_VERIFY_ELEMENT(rfToBrightnessElement, "RfToBrightnessConversion");
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfHilbertFilterCoeffs, rfToBrightnessElement);
   XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, BrightnessScale, rfToBrightnessElement);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(ComputationPrecision, rfToBrightnessElement, "DOUBLE", DOUBLE_PRECISION, "SINGLE", SINGLE_PRECISION);
+  XML_READ_ENUM2_ATTRIBUTE_OPTIONAL(OutputScalarType, rfToBrightnessElement, "UNSIGNED_CHAR", VTK_UNSIGNED_CHAR, "FLOAT", VTK_FLOAT);
   return PLUS_SUCCESS;
 }
 
@@ -327,6 +364,8 @@ PlusStatus vtkPlusRfToBrightnessConvert::WriteConfiguration(vtkXMLDataElement* r
 
   rfToBrightnessElement->SetDoubleAttribute("NumberOfHilbertFilterCoeffs", this->NumberOfHilbertFilterCoeffs);
   rfToBrightnessElement->SetDoubleAttribute("BrightnessScale", this->BrightnessScale);
+  rfToBrightnessElement->SetAttribute("ComputationPrecision", this->ComputationPrecision == SINGLE_PRECISION ? "SINGLE" : "DOUBLE");
+  rfToBrightnessElement->SetAttribute("OutputScalarType", this->OutputScalarType == VTK_FLOAT ? "FLOAT" : "UNSIGNED_CHAR");
 
   return PLUS_SUCCESS;
 }
@@ -346,6 +385,7 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
     // From http://www.vbforums.com/archive/index.php/t-639223.html
     this->HilbertTransformCoeffs[i] = 1 / ((i - this->NumberOfHilbertFilterCoeffs / 2) - 0.5) / vtkMath::Pi();
   }
+  this->HilbertTransformCoeffsSinglePrecision.assign(this->HilbertTransformCoeffs.begin(), this->HilbertTransformCoeffs.end());
 
   bool debugOutput = false; // print Hilbert transform coefficients in Matlab format
   if (debugOutput)
@@ -367,11 +407,9 @@ void vtkPlusRfToBrightnessConvert::ComputeHilbertTransformCoeffs()
   }
 }
 
-template<typename ScalarType>
-PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hilbertTransformOutput, ScalarType* input, int npt)
+template<typename ComputeType, typename ScalarType, typename HilbertType>
+PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(HilbertType* hilbertTransformOutput, ScalarType* input, int npt, const ComputeType* hilbertTransformCoeffs)
 {
-  ComputeHilbertTransformCoeffs(); // update the transform coefficients if needed
-
   if (npt < this->NumberOfHilbertFilterCoeffs)
   {
     LOG_ERROR("Insufficient data for performing Hilbert transform");
@@ -381,18 +419,18 @@ PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hil
   // Compute Hilbert transform by convolution
   for (int l = 1; l <= npt - this->NumberOfHilbertFilterCoeffs + 1; l++)
   {
-    double yt = 0.0;
+    ComputeType yt = 0;
     for (int i = 1; i <= this->NumberOfHilbertFilterCoeffs; i++)
     {
-      yt += input[l + i - 1] * this->HilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs + 1 - i];
+      yt += input[l + i - 1] * hilbertTransformCoeffs[this->NumberOfHilbertFilterCoeffs + 1 - i];
     }
-    hilbertTransformOutput[l] = yt;
+    hilbertTransformOutput[l] = static_cast<HilbertType>(yt);
   }
 
   // Shift this->NumberOfHilbertFilterCoeffs/1+1/2 points
   for (int i = 1; i <= npt - this->NumberOfHilbertFilterCoeffs; i++)
   {
-    hilbertTransformOutput[i] = 0.5 * (hilbertTransformOutput[i] + hilbertTransformOutput[i + 1]);
+    hilbertTransformOutput[i] = static_cast<HilbertType>(static_cast<ComputeType>(0.5) * (hilbertTransformOutput[i] + hilbertTransformOutput[i + 1]));
   }
   for (int i = npt - this->NumberOfHilbertFilterCoeffs; i >= 1; i--)
   {
@@ -402,28 +440,29 @@ PlusStatus vtkPlusRfToBrightnessConvert::ComputeHilbertTransform(ScalarType* hil
   // Pad by zeros
   for (int i = 1; i <= this->NumberOfHilbertFilterCoeffs / 2; i++)
   {
-    hilbertTransformOutput[i] = 0.0;
-    hilbertTransformOutput[npt + 1 - i] = 0.0;
+    hilbertTransformOutput[i] = 0;
+    hilbertTransformOutput[npt + 1 - i] = 0;
   }
 
   return PLUS_SUCCESS;
 }
 
-template<typename ScalarType>
-void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* ampl, ScalarType* inputSignal, ScalarType* inputSignalHilbertTransformed, int npt)
+template<typename ComputeType, typename OutputType, typename ScalarType, typename HilbertType>
+void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(OutputType* ampl, ScalarType* inputSignal, HilbertType* inputSignalHilbertTransformed, int npt)
 {
+  const ComputeType brightnessScale = static_cast<ComputeType>(this->BrightnessScale);
   for (int i = 0; i < this->NumberOfHilbertFilterCoeffs / 2 + 1; i++)
   {
     ampl[i] = 0;
   }
   for (int i = this->NumberOfHilbertFilterCoeffs / 2 + 1; i <= npt - this->NumberOfHilbertFilterCoeffs / 2; i++)
   {
-    double xt = inputSignal[i];
-    double xht = inputSignalHilbertTransformed[i];
-    double brightnessValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = MAX_BRIGHTNESS_VALUE; }
-    if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[i] = brightnessValue;
+    ComputeType xt = inputSignal[i];
+    ComputeType xht = inputSignalHilbertTransformed[i];
+    ComputeType brightnessValue = std::sqrt(std::sqrt(std::sqrt(xt * xt + xht * xht))) * brightnessScale;
+    if (brightnessValue > MAX_BRIGHTNESS_VALUE) { brightnessValue = static_cast<ComputeType>(MAX_BRIGHTNESS_VALUE); }
+    if (brightnessValue < MIN_BRIGHTNESS_VALUE) { brightnessValue = static_cast<ComputeType>(MIN_BRIGHTNESS_VALUE); }
+    ampl[i] = static_cast<OutputType>(brightnessValue);
     /*
     If needed, the phase could be computed as follows:
     phase[i] = atan2(xht ,xt);
@@ -440,19 +479,20 @@ void vtkPlusRfToBrightnessConvert::ComputeAmplitudeILineQLine(unsigned char* amp
   }
 }
 
-template<typename ScalarType>
-void vtkPlusRfToBrightnessConvert::ComputeAmplitudeIqLine(unsigned char* ampl, ScalarType* inputSignal, const int npt)
+template<typename ComputeType, typename OutputType, typename ScalarType>
+void vtkPlusRfToBrightnessConvert::ComputeAmplitudeIqLine(OutputType* ampl, ScalarType* inputSignal, const int npt)
 {
+  const ComputeType brightnessScale = static_cast<ComputeType>(this->BrightnessScale);
   int inputIndex = 0;
   int outputIndex = 0;
   int numberOfIqPairs = floor(double(npt) / 2);
   for (int i = 0; i < numberOfIqPairs; i++)
   {
-    double xt = inputSignal[inputIndex++];
-    double xht = inputSignal[inputIndex++];
-    double outputValue = sqrt(sqrt(sqrt(xt * xt + xht * xht))) * this->BrightnessScale;
-    if (outputValue > MAX_BRIGHTNESS_VALUE) { outputValue = MAX_BRIGHTNESS_VALUE; }
-    if (outputValue < MIN_BRIGHTNESS_VALUE) { outputValue = MIN_BRIGHTNESS_VALUE; }
-    ampl[outputIndex++] = outputValue;
+    ComputeType xt = inputSignal[inputIndex++];
+    ComputeType xht = inputSignal[inputIndex++];
+    ComputeType outputValue = std::sqrt(std::sqrt(std::sqrt(xt * xt + xht * xht))) * brightnessScale;
+    if (outputValue > MAX_BRIGHTNESS_VALUE) { outputValue = static_cast<ComputeType>(MAX_BRIGHTNESS_VALUE); }
+    if (outputValue < MIN_BRIGHTNESS_VALUE) { outputValue = static_cast<ComputeType>(MIN_BRIGHTNESS_VALUE); }
+    ampl[outputIndex++] = static_cast<OutputType>(outputValue);
   }
 }
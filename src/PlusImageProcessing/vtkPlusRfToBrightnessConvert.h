@@ -29,7 +29,14 @@ chosen because it provides a somewhat more linear mapping than log(.) function f
 range (16 bits).
 
 The input image type must be VTK_SHORT (signed 16-bit) and the output image type
-is always VTK_UNSIGNED_CHAR (unsigned 8-bit).
+is VTK_UNSIGNED_CHAR (unsigned 8-bit) by default. If OutputScalarType is set to VTK_FLOAT then
+the brightness values are not quantized, which allows scan conversion of the float envelope
+without loss of precision.
+
+By default the computation is performed in double precision. If ComputationPrecision is set to
+SINGLE_PRECISION then the Hilbert transform, amplitude computation and dynamic range compression
+are computed and stored in float (32-bit), which halves the memory bandwidth of the intermediate
+buffers. The result differs from the double precision computation by a few brightness levels at most.
 
 \ingroup PlusLibImageProcessingAlgo
 */ 
@@ -56,6 +63,22 @@ public:
   vtkSetMacro(BrightnessScale, double);
   vtkGetMacro(BrightnessScale, double);
 
+  enum ComputationPrecisionType
+  {
+    DOUBLE_PRECISION, /*!< Compute in double precision, Hilbert transform is stored in the input pixel type */
+    SINGLE_PRECISION  /*!< Compute and store intermediate results in float */
+  };
+
+  /*! Floating-point precision of the envelope detection and dynamic range compression */
+  vtkSetMacro(ComputationPrecision, ComputationPrecisionType);
+  vtkGetMacro(ComputationPrecision, ComputationPrecisionType);
+
+  /*! Pixel type of the output image. VTK_UNSIGNED_CHAR (default) and VTK_FLOAT are supported, the output value range is 0-255 in both cases. */
+  vtkSetMacro(OutputScalarType, int);
+  vtkGetMacro(OutputScalarType, int);
+  void SetOutputScalarTypeToUnsignedChar() { this->SetOutputScalarType(VTK_UNSIGNED_CHAR); }
+  void SetOutputScalarTypeToFloat() { this->SetOutputScalarType(VTK_FLOAT); }
+
 protected:
   vtkPlusRfToBrightnessConvert();
   ~vtkPlusRfToBrightnessConvert();
@@ -73,21 +96,30 @@ protected:
   /*! Compute the Hilbert transform coefficients. Used by the ComputeHilbertTransform method. */
   virtual void ComputeHilbertTransformCoeffs();
 
-  /*! Essentialy, a templated version of ThreadedRequestData */
+  /*! Essentialy, a templated version of ThreadedRequestData. Selects the computation and output types. */
   template<typename ScalarType>
   void ThreadedLineByLineHilbertTransform(int inExt[6], int outExt[6], vtkImageData ***inData, vtkImageData **outData, int threadId);
 
-  /*! Compute the Hilbert transform (90 deg phase shift) of a signal */
-  template<typename ScalarType>
-  PlusStatus ComputeHilbertTransform(ScalarType *hilbertTransformOutput, ScalarType *input, int npt);
+  /*!
+    Compute the brightness image line by line
+    \param ComputeType Floating-point type of the computation
+    \param HilbertType Pixel type of the Hilbert transformed signal
+    \param OutputType Output pixel type
+  */
+  template<typename ScalarType, typename ComputeType, typename HilbertType, typename OutputType>
+  void ThreadedLineByLineEnvelopeDetection(int inExt[6], int outExt[6], vtkImageData ***inData, vtkImageData **outData, int threadId, const ComputeType* hilbertTransformCoeffs);
+
+  /*! Compute the Hilbert transform (90 deg phase shift) of a signal. Coefficients must be computed by ComputeHilbertTransformCoeffs. */
+  template<typename ComputeType, typename ScalarType, typename HilbertType>
+  PlusStatus ComputeHilbertTransform(HilbertType *hilbertTransformOutput, ScalarType *input, int npt, const ComputeType* hilbertTransformCoeffs);
   
   /*! Compute amplitude from the original and Hilbert transformed RF data. npt is the number of samples in the input signal */
-  template<typename ScalarType>
-  void ComputeAmplitudeILineQLine(unsigned char *ampl, ScalarType *inputSignal, ScalarType *inputSignalHilbertTransformed, int npt);
+  template<typename ComputeType, typename OutputType, typename ScalarType, typename HilbertType>
+  void ComputeAmplitudeILineQLine(OutputType *ampl, ScalarType *inputSignal, HilbertType *inputSignalHilbertTransformed, int npt);
   
   /*! Compute amplitude from IQ encoded RF data. npt is the number of IQ pairs * 2. */
-  template<typename ScalarType>
-  void ComputeAmplitudeIqLine(unsigned char *ampl, ScalarType *inputSignal, const int npt);
+  template<typename ComputeType, typename OutputType, typename ScalarType>
+  void ComputeAmplitudeIqLine(OutputType *ampl, ScalarType *inputSignal, const int npt);
 
   /*! Scaling of the brightness output. Higher value means brighter image. */
   double BrightnessScale;
@@ -98,6 +130,15 @@ protected:
   /*! Coefficients of the Hilbert transform, computed from the NumberOfHilbertFilterCoeffs */
   std::vector<double> HilbertTransformCoeffs;
 
+  /*! Single precision copy of HilbertTransformCoeffs */
+  std::vector<float> HilbertTransformCoeffsSinglePrecision;
+
+  /*! Floating-point precision of the computation */
+  ComputationPrecisionType ComputationPrecision;
+
+  /*! Pixel type of the output image */
+  int OutputScalarType;
+
   /*! Image type (RF_IQ_LINE, RF_I_LINE_Q_LINE, ...) */
   US_IMAGE_TYPE ImageType;
 
@@ -0,0 +1,220 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusStreamingSequenceProcessor.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOMetaImageSequenceIO.h>
+#include <vtkIGSIOSequenceIO.h>
+#include <vtkIGSIOSequenceIOBase.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusStreamingSequenceProcessor);
+
+//----------------------------------------------------------------------------
+vtkPlusStreamingSequenceProcessor::vtkPlusStreamingSequenceProcessor()
+  : NumberOfThreads(0)
+  , ChunkSize(32)
+  , UseCompression(true)
+  , ImageOrientationInFile(US_IMG_ORIENT_MF)
+  , ReleaseInputFrames(true)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusStreamingSequenceProcessor::~vtkPlusStreamingSequenceProcessor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusStreamingSequenceProcessor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+  os << indent << "ChunkSize: " << this->ChunkSize << std::endl;
+  os << indent << "UseCompression: " << (this->UseCompression ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "ImageOrientationInFile: " << igsioCommon::GetStringFromUsImageOrientation(this->ImageOrientationInFile) << std::endl;
+  os << indent << "ReleaseInputFrames: " << (this->ReleaseInputFrames ? "TRUE" : "FALSE") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkPlusStreamingSequenceProcessor::GetNumberOfWorkerThreads() const
+{
+  if (this->NumberOfThreads == 0)
+  {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  return this->NumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceProcessor::Process(vtkIGSIOTrackedFrameList* inputFrames, const std::string& outputFilePath, FrameProcessingFunction processFrame)
+{
+  if (inputFrames == NULL || inputFrames->GetNumberOfTrackedFrames() == 0)
+  {
+    LOG_ERROR("No frames to process, output file is not written: " << outputFilePath);
+    return PLUS_FAIL;
+  }
+
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> writer = vtkSmartPointer<vtkIGSIOSequenceIOBase>::Take(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(outputFilePath));
+  if (writer == NULL)
+  {
+    LOG_ERROR("Could not create writer for file: " << outputFilePath);
+    return PLUS_FAIL;
+  }
+  bool useCompression = this->UseCompression;
+  if (useCompression && vtkIGSIOMetaImageSequenceIO::CanWriteFile(outputFilePath.c_str()))
+  {
+    // Compressed metaimage files cannot be written incrementally
+    LOG_WARNING("Compressed saving of metaimage file requested. This is not supported. Reverting to uncompressed metaimage file.");
+    useCompression = false;
+  }
+  writer->SetUseCompression(useCompression);
+  writer->SetImageOrientationInFile(this->ImageOrientationInFile);
+  writer->SetFileName(outputFilePath);
+
+  const unsigned int numberOfThreads = this->GetNumberOfWorkerThreads();
+  const int numberOfFrames = static_cast<int>(inputFrames->GetNumberOfTrackedFrames());
+  LOG_INFO("Processing " << numberOfFrames << " frames using " << numberOfThreads << " threads, writing to " << outputFilePath);
+
+  // While a chunk is written the other one is processed
+  vtkSmartPointer<vtkIGSIOTrackedFrameList> chunkFrames[2] = { vtkSmartPointer<vtkIGSIOTrackedFrameList>::New(), vtkSmartPointer<vtkIGSIOTrackedFrameList>::New() };
+  std::thread writerThread;
+  PlusStatus writeStatus = PLUS_SUCCESS;
+  bool headerPrepared = false;
+  bool isData3D = false;
+  int numberOfWrittenFrames = 0;
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (int firstFrameIndex = 0, chunkIndex = 0; firstFrameIndex < numberOfFrames; firstFrameIndex += this->ChunkSize, ++chunkIndex)
+  {
+    const int endFrameIndex = std::min(firstFrameIndex + this->ChunkSize, numberOfFrames);
+    vtkIGSIOTrackedFrameList* chunk = chunkFrames[chunkIndex % 2];
+    chunk->Clear();
+    for (int frameIndex = firstFrameIndex; frameIndex < endFrameIndex; ++frameIndex)
+    {
+      chunk->AddTrackedFrame(inputFrames->GetTrackedFrame(frameIndex));
+    }
+
+    // Each worker picks the next unprocessed frame of the chunk until all of them are processed
+    std::atomic<int> nextFrameIndex(0);
+    std::atomic<bool> processingFailed(false);
+    const int numberOfChunkFrames = endFrameIndex - firstFrameIndex;
+    std::function<void(unsigned int)> worker = [chunk, firstFrameIndex, numberOfChunkFrames, &nextFrameIndex, &processingFailed, &processFrame](unsigned int threadIndex)
+    {
+      for (int frameIndex = nextFrameIndex++; frameIndex < numberOfChunkFrames; frameIndex = nextFrameIndex++)
+      {
+        if (processFrame(threadIndex, *chunk->GetTrackedFrame(frameIndex)) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to process frame " << firstFrameIndex + frameIndex);
+          processingFailed = true;
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int threadIndex = 1; threadIndex < std::min<unsigned int>(numberOfThreads, numberOfChunkFrames); ++threadIndex)
+    {
+      workers.push_back(std::thread(worker, threadIndex));
+    }
+    // the calling thread is also used as a worker
+    worker(0);
+    for (std::vector<std::thread>::iterator workerIt = workers.begin(); workerIt != workers.end(); ++workerIt)
+    {
+      workerIt->join();
+    }
+
+    if (this->ReleaseInputFrames)
+    {
+      for (int frameIndex = firstFrameIndex; frameIndex < endFrameIndex; ++frameIndex)
+      {
+        *inputFrames->GetTrackedFrame(frameIndex) = igsioTrackedFrame();
+      }
+    }
+
+    // Wait for the previous chunk to be written before the file is appended again
+    if (writerThread.joinable())
+    {
+      writerThread.join();
+    }
+    if (processingFailed || writeStatus != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+      break;
+    }
+
+    if (chunkIndex == 0)
+    {
+      isData3D = (chunk->GetTrackedFrame(0)->GetFrameSize()[2] > 1);
+    }
+    numberOfWrittenFrames += numberOfChunkFrames;
+    writerThread = std::thread([this, &writer, chunk, &headerPrepared, &writeStatus]()
+    {
+      writeStatus = this->WriteChunk(writer, chunk, headerPrepared);
+    });
+  }
+
+  if (writerThread.joinable())
+  {
+    writerThread.join();
+  }
+  if (writeStatus != PLUS_SUCCESS)
+  {
+    status = PLUS_FAIL;
+  }
+
+  if (headerPrepared)
+  {
+    // Fix the header to contain the correct number of frames
+    writer->UpdateDimensionsCustomStrings(numberOfWrittenFrames, isData3D);
+    writer->UpdateFieldInImageHeader(writer->GetDimensionSizeString());
+    writer->UpdateFieldInImageHeader(writer->GetDimensionKindsString());
+    writer->FinalizeHeader();
+    writer->Close();
+  }
+
+  if (status != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Processing of the sequence failed, output file is incomplete: " << outputFilePath);
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Sucessfully wrote " << numberOfWrittenFrames << " frames to " << outputFilePath);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusStreamingSequenceProcessor::WriteChunk(vtkIGSIOSequenceIOBase* writer, vtkIGSIOTrackedFrameList* chunkFrames, bool& headerPrepared)
+{
+  writer->SetTrackedFrameList(chunkFrames);
+  if (!headerPrepared)
+  {
+    if (writer->PrepareHeader() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to prepare header of file: " << writer->GetFileName());
+      return PLUS_FAIL;
+    }
+    headerPrepared = true;
+  }
+  if (writer->AppendImagesToHeader() != PLUS_SUCCESS || writer->WriteImages() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to append images to file: " << writer->GetFileName());
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
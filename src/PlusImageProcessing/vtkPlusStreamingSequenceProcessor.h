@@ -0,0 +1,100 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusStreamingSequenceProcessor_h
+#define __vtkPlusStreamingSequenceProcessor_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusImageProcessingExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STL includes
+#include <functional>
+#include <string>
+
+class igsioTrackedFrame;
+class vtkIGSIOSequenceIOBase;
+class vtkIGSIOTrackedFrameList;
+
+/*!
+  \class vtkPlusStreamingSequenceProcessor
+  \brief Processes the frames of a sequence on multiple threads and writes the results to file incrementally
+
+  Frames are processed in chunks of ChunkSize frames. The frames of a chunk are copied, the copies are
+  processed in place by NumberOfThreads threads, then the chunk is appended to the output file in the
+  original frame order while the next chunk is being processed. Memory usage of the output is therefore
+  limited to two chunks instead of the whole sequence. If ReleaseInputFrames is enabled then the input
+  frames are also released as soon as they are processed.
+
+  The processing function is called concurrently from multiple threads with a thread index in the range
+  of [0, GetNumberOfWorkerThreads()-1]. It must only use objects that belong to that thread index
+  (typically each thread has its own processing algorithm instance).
+
+  \ingroup PlusLibImageProcessingAlgo
+*/
+class vtkPlusImageProcessingExport vtkPlusStreamingSequenceProcessor : public vtkObject
+{
+public:
+  static vtkPlusStreamingSequenceProcessor* New();
+  vtkTypeMacro(vtkPlusStreamingSequenceProcessor, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Function that processes a frame in place */
+  typedef std::function<PlusStatus(unsigned int threadIndex, igsioTrackedFrame& frame)> FrameProcessingFunction;
+
+  /*! Number of processing threads. 0 means the number of hardware threads. */
+  vtkSetMacro(NumberOfThreads, unsigned int);
+  vtkGetMacro(NumberOfThreads, unsigned int);
+
+  /*! Number of processing threads that are actually used (NumberOfThreads, with 0 resolved to the number of hardware threads) */
+  unsigned int GetNumberOfWorkerThreads() const;
+
+  /*! Number of frames that are processed before they are written to file */
+  vtkSetClampMacro(ChunkSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(ChunkSize, int);
+
+  /*! Compress the image data in the output file */
+  vtkSetMacro(UseCompression, bool);
+  vtkGetMacro(UseCompression, bool);
+
+  /*! Orientation of the images in the output file */
+  vtkSetMacro(ImageOrientationInFile, US_IMAGE_ORIENTATION);
+  vtkGetMacro(ImageOrientationInFile, US_IMAGE_ORIENTATION);
+
+  /*! Release the image data of the input frames after they are processed, to reduce memory usage */
+  vtkSetMacro(ReleaseInputFrames, bool);
+  vtkGetMacro(ReleaseInputFrames, bool);
+
+  /*!
+    Process all input frames and write the results to a sequence file
+    \param inputFrames Frames to process. The frames are not modified, but they are released if ReleaseInputFrames is enabled.
+    \param outputFilePath Full path of the output sequence file
+    \param processFrame Function that processes a copy of an input frame in place
+  */
+  PlusStatus Process(vtkIGSIOTrackedFrameList* inputFrames, const std::string& outputFilePath, FrameProcessingFunction processFrame);
+
+protected:
+  vtkPlusStreamingSequenceProcessor();
+  virtual ~vtkPlusStreamingSequenceProcessor();
+
+  /*! Append the frames of a chunk to the output file. The header is written with the first chunk. */
+  PlusStatus WriteChunk(vtkIGSIOSequenceIOBase* writer, vtkIGSIOTrackedFrameList* chunkFrames, bool& headerPrepared);
+
+  unsigned int NumberOfThreads;
+  int ChunkSize;
+  bool UseCompression;
+  US_IMAGE_ORIENTATION ImageOrientationInFile;
+  bool ReleaseInputFrames;
+
+private:
+  vtkPlusStreamingSequenceProcessor(const vtkPlusStreamingSequenceProcessor&);  // Not implemented.
+  void operator=(const vtkPlusStreamingSequenceProcessor&);  // Not implemented.
+};
+
+#endif
@@ -24,6 +24,7 @@ See License.txt for details.
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 
+#include <algorithm>
 #include <cmath>
 
 //----------------------------------------------------------------------------
@@ -45,6 +46,31 @@ void vtkPlusTransverseProcessEnhancer::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
+//----------------------------------------------------------------------------
+// Removes the outline pixels of a bone area from the image. In each row of the area, the
+// first outline pixel found is removed together with the rest of the outline behind it.
+void vtkPlusTransverseProcessEnhancer::RemoveBoneOutline(vtkImageData* inputImage, const BoneArea& area)
+{
+  for (int y = area.YMax; y >= area.YMin; --y)
+  {
+    unsigned char* rowPixels = static_cast<unsigned char*>(inputImage->GetScalarPointer(0, y, 0));
+
+    //search through the area where the pixels are known to be
+    for (int x = area.XMax - this->BonePushBackPx; x >= area.XMin - this->BonePushBackPx && x >= 0; --x)
+    {
+      if (rowPixels[x] != 0)
+      {
+        //remove all pixels in the outline
+        for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex <= x; ++removeBonex)
+        {
+          rowPixels[removeBonex] = 0;
+        }
+        break;
+      }
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 // Takes a vtkSmartPointer<vtkImageData> with clearly defined possible bone segments as an
 // argument and modifies it so the bone areas that are too close to the camera's edge are removed.
@@ -53,43 +79,40 @@ void vtkPlusTransverseProcessEnhancer::RemoveOffCameraBones(vtkSmartPointer<vtkI
   int dims[3] = { 0, 0, 0 };
   inputImage->GetDimensions(dims);
 
-  unsigned char* vOutput = 0;
-
   int distanceVerticalBuffer = 10;    // For a bone to be valid, it must be this distance from the transducer
   int distanceHorizontalBuffer = 20;  // For a bone to be valid, it must be this distance from the horizontal sides of the frame
   int boneMinSize = 10;               // Minimum bone size a bone must have to be valid
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
 
   int boneHalfLen;
   bool clearArea;
-  bool foundBone;
-
-  this->BoneAreasInfo.clear();
 
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  // Areas are processed from the last one to the first one and the valid areas are kept in this order
+  std::reverse(this->BoneAreasInfo.begin(), this->BoneAreasInfo.end());
+  size_t numberOfValidAreas = 0;
+  for (size_t areaIndex = 0; areaIndex < this->BoneAreasInfo.size(); ++areaIndex)
   {
-    std::map<std::string, int> currentArea = boneAreas.at(areaIndex);
+    const BoneArea& currentArea = this->BoneAreasInfo[areaIndex];
 
     clearArea = false;
-    boneHalfLen = ((currentArea["yMax"] - currentArea["yMin"]) + 1) / 2;
+    boneHalfLen = ((currentArea.YMax - currentArea.YMin) + 1) / 2;
 
     //check if the bone is to close too the scan's edge
-    if (currentArea["yMax"] + distanceVerticalBuffer >= dims[1] - 1 || currentArea["yMin"] - distanceVerticalBuffer <= 0)
+    if (currentArea.YMax + distanceVerticalBuffer >= dims[1] - 1 || currentArea.YMin - distanceVerticalBuffer <= 0)
     {
       clearArea = true;
     }
     //check if given the size, the bone is too close to the scan's edge
-    else if (boneHalfLen + currentArea["yMax"] >= dims[1] - 1 || (currentArea["yMin"] - 1) - boneHalfLen <= 0)
+    else if (boneHalfLen + currentArea.YMax >= dims[1] - 1 || (currentArea.YMin - 1) - boneHalfLen <= 0)
     {
       clearArea = true;
     }
     //check if the bone is too close/far from the transducer 
-    else if (currentArea["depth"] < distanceHorizontalBuffer || currentArea["depth"] > dims[0] - distanceHorizontalBuffer)
+    else if (currentArea.Depth < distanceHorizontalBuffer || currentArea.Depth > dims[0] - distanceHorizontalBuffer)
     {
       clearArea = true;
     }
     //check if the bone is to small
-    else if (currentArea["yMax"] - currentArea["yMin"] <= boneMinSize)
+    else if (currentArea.YMax - currentArea.YMin <= boneMinSize)
     {
       clearArea = true;
     }
@@ -97,35 +120,15 @@ void vtkPlusTransverseProcessEnhancer::RemoveOffCameraBones(vtkSmartPointer<vtkI
     //If it does not meet the criteria, remove the bones in this area
     if (clearArea == true)
     {
-      //search through the area where the pixels are known to be
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-      {
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-
-            foundBone = true;
-          }
-          x--;
-        }
-      }
+      this->RemoveBoneOutline(inputImage, currentArea);
     }
     else
     {
-      this->BoneAreasInfo.push_back(currentArea);
+      this->BoneAreasInfo[numberOfValidAreas++] = currentArea;
     }
   }
+  this->BoneAreasInfo.resize(numberOfValidAreas);
+  inputImage->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -139,7 +142,6 @@ void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkIma
   inputImage->GetDimensions(dims);
 
   float vInput = 0;
-  unsigned char* vOutput = 0;
 
   //Variables used for measuring the size and intensity sum for bone, above, and below areas
   int boneLen;
@@ -153,48 +155,48 @@ void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkIma
   float areaAvgShadow;  //Shadow intensity of the area
   float belowAvgShadow; //Shadow intensity of the below area
 
-  std::map<std::string, int> currentArea;
-  std::vector<std::map<std::string, int> > boneAreas = this->BoneAreasInfo;
-
-  bool foundBone;
-  this->BoneAreasInfo.clear();
-
-  for (int areaIndex = boneAreas.size() - 1; areaIndex >= 0; --areaIndex)
+  // Areas are processed from the last one to the first one and the valid areas are kept in this order
+  std::reverse(this->BoneAreasInfo.begin(), this->BoneAreasInfo.end());
+  size_t numberOfValidAreas = 0;
+  for (size_t areaIndex = 0; areaIndex < this->BoneAreasInfo.size(); ++areaIndex)
   {
-    currentArea = boneAreas.at(areaIndex);
+    const BoneArea& currentArea = this->BoneAreasInfo[areaIndex];
 
     aboveSum = 0;
     areaSum = 0;
     belowSum = 0;
 
-    boneLen = (currentArea["yMax"] - currentArea["yMin"]) + 1;
+    boneLen = (currentArea.YMax - currentArea.YMin) + 1;
     boneHalfLen = boneLen / 2;
-    boneArea = boneLen * currentArea["depth"];
+    boneArea = boneLen * currentArea.Depth;
 
     //gather sum of shadow areas from above the area
-    for (int y = currentArea["yMax"] + boneHalfLen; y > currentArea["yMax"]; --y)
+    for (int y = currentArea.YMax + boneHalfLen; y > currentArea.YMax; --y)
     {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
+      const unsigned char* rowPixels = static_cast<unsigned char*>(originalImage->GetScalarPointer(0, y, 0));
+      for (int x = dims[0] - 1; x >= currentArea.Depth; --x)
       {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
+        vInput = rowPixels[x];
         aboveSum += vInput;
       }
     }
     //gather sum of shadow areas from the area
-    for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
+    for (int y = currentArea.YMax; y >= currentArea.YMin; --y)
     {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
+      const unsigned char* rowPixels = static_cast<unsigned char*>(originalImage->GetScalarPointer(0, y, 0));
+      for (int x = dims[0] - 1; x >= currentArea.Depth; --x)
       {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
+        vInput = rowPixels[x];
         areaSum += vInput;
       }
     }
     //gather sum of shadow areas from below the area
-    for (int y = currentArea["yMin"] - boneHalfLen; y < currentArea["yMin"]; ++y)
+    for (int y = currentArea.YMin - boneHalfLen; y < currentArea.YMin; ++y)
     {
-      for (int x = dims[0] - 1; x >= currentArea["depth"]; --x)
+      const unsigned char* rowPixels = static_cast<unsigned char*>(originalImage->GetScalarPointer(0, y, 0));
+      for (int x = dims[0] - 1; x >= currentArea.Depth; --x)
       {
-        vInput = (originalImage->GetScalarComponentAsFloat(x, y, 0, 0));
+        vInput = rowPixels[x];
         belowSum += vInput;
       }
     }
@@ -207,36 +209,15 @@ void vtkPlusTransverseProcessEnhancer::CompareShadowAreas(vtkSmartPointer<vtkIma
     //If there is a higher amount of bones around it, remove the area
     if (aboveAvgShadow - areaAvgShadow <= areaAvgShadow / 2 || belowAvgShadow - areaAvgShadow <= areaAvgShadow / 2)
     {
-
-      for (int y = currentArea["yMax"]; y >= currentArea["yMin"]; --y)
-      {
-        //search through the area where the pixels are known to be
-        int x = currentArea["xMax"] - this->BonePushBackPx;
-        foundBone = false;
-        while (x >= currentArea["xMin"] - this->BonePushBackPx && x >= 0 && foundBone == false)
-        {
-          vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(x, y, 0));
-          if (*vOutput != 0)
-          {
-            //remove all pixels in the outline
-            *vOutput = 0;
-
-            for (int removeBonex = std::max(0, x - (this->BoneOutlineDepthPx - 1)); removeBonex < x; ++removeBonex)
-            {
-              vOutput = static_cast<unsigned char*>(inputImage->GetScalarPointer(removeBonex, y, 0));
-              *vOutput = 0;
-            }
-            foundBone = true;
-          }
-          x--;
-        }
-      }
+      this->RemoveBoneOutline(inputImage, currentArea);
     }
     else
     {
-      this->BoneAreasInfo.push_back(currentArea);
+      this->BoneAreasInfo[numberOfValidAreas++] = currentArea;
     }
   }
+  this->BoneAreasInfo.resize(numberOfValidAreas);
+  inputImage->Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -246,21 +227,24 @@ PlusStatus vtkPlusTransverseProcessEnhancer::ProcessFrame(igsioTrackedFrame* inp
   this->BoneAreasInfo.clear();
 
   vtkSmartPointer<vtkImageData> intermediateImage = vtkPlusBoneEnhancer::UnprocessedFrameToLinearImage(inputFrame);
-  intermediateImage->DeepCopy(this->LinesImage);
+  if (intermediateImage == NULL)
+  {
+    return PLUS_FAIL;
+  }
 
-  //Save this image so that it can be used for comparison with the output image
-  vtkSmartPointer<vtkImageData> originalImage = vtkSmartPointer<vtkImageData>::New();
-  originalImage->DeepCopy(intermediateImage);
+  // The lines image is not modified by the noise removal (it works on a copy),
+  // so it can be used for comparison with the output image without making another copy
+  vtkSmartPointer<vtkImageData> originalImage = this->LinesImage;
 
   vtkPlusBoneEnhancer::RemoveNoise(intermediateImage);
 
   this->RemoveOffCameraBones(intermediateImage);
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_09PostFilters_2PostRemoveOffCamera", intermediateImage);
   }
   this->CompareShadowAreas(originalImage, intermediateImage);
-  if (this->SaveIntermediateResults)
+  if (this->IsIntermediateFrameCaptured())
   {
     this->AddIntermediateImage("_09PostFilters_3PostCompareShadowAreas", intermediateImage);
   }
@@ -31,6 +31,9 @@ public:
 
   virtual const char* GetProcessorTypeName() { return "vtkPlusTransverseProcessEnhancer"; };
 
+  /*! Number of intermediate images that are saved per processed frame, including the shadow area steps */
+  virtual int GetNumberOfIntermediateImageStages() { return vtkPlusBoneEnhancer::GetNumberOfIntermediateImageStages() + 2; };
+
   /*! Process input frame to localize transverse process bone surfaces */
   PlusStatus ProcessFrame(igsioTrackedFrame* inputFrame, igsioTrackedFrame* outputFrame);
 
@@ -42,6 +45,9 @@ protected:
   vtkPlusTransverseProcessEnhancer();
   virtual ~vtkPlusTransverseProcessEnhancer();
 
+  /*! Remove the outline of a bone area that is found to be invalid */
+  void RemoveBoneOutline(vtkImageData* inputImage, const BoneArea& area);
+
 private:
   vtkPlusTransverseProcessEnhancer(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
   void operator=(const vtkPlusTransverseProcessEnhancer&);  // Not implemented.
@@ -8,8 +8,36 @@ See License.txt for details.
 
 #include "vtkPlusUsScanConvert.h"
 
+#include "vtkImageData.h"
 #include "vtkObjectFactory.h"
 
+#include <algorithm>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  template<class T>
+  void GatherScanLineSamples(const T* inputPixels, const vtkPlusUsScanConvert::ScanLineSamplingTable& table, unsigned char* linesPixels, vtkIdType linesRowIncrement)
+  {
+    const int numberOfSamples = table.NumberOfSamplesPerScanLine;
+    for (int scanLine = 0; scanLine < table.NumberOfScanLines; ++scanLine)
+    {
+      unsigned char* linePixels = linesPixels + scanLine * linesRowIncrement;
+      const vtkIdType* lineSampleOffsets = table.SampleOffsets.data() + static_cast<vtkIdType>(scanLine) * table.NumberOfSamplesPerScanLine;
+      const int firstSample = table.FirstSampleInImage[scanLine];
+      const int endSample = table.EndSampleInImage[scanLine];
+      std::fill(linePixels, linePixels + firstSample, 0);
+      // Branch-free loop over the samples inside the image, so that the compiler can vectorize the gather
+      for (int sampleIndex = firstSample; sampleIndex < endSample; ++sampleIndex)
+      {
+        // Same conversion as vtkImageData::GetScalarComponentAsDouble followed by SetScalarComponentFromFloat
+        linePixels[sampleIndex] = static_cast<unsigned char>(static_cast<float>(static_cast<double>(inputPixels[lineSampleOffsets[sampleIndex]])));
+      }
+      std::fill(linePixels + endSample, linePixels + numberOfSamples, 0);
+    }
+  }
+}
+
 
 //----------------------------------------------------------------------------
 vtkPlusUsScanConvert::vtkPlusUsScanConvert()
@@ -33,6 +61,11 @@ vtkPlusUsScanConvert::vtkPlusUsScanConvert()
   this->TransducerCenterPixelSpecified = false;
   this->TransducerCenterPixel[0] = 0;
   this->TransducerCenterPixel[1] = 0;
+  this->SamplingTable.NumberOfScanLines = 0;
+  this->SamplingTable.NumberOfSamplesPerScanLine = 0;
+  std::fill(this->SamplingTableInputImageExtent, this->SamplingTableInputImageExtent + 4, 0);
+  std::fill(this->SamplingTableImageExtent, this->SamplingTableImageExtent + 4, 0);
+  std::fill(this->SamplingTableImageIncrements, this->SamplingTableImageIncrements + 2, 0);
 }
 
 //----------------------------------------------------------------------------
@@ -99,6 +132,9 @@ PlusStatus vtkPlusUsScanConvert::ReadConfiguration(vtkXMLDataElement* scanConver
     this->TransducerCenterPixel[1] = transducerCenterPixel[1];
   }
 
+  // Geometry members are set directly
+  this->Modified();
+
   return PLUS_SUCCESS;
 }
 
@@ -137,3 +173,124 @@ FrameSizeType vtkPlusUsScanConvert::GetOutputImageSizePixel()
                             };
   return frameSize;
 }
+
+//-----------------------------------------------------------------------------
+const vtkPlusUsScanConvert::ScanLineSamplingTable& vtkPlusUsScanConvert::GetScanLineSamplingTable(const int imageExtent[6], const vtkIdType imageIncrements[3])
+{
+  const int numberOfSamples = this->InputImageExtent[1] - this->InputImageExtent[0] + 1;
+  const int numberOfScanLines = this->InputImageExtent[3] - this->InputImageExtent[2] + 1;
+
+  // The table is keyed on the scanline end points and not on the modification time, because setting
+  // the input image modifies the algorithm. Computing the end points is cheap compared to the table.
+  std::vector<double> scanLineEndPoints(4 * static_cast<size_t>(std::max(0, numberOfScanLines)), 0.0);
+  for (int scanLine = 0; scanLine < numberOfScanLines; ++scanLine)
+  {
+    double start[4] = { 0, 0, 0, 0 };
+    double end[4] = { 0, 0, 0, 0 };
+    this->GetScanLineEndPoints(scanLine, start, end);
+    scanLineEndPoints[4 * scanLine] = start[0];
+    scanLineEndPoints[4 * scanLine + 1] = start[1];
+    scanLineEndPoints[4 * scanLine + 2] = end[0];
+    scanLineEndPoints[4 * scanLine + 3] = end[1];
+  }
+  if (this->SamplingTableBuildTime.GetMTime() > 0
+      && scanLineEndPoints == this->SamplingTableScanLineEndPoints
+      && std::equal(this->InputImageExtent, this->InputImageExtent + 4, this->SamplingTableInputImageExtent)
+      && std::equal(imageExtent, imageExtent + 4, this->SamplingTableImageExtent)
+      && std::equal(imageIncrements, imageIncrements + 2, this->SamplingTableImageIncrements))
+  {
+    return this->SamplingTable;
+  }
+
+  ScanLineSamplingTable& table = this->SamplingTable;
+  table.NumberOfScanLines = std::max(0, numberOfScanLines);
+  table.NumberOfSamplesPerScanLine = std::max(0, numberOfSamples);
+  table.SampleOffsets.assign(static_cast<size_t>(table.NumberOfScanLines) * table.NumberOfSamplesPerScanLine, 0);
+  table.FirstSampleInImage.assign(table.NumberOfScanLines, 0);
+  table.EndSampleInImage.assign(table.NumberOfScanLines, 0);
+
+  for (int scanLine = 0; scanLine < table.NumberOfScanLines; ++scanLine)
+  {
+    const double* start = &scanLineEndPoints[4 * scanLine];
+    const double* end = &scanLineEndPoints[4 * scanLine + 2];
+
+    double directionVectorX = 0;
+    double directionVectorY = 0;
+    if (numberOfSamples > 1)
+    {
+      directionVectorX = static_cast<double>(end[0] - start[0]) / (numberOfSamples - 1);
+      directionVectorY = static_cast<double>(end[1] - start[1]) / (numberOfSamples - 1);
+    }
+    vtkIdType* lineSampleOffsets = table.SampleOffsets.data() + static_cast<vtkIdType>(scanLine) * table.NumberOfSamplesPerScanLine;
+    bool inImage = false;
+    for (int sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+    {
+      // Pixel coordinates are truncated, as in the original per-pixel sampling
+      int pixelCoordX = start[0] + directionVectorX * sampleIndex;
+      int pixelCoordY = start[1] + directionVectorY * sampleIndex;
+      if (pixelCoordX < imageExtent[0] || pixelCoordX > imageExtent[1]
+          || pixelCoordY < imageExtent[2] || pixelCoordY > imageExtent[3])
+      {
+        // Pixel coordinates change monotonically along the scanline, so the samples inside the image are contiguous
+        continue;
+      }
+      if (!inImage)
+      {
+        table.FirstSampleInImage[scanLine] = sampleIndex;
+        inImage = true;
+      }
+      table.EndSampleInImage[scanLine] = sampleIndex + 1;
+      lineSampleOffsets[sampleIndex] = (pixelCoordX - imageExtent[0]) * imageIncrements[0] + (pixelCoordY - imageExtent[2]) * imageIncrements[1];
+    }
+  }
+
+  this->SamplingTableScanLineEndPoints.swap(scanLineEndPoints);
+  std::copy(this->InputImageExtent, this->InputImageExtent + 4, this->SamplingTableInputImageExtent);
+  std::copy(imageExtent, imageExtent + 4, this->SamplingTableImageExtent);
+  std::copy(imageIncrements, imageIncrements + 2, this->SamplingTableImageIncrements);
+  this->SamplingTableBuildTime.Modified();
+  LOG_DEBUG("Scanline sampling table computed for " << table.NumberOfScanLines << " scanlines of " << table.NumberOfSamplesPerScanLine << " samples");
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusUsScanConvert::ExtractScanLines(vtkImageData* scanConvertedImage, vtkImageData* linesImage)
+{
+  if (scanConvertedImage == NULL || linesImage == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: invalid input or output image");
+    return PLUS_FAIL;
+  }
+  int* linesExtent = linesImage->GetExtent();
+  if (linesImage->GetScalarType() != VTK_UNSIGNED_CHAR
+      || linesExtent[1] - linesExtent[0] != this->InputImageExtent[1] - this->InputImageExtent[0]
+      || linesExtent[3] - linesExtent[2] != this->InputImageExtent[3] - this->InputImageExtent[2])
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: lines image is expected to be an unsigned char image of "
+              << this->InputImageExtent[1] - this->InputImageExtent[0] + 1 << "x" << this->InputImageExtent[3] - this->InputImageExtent[2] + 1 << " pixels");
+    return PLUS_FAIL;
+  }
+
+  int* inputExtent = scanConvertedImage->GetExtent();
+  const ScanLineSamplingTable& table = this->GetScanLineSamplingTable(inputExtent, scanConvertedImage->GetIncrements());
+  void* inputPixels = scanConvertedImage->GetScalarPointer(inputExtent[0], inputExtent[2], 0);
+  unsigned char* linesPixels = static_cast<unsigned char*>(linesImage->GetScalarPointer(linesExtent[0], linesExtent[2], linesExtent[4]));
+  if (inputPixels == NULL || linesPixels == NULL)
+  {
+    LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: image scalars are not allocated");
+    return PLUS_FAIL;
+  }
+  if (table.NumberOfScanLines > 0 && table.NumberOfSamplesPerScanLine > 0)
+  {
+    vtkIdType linesRowIncrement = linesImage->GetIncrements()[1];
+    switch (scanConvertedImage->GetScalarType())
+    {
+      vtkTemplateMacro(GatherScanLineSamples(static_cast<const VTK_TT*>(inputPixels), table, linesPixels, linesRowIncrement));
+      default:
+        LOG_ERROR("vtkPlusUsScanConvert::ExtractScanLines failed: unsupported scalar type " << scanConvertedImage->GetScalarType());
+        return PLUS_FAIL;
+    }
+  }
+  linesImage->Modified();
+  return PLUS_SUCCESS;
+}
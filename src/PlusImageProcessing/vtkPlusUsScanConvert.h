@@ -9,6 +9,9 @@ See License.txt for details.
 
 #include "vtkPlusImageProcessingExport.h"
 #include "vtkThreadedImageAlgorithm.h"
+#include "vtkTimeStamp.h"
+
+#include <vector>
 
 /*!
 \class vtkPlusUsScanConvert
@@ -66,6 +69,42 @@ public:
   /*! Get the distance between two sample points in the scanline, in mm. Setting of the input image or at least the input image extent is required before calling this method. */
   virtual double GetDistanceBetweenScanlineSamplePointsMm() = 0;
 
+  /*!
+    Positions of the scanline sample points in a scan converted image, see GetScanLineSamplingTable().
+    Samples are taken from the nearest pixel (sample point coordinates are truncated), so no interpolation weights are needed.
+  */
+  struct ScanLineSamplingTable
+  {
+    int NumberOfScanLines;
+    int NumberOfSamplesPerScanLine;
+    /*! Offset of each sample from the first pixel of the image, in scalars. Index is scanLineIndex*NumberOfSamplesPerScanLine+sampleIndex. Only set for samples inside the image. */
+    std::vector<vtkIdType> SampleOffsets;
+    /*! Index of the first sample of each scanline that is inside the image */
+    std::vector<int> FirstSampleInImage;
+    /*! Index after the last sample of each scanline that is inside the image. Samples outside of [FirstSampleInImage, EndSampleInImage) are outside of the image. */
+    std::vector<int> EndSampleInImage;
+  };
+
+  /*!
+    Get the sample positions of all scanlines in an image. Setting of the input image or at least the input image extent is required before calling this method.
+    The table is cached and only recomputed if the scanline end points (transducer geometry), the input image extent or the requested
+    image extent or memory layout change. Setting a new input image does not invalidate the table.
+    \param imageExtent Extent of the scan converted image that the scanlines are sampled from
+    \param imageIncrements Increments of the scan converted image, in scalars (see vtkImageData::GetIncrements())
+  */
+  const ScanLineSamplingTable& GetScanLineSamplingTable(const int imageExtent[6], const vtkIdType imageIncrements[3]);
+
+  /*!
+    Fill an image with the scanlines sampled from a scan converted image. Each row of the lines image is a scanline.
+    Samples that are outside of the scan converted image are set to 0. Only the first scalar component of the scan converted image is used.
+    \param scanConvertedImage Image to sample the scanlines from
+    \param linesImage Output image, it must have unsigned char scalar type and the same size as the input image extent
+  */
+  PlusStatus ExtractScanLines(vtkImageData* scanConvertedImage, vtkImageData* linesImage);
+
+  /*! Get the time when the scanline sampling table was last computed */
+  vtkMTimeType GetScanLineSamplingTableBuildTime() { return this->SamplingTableBuildTime.GetMTime(); };
+
 protected:
   vtkPlusUsScanConvert();
   virtual ~vtkPlusUsScanConvert();
@@ -99,6 +138,17 @@ protected:
   */
   int InputImageExtent[6];
 
+  /*! Cached scanline sample positions, see GetScanLineSamplingTable() */
+  ScanLineSamplingTable SamplingTable;
+  /*! Time when the sampling table was computed */
+  vtkTimeStamp SamplingTableBuildTime;
+  /*! Start and end points (x, y) of the scanlines that the sampling table was computed for, 4 values per scanline */
+  std::vector<double> SamplingTableScanLineEndPoints;
+  /*! Input image extent, image extent and increments that the sampling table was computed for */
+  int SamplingTableInputImageExtent[4];
+  int SamplingTableImageExtent[4];
+  vtkIdType SamplingTableImageIncrements[2];
+
 private:
   vtkPlusUsScanConvert(const vtkPlusUsScanConvert&);  // Not implemented.
   void operator=(const vtkPlusUsScanConvert&);  // Not implemented.
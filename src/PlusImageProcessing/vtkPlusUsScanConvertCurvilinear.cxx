@@ -31,6 +31,7 @@ non-commercial terms in your toolbox and distribute it."
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits>
 
 vtkStandardNewMacro( vtkPlusUsScanConvertCurvilinear );
 
@@ -293,6 +294,9 @@ void vtkPlusUsScanConvertExecute( vtkPlusUsScanConvertCurvilinear* self,
 
   T* image = outPtr; // The resulting image
 
+  // Integer output is rounded, floating-point output (e.g., float envelope) is kept as is
+  const double roundingOffset = std::numeric_limits<T>::is_integer ? 0.5 : 0.0;
+
   std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator firstPoint = self->GetInterpolatedPointArray().begin() + interpolationTableExt[0];
   std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator afterLastPoint = self->GetInterpolatedPointArray().begin() + interpolationTableExt[1] + 1;
   for ( std::vector<vtkPlusUsScanConvertCurvilinear::InterpolatedPoint>::const_iterator it = firstPoint; it != afterLastPoint; ++it )
@@ -303,7 +307,7 @@ void vtkPlusUsScanConvertExecute( vtkPlusUsScanConvertCurvilinear* self,
       + it->weightCoefficients[1] * env_pointer[1] // (+1, +0)
       + it->weightCoefficients[2] * env_pointer[numberOfSamples] // (+0, +1)
       + it->weightCoefficients[3] * env_pointer[numberOfSamples + 1] // (+1, +1)
-      + 0.5; // for rounding
+      + roundingOffset;
   }
 }
 
@@ -0,0 +1,144 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusIgtlTransformTable.h"
+
+// IGSIO includes
+#include <vtkIGSIOTransformRepository.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+//----------------------------------------------------------------------------
+PlusIgtlTransformTable::PlusIgtlTransformTable()
+  : TransformRepository(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusIgtlTransformTable::~PlusIgtlTransformTable()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlTransformTable::Clear()
+{
+  this->Entries.clear();
+  this->EntryIndices.clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlTransformTable::AddRequestedTransform(const igsioTransformName& transformName)
+{
+  bool newEntry(false);
+  this->GetEntryIndex(transformName, newEntry);
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlTransformTable::AddRequestedTransforms(const PlusIgtlClientInfo& clientInfo)
+{
+  for (std::vector<igsioTransformName>::const_iterator nameIt = clientInfo.TransformNames.begin(); nameIt != clientInfo.TransformNames.end(); ++nameIt)
+  {
+    this->AddRequestedTransform(*nameIt);
+  }
+  for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIt = clientInfo.ImageStreams.begin(); imageStreamIt != clientInfo.ImageStreams.end(); ++imageStreamIt)
+  {
+    this->AddRequestedTransform(igsioTransformName(imageStreamIt->Name, imageStreamIt->EmbeddedTransformToFrame));
+  }
+  for (std::vector<PlusIgtlClientInfo::VideoStream>::const_iterator videoStreamIt = clientInfo.VideoStreams.begin(); videoStreamIt != clientInfo.VideoStreams.end(); ++videoStreamIt)
+  {
+    this->AddRequestedTransform(igsioTransformName(videoStreamIt->Name, videoStreamIt->EmbeddedTransformToFrame));
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusIgtlTransformTable::Update(const vtkIGSIOTransformRepository* transformRepository)
+{
+  this->TransformRepository = transformRepository;
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<TransformEntry>::iterator entryIt = this->Entries.begin(); entryIt != this->Entries.end(); ++entryIt)
+  {
+    this->EvaluateEntry(*entryIt);
+    if (entryIt->Result != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusIgtlTransformTable::GetTransform(const igsioTransformName& transformName, vtkMatrix4x4* matrix, ToolStatus* status /*=NULL*/)
+{
+  bool newEntry(false);
+  TransformEntry& entry = this->Entries[this->GetEntryIndex(transformName, newEntry)];
+  if (newEntry)
+  {
+    // Not requested in advance, compute it now and keep it for the following Update() calls
+    this->EvaluateEntry(entry);
+  }
+
+  if (matrix != NULL)
+  {
+    matrix->DeepCopy(entry.Matrix);
+  }
+  if (status != NULL)
+  {
+    *status = entry.Status;
+  }
+  return entry.Result;
+}
+
+//----------------------------------------------------------------------------
+int PlusIgtlTransformTable::GetNumberOfTransforms() const
+{
+  return static_cast<int>(this->Entries.size());
+}
+
+//----------------------------------------------------------------------------
+int PlusIgtlTransformTable::GetEntryIndex(const igsioTransformName& transformName, bool& newEntry)
+{
+  std::pair<std::string, std::string> key(transformName.From(), transformName.To());
+  std::map<std::pair<std::string, std::string>, int>::iterator indexIt = this->EntryIndices.find(key);
+  if (indexIt != this->EntryIndices.end())
+  {
+    newEntry = false;
+    return indexIt->second;
+  }
+
+  TransformEntry entry;
+  entry.Name = transformName;
+  vtkMatrix4x4::Identity(entry.Matrix);
+  entry.Status = TOOL_INVALID;
+  entry.Result = PLUS_FAIL;
+  this->Entries.push_back(entry);
+
+  int index = static_cast<int>(this->Entries.size()) - 1;
+  this->EntryIndices[key] = index;
+  newEntry = true;
+  return index;
+}
+
+//----------------------------------------------------------------------------
+void PlusIgtlTransformTable::EvaluateEntry(TransformEntry& entry)
+{
+  entry.Status = TOOL_INVALID;
+  if (this->TransformRepository == NULL)
+  {
+    vtkMatrix4x4::Identity(entry.Matrix);
+    entry.Result = PLUS_FAIL;
+    return;
+  }
+
+  // Same initial matrix as the callers of vtkIGSIOTransformRepository::GetTransform use, so the output is identical even if the query fails
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  entry.Result = this->TransformRepository->GetTransform(entry.Name, matrix, &entry.Status);
+  vtkMatrix4x4::DeepCopy(entry.Matrix, matrix);
+}
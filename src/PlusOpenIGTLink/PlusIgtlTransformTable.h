@@ -0,0 +1,97 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusIgtlTransformTable_h
+#define __PlusIgtlTransformTable_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusOpenIGTLinkExport.h"
+#include "PlusIgtlClientInfo.h"
+
+// IGSIO includes
+#include <igsioTransformName.h>
+
+// STL includes
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkIGSIOTransformRepository;
+class vtkMatrix4x4;
+
+/*!
+  \class PlusIgtlTransformTable
+  \brief Table of transforms evaluated once per broadcast tick and shared by all clients
+
+  The transforms that the connected clients request (transform names and embedded image/video transforms)
+  are collected once, when the client subscriptions change. Each time Update() is called the requested
+  transforms are computed from the transform repository exactly once, and every message of every client
+  is packed from the stored values, without further transform repository queries.
+
+  Transforms that were not requested in advance are computed from the repository on first use and
+  kept in the table, so that they are evaluated only once per tick as well.
+
+  The values returned by GetTransform() are bit-identical to the values that
+  vtkIGSIOTransformRepository::GetTransform() returns for the same repository state.
+
+  \ingroup PlusLibOpenIGTLink
+*/
+class vtkPlusOpenIGTLinkExport PlusIgtlTransformTable
+{
+public:
+  PlusIgtlTransformTable();
+  virtual ~PlusIgtlTransformTable();
+
+  /*! Remove all requested transforms and stored values */
+  void Clear();
+
+  /*! Add a transform to the list of requested transforms. Each transform is stored only once. */
+  void AddRequestedTransform(const igsioTransformName& transformName);
+
+  /*! Add all transforms that are needed for packing the messages of a client */
+  void AddRequestedTransforms(const PlusIgtlClientInfo& clientInfo);
+
+  /*!
+    Compute all requested transforms from the transform repository.
+    The repository must already contain the transforms of the current frame (see vtkIGSIOTransformRepository::SetTransforms).
+    The repository is also used later for computing transforms that were not requested in advance.
+  */
+  PlusStatus Update(const vtkIGSIOTransformRepository* transformRepository);
+
+  /*!
+    Get a transform from the table. Returns with the same matrix, tool status and return value as
+    vtkIGSIOTransformRepository::GetTransform would for the repository state at the last Update() call.
+  */
+  PlusStatus GetTransform(const igsioTransformName& transformName, vtkMatrix4x4* matrix, ToolStatus* status = NULL);
+
+  /*! Number of transforms that are computed in each Update() call */
+  int GetNumberOfTransforms() const;
+
+protected:
+  struct TransformEntry
+  {
+    igsioTransformName Name;
+    double Matrix[16];
+    ToolStatus Status;
+    PlusStatus Result;
+  };
+
+  /*! Find the entry that belongs to a transform name, add a new one if not found */
+  int GetEntryIndex(const igsioTransformName& transformName, bool& newEntry);
+
+  /*! Compute an entry from the transform repository */
+  void EvaluateEntry(TransformEntry& entry);
+
+  std::vector<TransformEntry> Entries;
+
+  /*! Index of the entries, keyed by (From, To) coordinate frame names */
+  std::map<std::pair<std::string, std::string>, int> EntryIndices;
+
+  const vtkIGSIOTransformRepository* TransformRepository;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusIgtlTransformTableTest.cxx
+  \brief This program tests if the transforms served from a PlusIgtlTransformTable are bit-identical to the ones computed directly by the transform repository
+*/
+
+#include "PlusConfigure.h"
+#include "PlusIgtlClientInfo.h"
+#include "PlusIgtlTransformTable.h"
+#include "igsioTrackedFrame.h"
+#include "vtkIGSIOTransformRepository.h"
+#include "vtkMatrix4x4.h"
+#include "vtkPlusIgtlMessageCommon.h"
+#include "vtkSmartPointer.h"
+#include "vtkTransform.h"
+#include "vtksys/CommandLineArguments.hxx"
+
+#include <cstring>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void SetFrameTransform(igsioTrackedFrame& trackedFrame, const std::string& from, const std::string& to, double angleDeg, double offset, ToolStatus status)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(offset, -0.3 * offset, 1.7 * offset);
+    transform->RotateWXYZ(angleDeg, 0.2, 0.7, -0.4);
+    transform->RotateX(angleDeg / 3.0);
+    igsioTransformName transformName(from, to);
+    trackedFrame.SetFrameTransform(transformName, transform->GetMatrix());
+    trackedFrame.SetFrameTransformStatus(transformName, status);
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareTransforms(vtkIGSIOTransformRepository* repository, PlusIgtlTransformTable& table, const std::vector<igsioTransformName>& names)
+  {
+    int numberOfFailures = 0;
+    for (std::vector<igsioTransformName>::const_iterator nameIt = names.begin(); nameIt != names.end(); ++nameIt)
+    {
+      vtkSmartPointer<vtkMatrix4x4> repositoryMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      ToolStatus repositoryStatus(TOOL_INVALID);
+      PlusStatus repositoryResult = repository->GetTransform(*nameIt, repositoryMatrix, &repositoryStatus);
+
+      vtkSmartPointer<vtkMatrix4x4> tableMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      ToolStatus tableStatus(TOOL_INVALID);
+      PlusStatus tableResult = table.GetTransform(*nameIt, tableMatrix, &tableStatus);
+
+      if (repositoryResult != tableResult || repositoryStatus != tableStatus)
+      {
+        LOG_ERROR("Transform " << nameIt->GetTransformName() << " status mismatch: repository returned " << repositoryResult << " (" << repositoryStatus
+                  << "), table returned " << tableResult << " (" << tableStatus << ")");
+        numberOfFailures++;
+      }
+      if (memcmp(*repositoryMatrix->Element, *tableMatrix->Element, sizeof(double) * 16) != 0)
+      {
+        LOG_ERROR("Transform " << nameIt->GetTransformName() << " matrix is not bit-identical to the transform repository result");
+        numberOfFailures++;
+      }
+
+      igtl::Matrix4x4 repositoryIgtlMatrix;
+      igtl::Matrix4x4 tableIgtlMatrix;
+      igsioTransformName transformName(*nameIt);
+      if (repositoryStatus == TOOL_OK)
+      {
+        vtkPlusIgtlMessageCommon::GetIgtlMatrix(repositoryIgtlMatrix, repository, transformName);
+        vtkPlusIgtlMessageCommon::GetIgtlMatrix(tableIgtlMatrix, table, transformName);
+        if (memcmp(repositoryIgtlMatrix, tableIgtlMatrix, sizeof(igtl::Matrix4x4)) != 0)
+        {
+          LOG_ERROR("Transform " << nameIt->GetTransformName() << " IGTL matrix is not bit-identical to the transform repository result");
+          numberOfFailures++;
+        }
+      }
+    }
+    return numberOfFailures;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  int numberOfFrames = 20;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of simulated broadcast frames");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  // Two clients with overlapping subscriptions
+  PlusIgtlClientInfo firstClientInfo;
+  firstClientInfo.TransformNames.push_back(igsioTransformName("Probe", "Reference"));
+  firstClientInfo.TransformNames.push_back(igsioTransformName("Stylus", "Probe"));
+  firstClientInfo.TransformNames.push_back(igsioTransformName("Tracker", "Probe"));
+  PlusIgtlClientInfo::ImageStream imageStream;
+  imageStream.Name = "Probe";
+  imageStream.EmbeddedTransformToFrame = "Tracker";
+  firstClientInfo.ImageStreams.push_back(imageStream);
+
+  PlusIgtlClientInfo secondClientInfo;
+  secondClientInfo.TransformNames.push_back(igsioTransformName("Probe", "Reference"));
+  secondClientInfo.TransformNames.push_back(igsioTransformName("Reference", "Tracker"));
+  secondClientInfo.TransformNames.push_back(igsioTransformName("Stylus", "Reference"));
+
+  PlusIgtlTransformTable table;
+  table.AddRequestedTransforms(firstClientInfo);
+  table.AddRequestedTransforms(secondClientInfo);
+  if (table.GetNumberOfTransforms() != 6)
+  {
+    LOG_ERROR("Requested transforms are not deduplicated: expected 6, got " << table.GetNumberOfTransforms());
+    return EXIT_FAILURE;
+  }
+
+  // All requested transforms, followed by transforms that are served through the repository fallback (ProbeToTracker is already requested as image transform)
+  std::vector<igsioTransformName> names(firstClientInfo.TransformNames);
+  names.insert(names.end(), secondClientInfo.TransformNames.begin(), secondClientInfo.TransformNames.end());
+  names.push_back(igsioTransformName("Probe", "Tracker"));
+  names.push_back(igsioTransformName("Reference", "Probe"));
+  names.push_back(igsioTransformName("Tracker", "Stylus"));
+
+  vtkSmartPointer<vtkIGSIOTransformRepository> repository = vtkSmartPointer<vtkIGSIOTransformRepository>::New();
+  int numberOfFailures = 0;
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+  {
+    igsioTrackedFrame trackedFrame;
+    trackedFrame.SetTimestamp(frameIndex * 0.1);
+    SetFrameTransform(trackedFrame, "Probe", "Tracker", 13.1 * frameIndex, 1.0 / 3.0 + frameIndex, TOOL_OK);
+    SetFrameTransform(trackedFrame, "Reference", "Tracker", -7.3 * frameIndex, 17.0 / 7.0 - frameIndex, TOOL_OK);
+    // Stylus is out of view in every third frame
+    SetFrameTransform(trackedFrame, "Stylus", "Tracker", 29.7 * frameIndex, 0.1 * frameIndex, (frameIndex % 3 == 0) ? TOOL_OUT_OF_VIEW : TOOL_OK);
+
+    if (repository->SetTransforms(trackedFrame) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set transforms of frame " << frameIndex);
+      return EXIT_FAILURE;
+    }
+    table.Update(repository);
+
+    numberOfFailures += CompareTransforms(repository, table, names);
+  }
+
+  if (table.GetNumberOfTransforms() != 8)
+  {
+    LOG_ERROR("Transforms computed on first use are not kept in the table: expected 8, got " << table.GetNumberOfTransforms());
+    numberOfFailures++;
+  }
+
+  if (numberOfFailures > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfFailures << " mismatches");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusIgtlTransformTable.h"
 #include "igsioTrackedFrame.h"
 #include "igsioVideoFrame.h"
 #include "vtkPlusIgtlMessageCommon.h"
@@ -85,6 +86,33 @@ PlusStatus vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtl::Matrix4x4& igtlMatrix,
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtl::Matrix4x4& igtlMatrix,
+    PlusIgtlTransformTable& transformTable,
+    const igsioTransformName& transformName)
+{
+  igtl::IdentityMatrix(igtlMatrix);
+
+  ToolStatus status(TOOL_INVALID);
+  vtkSmartPointer<vtkMatrix4x4> vtkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  if (transformTable.GetTransform(transformName, vtkMatrix, &status) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to get transform from transform table (" << transformName.From() << " to " << transformName.To() << ")");
+    return PLUS_FAIL;
+  }
+
+  if (status != TOOL_OK)
+  {
+    LOG_DEBUG("Skipped transformation matrix - Invalid transform in the transform table (" << transformName.From() << " to " << transformName.To() << ")");
+    return PLUS_FAIL;
+  }
+
+  // Copy VTK matrix to IGTL matrix
+  igtlioTransformConverter::VTKToIGTLTransform(*vtkMatrix, igtlMatrix);
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusIgtlMessageCommon::PackTrackedFrameMessage(igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage,
     igsioTrackedFrame& trackedFrame,
@@ -634,6 +662,18 @@ PlusStatus vtkPlusIgtlMessageCommon::PackTrackingDataMessage(igtl::TrackingDataM
     const std::vector<igsioTransformName>& names,
     const vtkIGSIOTransformRepository& repository,
     double timestamp)
+{
+  // Transforms that are not requested in advance are computed from the repository on first use
+  PlusIgtlTransformTable transformTable;
+  transformTable.Update(&repository);
+  return PackTrackingDataMessage(trackingDataMessage, names, transformTable, timestamp);
+}
+
+//-------------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageCommon::PackTrackingDataMessage(igtl::TrackingDataMessage::Pointer trackingDataMessage,
+    const std::vector<igsioTransformName>& names,
+    PlusIgtlTransformTable& transformTable,
+    double timestamp)
 {
   if (trackingDataMessage.IsNull())
   {
@@ -655,7 +695,7 @@ PlusStatus vtkPlusIgtlMessageCommon::PackTrackingDataMessage(igtl::TrackingDataM
 
     vtkNew<vtkMatrix4x4> vtkMat;
     ToolStatus status(TOOL_INVALID);
-    if (repository.GetTransform(*it, vtkMat.GetPointer(), &status) != PLUS_SUCCESS)
+    if (transformTable.GetTransform(*it, vtkMat.GetPointer(), &status) != PLUS_SUCCESS)
     {
       LOG_ERROR("Transform " << it->From() << "To" << it->To() << " not found in repository.");
       continue;
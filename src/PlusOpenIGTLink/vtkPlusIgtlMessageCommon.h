@@ -36,6 +36,7 @@ class vtkXMLDataElement;
 class vtkPolyData;
 //class vtkIGSIOTransformRepository;
 class vtkIGSIOFrameConverter;
+class PlusIgtlTransformTable;
 
 /*!
 \class vtkPlusIgtlMessageCommon
@@ -91,6 +92,9 @@ public:
   /*! Pack data message from tracked frame */
   static PlusStatus PackTrackingDataMessage(igtl::TrackingDataMessage::Pointer tdataMessage, const std::vector<igsioTransformName>& names, const vtkIGSIOTransformRepository& repository, double timestamp);
 
+  /*! Pack data message from the transforms stored in a transform table */
+  static PlusStatus PackTrackingDataMessage(igtl::TrackingDataMessage::Pointer tdataMessage, const std::vector<igsioTransformName>& names, PlusIgtlTransformTable& transformTable, double timestamp);
+
   /*! Unpack data message */
   static PlusStatus UnpackTrackingDataMessage(igtl::MessageHeader::Pointer headerMsg, igtl::Socket* socket,
       std::vector<igsioTransformName>& names, vtkIGSIOTransformRepository& repository, double& timestamp, int crccheck);
@@ -115,6 +119,9 @@ public:
   /*! Generate igtl::Matrix4x4 with the selected transform name from the transform repository */
   static PlusStatus GetIgtlMatrix(igtl::Matrix4x4& igtlMatrix, vtkIGSIOTransformRepository* transformRepository, igsioTransformName& transformName);
 
+  /*! Generate igtl::Matrix4x4 with the selected transform name from a transform table */
+  static PlusStatus GetIgtlMatrix(igtl::Matrix4x4& igtlMatrix, PlusIgtlTransformTable& transformTable, const igsioTransformName& transformName);
+
 protected:
   vtkPlusIgtlMessageCommon();
   virtual ~vtkPlusIgtlMessageCommon();
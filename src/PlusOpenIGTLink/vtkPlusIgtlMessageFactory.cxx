@@ -142,14 +142,25 @@ igtl::MessageBase::Pointer vtkPlusIgtlMessageFactory::CreateSendMessage(const st
 PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, igsioTrackedFrame& trackedFrame,
     bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository/*=NULL*/)
 {
-  int numberOfErrors(0);
-  igtlMessages.clear();
-
   if (transformRepository != NULL)
   {
     transformRepository->SetTransforms(trackedFrame);
   }
 
+  PlusIgtlTransformTable transformTable;
+  transformTable.AddRequestedTransforms(clientInfo);
+  transformTable.Update(transformRepository);
+
+  return this->PackMessages(clientId, clientInfo, igtlMessages, trackedFrame, packValidTransformsOnly, transformTable);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtlMessages, igsioTrackedFrame& trackedFrame,
+    bool packValidTransformsOnly, PlusIgtlTransformTable& transformTable)
+{
+  int numberOfErrors(0);
+  igtlMessages.clear();
+
   for (std::vector<std::string>::const_iterator messageTypeIterator = clientInfo.IgtlMessageTypes.begin(); messageTypeIterator != clientInfo.IgtlMessageTypes.end(); ++ messageTypeIterator)
   {
     std::string messageType = (*messageTypeIterator);
@@ -173,29 +184,29 @@ PlusStatus vtkPlusIgtlMessageFactory::PackMessages(int clientId, const PlusIgtlC
 
     if (typeid(*igtlMessage) == typeid(igtl::ImageMessage))
     {
-      numberOfErrors += PackImageMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
+      numberOfErrors += PackImageMessage(clientInfo, transformTable, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
     }
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
     else if (typeid(*igtlMessage) == typeid(igtl::VideoMessage))
     {
-      numberOfErrors += PackVideoMessage(clientInfo, *transformRepository, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
+      numberOfErrors += PackVideoMessage(clientInfo, transformTable, messageType, igtlMessage, trackedFrame, igtlMessages, clientId);
     }
 #endif
     else if (typeid(*igtlMessage) == typeid(igtl::TransformMessage))
     {
-      numberOfErrors += PackTransformMessage(clientInfo, *transformRepository, packValidTransformsOnly, igtlMessage, trackedFrame, igtlMessages);
+      numberOfErrors += PackTransformMessage(clientInfo, transformTable, packValidTransformsOnly, igtlMessage, trackedFrame, igtlMessages);
     }
     else if (typeid(*igtlMessage) == typeid(igtl::TrackingDataMessage))
     {
-      numberOfErrors += PackTrackingDataMessage(clientInfo, trackedFrame, *transformRepository, packValidTransformsOnly, igtlMessage, igtlMessages);
+      numberOfErrors += PackTrackingDataMessage(clientInfo, trackedFrame, transformTable, packValidTransformsOnly, igtlMessage, igtlMessages);
     }
     else if (typeid(*igtlMessage) == typeid(igtl::PositionMessage))
     {
-      numberOfErrors += PackPositionMessage(clientInfo, *transformRepository, igtlMessage, trackedFrame, igtlMessages);
+      numberOfErrors += PackPositionMessage(clientInfo, transformTable, igtlMessage, trackedFrame, igtlMessages);
     }
     else if (typeid(*igtlMessage) == typeid(igtl::PlusTrackedFrameMessage))
     {
-      numberOfErrors += PackTrackedFrameMessage(igtlMessage, clientInfo, *transformRepository, trackedFrame, igtlMessages);
+      numberOfErrors += PackTrackedFrameMessage(igtlMessage, clientInfo, transformTable, trackedFrame, igtlMessages);
     }
     else if (typeid(*igtlMessage) == typeid(igtl::PlusUsMessage))
     {
@@ -263,7 +274,7 @@ int vtkPlusIgtlMessageFactory::PackUsMessage(igtl::MessageBase::Pointer igtlMess
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   int numberOfErrors(0);
   igtl::PlusTrackedFrameMessage::Pointer trackedFrameMessage = dynamic_cast<igtl::PlusTrackedFrameMessage*>(igtlMessage->Clone().GetPointer());
@@ -272,7 +283,7 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
   {
     ToolStatus status(TOOL_INVALID);
     vtkSmartPointer<vtkMatrix4x4> matrix(vtkSmartPointer<vtkMatrix4x4>::New());
-    transformRepository.GetTransform(*nameIter, matrix, &status);
+    transformTable.GetTransform(*nameIter, matrix, &status);
     trackedFrame.SetFrameTransform(*nameIter, matrix);
     trackedFrame.SetFrameTransformStatus(*nameIter, status);
   }
@@ -282,7 +293,7 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
   if (!clientInfo.ImageStreams.empty())
   {
     ToolStatus status(TOOL_INVALID);
-    if (transformRepository.GetTransform(igsioTransformName(clientInfo.ImageStreams[0].Name, clientInfo.ImageStreams[0].EmbeddedTransformToFrame), imageMatrix, &status) != PLUS_SUCCESS)
+    if (transformTable.GetTransform(igsioTransformName(clientInfo.ImageStreams[0].Name, clientInfo.ImageStreams[0].EmbeddedTransformToFrame), imageMatrix, &status) != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to retrieve embedded image transform: " << clientInfo.ImageStreams[0].Name << "To" << clientInfo.ImageStreams[0].EmbeddedTransformToFrame << ".");
       numberOfErrors++;
@@ -300,7 +311,7 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   for (std::vector<igsioTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
   {
@@ -312,11 +323,11 @@ int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& cli
     */
     igsioTransformName transformName = (*transformNameIterator);
     igtl::Matrix4x4 igtlMatrix;
-    vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, &transformRepository, transformName);
+    vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, transformTable, transformName);
 
     ToolStatus status;
     vtkNew<vtkMatrix4x4> temp;
-    transformRepository.GetTransform(transformName, temp.GetPointer(), &status);
+    transformTable.GetTransform(transformName, temp.GetPointer(), &status);
 
     float position[3] = { igtlMatrix[0][3], igtlMatrix[1][3], igtlMatrix[2][3] };
     float quaternion[4] = { 0, 0, 0, 1 };
@@ -331,7 +342,7 @@ int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& cli
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly, igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+int vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, PlusIgtlTransformTable& transformTable, bool packValidTransformsOnly, igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   if (clientInfo.GetTDATARequested() && clientInfo.GetLastTDATASentTimeStamp() + clientInfo.GetTDATAResolution() < trackedFrame.GetTimestamp())
   {
@@ -344,7 +355,7 @@ int vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo&
 
       ToolStatus status(TOOL_INVALID);
       vtkSmartPointer<vtkMatrix4x4> mat = vtkSmartPointer<vtkMatrix4x4>::New();
-      transformRepository.GetTransform(transformName, mat, &status);
+      transformTable.GetTransform(transformName, mat, &status);
 
       if (status != TOOL_OK && packValidTransformsOnly)
       {
@@ -356,21 +367,21 @@ int vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo&
     }
 
     igtl::TrackingDataMessage::Pointer trackingDataMessage = dynamic_cast<igtl::TrackingDataMessage*>(igtlMessage->Clone().GetPointer());
-    vtkPlusIgtlMessageCommon::PackTrackingDataMessage(trackingDataMessage, names, transformRepository, trackedFrame.GetTimestamp());
+    vtkPlusIgtlMessageCommon::PackTrackingDataMessage(trackingDataMessage, names, transformTable, trackedFrame.GetTimestamp());
     igtlMessages.push_back(trackingDataMessage.GetPointer());
   }
   return 0; // no errors possible for this message type
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
+int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, bool packValidTransformsOnly, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages)
 {
   for (std::vector<igsioTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
   {
     igsioTransformName transformName = (*transformNameIterator);
     ToolStatus status(TOOL_UNKNOWN);
     vtkNew<vtkMatrix4x4> temp;
-    transformRepository.GetTransform(transformName, temp.GetPointer(), &status);
+    transformTable.GetTransform(transformName, temp.GetPointer(), &status);
 
     if (status != TOOL_OK && packValidTransformsOnly)
     {
@@ -379,7 +390,7 @@ int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& cl
     }
 
     igtl::Matrix4x4 igtlMatrix;
-    vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, &transformRepository, transformName);
+    vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, transformTable, transformName);
     igtl::TransformMessage::Pointer transformMessage = dynamic_cast<igtl::TransformMessage*>(igtlMessage->Clone().GetPointer()); 
     igsioFieldMapType frameFields = trackedFrame.GetFrameFields();
     for (igsioFieldMapType::iterator iter = frameFields.begin(); iter != frameFields.end(); ++iter)
@@ -402,7 +413,7 @@ int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& cl
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
+int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
 {
   int numberOfErrors = 0;
   for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIterator = clientInfo.ImageStreams.begin(); imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
@@ -414,7 +425,7 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
 
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     ToolStatus status;
-    if (transformRepository.GetTransform(imageTransformName, matrix.Get(), &status) != PLUS_SUCCESS)
+    if (transformTable.GetTransform(imageTransformName, matrix.Get(), &status) != PLUS_SUCCESS)
     {
       LOG_WARNING("Failed to create " << messageType << " message: cannot get image transform. ToolStatus: " << status);
       numberOfErrors++;
@@ -459,7 +470,7 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
 
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
 //----------------------------------------------------------------------------
-int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
+int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, const std::string& messageType, igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId)
 {
   int numberOfErrors = 0;
   for (std::vector<PlusIgtlClientInfo::VideoStream>::const_iterator videoStreamIterator = clientInfo.VideoStreams.begin(); videoStreamIterator != clientInfo.VideoStreams.end(); ++videoStreamIterator)
@@ -470,7 +481,7 @@ int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& client
     igsioTransformName imageTransformName = igsioTransformName(videoStream.Name, videoStream.EmbeddedTransformToFrame);
 
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (transformRepository.GetTransform(imageTransformName, matrix.Get()) != PLUS_SUCCESS)
+    if (transformTable.GetTransform(imageTransformName, matrix.Get()) != PLUS_SUCCESS)
     {
       LOG_WARNING("Failed to create " << messageType << " message: cannot get image transform");
       numberOfErrors++;
@@ -19,6 +19,7 @@
 
 // PlusLib includes
 #include "PlusIgtlClientInfo.h"
+#include "PlusIgtlTransformTable.h"
 
 class vtkXMLDataElement;
 //class igsioTrackedFrame; 
@@ -80,6 +81,19 @@ public:
   PlusStatus PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, igsioTrackedFrame& trackedFrame,
                           bool packValidTransformsOnly, vtkIGSIOTransformRepository* transformRepository = NULL);
 
+  /*!
+  Generate and pack IGTL messages from tracked frame, using transforms that are already computed for the current frame.
+  The transform table can be shared between clients, so that each transform is computed only once per frame.
+  \param clientId Id of the client that messages will be sent to
+  \param packValidTransformsOnly Control whether or not to pack transform messages if they contain invalid transforms
+  \param clientInfo Specifies list of message types and names to generate for a client.
+  \param igtMessages Output list for the generated IGTL messages
+  \param trackedFrame Input tracked frame data used for IGTL message generation
+  \param transformTable Transforms of the current frame (see PlusIgtlTransformTable::Update)
+  */
+  PlusStatus PackMessages(int clientId, const PlusIgtlClientInfo& clientInfo, std::vector<igtl::MessageBase::Pointer>& igtMessages, igsioTrackedFrame& trackedFrame,
+                          bool packValidTransformsOnly, PlusIgtlTransformTable& transformTable);
+
 protected:
   vtkPlusIgtlMessageFactory();
   virtual ~vtkPlusIgtlMessageFactory();
@@ -87,19 +101,19 @@ protected:
   igtl::MessageFactory::Pointer IgtlFactory;
 
 protected:
-  int PackImageMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
+  int PackImageMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, const std::string& messageType,
                        igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId);
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-  int PackVideoMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, const std::string& messageType,
+  int PackVideoMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, const std::string& messageType,
                        igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages, int clientId);
 #endif
-  int PackTransformMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly,
+  int PackTransformMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, bool packValidTransformsOnly,
                            igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
-  int PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, vtkIGSIOTransformRepository& transformRepository, bool packValidTransformsOnly,
+  int PackTrackingDataMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, PlusIgtlTransformTable& transformTable, bool packValidTransformsOnly,
                               igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
-  int PackPositionMessage(const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository, igtl::MessageBase::Pointer igtlMessage,
+  int PackPositionMessage(const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable, igtl::MessageBase::Pointer igtlMessage,
                           igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
-  int PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, vtkIGSIOTransformRepository& transformRepository,
+  int PackTrackedFrameMessage(igtl::MessageBase::Pointer igtlMessage, const PlusIgtlClientInfo& clientInfo, PlusIgtlTransformTable& transformTable,
                               igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackUsMessage(igtl::MessageBase::Pointer igtlMessage, igsioTrackedFrame& trackedFrame, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
   int PackStringMessage(const PlusIgtlClientInfo& clientInfo, igsioTrackedFrame& trackedFrame, igtl::MessageBase::Pointer igtlMessage, std::vector<igtl::MessageBase::Pointer>& igtlMessages);
@@ -0,0 +1,108 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusCancelCommand.h"
+#include "vtkPlusCommandProcessor.h"
+
+vtkStandardNewMacro(vtkPlusCancelCommand);
+
+namespace
+{
+  static const std::string CANCEL_CMD = "CancelCommand";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusCancelCommand::vtkPlusCancelCommand()
+  : CancelledJobId(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusCancelCommand::~vtkPlusCancelCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCancelCommand::SetNameToCancel() { this->SetName(CANCEL_CMD); }
+
+//----------------------------------------------------------------------------
+void vtkPlusCancelCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(CANCEL_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusCancelCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, CANCEL_CMD))
+  {
+    desc += CANCEL_CMD;
+    desc += ": Cancel a long-running command. Attributes: JobId: job id that was returned in the reply of the long-running command.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCancelCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "JobId: " << this->CancelledJobId << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCancelCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  int jobId = 0;
+  if (!aConfig->GetScalarAttribute("JobId", jobId) || jobId <= 0)
+  {
+    LOG_ERROR("Unable to read required JobId attribute of " << CANCEL_CMD << " command");
+    return PLUS_FAIL;
+  }
+  this->CancelledJobId = static_cast<unsigned int>(jobId);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCancelCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  aConfig->SetIntAttribute("JobId", static_cast<int>(this->CancelledJobId));
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCancelCommand::Execute()
+{
+  LOG_DEBUG("vtkPlusCancelCommand::Execute: job " << this->CancelledJobId);
+
+  if (this->CommandProcessor == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Invalid command processor.");
+    return PLUS_FAIL;
+  }
+
+  if (this->CommandProcessor->CancelJob(this->CancelledJobId) != PLUS_SUCCESS)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.",
+                               "Job " + igsioCommon::ToString<unsigned int>(this->CancelledJobId) + " is not pending or running.");
+    return PLUS_FAIL;
+  }
+
+  igtl::MessageBase::MetaDataMap metaData;
+  metaData[JOB_ID_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned int>(this->CancelledJobId));
+  this->QueueCommandResponse(PLUS_SUCCESS, "Cancellation requested.", "", &metaData);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusCancelCommand_h
+#define __vtkPlusCancelCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusCancelCommand
+  \brief This command cancels a long-running command (job) that is waiting for execution or being executed.
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusCancelCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusCancelCommand* New();
+  vtkTypeMacro(vtkPlusCancelCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  /*! Id of the job to cancel, as received in the reply of the long-running command */
+  vtkGetMacro(CancelledJobId, unsigned int);
+  vtkSetMacro(CancelledJobId, unsigned int);
+
+  void SetNameToCancel();
+
+protected:
+  vtkPlusCancelCommand();
+  virtual ~vtkPlusCancelCommand();
+
+private:
+  unsigned int CancelledJobId;
+
+  vtkPlusCancelCommand(const vtkPlusCancelCommand&);
+  void operator=(const vtkPlusCancelCommand&);
+};
+
+#endif
@@ -15,12 +15,25 @@
 const std::string vtkPlusCommand::DEVICE_NAME_COMMAND = "CMD";
 const std::string vtkPlusCommand::DEVICE_NAME_REPLY = "ACK";
 
+const std::string vtkPlusCommand::JOB_ID_PARAMETER_NAME = "JobId";
+const std::string vtkPlusCommand::JOB_STATE_PARAMETER_NAME = "JobState";
+const std::string vtkPlusCommand::JOB_PROGRESS_PARAMETER_NAME = "JobProgressPercent";
+
+const std::string vtkPlusCommand::JOB_STATE_ACCEPTED = "Accepted";
+const std::string vtkPlusCommand::JOB_STATE_RUNNING = "Running";
+const std::string vtkPlusCommand::JOB_STATE_COMPLETED = "Completed";
+const std::string vtkPlusCommand::JOB_STATE_FAILED = "Failed";
+const std::string vtkPlusCommand::JOB_STATE_CANCELLED = "Cancelled";
+
 //----------------------------------------------------------------------------
 vtkPlusCommand::vtkPlusCommand()
   : CommandProcessor(NULL)
   , ClientId(0)
   , Id(0)
   , RespondWithCommandMessage(true)
+  , JobId(0)
+  , CancelRequested(false)
+  , ProgressPercent(-1.0)
 {
 }
 
@@ -249,6 +262,24 @@ void vtkPlusCommand::PopCommandResponses(PlusCommandResponseList& responses)
   responses.splice(responses.end(), this->CommandResponseQueue, this->CommandResponseQueue.begin(), this->CommandResponseQueue.end());
 }
 
+//------------------------------------------------------------------------------
+void vtkPlusCommand::RequestCancel()
+{
+  this->CancelRequested = true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkPlusCommand::IsCancelRequested() const
+{
+  return this->CancelRequested;
+}
+
+//------------------------------------------------------------------------------
+double vtkPlusCommand::GetProgressPercent() const
+{
+  return this->ProgressPercent;
+}
+
 //------------------------------------------------------------------------------
 void vtkPlusCommand::QueueCommandResponse(PlusStatus status, const std::string& message, const std::string& error, const igtl::MessageBase::MetaDataMap* replyMetaData)
 {
@@ -263,9 +294,21 @@ void vtkPlusCommand::QueueCommandResponse(PlusStatus status, const std::string&
   commandResponse->SetRespondWithCommandMessage(this->RespondWithCommandMessage);
   commandResponse->SetErrorString(error);
   commandResponse->SetResultString(message);
+  igtl::MessageBase::MetaDataMap parameters;
   if (replyMetaData != NULL)
   {
-    commandResponse->SetParameters(*replyMetaData);
+    parameters = *replyMetaData;
+  }
+  if (this->JobId != 0)
+  {
+    // Final reply of a long-running command, let the client know which job has been finished and how
+    std::string jobState = (status == PLUS_SUCCESS ? JOB_STATE_COMPLETED : (this->IsCancelRequested() ? JOB_STATE_CANCELLED : JOB_STATE_FAILED));
+    parameters[JOB_ID_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned int>(this->JobId));
+    parameters[JOB_STATE_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, jobState);
+  }
+  if (!parameters.empty())
+  {
+    commandResponse->SetParameters(parameters);
   }
   this->CommandResponseQueue.push_back(commandResponse);
 }
\ No newline at end of file
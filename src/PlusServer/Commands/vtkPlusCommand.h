@@ -19,6 +19,9 @@ class vtkImageData;
 // igtl includes
 #include "igtlMessageBase.h"
 
+// STL includes
+#include <atomic>
+
 /*!
   \class vtkPlusCommand
   \brief This is an abstract superclass for commands in the OpenIGTLink network interface for Plus.
@@ -34,6 +37,18 @@ public:
   static const std::string DEVICE_NAME_COMMAND;
   static const std::string DEVICE_NAME_REPLY;
 
+  /*! Names of the reply parameters that describe the state of a long-running command (job) */
+  static const std::string JOB_ID_PARAMETER_NAME;
+  static const std::string JOB_STATE_PARAMETER_NAME;
+  static const std::string JOB_PROGRESS_PARAMETER_NAME;
+
+  /*! Values of the job state reply parameter */
+  static const std::string JOB_STATE_ACCEPTED;
+  static const std::string JOB_STATE_RUNNING;
+  static const std::string JOB_STATE_COMPLETED;
+  static const std::string JOB_STATE_FAILED;
+  static const std::string JOB_STATE_CANCELLED;
+
   virtual vtkPlusCommand* Clone() = 0;
 
   virtual void PrintSelf(ostream& os, vtkIndent indent);
@@ -81,6 +96,43 @@ public:
   vtkGetMacro(Id, uint32_t);
   vtkSetMacro(Id, uint32_t);
 
+  /*!
+    Returns true if execution of the command may take a long time (e.g., processing of a recorded file).
+    Long-running commands are executed on a worker thread of the command processor, so that they do not
+    block processing of other commands. The client immediately receives an "accepted" reply with a job id,
+    then progress replies and a final reply.
+  */
+  virtual bool IsLongRunning() { return false; }
+
+  /*!
+    Id of the device that the command operates on, empty if the command does not operate on a specific device.
+    While a long-running command (job) of a device is pending or running, the other commands of the same device
+    are kept in the command queue, so that the commands of a device are executed in the order they were received.
+  */
+  virtual std::string GetJobDeviceId() { return ""; }
+
+  /*!
+    Returns true if the client expects the accepted and progress replies of the command when it is executed as a job.
+    The final reply is always sent.
+  */
+  virtual bool IsJobStateReplyExpected() { return this->RespondWithCommandMessage; }
+
+  /*! Id of the job if the command is executed as a long-running command, 0 otherwise */
+  vtkGetMacro(JobId, unsigned int);
+  vtkSetMacro(JobId, unsigned int);
+
+  /*!
+    Request cancellation of the command. Cancellation is cooperative: execution stops at the next
+    cancellation point of the command, and the command replies with a failure. Can be called from any thread.
+  */
+  void RequestCancel();
+
+  /*! Returns true if cancellation of the command has been requested. Can be called from any thread. */
+  bool IsCancelRequested() const;
+
+  /*! Get execution progress of the command in percent. Negative value if progress is not known. Can be called from any thread. */
+  double GetProgressPercent() const;
+
   /*!
     Get command responses from the device, append them to the provided list, and then remove them from the command.
     The ownership of the command responses are transferred to the caller, it is responsible
@@ -172,6 +224,15 @@ protected:
   // Contains a list of command responses that should be forwarded to the caller
   PlusCommandResponseList CommandResponseQueue;
 
+  /*! Job id assigned by the command processor if the command is executed as a long-running command */
+  unsigned int JobId;
+
+  /*! Set when cancellation is requested, checked by the cancellation points of the command */
+  std::atomic<bool> CancelRequested;
+
+  /*! Execution progress in percent, updated by long-running commands. Negative if not known. */
+  std::atomic<double> ProgressPercent;
+
 private:
   vtkPlusCommand(const vtkPlusCommand&);
   void operator=(const vtkPlusCommand&);
@@ -0,0 +1,156 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDumpBuffersCommand.h"
+
+// STL includes
+#include <algorithm>
+#include <iomanip>
+
+vtkStandardNewMacro(vtkPlusDumpBuffersCommand);
+
+namespace
+{
+  static const std::string DUMP_BUFFERS_CMD = "DumpBuffers";
+  static const std::string GET_DUMP_BUFFERS_STATUS_CMD = "GetDumpBuffersStatus";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDumpBuffersCommand::vtkPlusDumpBuffersCommand()
+  : EnableCompression(false)
+  , NumberOfThreads(0)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDumpBuffersCommand::~vtkPlusDumpBuffersCommand()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDumpBuffersCommand::SetNameToDumpBuffers() { this->SetName(DUMP_BUFFERS_CMD); }
+void vtkPlusDumpBuffersCommand::SetNameToGetDumpBuffersStatus() { this->SetName(GET_DUMP_BUFFERS_STATUS_CMD); }
+
+//----------------------------------------------------------------------------
+void vtkPlusDumpBuffersCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(DUMP_BUFFERS_CMD);
+  cmdNames.push_back(GET_DUMP_BUFFERS_STATUS_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusDumpBuffersCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, DUMP_BUFFERS_CMD))
+  {
+    desc += DUMP_BUFFERS_CMD;
+    desc += ": Start writing the buffers of all data sources to files in the background.";
+    desc += " Attributes: OutputDirectory: output directory, relative to the Plus output directory, must not be outside of it (optional).";
+    desc += " EnableCompression: write compressed files (optional).";
+    desc += " NumberOfThreads: number of data sources written at the same time, 0 means number of processor cores (optional).";
+  }
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_DUMP_BUFFERS_STATUS_CMD))
+  {
+    desc += GET_DUMP_BUFFERS_STATUS_CMD;
+    desc += ": Get progress and result of the last DumpBuffers command.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDumpBuffersCommand::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "OutputDirectory: " << this->OutputDirectory << std::endl;
+  os << indent << "EnableCompression: " << (this->EnableCompression ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDumpBuffersCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  XML_READ_STRING_ATTRIBUTE_OPTIONAL(OutputDirectory, aConfig);
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(EnableCompression, aConfig);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfThreads, aConfig);
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDumpBuffersCommand::WriteConfiguration(vtkXMLDataElement* aConfig)
+{
+  if (vtkPlusCommand::WriteConfiguration(aConfig) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (this->GetName() == DUMP_BUFFERS_CMD)
+  {
+    XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(OutputDirectory, aConfig);
+    XML_WRITE_BOOL_ATTRIBUTE(EnableCompression, aConfig);
+    aConfig->SetIntAttribute("NumberOfThreads", this->NumberOfThreads);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDumpBuffersCommand::Execute()
+{
+  LOG_DEBUG("vtkPlusDumpBuffersCommand::Execute: " << (!this->Name.empty() ? this->Name : "(undefined)"));
+
+  vtkPlusDataCollector* dataCollector = this->GetDataCollector();
+  if (dataCollector == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Invalid data collector.");
+    return PLUS_FAIL;
+  }
+
+  if (igsioCommon::IsEqualInsensitive(this->Name, DUMP_BUFFERS_CMD))
+  {
+    if (dataCollector->StartDumpBuffersToDirectory(this->OutputDirectory, this->EnableCompression, static_cast<unsigned int>(std::max(this->NumberOfThreads, 0))) != PLUS_SUCCESS)
+    {
+      this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Unable to start buffer dump. A buffer dump may be already in progress or OutputDirectory is not inside the Plus output directory.");
+      return PLUS_FAIL;
+    }
+    igtl::MessageBase::MetaDataMap metaData;
+    metaData["ManifestFile"] = std::make_pair(IANA_TYPE_US_ASCII, dataCollector->GetDumpBuffersManifestFilePath());
+    this->QueueCommandResponse(PLUS_SUCCESS, "Buffer dump started.", "", &metaData);
+    return PLUS_SUCCESS;
+  }
+  else if (igsioCommon::IsEqualInsensitive(this->Name, GET_DUMP_BUFFERS_STATUS_CMD))
+  {
+    const bool inProgress = dataCollector->IsDumpBuffersInProgress();
+    const double progressPercent = dataCollector->GetDumpBuffersProgress() * 100.0;
+    const PlusStatus dumpStatus = inProgress ? PLUS_SUCCESS : dataCollector->GetDumpBuffersStatus();
+
+    std::ostringstream message;
+    if (inProgress)
+    {
+      message << "Buffer dump in progress: " << std::fixed << std::setprecision(0) << progressPercent << "%";
+    }
+    else
+    {
+      message << "Buffer dump " << (dumpStatus == PLUS_SUCCESS ? "completed." : "failed.");
+    }
+
+    igtl::MessageBase::MetaDataMap metaData;
+    metaData["InProgress"] = std::make_pair(IANA_TYPE_US_ASCII, std::string(inProgress ? "TRUE" : "FALSE"));
+    metaData["ProgressPercent"] = std::make_pair(IANA_TYPE_US_ASCII, igsioCommon::ToString<double>(progressPercent));
+    metaData["ManifestFile"] = std::make_pair(IANA_TYPE_US_ASCII, dataCollector->GetDumpBuffersManifestFilePath());
+    this->QueueCommandResponse(dumpStatus, message.str(), dumpStatus == PLUS_SUCCESS ? "" : "Writing of some buffers failed. See the manifest file for details.", &metaData);
+    return PLUS_SUCCESS;
+  }
+
+  this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Unknown command name: " + this->Name);
+  return PLUS_FAIL;
+}
@@ -0,0 +1,68 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusDumpBuffersCommand_h
+#define __vtkPlusDumpBuffersCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusDumpBuffersCommand
+  \brief This command writes the buffers of all data sources to disk in the background and reports the progress of the writing.
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusDumpBuffersCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusDumpBuffersCommand* New();
+  vtkTypeMacro(vtkPlusDumpBuffersCommand, vtkPlusCommand);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Read command parameters from XML */
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Write command parameters to XML */
+  virtual PlusStatus WriteConfiguration(vtkXMLDataElement* aConfig);
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  vtkGetStdStringMacro(OutputDirectory);
+  vtkSetStdStringMacro(OutputDirectory);
+
+  vtkGetMacro(EnableCompression, bool);
+  vtkSetMacro(EnableCompression, bool);
+
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetMacro(NumberOfThreads, int);
+
+  void SetNameToDumpBuffers();
+  void SetNameToGetDumpBuffersStatus();
+
+protected:
+  vtkPlusDumpBuffersCommand();
+  virtual ~vtkPlusDumpBuffersCommand();
+
+private:
+  std::string OutputDirectory;
+  bool        EnableCompression;
+  int         NumberOfThreads;
+
+  vtkPlusDumpBuffersCommand(const vtkPlusDumpBuffersCommand&);
+  void operator=(const vtkPlusDumpBuffersCommand&);
+};
+
+#endif
@@ -76,6 +76,29 @@ void vtkPlusGetImageCommand::SetNameToGetImage()
   SetName(GET_IMAGE);
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusGetImageCommand::IsLongRunning()
+{
+  return igsioCommon::IsEqualInsensitive(this->Name, GET_IMAGE);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetImageCommand::GetJobDeviceId()
+{
+  if (!igsioCommon::IsEqualInsensitive(this->Name, GET_IMAGE))
+  {
+    // Meta data is collected from all the devices
+    return "";
+  }
+  size_t dashFound = this->ImageId.find_last_of(DeviceNameImageIdSeparator);
+  if (dashFound == std::string::npos)
+  {
+    // Invalid image id, execution will report the error
+    return "";
+  }
+  return this->ImageId.substr(0, dashFound);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusGetImageCommand::Execute()
 {
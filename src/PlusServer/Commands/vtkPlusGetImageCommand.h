@@ -40,6 +40,15 @@ public:
   void SetNameToGetImageMeta();
   void SetNameToGetImage();
 
+  /*! Getting an image is long-running, as the device may need to acquire the image (e.g., download a DICOM series) */
+  virtual bool IsLongRunning();
+
+  /*! Id of the device that provides the requested image */
+  virtual std::string GetJobDeviceId();
+
+  /*! The client sent an OpenIGTLink GET_IMAGE query, which is answered by the image (or an error) only */
+  virtual bool IsJobStateReplyExpected() { return false; }
+
   /*! Id of the device */
   vtkGetStdStringMacro(ImageId);
   vtkSetStdStringMacro(ImageId);
@@ -196,6 +196,18 @@ PlusStatus vtkPlusReconstructVolumeCommand::WriteConfiguration(vtkXMLDataElement
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusReconstructVolumeCommand::IsLongRunning()
+{
+  return igsioCommon::IsEqualInsensitive(this->Name, RECONSTRUCT_PRERECORDED_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusReconstructVolumeCommand::GetJobDeviceId()
+{
+  return this->VolumeReconstructorDeviceId;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusReconstructVolumeCommand::Execute()
 {
@@ -267,7 +279,7 @@ PlusStatus vtkPlusReconstructVolumeCommand::Execute()
     reconstructorDevice->Reset(); // Clear volume
     vtkSmartPointer<vtkImageData> volumeToSend = vtkSmartPointer<vtkImageData>::New();
     std::string errorMessage;
-    if (reconstructorDevice->GetReconstructedVolumeFromFile(this->InputSeqFilename, volumeToSend, errorMessage) != PLUS_SUCCESS)
+    if (reconstructorDevice->GetReconstructedVolumeFromFile(this->InputSeqFilename, volumeToSend, errorMessage, &this->CancelRequested, &this->ProgressPercent) != PLUS_SUCCESS)
     {
       this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", baseMessage + " Reconstruction from sequence file failed: " + errorMessage);
       return PLUS_FAIL;
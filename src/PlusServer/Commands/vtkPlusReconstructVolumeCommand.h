@@ -44,6 +44,12 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Reconstruction from file is long-running, as all the frames of the file are processed */
+  virtual bool IsLongRunning();
+
+  /*! Commands of a volume reconstructor device are executed after the reconstruction job of the device is finished */
+  virtual std::string GetJobDeviceId();
+
   /*! File name of the sequence file that contains the image frames */
   vtkGetStdStringMacro(InputSeqFilename);
   vtkSetStdStringMacro(InputSeqFilename);
@@ -105,6 +105,19 @@ vtkPlusCommand* vtkPlusStartStopRecordingCommand::Clone()
   return New();
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusStartStopRecordingCommand::IsLongRunning()
+{
+  return igsioCommon::IsEqualInsensitive(this->Name, STOP_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusStartStopRecordingCommand::GetJobDeviceId()
+{
+  // Capture devices that are created for a channel are always referred to by the channel id
+  return !this->CaptureDeviceId.empty() ? this->CaptureDeviceId : this->ChannelId;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusStartStopRecordingCommand::ReadConfiguration(vtkXMLDataElement* aConfig)
 {
@@ -395,11 +408,21 @@ PlusStatus vtkPlusStartStopRecordingCommand::Execute()
 
     long numberOfFramesRecorded = captureDevice->GetTotalFramesRecorded();
     std::string actualOutputFilename;
-    if (captureDevice->CloseFile(resultFilename.c_str(), &actualOutputFilename) != PLUS_SUCCESS)
+    long numberOfDiscardedFrames = 0;
+    if (captureDevice->CloseFile(resultFilename.c_str(), &actualOutputFilename, &this->CancelRequested, &numberOfDiscardedFrames) != PLUS_SUCCESS)
     {
       this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", responseMessageBase + "Failed to finalize file: " + resultFilename);
       return PLUS_FAIL;
     }
+    if (numberOfDiscardedFrames > 0)
+    {
+      std::ostringstream ss;
+      ss << "Recording stopped, but writing of " << numberOfDiscardedFrames << " buffered frames was cancelled. " << numberOfFramesRecorded - numberOfDiscardedFrames
+         << " frames written before cancellation are saved to file " << actualOutputFilename;
+      this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", responseMessageBase + ss.str());
+      return PLUS_FAIL;
+    }
+    // If cancellation was requested after all the frames had been written then the recording is complete
     std::ostringstream ss;
     ss << "Recording " << numberOfFramesRecorded << " frames successful to file " << actualOutputFilename;
     this->QueueCommandResponse(PLUS_SUCCESS, responseMessageBase + ss.str());
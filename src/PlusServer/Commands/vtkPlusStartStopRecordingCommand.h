@@ -43,6 +43,12 @@ public:
   /*! Gets the description for the specified command name. */
   virtual std::string GetDescription(const std::string& commandName);
 
+  /*! Stopping of the recording is long-running, as it writes all the buffered frames to file */
+  virtual bool IsLongRunning();
+
+  /*! All recording commands of a capture device are executed in order, after the stop recording job of the device is finished */
+  virtual std::string GetJobDeviceId();
+
   vtkGetStdStringMacro(OutputFilename);
   vtkSetStdStringMacro(OutputFilename);
 
@@ -0,0 +1,476 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusCommandProcessorJobTest.cxx
+  \brief This program tests the execution of long-running commands (jobs) by the command processor.
+  It checks the accepted, progress, and final replies of a job, cancellation of a running and of a pending job,
+  and that the commands of a device that has a job in progress are executed after the job is finished.
+  If an input sequence file is specified then it also checks that StopRecording completes successfully
+  if cancellation is requested after all the recorded frames have been written.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkIGSIOAccurateTimer.h"
+#include "vtkPlusCommand.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusCommandResponse.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+#include "vtkPlusStartStopRecordingCommand.h"
+#include "vtkPlusVirtualCapture.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+  static const std::string TEST_JOB_CMD = "TestJob";
+  static const std::string TEST_DEVICE_CMD = "TestDeviceCommand";
+
+  const double MAX_WAIT_TIME_SEC = 30.0;
+
+  // Events of the test commands, in the order of execution
+  std::mutex EventLogMutex;
+  std::vector<std::string> EventLog;
+
+  //----------------------------------------------------------------------------
+  void LogEvent(const std::string& eventName)
+  {
+    std::lock_guard<std::mutex> lock(EventLogMutex);
+    EventLog.push_back(eventName);
+  }
+
+  //----------------------------------------------------------------------------
+  int GetEventIndex(const std::string& eventName)
+  {
+    std::lock_guard<std::mutex> lock(EventLogMutex);
+    std::vector<std::string>::iterator eventIt = std::find(EventLog.begin(), EventLog.end(), eventName);
+    if (eventIt == EventLog.end())
+    {
+      return -1;
+    }
+    return static_cast<int>(eventIt - EventLog.begin());
+  }
+}
+
+//----------------------------------------------------------------------------
+/*!
+  Test command. TestJob is a long-running command that reports progress and can be cancelled after each step,
+  TestDeviceCommand is executed immediately. Both of them operate on the device specified by the DeviceId attribute.
+*/
+class vtkPlusTestJobCommand : public vtkPlusCommand
+{
+public:
+  static vtkPlusTestJobCommand* New();
+  vtkTypeMacro(vtkPlusTestJobCommand, vtkPlusCommand);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  virtual void GetCommandNames(std::list<std::string>& cmdNames)
+  {
+    cmdNames.clear();
+    cmdNames.push_back(TEST_JOB_CMD);
+    cmdNames.push_back(TEST_DEVICE_CMD);
+  }
+
+  virtual std::string GetDescription(const std::string& commandName)
+  {
+    return "Test command";
+  }
+
+  virtual PlusStatus ReadConfiguration(vtkXMLDataElement* aConfig)
+  {
+    if (vtkPlusCommand::ReadConfiguration(aConfig) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    XML_READ_STRING_ATTRIBUTE_REQUIRED(DeviceId, aConfig);
+    XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(int, NumberOfSteps, aConfig);
+    return PLUS_SUCCESS;
+  }
+
+  virtual bool IsLongRunning() { return igsioCommon::IsEqualInsensitive(this->Name, TEST_JOB_CMD); }
+
+  virtual std::string GetJobDeviceId() { return this->DeviceId; }
+
+  virtual PlusStatus Execute()
+  {
+    if (!this->IsLongRunning())
+    {
+      LogEvent("Command:" + this->DeviceId);
+      this->QueueCommandResponse(PLUS_SUCCESS, "Command executed.");
+      return PLUS_SUCCESS;
+    }
+
+    LogEvent("JobStarted:" + this->DeviceId);
+    for (int step = 0; step < this->NumberOfSteps; ++step)
+    {
+      if (this->IsCancelRequested())
+      {
+        LogEvent("JobCancelled:" + this->DeviceId);
+        this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "Cancelled.");
+        return PLUS_FAIL;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      this->ProgressPercent = 100.0 * (step + 1) / this->NumberOfSteps;
+    }
+    LogEvent("JobFinished:" + this->DeviceId);
+    this->QueueCommandResponse(PLUS_SUCCESS, "Job completed.");
+    return PLUS_SUCCESS;
+  }
+
+  vtkSetStdStringMacro(DeviceId);
+  vtkGetStdStringMacro(DeviceId);
+  vtkSetMacro(NumberOfSteps, int);
+  vtkGetMacro(NumberOfSteps, int);
+
+protected:
+  vtkPlusTestJobCommand() : NumberOfSteps(10) {}
+  virtual ~vtkPlusTestJobCommand() {}
+
+  std::string DeviceId;
+  int NumberOfSteps;
+
+private:
+  vtkPlusTestJobCommand(const vtkPlusTestJobCommand&);
+  void operator=(const vtkPlusTestJobCommand&);
+};
+
+vtkStandardNewMacro(vtkPlusTestJobCommand);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetParameter(vtkPlusCommandRTSCommandResponse* response, const std::string& parameterName)
+  {
+    igtl::MessageBase::MetaDataMap::const_iterator parameterIt = response->GetParameters().find(parameterName);
+    if (parameterIt == response->GetParameters().end())
+    {
+      return "";
+    }
+    return parameterIt->second.second;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFinalJobState(const std::string& jobState)
+  {
+    return jobState == vtkPlusCommand::JOB_STATE_COMPLETED || jobState == vtkPlusCommand::JOB_STATE_FAILED || jobState == vtkPlusCommand::JOB_STATE_CANCELLED;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Execute commands until a reply for the command uid is received that satisfies the condition, collect all replies */
+  vtkPlusCommandRTSCommandResponse* WaitForReply(vtkPlusCommandProcessor* processor, uint32_t uid, bool finalJobReply,
+      std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> >& replies)
+  {
+    const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    while (vtkIGSIOAccurateTimer::GetSystemTime() - startTime < MAX_WAIT_TIME_SEC)
+    {
+      processor->ExecuteCommands();
+      PlusCommandResponseList responses;
+      processor->PopCommandResponses(responses);
+      for (PlusCommandResponseList::iterator responseIt = responses.begin(); responseIt != responses.end(); ++responseIt)
+      {
+        vtkPlusCommandRTSCommandResponse* reply = vtkPlusCommandRTSCommandResponse::SafeDownCast(*responseIt);
+        if (reply != NULL)
+        {
+          replies.push_back(reply);
+        }
+      }
+      for (std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> >::iterator replyIt = replies.begin(); replyIt != replies.end(); ++replyIt)
+      {
+        if ((*replyIt)->GetOriginalId() == uid && (!finalJobReply || IsFinalJobState(GetParameter(*replyIt, vtkPlusCommand::JOB_STATE_PARAMETER_NAME))))
+        {
+          return *replyIt;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    LOG_ERROR("No reply received for command " << uid << " in " << MAX_WAIT_TIME_SEC << " sec");
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus QueueCommand(vtkPlusCommandProcessor* processor, uint32_t uid, const std::string& commandName, const std::string& attributes)
+  {
+    std::string commandString = "<Command Name=\"" + commandName + "\" " + attributes + " />";
+    igtl::MessageBase::MetaDataMap metaData;
+    return processor->QueueCommand(true, 1, commandName, commandString, "TestClient", uid, metaData);
+  }
+
+  //----------------------------------------------------------------------------
+  int TestJobReplies(vtkPlusCommandProcessor* processor)
+  {
+    int numberOfErrors = 0;
+    LOG_INFO("Test job replies and command order");
+
+    // The job of device A delays the following command of device A, but not the command of device B
+    QueueCommand(processor, 1, TEST_JOB_CMD, "DeviceId=\"A\" NumberOfSteps=\"10\"");
+    QueueCommand(processor, 2, TEST_DEVICE_CMD, "DeviceId=\"A\"");
+    QueueCommand(processor, 3, TEST_DEVICE_CMD, "DeviceId=\"B\"");
+
+    std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> > replies;
+    vtkPlusCommandRTSCommandResponse* finalReply = WaitForReply(processor, 1, true, replies);
+    if (WaitForReply(processor, 2, false, replies) == NULL || WaitForReply(processor, 3, false, replies) == NULL || finalReply == NULL)
+    {
+      return 1;
+    }
+
+    std::vector<std::string> jobStates;
+    std::string jobId;
+    bool progressReported = false;
+    for (std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> >::iterator replyIt = replies.begin(); replyIt != replies.end(); ++replyIt)
+    {
+      if ((*replyIt)->GetOriginalId() != 1)
+      {
+        continue;
+      }
+      std::string jobState = GetParameter(*replyIt, vtkPlusCommand::JOB_STATE_PARAMETER_NAME);
+      jobStates.push_back(jobState);
+      if (jobId.empty())
+      {
+        jobId = GetParameter(*replyIt, vtkPlusCommand::JOB_ID_PARAMETER_NAME);
+      }
+      else if (GetParameter(*replyIt, vtkPlusCommand::JOB_ID_PARAMETER_NAME) != jobId)
+      {
+        LOG_ERROR("Job id changed in the replies of the job: " << jobId << " -> " << GetParameter(*replyIt, vtkPlusCommand::JOB_ID_PARAMETER_NAME));
+        numberOfErrors++;
+      }
+      if (jobState == vtkPlusCommand::JOB_STATE_RUNNING && !GetParameter(*replyIt, vtkPlusCommand::JOB_PROGRESS_PARAMETER_NAME).empty())
+      {
+        progressReported = true;
+      }
+    }
+    if (jobId.empty())
+    {
+      LOG_ERROR("Replies of the job do not contain job id");
+      numberOfErrors++;
+    }
+    if (jobStates.empty() || jobStates.front() != vtkPlusCommand::JOB_STATE_ACCEPTED)
+    {
+      LOG_ERROR("The first reply of the job is expected to be " << vtkPlusCommand::JOB_STATE_ACCEPTED);
+      numberOfErrors++;
+    }
+    if (!progressReported)
+    {
+      LOG_ERROR("No progress reply was received for the job");
+      numberOfErrors++;
+    }
+    if (jobStates.back() != vtkPlusCommand::JOB_STATE_COMPLETED || finalReply->GetStatus() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("The final reply of the job is expected to be successful and " << vtkPlusCommand::JOB_STATE_COMPLETED << ", received: " << jobStates.back());
+      numberOfErrors++;
+    }
+
+    if (GetEventIndex("Command:B") > GetEventIndex("JobFinished:A"))
+    {
+      LOG_ERROR("Command of device B was delayed by the job of device A");
+      numberOfErrors++;
+    }
+    if (GetEventIndex("Command:A") < GetEventIndex("JobFinished:A"))
+    {
+      LOG_ERROR("Command of device A was executed while the job of device A was in progress");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestJobCancellation(vtkPlusCommandProcessor* processor)
+  {
+    int numberOfErrors = 0;
+    LOG_INFO("Test job cancellation");
+
+    // With a single worker thread the job of device D waits until the job of device C is finished
+    QueueCommand(processor, 11, TEST_JOB_CMD, "DeviceId=\"C\" NumberOfSteps=\"200\"");
+    QueueCommand(processor, 12, TEST_JOB_CMD, "DeviceId=\"D\" NumberOfSteps=\"10\"");
+
+    std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> > replies;
+    vtkPlusCommandRTSCommandResponse* runningJobAccepted = WaitForReply(processor, 11, false, replies);
+    vtkPlusCommandRTSCommandResponse* pendingJobAccepted = WaitForReply(processor, 12, false, replies);
+    if (runningJobAccepted == NULL || pendingJobAccepted == NULL)
+    {
+      return 1;
+    }
+    const std::string runningJobId = GetParameter(runningJobAccepted, vtkPlusCommand::JOB_ID_PARAMETER_NAME);
+    const std::string pendingJobId = GetParameter(pendingJobAccepted, vtkPlusCommand::JOB_ID_PARAMETER_NAME);
+
+    // Cancel the pending job first, it must not start
+    QueueCommand(processor, 13, "CancelCommand", "JobId=\"" + pendingJobId + "\"");
+    vtkPlusCommandRTSCommandResponse* pendingJobFinalReply = WaitForReply(processor, 12, true, replies);
+    if (pendingJobFinalReply == NULL
+        || GetParameter(pendingJobFinalReply, vtkPlusCommand::JOB_STATE_PARAMETER_NAME) != vtkPlusCommand::JOB_STATE_CANCELLED
+        || pendingJobFinalReply->GetStatus() != PLUS_FAIL)
+    {
+      LOG_ERROR("Pending job is expected to be cancelled");
+      numberOfErrors++;
+    }
+
+    const double cancelTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    QueueCommand(processor, 14, "CancelCommand", "JobId=\"" + runningJobId + "\"");
+    vtkPlusCommandRTSCommandResponse* cancelReply = WaitForReply(processor, 14, false, replies);
+    if (cancelReply == NULL || cancelReply->GetStatus() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Cancel command failed");
+      numberOfErrors++;
+    }
+    vtkPlusCommandRTSCommandResponse* runningJobFinalReply = WaitForReply(processor, 11, true, replies);
+    if (runningJobFinalReply == NULL
+        || GetParameter(runningJobFinalReply, vtkPlusCommand::JOB_STATE_PARAMETER_NAME) != vtkPlusCommand::JOB_STATE_CANCELLED
+        || runningJobFinalReply->GetStatus() != PLUS_FAIL)
+    {
+      LOG_ERROR("Running job is expected to be cancelled");
+      numberOfErrors++;
+    }
+    // The job would need 10 sec without cancellation, it should stop at the next step
+    if (vtkIGSIOAccurateTimer::GetSystemTime() - cancelTime > 5.0)
+    {
+      LOG_ERROR("Running job did not stop after cancellation");
+      numberOfErrors++;
+    }
+    if (GetEventIndex("JobCancelled:C") < 0)
+    {
+      LOG_ERROR("Running job did not reach a cancellation point");
+      numberOfErrors++;
+    }
+    if (GetEventIndex("JobStarted:D") >= 0)
+    {
+      LOG_ERROR("Cancelled pending job was executed");
+      numberOfErrors++;
+    }
+
+    // Cancelling a finished job fails
+    QueueCommand(processor, 15, "CancelCommand", "JobId=\"" + runningJobId + "\"");
+    cancelReply = WaitForReply(processor, 15, false, replies);
+    if (cancelReply == NULL || cancelReply->GetStatus() != PLUS_FAIL)
+    {
+      LOG_ERROR("Cancellation of a finished job is expected to fail");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestStopRecordingCancelledAfterWriting(vtkPlusCommandProcessor* processor, const std::string& inputSequenceFileName)
+  {
+    LOG_INFO("Test cancellation of StopRecording after all frames are written");
+
+    std::ostringstream config;
+    config << "<PlusConfiguration version=\"2.1\"><DataCollection StartupDelaySec=\"0\">"
+           << "<Device Id=\"VideoDevice\" Type=\"SavedDataSource\" SequenceFile=\"" << inputSequenceFileName << "\" UseData=\"IMAGE\" AcquisitionRate=\"10\" RepeatEnabled=\"TRUE\">"
+           << "<DataSources><DataSource Type=\"Video\" Id=\"Video\" PortUsImageOrientation=\"MF\" BufferSize=\"50\" /></DataSources>"
+           << "<OutputChannels><OutputChannel Id=\"VideoStream\" VideoDataSourceId=\"Video\" /></OutputChannels>"
+           << "</Device>"
+           // Frames are not buffered, they are written to file as they are recorded
+           << "<Device Id=\"CaptureDevice\" Type=\"VirtualCapture\" BaseFilename=\"vtkPlusCommandProcessorJobTestRecording.igs.mha\" EnableCapturingOnStart=\"FALSE\" RequestedFrameRate=\"10\">"
+           << "<InputChannels><InputChannel Id=\"VideoStream\" /></InputChannels>"
+           << "</Device>"
+           << "</DataCollection></PlusConfiguration>";
+    vtkSmartPointer<vtkXMLDataElement> configRootElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(config.str().c_str()));
+    vtkPlusConfig::GetInstance()->SetDeviceSetConfigurationData(configRootElement);
+
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+    if (dataCollector->ReadConfiguration(configRootElement) != PLUS_SUCCESS || dataCollector->Connect() != PLUS_SUCCESS || dataCollector->Start() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to start data collection");
+      return 1;
+    }
+    vtkSmartPointer<vtkPlusOpenIGTLinkServer> server = vtkSmartPointer<vtkPlusOpenIGTLinkServer>::New();
+    server->SetDataCollector(dataCollector);
+    processor->SetPlusServer(server);
+
+    int numberOfErrors = 0;
+    std::vector< vtkSmartPointer<vtkPlusCommandRTSCommandResponse> > replies;
+    QueueCommand(processor, 21, "StartRecording", "CaptureDeviceId=\"CaptureDevice\"");
+    vtkPlusCommandRTSCommandResponse* startReply = WaitForReply(processor, 21, false, replies);
+    if (startReply == NULL || startReply->GetStatus() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("StartRecording failed");
+      numberOfErrors++;
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+
+      // Cancellation is requested, but there are no buffered frames that could be discarded
+      vtkSmartPointer<vtkPlusStartStopRecordingCommand> stopCommand = vtkSmartPointer<vtkPlusStartStopRecordingCommand>::New();
+      stopCommand->SetCommandProcessor(processor);
+      stopCommand->SetNameToStop();
+      stopCommand->SetCaptureDeviceId("CaptureDevice");
+      stopCommand->SetJobId(100);
+      stopCommand->RequestCancel();
+      PlusStatus stopStatus = stopCommand->Execute();
+      PlusCommandResponseList responses;
+      stopCommand->PopCommandResponses(responses);
+      vtkPlusCommandRTSCommandResponse* stopReply = responses.empty() ? NULL : vtkPlusCommandRTSCommandResponse::SafeDownCast(responses.back());
+      if (stopStatus != PLUS_SUCCESS || stopReply == NULL || stopReply->GetStatus() != PLUS_SUCCESS
+          || GetParameter(stopReply, vtkPlusCommand::JOB_STATE_PARAMETER_NAME) != vtkPlusCommand::JOB_STATE_COMPLETED)
+      {
+        LOG_ERROR("StopRecording is expected to complete successfully if all the frames were written before cancellation"
+                  << (stopReply != NULL ? ": " + stopReply->GetErrorString() : ""));
+        numberOfErrors++;
+      }
+    }
+
+    processor->SetPlusServer(NULL);
+    dataCollector->Stop();
+    dataCollector->Disconnect();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  std::string inputSequenceFileName;
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--input-seq-file", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputSequenceFileName, "Sequence file that is recorded in the StopRecording cancellation test (optional)");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments." << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusCommandProcessor> processor = vtkSmartPointer<vtkPlusCommandProcessor>::New();
+  processor->SetNumberOfJobWorkerThreads(1);
+  processor->SetJobProgressReportIntervalSec(0.0);
+  vtkSmartPointer<vtkPlusTestJobCommand> testCommand = vtkSmartPointer<vtkPlusTestJobCommand>::New();
+  processor->RegisterPlusCommand(testCommand);
+
+  int numberOfErrors = 0;
+  numberOfErrors += TestJobReplies(processor);
+  numberOfErrors += TestJobCancellation(processor);
+  if (!inputSequenceFileName.empty())
+  {
+    numberOfErrors += TestStopRecordingCancelledAfterWriting(processor, inputSequenceFileName);
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
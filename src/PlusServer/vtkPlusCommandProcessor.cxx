@@ -37,6 +37,8 @@ See License.txt for details.
 
 
 #include "vtkPlusAddRecordingDeviceCommand.h"
+#include "vtkPlusCancelCommand.h"
+#include "vtkPlusDumpBuffersCommand.h"
 #include "vtkPlusGenericSerialCommand.h"
 #include "vtkPlusGetFrameRateCommand.h"
 #include "vtkPlusGetPolydataCommand.h"
@@ -68,6 +70,11 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   , Mutex(vtkSmartPointer<vtkIGSIORecursiveCriticalSection>::New())
   , CommandExecutionActive(std::make_pair(false, false))
   , CommandExecutionThreadId(-1)
+  , JobWorkersActive(false)
+  , NextJobId(1)
+  , NumberOfJobWorkerThreads(2)
+  , JobProgressReportIntervalSec(1.0)
+  , LastJobProgressReportTime(0.0)
 {
   // Register default commands
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetImageCommand>::New());
@@ -83,8 +90,10 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
   RegisterPlusCommand(vtkSmartPointer<vtkPlusSetUsParameterCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetUsParameterCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusAddRecordingDeviceCommand>::New());
+  RegisterPlusCommand(vtkSmartPointer<vtkPlusCancelCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGenericSerialCommand>::New());
   RegisterPlusCommand(vtkSmartPointer<vtkPlusGetFrameRateCommand>::New());
+  RegisterPlusCommand(vtkSmartPointer<vtkPlusDumpBuffersCommand>::New());
 #ifdef PLUS_USE_CAPISTRANO_VIDEO
   RegisterPlusCommand(vtkSmartPointer<vtkPlusCapistranoCommand>::New());
 #endif
@@ -111,6 +120,8 @@ vtkPlusCommandProcessor::vtkPlusCommandProcessor()
 //----------------------------------------------------------------------------
 vtkPlusCommandProcessor::~vtkPlusCommandProcessor()
 {
+  this->StopJobWorkers();
+
   SetPlusServer(NULL);
 
   for (auto& kv : this->RegisteredCommands)
@@ -158,6 +169,8 @@ PlusStatus vtkPlusCommandProcessor::Stop()
 
   LOG_DEBUG("Command execution thread stopped");
 
+  this->StopJobWorkers();
+
   return PLUS_SUCCESS;
 }
 
@@ -190,19 +203,47 @@ void* vtkPlusCommandProcessor::CommandExecutionThread(vtkMultiThreader::ThreadIn
 //----------------------------------------------------------------------------
 int vtkPlusCommandProcessor::ExecuteCommands()
 {
+  this->ReportJobProgress();
+
   // Implemented in a while loop to not block the mutex during command execution, only during management of the queue.
   int numberOfExecutedCommands(0);
   while (1)
   {
     vtkSmartPointer<vtkPlusCommand> cmd; // next command to be processed
     {
+      std::lock_guard<std::mutex> jobLock(this->JobMutex);
       igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
-      if (this->CommandQueue.empty())
+      // Commands of a device that has a job in progress remain in the queue (in the order of arrival) until the job is finished
+      for (PlusCommandList::iterator cmdIt = this->CommandQueue.begin(); cmdIt != this->CommandQueue.end(); ++cmdIt)
+      {
+        if (!this->IsJobInProgressForDevice((*cmdIt)->GetJobDeviceId()))
+        {
+          cmd = *cmdIt;
+          this->CommandQueue.erase(cmdIt);
+          break;
+        }
+      }
+      if (cmd.GetPointer() == NULL)
       {
         return numberOfExecutedCommands;
       }
-      cmd = this->CommandQueue.front();
-      this->CommandQueue.pop_front();
+    }
+
+    if (this->NumberOfJobWorkerThreads > 0 && cmd->IsLongRunning())
+    {
+      // Hand over the command to the worker threads, so that it does not block the execution of other commands
+      this->StartJobWorkers();
+      {
+        std::lock_guard<std::mutex> jobLock(this->JobMutex);
+        cmd->SetJobId(this->NextJobId++);
+        this->JobDeviceIds[cmd->GetJobId()] = cmd->GetJobDeviceId();
+        this->PendingJobs.push_back(cmd);
+        this->QueueJobStateResponse(cmd, PLUS_SUCCESS, vtkPlusCommand::JOB_STATE_ACCEPTED, "Command accepted.");
+      }
+      LOG_DEBUG("Command " << cmd->GetName() << " is executed in the background as job " << cmd->GetJobId());
+      this->JobQueueChanged.notify_one();
+      numberOfExecutedCommands++;
+      continue;
     }
 
     LOG_DEBUG("Executing command");
@@ -224,6 +265,217 @@ int vtkPlusCommandProcessor::ExecuteCommands()
   return numberOfExecutedCommands;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::StartJobWorkers()
+{
+  std::lock_guard<std::mutex> jobLock(this->JobMutex);
+  if (this->JobWorkersActive)
+  {
+    return;
+  }
+  this->JobWorkersActive = true;
+  for (int i = 0; i < this->NumberOfJobWorkerThreads; ++i)
+  {
+    this->JobWorkerThreads.push_back(std::thread(&vtkPlusCommandProcessor::JobWorkerThread, this));
+  }
+  LOG_DEBUG("Started " << this->NumberOfJobWorkerThreads << " command job worker threads");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::StopJobWorkers()
+{
+  {
+    std::lock_guard<std::mutex> jobLock(this->JobMutex);
+    if (!this->JobWorkersActive)
+    {
+      return;
+    }
+    this->JobWorkersActive = false;
+    if (!this->PendingJobs.empty())
+    {
+      LOG_WARNING(this->PendingJobs.size() << " pending command jobs are dropped");
+      for (PlusCommandList::iterator jobIt = this->PendingJobs.begin(); jobIt != this->PendingJobs.end(); ++jobIt)
+      {
+        this->JobDeviceIds.erase((*jobIt)->GetJobId());
+      }
+      this->PendingJobs.clear();
+    }
+    for (PlusCommandList::iterator jobIt = this->RunningJobs.begin(); jobIt != this->RunningJobs.end(); ++jobIt)
+    {
+      LOG_INFO("Cancelling command job " << (*jobIt)->GetJobId() << " (" << (*jobIt)->GetName() << ")");
+      (*jobIt)->RequestCancel();
+    }
+  }
+  this->JobQueueChanged.notify_all();
+  for (std::vector<std::thread>::iterator threadIt = this->JobWorkerThreads.begin(); threadIt != this->JobWorkerThreads.end(); ++threadIt)
+  {
+    threadIt->join();
+  }
+  this->JobWorkerThreads.clear();
+  LOG_DEBUG("Command job worker threads stopped");
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::JobWorkerThread()
+{
+  while (true)
+  {
+    vtkSmartPointer<vtkPlusCommand> cmd;
+    {
+      std::unique_lock<std::mutex> jobLock(this->JobMutex);
+      this->JobQueueChanged.wait(jobLock, [this] { return !this->JobWorkersActive || !this->PendingJobs.empty(); });
+      if (!this->JobWorkersActive)
+      {
+        return;
+      }
+      cmd = this->PendingJobs.front();
+      this->PendingJobs.pop_front();
+      this->RunningJobs.push_back(cmd);
+    }
+
+    LOG_DEBUG("Executing command job " << cmd->GetJobId() << " (" << cmd->GetName() << ")");
+    if (cmd->Execute() != PLUS_SUCCESS)
+    {
+      if (cmd->IsCancelRequested())
+      {
+        LOG_INFO("Command job " << cmd->GetJobId() << " (" << cmd->GetName() << ") cancelled");
+      }
+      else
+      {
+        LOG_ERROR("Command job " << cmd->GetJobId() << " (" << cmd->GetName() << ") failed");
+      }
+    }
+
+    // Move the final responses to the processor's queue and remove the job from the running jobs
+    // at once, so that no progress reply can be queued after the final reply
+    {
+      std::lock_guard<std::mutex> jobLock(this->JobMutex);
+      {
+        igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+        cmd->PopCommandResponses(this->CommandResponseQueue);
+      }
+      this->RunningJobs.remove(cmd);
+      this->ReportedJobProgressPercent.erase(cmd->GetJobId());
+      this->JobDeviceIds.erase(cmd->GetJobId());
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusCommandProcessor::CancelJob(unsigned int jobId)
+{
+  std::lock_guard<std::mutex> jobLock(this->JobMutex);
+  for (PlusCommandList::iterator jobIt = this->PendingJobs.begin(); jobIt != this->PendingJobs.end(); ++jobIt)
+  {
+    if ((*jobIt)->GetJobId() == jobId)
+    {
+      LOG_INFO("Command job " << jobId << " (" << (*jobIt)->GetName() << ") cancelled before execution");
+      (*jobIt)->RequestCancel();
+      this->QueueJobStateResponse(*jobIt, PLUS_FAIL, vtkPlusCommand::JOB_STATE_CANCELLED, "Command cancelled before execution started.");
+      this->JobDeviceIds.erase(jobId);
+      this->PendingJobs.erase(jobIt);
+      return PLUS_SUCCESS;
+    }
+  }
+  for (PlusCommandList::iterator jobIt = this->RunningJobs.begin(); jobIt != this->RunningJobs.end(); ++jobIt)
+  {
+    if ((*jobIt)->GetJobId() == jobId)
+    {
+      LOG_INFO("Cancellation of command job " << jobId << " (" << (*jobIt)->GetName() << ") requested");
+      (*jobIt)->RequestCancel();
+      return PLUS_SUCCESS;
+    }
+  }
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusCommandProcessor::IsJobInProgressForDevice(const std::string& deviceId)
+{
+  if (deviceId.empty())
+  {
+    return false;
+  }
+  for (std::map<unsigned int, std::string>::iterator jobIt = this->JobDeviceIds.begin(); jobIt != this->JobDeviceIds.end(); ++jobIt)
+  {
+    if (jobIt->second == deviceId)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::ReportJobProgress()
+{
+  const double currentTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (currentTime - this->LastJobProgressReportTime < this->JobProgressReportIntervalSec)
+  {
+    return;
+  }
+  this->LastJobProgressReportTime = currentTime;
+
+  std::lock_guard<std::mutex> jobLock(this->JobMutex);
+  for (PlusCommandList::iterator jobIt = this->RunningJobs.begin(); jobIt != this->RunningJobs.end(); ++jobIt)
+  {
+    const double progressPercent = (*jobIt)->GetProgressPercent();
+    if (progressPercent < 0)
+    {
+      // progress is not known
+      continue;
+    }
+    std::map<unsigned int, double>::iterator reportedIt = this->ReportedJobProgressPercent.find((*jobIt)->GetJobId());
+    if (reportedIt != this->ReportedJobProgressPercent.end() && reportedIt->second == progressPercent)
+    {
+      // no change since the last report
+      continue;
+    }
+    this->ReportedJobProgressPercent[(*jobIt)->GetJobId()] = progressPercent;
+    this->QueueJobStateResponse(*jobIt, PLUS_SUCCESS, vtkPlusCommand::JOB_STATE_RUNNING, "Command in progress.");
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusCommandProcessor::QueueJobStateResponse(vtkPlusCommand* cmd, PlusStatus status, const std::string& jobState, const std::string& message)
+{
+  const bool finalResponse = (jobState != vtkPlusCommand::JOB_STATE_ACCEPTED && jobState != vtkPlusCommand::JOB_STATE_RUNNING);
+  if (!cmd->IsJobStateReplyExpected() && !finalResponse)
+  {
+    // e.g., v1/v2 clients expect exactly one reply for each command
+    return;
+  }
+
+  vtkSmartPointer<vtkPlusCommandRTSCommandResponse> response = vtkSmartPointer<vtkPlusCommandRTSCommandResponse>::New();
+  response->SetClientId(cmd->GetClientId());
+  response->SetOriginalId(cmd->GetId());
+  response->SetDeviceName(cmd->GetDeviceName());
+  response->SetCommandName(cmd->GetName());
+  response->SetStatus(status);
+  response->SetRespondWithCommandMessage(cmd->GetRespondWithCommandMessage());
+  if (status == PLUS_SUCCESS)
+  {
+    response->SetResultString(message);
+  }
+  else
+  {
+    response->SetResultString("Command failed. See error message.");
+    response->SetErrorString(message);
+  }
+
+  igtl::MessageBase::MetaDataMap parameters;
+  parameters[vtkPlusCommand::JOB_ID_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned int>(cmd->GetJobId()));
+  parameters[vtkPlusCommand::JOB_STATE_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, jobState);
+  if (cmd->GetProgressPercent() >= 0)
+  {
+    parameters[vtkPlusCommand::JOB_PROGRESS_PARAMETER_NAME] = std::make_pair(IANA_TYPE_US_ASCII, igsioCommon::ToString<double>(cmd->GetProgressPercent()));
+  }
+  response->SetParameters(parameters);
+
+  igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->Mutex);
+  this->CommandResponseQueue.push_back(response);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusCommandProcessor::RegisterPlusCommand(vtkPlusCommand* cmd)
 {
@@ -14,7 +14,12 @@
 #include "vtkPlusCommand.h"
 #include "vtkPlusCommandResponse.h"
 #include "vtkPlusOpenIGTLinkServer.h"
+
+// STL includes
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
 
 class vtkImageData;
 class vtkMatrix4x4;
@@ -24,6 +29,9 @@ class vtkMatrix4x4;
   \brief Creates a PlusCommand from a string.
   If the commands are to be executed on the main thread then call ExecuteCommands() periodically from the main thread.
   If the commands are to be executed on a separate thread (to allow background processing, but maybe requiring more synchronization) call Start() to start an internal processing thread.
+  Long-running commands (see vtkPlusCommand::IsLongRunning) are not executed by the processing thread but by a pool of worker threads
+  (jobs), so that they do not block other commands. Jobs can be cancelled by CancelJob.
+  Commands of a device that has a job in progress (see vtkPlusCommand::GetJobDeviceId) are kept in the queue until the job is finished.
   Probably one of the processing models would be enough, but at this point it's not clear which one is better.
   TODO: keep only one method and remove the other approach completely once the processing model decision is finalized.
   \ingroup PlusLibPlusServer
@@ -88,6 +96,21 @@ public:
   */
   virtual void PopCommandResponses(PlusCommandResponseList& responses);
 
+  /*!
+    Cancel a long-running command (job). If the job has not started yet then it is removed from the job queue,
+    otherwise cancellation is requested and the job stops at its next cancellation point.
+    Returns with failure if there is no pending or running job with the specified id. Can be called from any thread.
+  */
+  virtual PlusStatus CancelJob(unsigned int jobId);
+
+  /*! Number of worker threads that execute long-running commands. If 0 then long-running commands are executed as any other command. */
+  vtkSetMacro(NumberOfJobWorkerThreads, int);
+  vtkGetMacro(NumberOfJobWorkerThreads, int);
+
+  /*! Minimum time between progress replies of a running job */
+  vtkSetMacro(JobProgressReportIntervalSec, double);
+  vtkGetMacro(JobProgressReportIntervalSec, double);
+
   vtkGetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
   vtkSetObjectMacro(PlusServer, vtkPlusOpenIGTLinkServer);
 
@@ -97,6 +120,24 @@ protected:
   /*! Thread for client connection handling */
   static void* CommandExecutionThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*! Start the worker threads that execute long-running commands, if they are not running yet */
+  void StartJobWorkers();
+
+  /*! Stop the worker threads. Pending jobs are dropped, running jobs are requested to cancel and waited for. */
+  void StopJobWorkers();
+
+  /*! Execute jobs until the workers are stopped */
+  void JobWorkerThread();
+
+  /*! Queue a reply that informs the client about the state of a job. Replies are only sent to clients that use command messages, except the final reply. */
+  void QueueJobStateResponse(vtkPlusCommand* cmd, PlusStatus status, const std::string& jobState, const std::string& message);
+
+  /*! Send progress replies of running jobs (at most once in JobProgressReportIntervalSec) */
+  void ReportJobProgress();
+
+  /*! Returns true if a job of the device is pending or running. JobMutex must be locked by the caller. */
+  bool IsJobInProgressForDevice(const std::string& deviceId);
+
   vtkPlusCommandProcessor();
   virtual ~vtkPlusCommandProcessor();
 
@@ -129,6 +170,28 @@ private:
   PlusCommandList CommandQueue;
   PlusCommandResponseList CommandResponseQueue;
 
+  /*! Long-running commands that wait for a worker thread */
+  PlusCommandList PendingJobs;
+
+  /*! Long-running commands that are being executed */
+  PlusCommandList RunningJobs;
+
+  /*! Last progress value that was sent to the client for each running job */
+  std::map<unsigned int, double> ReportedJobProgressPercent;
+
+  /*! Id of the device of each pending and running job (see vtkPlusCommand::GetJobDeviceId) */
+  std::map<unsigned int, std::string> JobDeviceIds;
+
+  /*! Protects the job lists. If both JobMutex and Mutex are needed then JobMutex must be locked first. */
+  std::mutex JobMutex;
+  std::condition_variable JobQueueChanged;
+  std::vector<std::thread> JobWorkerThreads;
+  bool JobWorkersActive;
+  unsigned int NextJobId;
+  int NumberOfJobWorkerThreads;
+  double JobProgressReportIntervalSec;
+  double LastJobProgressReportTime;
+
   vtkPlusCommandProcessor(const vtkPlusCommandProcessor&);  // Not implemented.
   void operator=(const vtkPlusCommandProcessor&);  // Not implemented.
 };
@@ -107,6 +107,7 @@ vtkPlusOpenIGTLinkServer::vtkPlusOpenIGTLinkServer()
   , MissingInputGracePeriodSec(0.0)
   , BroadcastStartTime(0.0)
   , NewClientConnected(false)
+  , ClientSubscriptionsChanged(true)
 {
 
 }
@@ -260,6 +261,7 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
       ClientData newClient;
       self->IgtlClients.push_back(newClient);
       self->NewClientConnected = true;
+      self->ClientSubscriptionsChanged = true;
 
       ClientData* client = &(self->IgtlClients.back());   // get a reference to the client data that is stored in the list
       client->ClientId = self->ClientIdCounter;
@@ -632,6 +634,7 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
         // Message received from client, need to lock to modify client info
         igsioLockGuard<vtkIGSIORecursiveCriticalSection> igtlClientsMutexGuardedLock(self->IgtlClientsMutex);
         client->ClientInfo = clientInfoMsg->GetClientInfo();
+        self->ClientSubscriptionsChanged = true;
         LOG_DEBUG("Client info message received from client " << clientId);
       }
     }
@@ -1055,6 +1058,20 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
     }
     this->NewClientConnected = false;
 
+    // Collect the transforms that the clients need only when the subscriptions change
+    if (this->ClientSubscriptionsChanged)
+    {
+      this->TransformTable.Clear();
+      for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
+      {
+        this->TransformTable.AddRequestedTransforms(clientIterator->ClientInfo);
+      }
+      this->ClientSubscriptionsChanged = false;
+    }
+
+    // Compute each requested transform once for this frame, all clients are served from the table
+    this->TransformTable.Update(this->TransformRepository);
+
     for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
     {
       igtl::ClientSocket::Pointer clientSocket = (*clientIterator).ClientSocket;
@@ -1063,7 +1080,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
       std::vector<igtl::MessageBase::Pointer> igtlMessages;
       std::vector<igtl::MessageBase::Pointer>::iterator igtlMessageIterator;
 
-      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientId, clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformRepository) != PLUS_SUCCESS)
+      if (this->IgtlMessageFactory->PackMessages(clientIterator->ClientId, clientIterator->ClientInfo, igtlMessages, trackedFrame, this->SendValidTransformsOnly, this->TransformTable) != PLUS_SUCCESS)
       {
         LOG_WARNING("Failed to pack all IGT messages");
       }
@@ -1186,6 +1203,7 @@ void vtkPlusOpenIGTLinkServer::DisconnectClient(int clientId)
         clientIterator->ClientSocket->CloseSocket();
       }
       this->IgtlClients.erase(clientIterator);
+      this->ClientSubscriptionsChanged = true;
       break;
     }
   }
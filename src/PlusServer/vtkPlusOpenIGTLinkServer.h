@@ -10,6 +10,7 @@
 // Local includes
 #include "vtkPlusServerExport.h"
 #include "PlusIgtlClientInfo.h"
+#include "PlusIgtlTransformTable.h"
 #include "vtkPlusDataCollector.h"
 #include "vtkPlusIgtlMessageFactory.h"
 #include "vtkIGSIOTransformRepository.h"
@@ -334,6 +335,15 @@ private:
   static const float CLIENT_SOCKET_TIMEOUT_SEC;
 
   bool NewClientConnected;
+
+  /*! Set if the transforms requested by the clients may have changed (client connected, disconnected or sent new client info) */
+  bool ClientSubscriptionsChanged;
+
+  /*!
+    Transforms requested by the connected clients, computed once for each broadcast frame and shared by all clients.
+    Only accessed by the data sender thread, while IgtlClientsMutex is locked.
+  */
+  PlusIgtlTransformTable TransformTable;
 };
 
 #endif
\ No newline at end of file
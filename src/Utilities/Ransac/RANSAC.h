@@ -5,9 +5,11 @@
 #include "ParametersEstimator.h"
 
 // STL includes
+#include <atomic>
 #include <set>
 #include <vector>
 #include <limits>
+#include <random>
 
 // OS includes
 #include <stdlib.h>
@@ -46,6 +48,14 @@
  *
  * Hartely R., Zisserman A., "Multiple View Geometry in Computer Vision", 2001.
  *
+ * The number of hypotheses is adapted to the largest consensus set found so
+ * far. Each thread keeps its own best hypothesis, these are merged when all
+ * threads are finished. Optionally, hypotheses are rejected early using the
+ * T(d,d) pre-test, in which the hypothesis is only scored against all the data
+ * if d randomly selected data objects agree with it:
+ * Matas J., Chum O., "Randomized RANSAC with T(d,d) test",
+ * Image and Vision Computing, Vol. 22(10), 2004.
+ *
  * The class template parameters are T - objects used for the parameter estimation
  *                                      (e.g. Point2D in line estimation,
  *                                            std::pair<Point2D,Point2D> in
@@ -82,6 +92,33 @@ namespace itk
     void SetNumberOfThreads(unsigned int numberOfThreads);
     unsigned int GetNumberOfThreads();
 
+    /**
+     * Set/Get the number of data objects used in the T(d,d) pre-test of the
+     * hypotheses. A hypothesis is scored against all the data only if all
+     * the pre-test objects agree with it. The number of hypotheses is
+     * increased accordingly, so that the probability of finding an outlier
+     * free subset is not changed. The pre-test is not used if it would
+     * require more hypotheses than the number of all possible subsets.
+     *
+     * @param numberOfPreTestObjects Number of data objects in the pre-test,
+     *                               0 disables the pre-test. Default is 0.
+     *                               The pre-test changes which hypotheses
+     *                               are scored, so results of a given seed
+     *                               differ from the results without it.
+     */
+    void SetNumberOfPreTestObjects(unsigned int numberOfPreTestObjects);
+    unsigned int GetNumberOfPreTestObjects();
+
+    /**
+     * Set the seed of the random number generators. By default the generators
+     * are seeded with the current time in each call of Compute. With a fixed
+     * seed and a single thread the result of Compute is reproducible.
+     *
+     * @param randomSeed Seed of the random number generators, each thread uses
+     *                   randomSeed+threadId.
+     */
+    void SetRandomSeed(unsigned int randomSeed);
+
     /**
      * Set the function object that is able to estimate the desired parametric
      * entity (e.g. PlaneParametersEstimator).
@@ -121,7 +158,8 @@ namespace itk
 
     /**
      * Construct an instance of the RANSAC algorithm. The number of threads used
-     * in the computation is 1, valid values are in [1, #cores].
+     * in the computation is 1, valid values are in [1, #cores]. The pre-test is
+     * disabled (0 pre-test objects).
      *
      */
     RANSAC();
@@ -138,6 +176,13 @@ namespace itk
      */
     unsigned int Choose(unsigned int n, unsigned int m);
 
+    /**
+     * Update the number of hypotheses (and whether the pre-test is used) based
+     * on the size of the largest consensus set found so far. Must be called
+     * while holding resultsMutex.
+     */
+    void UpdateNumberOfTries(unsigned int numVotes);
+
     class SubSetIndexComparator
     {
     private:
@@ -170,24 +215,42 @@ namespace itk
     //number of threads used in computing the RANSAC hypotheses
     unsigned int numberOfThreads;
 
+    //number of data objects used in the T(d,d) pre-test
+    unsigned int numberOfPreTestObjects;
+
     //the following variables are shared by all threads used in the RANSAC
     //computation
 
     //array corresponding to length of data array, data[i]== true if it
-    //agrees with the best model, otherwise false
+    //agrees with the best model, otherwise false. Each thread keeps its own
+    //best model, the best of these is copied here when the thread finishes.
     bool* bestVotes;
     unsigned int numVotesForBest;
 
+    //size of the largest consensus set found so far by any of the threads,
+    //used for adapting the number of hypotheses and for stopping the scoring
+    //of hypotheses that cannot have a larger consensus set
+    std::atomic<unsigned int> numVotesForBestSoFar;
+
     std::vector<T> data;
 
     //set which holds all of the subgroups/hypotheses already selected
     std::set<int*, SubSetIndexComparator >* chosenSubSets;
     //number of iterations, equivalent to desired number of hypotheses
-    unsigned int numTries;
+    std::atomic<unsigned int> numTries;
+    //number of hypotheses generated so far by all threads
+    std::atomic<unsigned int> numTriesSoFar;
+    //true if hypotheses are pre-tested before scoring them against all the data
+    std::atomic<bool> usePreTest;
 
     double numerator;
     unsigned int allTries;
 
+    //seed of the random number generators, each thread uses seed+threadId
+    unsigned int randomSeed;
+    //if false then the random number generators are seeded with the current time
+    bool useFixedRandomSeed;
+
     typename ParametersEstimator<T, S>::Pointer paramEstimator;
 
 #if ITK_VERSION_MAJOR >= 5
@@ -1,12 +1,17 @@
 #ifndef _RANSAC_TXX_
 #define _RANSAC_TXX_
 
+#include <algorithm>
+
 namespace itk
 {
   template<class T, class S>
   RANSAC<T, S>::RANSAC()
   {
     this->numberOfThreads = 1;
+    this->numberOfPreTestObjects = 0;
+    this->randomSeed = 0;
+    this->useFixedRandomSeed = false;
   }
 
 
@@ -40,6 +45,28 @@ namespace itk
   }
 
 
+  template<class T, class S>
+  void RANSAC<T, S>::SetNumberOfPreTestObjects(unsigned int numberOfPreTestObjects)
+  {
+    this->numberOfPreTestObjects = numberOfPreTestObjects;
+  }
+
+
+  template<class T, class S>
+  unsigned int RANSAC<T, S>::GetNumberOfPreTestObjects()
+  {
+    return this->numberOfPreTestObjects;
+  }
+
+
+  template<class T, class S>
+  void RANSAC<T, S>::SetRandomSeed(unsigned int randomSeed)
+  {
+    this->randomSeed = randomSeed;
+    this->useFixedRandomSeed = true;
+  }
+
+
   template<class T, class S>
   void RANSAC<T, S>::SetParametersEstimator(typename ParametersEstimator<T, S>::Pointer paramEstimator)
   {
@@ -91,17 +118,23 @@ namespace itk
     //initalize with 0 so that the first computation which gives
     //any type of fit will be set to best
     this->numVotesForBest = 0;
+    this->numVotesForBestSoFar = 0;
 
     SubSetIndexComparator subSetIndexComparator(numForEstimate);
     this->chosenSubSets =
       new std::set<int*, SubSetIndexComparator >(subSetIndexComparator);
-    //initialize with the number of all possible subsets
+    //initialize with the number of all possible subsets, the pre-test is
+    //only used when the number of hypotheses is estimated from a consensus set
     this->allTries = Choose(numDataObjects, numForEstimate);
     this->numTries = this->allTries;
+    this->numTriesSoFar = 0;
+    this->usePreTest = false;
     this->numerator = log(1.0 - desiredProbabilityForNoOutliers);
 
-
-    srand((unsigned)time(NULL));   //seed random number generator
+    if (!this->useFixedRandomSeed)
+    {
+      this->randomSeed = (unsigned)time(NULL);   //seed random number generators
+    }
 
     //STEP2: create the threads that generate hypotheses and test
 
@@ -165,59 +198,54 @@ namespace itk
 
     if (caller != NULL)
     {
-      unsigned int maxIndex, numVotesForCur;
+      unsigned int numVotesForCur;
       int* curSubSetIndexes(NULL);
 
       unsigned int numDataObjects = caller->data.size();
       unsigned int numForEstimate = caller->paramEstimator->GetMinimalForEstimate();
       std::vector<T*> exactEstimateData;
       std::vector<S> exactEstimateParameters;
-      double denominator;
+
+      //each thread uses its own random number generator, rand() is not
+      //thread safe
+#if ITK_VERSION_MAJOR >= 5
+      unsigned int threadId = infoStruct->WorkUnitID;
+#else
+      unsigned int threadId = infoStruct->ThreadID;
+#endif
+      std::mt19937 randomGenerator(caller->randomSeed + threadId);
+      std::uniform_int_distribution<unsigned int> randomDataIndex(0, numDataObjects - 1);
 
       //true if data[i] agrees with the current model, otherwise false
       bool* curVotes = new bool[numDataObjects];
 
-      //true if data[i] is NOT chosen for computing the exact fit, otherwise false
-      bool* notChosen = new bool[numDataObjects];
+      //best model found by this thread
+      bool* threadBestVotes = new bool[numDataObjects];
+      unsigned int threadNumVotesForBest = 0;
 
-      for (unsigned int i = 0; i < caller->numTries; i++)
+      while (caller->numTriesSoFar++ < caller->numTries)
       {
-        //randomly select data for exact model fit ('numForEstimate' objects).
-        std::fill(notChosen, notChosen + numDataObjects, true);
+        //randomly select data for exact model fit ('numForEstimate' distinct objects),
+        //the indexes of the chosen objects are stored in increasing order so
+        //that we can check that this sub-set hasn't been chosen already
         curSubSetIndexes = new int[numForEstimate];
-        exactEstimateData.clear();
-        maxIndex = numDataObjects - 1;
-
         for (unsigned int l = 0; l < numForEstimate; l++)
         {
-          //selectedIndex is in [0,maxIndex]
-          int selectedIndex = (int)(((float)rand() / (float)RAND_MAX) * maxIndex + 0.5);
-          unsigned int k(0);
-          int j(-1);
-          for (; k < numDataObjects && j < selectedIndex; k++)
+          int selectedIndex;
+          int* insertPosition;
+          do
           {
-            if (notChosen[k])
-            {
-              j++;
-            }
+            selectedIndex = randomDataIndex(randomGenerator) + 1;
+            insertPosition = std::lower_bound(curSubSetIndexes, curSubSetIndexes + l, selectedIndex);
           }
-          k--;
-          exactEstimateData.push_back(&(caller->data[k]));
-          notChosen[k] = false;
-          maxIndex--;
+          while (insertPosition != curSubSetIndexes + l && *insertPosition == selectedIndex);
+          std::copy_backward(insertPosition, curSubSetIndexes + l, curSubSetIndexes + l + 1);
+          *insertPosition = selectedIndex;
         }
-
-        //get the indexes of the chosen objects so we can check that
-        //this sub-set hasn't been chosen already
-        unsigned int m(0);
-        unsigned int l(0);
-        for (; m < numDataObjects; m++)
+        exactEstimateData.clear();
+        for (unsigned int l = 0; l < numForEstimate; l++)
         {
-          if (!notChosen[m])
-          {
-            curSubSetIndexes[l] = m + 1;
-            l++;
-          }
+          exactEstimateData.push_back(&(caller->data[curSubSetIndexes[l] - 1]));
         }
 
         std::pair< typename std::set<int*, SubSetIndexComparator >::iterator, bool> res;
@@ -235,80 +263,106 @@ namespace itk
         caller->hypothesisMutex.Unlock();
 #endif
 
-        if (res.second == true)
+        if (res.second == false)
         {
-          //first time we chose this sub set
-          //use the selected data for an exact model parameter fit
-          caller->paramEstimator->Estimate(exactEstimateData,
-                                           exactEstimateParameters);
-
-          //selected data is a singular configuration (e.g. three
-          //colinear points for a circle fit)
-          if (exactEstimateParameters.size() == 0)
-          {
-            continue;
-          }
+          //this sub set already appeared, release memory
+          delete [] curSubSetIndexes;
+          continue;
+        }
 
-          //see how many agree on this estimate
-          numVotesForCur = 0;
-          std::fill(curVotes, curVotes + numDataObjects, false);
+        //first time we chose this sub set
+        //use the selected data for an exact model parameter fit
+        caller->paramEstimator->Estimate(exactEstimateData,
+                                         exactEstimateParameters);
 
-          //continue checking data until there is no chance of getting a larger consensus set
-          //or all the data has been checked
-          for (m = 0; m < numDataObjects && caller->numVotesForBest - numVotesForCur < numDataObjects - m + 1; m++)
-          {
-            if (caller->paramEstimator->Agree(exactEstimateParameters, caller->data[m]))
-            {
-              curVotes[m] = true;
-              numVotesForCur++;
-            }
-          } //found a larger consensus set?
+        //selected data is a singular configuration (e.g. three
+        //colinear points for a circle fit)
+        if (exactEstimateParameters.size() == 0)
+        {
+          continue;
+        }
 
-#if ITK_VERSION_MAJOR >= 5
-          caller->resultsMutex.lock();
-#else
-          caller->resultsMutex.Lock();
-#endif
-          if (numVotesForCur > caller->numVotesForBest)
+        //T(d,d) pre-test: reject the hypothesis if any of the randomly
+        //selected data objects (that are not in the sub-set) disagrees with it
+        if (caller->usePreTest)
+        {
+          bool preTestPassed = true;
+          for (unsigned int l = 0; l < caller->numberOfPreTestObjects && preTestPassed; l++)
           {
-            caller->numVotesForBest = numVotesForCur;
-            for (unsigned int objIndex = 0; objIndex < numDataObjects; ++objIndex)
+            int selectedIndex;
+            do
             {
-              caller->bestVotes[objIndex] = curVotes[objIndex];
+              selectedIndex = randomDataIndex(randomGenerator) + 1;
             }
-            //std::copy( curVotes, curVotes+numDataObjects, caller->bestVotes );
+            while (std::binary_search(curSubSetIndexes, curSubSetIndexes + numForEstimate, selectedIndex));
+            preTestPassed = caller->paramEstimator->Agree(exactEstimateParameters, caller->data[selectedIndex - 1]);
+          }
+          if (!preTestPassed)
+          {
+            continue;
+          }
+        }
 
-            //all data objects are inliers, terminate the search
-            if (caller->numVotesForBest == numDataObjects)
-            {
-              i = caller->numTries;
-            }
-            else
-            {
-              //update the estimate of outliers and the number of iterations we need
-              denominator = log(1.0 - pow((double)numVotesForCur / (double)numDataObjects,
-                                          (double)(numForEstimate)));
-              caller->numTries = (int)(caller->numerator / denominator + 0.5);
+        //see how many agree on this estimate
+        numVotesForCur = 0;
+        std::fill(curVotes, curVotes + numDataObjects, false);
 
-              //there are cases when the probablistic number of tries is greater than all possible sub-sets
-              caller->numTries = caller->numTries < caller->allTries ? caller->numTries : caller->allTries;
-            }
+        //continue checking data until there is no chance of getting a larger consensus set
+        //or all the data has been checked
+        unsigned int numVotesForBestSoFar = caller->numVotesForBestSoFar;
+        for (unsigned int m = 0; m < numDataObjects && numVotesForCur + (numDataObjects - m) > numVotesForBestSoFar; m++)
+        {
+          if (caller->paramEstimator->Agree(exactEstimateParameters, caller->data[m]))
+          {
+            curVotes[m] = true;
+            numVotesForCur++;
           }
+        }
+
+        //found a larger consensus set?
+        if (numVotesForCur <= threadNumVotesForBest || numVotesForCur <= numVotesForBestSoFar)
+        {
+          continue;
+        }
+        threadNumVotesForBest = numVotesForCur;
+        std::copy(curVotes, curVotes + numDataObjects, threadBestVotes);
+
 #if ITK_VERSION_MAJOR >= 5
-          caller->resultsMutex.unlock();
+        caller->resultsMutex.lock();
 #else
-          caller->resultsMutex.Unlock();
+        caller->resultsMutex.Lock();
 #endif
-
-        }
-        else
+        if (numVotesForCur > caller->numVotesForBestSoFar)
         {
-          //this sub set already appeared, release memory
-          delete [] curSubSetIndexes;
+          caller->numVotesForBestSoFar = numVotesForCur;
+          caller->UpdateNumberOfTries(numVotesForCur);
         }
+#if ITK_VERSION_MAJOR >= 5
+        caller->resultsMutex.unlock();
+#else
+        caller->resultsMutex.Unlock();
+#endif
       }
+
+      //merge the best model of this thread into the overall best model
+#if ITK_VERSION_MAJOR >= 5
+      caller->resultsMutex.lock();
+#else
+      caller->resultsMutex.Lock();
+#endif
+      if (threadNumVotesForBest > caller->numVotesForBest)
+      {
+        caller->numVotesForBest = threadNumVotesForBest;
+        std::copy(threadBestVotes, threadBestVotes + numDataObjects, caller->bestVotes);
+      }
+#if ITK_VERSION_MAJOR >= 5
+      caller->resultsMutex.unlock();
+#else
+      caller->resultsMutex.Unlock();
+#endif
+
       delete [] curVotes;
-      delete [] notChosen;
+      delete [] threadBestVotes;
     }
 #if ITK_VERSION_MAJOR >= 5
     return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -319,6 +373,49 @@ namespace itk
 
   /*****************************************************************************/
 
+  template<class T, class S>
+  void RANSAC<T, S>::UpdateNumberOfTries(unsigned int numVotes)
+  {
+    unsigned int numDataObjects = this->data.size();
+    //all data objects are inliers, terminate the search
+    if (numVotes == numDataObjects)
+    {
+      this->numTries = 0;
+      return;
+    }
+
+    //update the estimate of outliers and the number of iterations we need.
+    //A hypothesis is accepted if the 'numForEstimate' objects of the sub-set
+    //and the pre-test objects are all inliers.
+    double inlierRatio = (double)numVotes / (double)numDataObjects;
+    double numForEstimate = this->paramEstimator->GetMinimalForEstimate();
+    //there are cases when the probablistic number of tries is greater than all possible sub-sets
+    //(the denominator is 0 if the probability of choosing an outlier free sub-set is negligible)
+    if (this->numberOfPreTestObjects > 0)
+    {
+      //the pre-test is only used if all possible sub-sets don't have to be tried
+      double denominator = log(1.0 - pow(inlierRatio, numForEstimate + this->numberOfPreTestObjects));
+      if (denominator < 0.0 && this->numerator / denominator + 0.5 < this->allTries)
+      {
+        this->numTries = (unsigned int)(this->numerator / denominator + 0.5);
+        this->usePreTest = true;
+        return;
+      }
+    }
+    double denominator = log(1.0 - pow(inlierRatio, numForEstimate));
+    if (denominator < 0.0 && this->numerator / denominator + 0.5 < this->allTries)
+    {
+      this->numTries = (unsigned int)(this->numerator / denominator + 0.5);
+    }
+    else
+    {
+      this->numTries = this->allTries;
+    }
+    this->usePreTest = false;
+  }
+
+  /*****************************************************************************/
+
   template<class T, class S>
   unsigned int RANSAC<T, S>::Choose(unsigned int n, unsigned int m)
   {
@@ -0,0 +1,274 @@
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <itkPoint.h>
+#include <itkTimeProbe.h>
+#include "RANSAC.h"
+#include "RandomNumberGenerator.h"
+#include "PlaneParametersEstimator.h"
+#include "SphereParametersEstimator.h"
+
+const unsigned int DIMENSION = 3;
+typedef itk::Point<double, DIMENSION> PointType;
+typedef itk::RANSAC<PointType, double> RANSACType;
+
+/**
+ * Generate points on a plane with additive zero mean Gaussian noise and
+ * outliers (points that are further than outlierDistance from the plane).
+ * @param planeParameters [n,a], plane normal and point on plane.
+ */
+void GeneratePlaneData( unsigned int numInliers, unsigned int numOutliers,
+                        double outlierDistance, RandomNumberGenerator &random,
+                        std::vector<PointType> &data,
+                        std::vector<double> &planeParameters );
+
+/**
+ * Generate points on a sphere with additive zero mean Gaussian noise and
+ * outliers (points that are further than outlierDistance from the sphere).
+ * @param sphereParameters [c,r], sphere center and radius.
+ */
+void GenerateSphereData( unsigned int numInliers, unsigned int numOutliers,
+                         double outlierDistance, RandomNumberGenerator &random,
+                         std::vector<PointType> &data,
+                         std::vector<double> &sphereParameters );
+
+/**
+ * Run the RANSAC estimation and print the computation time.
+ * @return Percentage of data used in the least squares estimate.
+ */
+double RunRANSAC( const std::string &title,
+                  itk::ParametersEstimator<PointType, double>::Pointer estimator,
+                  std::vector<PointType> &data, unsigned int numberOfThreads,
+                  unsigned int numberOfPreTestObjects,
+                  std::vector<double> &parameters );
+
+/*
+ * Benchmark of the RANSAC plane and sphere estimation on large point clouds,
+ * with and without the T(d,d) pre-test, using one and all threads. The
+ * estimates are compared to the known plane and sphere. Optional arguments:
+ * number of inliers and number of outliers (default: 70000 and 30000).
+ */
+int main( int argc, char *argv[] )
+{
+  unsigned int numInliers = 70000;
+  unsigned int numOutliers = 30000;
+  if( argc > 1 )
+    numInliers = atoi( argv[1] );
+  if( argc > 2 )
+    numOutliers = atoi( argv[2] );
+
+  const double outlierDistance = 20.0;
+  const double maximalDistance = 1.0;
+  //the noise standard deviation is 0.2, so almost all inliers agree with the true model
+  const double minPercentageOfDataUsed = 0.95 * numInliers / ( numInliers + numOutliers );
+  RandomNumberGenerator random( 12345 );
+  bool succeeded = true;
+  unsigned int i;
+
+#if ITK_VERSION_MAJOR >= 5
+  unsigned int maxNumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+#else
+  unsigned int maxNumberOfThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+#endif
+  const unsigned int numberOfThreads[] = { 1, maxNumberOfThreads };
+  const unsigned int numberOfPreTestObjects[] = { 0, 1 };
+
+  std::cout<<"Points: "<<numInliers<<" inliers, "<<numOutliers<<" outliers\n\n";
+
+                       //plane estimation
+  std::vector<PointType> planeData;
+  std::vector<double> truePlaneParameters, planeParameters;
+  GeneratePlaneData( numInliers, numOutliers, outlierDistance, random,
+                     planeData, truePlaneParameters );
+  auto planeEstimator = itk::PlaneParametersEstimator<DIMENSION>::New();
+  planeEstimator->SetDelta( maximalDistance );
+  for( unsigned int t=0; t<2; t++ ) {
+    for( unsigned int p=0; p<2; p++ ) {
+      double percentageOfDataUsed =
+        RunRANSAC( "Plane", planeEstimator.GetPointer(), planeData,
+                   numberOfThreads[t], numberOfPreTestObjects[p], planeParameters );
+      if( planeParameters.empty() ) {
+        std::cerr<<"RANSAC plane estimate failed\n";
+        succeeded = false;
+        continue;
+      }
+                //cos(theta), theta is the angle between the two unit normals
+      double dotProduct = 0.0;
+      for( i=0; i<DIMENSION; i++ )
+        dotProduct+= planeParameters[i]*truePlaneParameters[i];
+                //distance of the estimated point on plane from the known plane
+      double distance = 0.0;
+      for( i=0; i<DIMENSION; i++ )
+        distance+= ( planeParameters[DIMENSION+i] -
+                     truePlaneParameters[DIMENSION+i] )*truePlaneParameters[i];
+      if( fabs( dotProduct ) < 0.9999 || fabs( distance ) > maximalDistance ||
+          percentageOfDataUsed < minPercentageOfDataUsed ) {
+        std::cerr<<"Plane estimate is inaccurate: dot product of normals = "
+                 <<dotProduct<<", distance = "<<distance
+                 <<", percentage of data used = "<<percentageOfDataUsed<<"\n";
+        succeeded = false;
+      }
+    }
+  }
+
+                       //sphere estimation
+  std::vector<PointType> sphereData;
+  std::vector<double> trueSphereParameters, sphereParameters;
+  GenerateSphereData( numInliers, numOutliers, outlierDistance, random,
+                      sphereData, trueSphereParameters );
+  auto sphereEstimator = itk::SphereParametersEstimator<DIMENSION>::New();
+  sphereEstimator->SetDelta( maximalDistance );
+  for( unsigned int t=0; t<2; t++ ) {
+    for( unsigned int p=0; p<2; p++ ) {
+      double percentageOfDataUsed =
+        RunRANSAC( "Sphere", sphereEstimator.GetPointer(), sphereData,
+                   numberOfThreads[t], numberOfPreTestObjects[p], sphereParameters );
+      if( sphereParameters.empty() ) {
+        std::cerr<<"RANSAC sphere estimate failed\n";
+        succeeded = false;
+        continue;
+      }
+      double centerDistance = 0.0;
+      for( i=0; i<DIMENSION; i++ )
+        centerDistance+= ( sphereParameters[i] - trueSphereParameters[i] ) *
+                         ( sphereParameters[i] - trueSphereParameters[i] );
+      centerDistance = sqrt( centerDistance );
+      double radiusDifference = fabs( sphereParameters[DIMENSION] -
+                                      trueSphereParameters[DIMENSION] );
+      if( centerDistance > maximalDistance || radiusDifference > maximalDistance ||
+          percentageOfDataUsed < minPercentageOfDataUsed ) {
+        std::cerr<<"Sphere estimate is inaccurate: center distance = "
+                 <<centerDistance<<", radius difference = "<<radiusDifference
+                 <<", percentage of data used = "<<percentageOfDataUsed<<"\n";
+        succeeded = false;
+      }
+    }
+  }
+
+  if( !succeeded ) {
+    std::cerr<<"Test failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout<<"Test completed successfully\n";
+  return EXIT_SUCCESS;
+}
+
+
+double RunRANSAC( const std::string &title,
+                  itk::ParametersEstimator<PointType, double>::Pointer estimator,
+                  std::vector<PointType> &data, unsigned int numberOfThreads,
+                  unsigned int numberOfPreTestObjects,
+                  std::vector<double> &parameters )
+{
+  const double desiredProbabilityForNoOutliers = 0.999;
+  auto ransacEstimator = RANSACType::New();
+  ransacEstimator->SetData( data );
+  ransacEstimator->SetParametersEstimator( estimator );
+  ransacEstimator->SetNumberOfThreads( numberOfThreads );
+  ransacEstimator->SetNumberOfPreTestObjects( numberOfPreTestObjects );
+
+  itk::TimeProbe timer;
+  timer.Start();
+  double percentageOfDataUsed =
+    ransacEstimator->Compute( parameters, desiredProbabilityForNoOutliers );
+  timer.Stop();
+
+  std::cout<<title<<" estimation ("<<numberOfThreads<<" threads, "
+           <<numberOfPreTestObjects<<" pre-test objects): "
+           <<timer.GetTotal()*1000.0<<" ms, percentage of data used: "
+           <<percentageOfDataUsed<<"\n";
+  return percentageOfDataUsed;
+}
+
+
+void GeneratePlaneData( unsigned int numInliers, unsigned int numOutliers,
+                        double outlierDistance, RandomNumberGenerator &random,
+                        std::vector<PointType> &data,
+                        std::vector<double> &planeParameters )
+{
+  itk::Vector<double, DIMENSION> normal, noise, tmp;
+  PointType pointOnPlane, randomPoint;
+  double noiseStandardDeviation = 0.2;
+  double coordinateMax = 1000.0;
+  unsigned int i, j;
+
+  planeParameters.clear();
+  for( i=0; i<DIMENSION; i++ ) {
+    normal[i] = random.uniform();
+    pointOnPlane[i] = random.uniform( -coordinateMax, coordinateMax );
+  }
+  normal.Normalize();
+  for( i=0; i<DIMENSION; i++ )
+    planeParameters.push_back( normal[i] );
+  for( i=0; i<DIMENSION; i++ )
+    planeParameters.push_back( pointOnPlane[i] );
+
+               //generate inliers
+  for( i=0; i<numInliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      randomPoint[j] = random.uniform( -coordinateMax, coordinateMax );
+      noise[j] = random.normal( noiseStandardDeviation );
+    }
+            //project random point onto the plane and add noise
+    tmp = randomPoint - pointOnPlane;
+    randomPoint = pointOnPlane + noise + (tmp - (tmp*normal)*normal);
+    data.push_back( randomPoint );
+  }
+           //generate outliers (via rejection)
+  for( i=0; i<numOutliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      randomPoint[j] = random.uniform( -coordinateMax, coordinateMax );
+    }
+    tmp = randomPoint - pointOnPlane;
+    if( fabs(tmp*normal)>= outlierDistance )
+      data.push_back( randomPoint );
+    else
+      i--;
+  }
+}
+
+
+void GenerateSphereData( unsigned int numInliers, unsigned int numOutliers,
+                         double outlierDistance, RandomNumberGenerator &random,
+                         std::vector<PointType> &data,
+                         std::vector<double> &sphereParameters )
+{
+  itk::Vector<double, DIMENSION> tmp, noise;
+  PointType sphereCenter, randomPoint;
+  double noiseStandardDeviation = 0.2;
+  double coordinateMax = 1000.0;
+  unsigned int i, j;
+
+  sphereParameters.clear();
+  for( i=0; i<DIMENSION; i++ ) {
+    sphereCenter[i] = random.uniform( -coordinateMax, coordinateMax );
+  }
+  double sphereRadius = random.uniform( 0.1*coordinateMax, coordinateMax );
+  for( i=0; i<DIMENSION; i++ )
+    sphereParameters.push_back( sphereCenter[i] );
+  sphereParameters.push_back( sphereRadius );
+
+               //generate inliers
+  for( i=0; i<numInliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      tmp[j] = random.uniform( -1.0, 1.0 );
+      noise[j] = random.normal( noiseStandardDeviation );
+    }
+            //project random point onto the sphere and add noise
+    tmp.Normalize();
+    randomPoint = sphereCenter + noise + tmp*sphereRadius;
+    data.push_back( randomPoint );
+  }
+           //generate outliers (via rejection)
+  for( i=0; i<numOutliers; i++ ) {
+    for( j=0; j<DIMENSION; j++ ) {
+      randomPoint[j] = sphereCenter[j] + random.uniform( -2.0*sphereRadius, 2.0*sphereRadius );
+    }
+    tmp = randomPoint - sphereCenter;
+    if( fabs( tmp.GetNorm() - sphereRadius ) >= outlierDistance )
+      data.push_back( randomPoint );
+    else
+      i--;
+  }
+}